@@ -5,7 +5,8 @@ import path from 'path';
 
 // Create require for native module loading
 const require = createRequire(import.meta.url);
-const NativeProvider = require('./build/Release/ifsprojfs.node').IFSProjFSProvider;
+const nativeModule = require('./build/Release/ifsprojfs.node');
+const NativeProvider = nativeModule.IFSProjFSProvider;
 
 // File logging - use a fixed path that works in both webpack and direct node contexts
 const LOG_FILE = 'C:\\Users\\juerg\\source\\one.filer.windows\\projfs-operations.log';
@@ -45,7 +46,96 @@ function log(message) {
 // Global state
 const enumerationCount = { count: 0 };
 
+// Timestamps cross to native code as milliseconds since the epoch; 0 is unknown
+function toMillis(time) {
+    const millis = time instanceof Date ? time.getTime() : Number(time);
+    return Number.isFinite(millis) && millis > 0 ? Math.floor(millis) : 0;
+}
+
+// Packed layout read by the native setCachedTree (see src/tree_batch.h)
+const TREE_MAGIC = 0x32544A50; // "PJT2"
+const TREE_HEADER_SIZE = 16;
+const TREE_DIRECTORY_SIZE = 16;
+const TREE_ENTRY_SIZE = 40;
+const TREE_FLAG_DIRECTORY = 1;
+const TREE_FLAG_BLOB_OR_CLOB = 2;
+
+/**
+ * Encode directory listings ([{ path, entries }]) into one buffer so the native
+ * side stores them without walking a JS object per field per entry.
+ */
+function encodeCachedTree(directories) {
+    const encoder = new TextEncoder();
+    const strings = [];
+    let stringBytes = 0;
+    const addString = (value) => {
+        const bytes = encoder.encode(value || '');
+        const offset = stringBytes;
+        strings.push(bytes);
+        stringBytes += bytes.length;
+        return [offset, bytes.length];
+    };
+
+    let entryCount = 0;
+    for (const directory of directories) {
+        entryCount += directory.entries.length;
+    }
+
+    const directoryRecords = [];
+    const entryRecords = [];
+    for (const directory of directories) {
+        directoryRecords.push([...addString(directory.path), entryRecords.length, directory.entries.length]);
+        for (const entry of directory.entries) {
+            const size = entry.size || 0;
+            const mtime = entry.mtime || 0;
+            const flags = (entry.isDirectory ? TREE_FLAG_DIRECTORY : 0) |
+                          (entry.isBlobOrClob ? TREE_FLAG_BLOB_OR_CLOB : 0);
+            entryRecords.push([
+                ...addString(entry.name),
+                ...addString(entry.hash),
+                size >>> 0,
+                Math.floor(size / 0x100000000),
+                entry.mode || 0,
+                flags,
+                mtime >>> 0,
+                Math.floor(mtime / 0x100000000)
+            ]);
+        }
+    }
+
+    const stringsStart = TREE_HEADER_SIZE + directoryRecords.length * TREE_DIRECTORY_SIZE + entryCount * TREE_ENTRY_SIZE;
+    const bytes = new Uint8Array(stringsStart + stringBytes);
+    const view = new DataView(bytes.buffer);
+
+    let offset = 0;
+    for (const value of [TREE_MAGIC, directoryRecords.length, entryCount, stringBytes]) {
+        view.setUint32(offset, value, true);
+        offset += 4;
+    }
+    for (const record of directoryRecords.concat(entryRecords)) {
+        for (const value of record) {
+            view.setUint32(offset, value, true);
+            offset += 4;
+        }
+    }
+    for (const string of strings) {
+        bytes.set(string, offset);
+        offset += string.length;
+    }
+    return bytes;
+}
+
 class IFSProjFSProvider extends EventEmitter {
+    /**
+     * Set the cache budget shared by every provider in this process that has
+     * no cacheBudget of its own; omitted tiers keep their current budget
+     */
+    static setSharedCacheBudget(budget) {
+        if (typeof nativeModule.setSharedCacheBudget === 'function') {
+            nativeModule.setSharedCacheBudget(budget);
+        }
+    }
+
     constructor(options) {
         super();
         
@@ -60,6 +150,11 @@ class IFSProjFSProvider extends EventEmitter {
             this.virtualRoot = options.virtualRoot || 'C:\\OneFiler';
             this.fileSystem = options.fileSystem;
             this.debug = options.debug || false;
+            this.cacheBudget = options.cacheBudget || null;
+            this.logLevel = options.logLevel || null;
+            this.prefetch = options.prefetch || null;
+            this.preservePlaceholders = options.preservePlaceholders || false;
+            this.writable = options.writable || false;
         }
         
         log('\n========================================');
@@ -75,19 +170,55 @@ class IFSProjFSProvider extends EventEmitter {
 
         // Create native provider with instancePath (where objects are stored)
         this.provider = new NativeProvider(this.instancePath);
+
+        // Apply per-tier byte budgets for the native cache (defaults live in content_cache.h)
+        if (this.cacheBudget && typeof this.provider.setCacheBudget === 'function') {
+            this.provider.setCacheBudget(this.cacheBudget);
+        }
+
+        // Optional read-ahead below enumerated directories
+        if (this.prefetch) {
+            this.setPrefetchOptions(this.prefetch === true ? {} : this.prefetch);
+        }
+        
+        // Native logging defaults to 'info'; debug mode turns on the per-callback traces
+        const logLevel = this.logLevel || (this.debug ? 'debug' : null);
+        if (logLevel) {
+            this.setLogLevel(logLevel);
+        }
         
         // Register callbacks
         this.provider.registerCallbacks({
             getFileInfo: this.getFileInfo.bind(this),
             readFile: this.readFile.bind(this),
+            ...(this.canReadRanges() ? { readFileRange: this.readFileRange.bind(this) } : {}),
             readDirectory: this.readDirectory.bind(this),
             createFile: this.createFile.bind(this),
+            updateFile: this.updateFile.bind(this),
+            deleteFile: this.deleteFile.bind(this),
+            readBatch: this.readBatch.bind(this),
             onDebugMessage: this.onDebugMessage.bind(this)
         });
     }
     
-    onDebugMessage(message) {
-        log(`[Native] ${message}`);
+    onDebugMessage(messages) {
+        // The native logger delivers forwarded messages in batches
+        const batch = Array.isArray(messages) ? messages : [messages];
+        for (const message of batch) {
+            log(`[Native] ${message}`);
+        }
+    }
+    
+    setLogLevel(level) {
+        if (this.provider && typeof this.provider.setLogLevel === 'function') {
+            this.provider.setLogLevel(level);
+        }
+    }
+    
+    getLogLevel() {
+        return this.provider && typeof this.provider.getLogLevel === 'function'
+            ? this.provider.getLogLevel()
+            : null;
     }
     
     normalizePath(inputPath) {
@@ -111,38 +242,49 @@ class IFSProjFSProvider extends EventEmitter {
     }
     
     async getFileInfo(path) {
+        try {
+            return await this.statFileInfo(path);
+        } catch (error) {
+            log(`getFileInfo ERROR: ${error.message}`);
+            return null;
+        }
+    }
+
+    // getFileInfo's answer, throwing what the file system throws
+    async statFileInfo(path) {
         const normalizedPath = this.normalizePath(path);
         log(`getFileInfo: "${path}" -> "${normalizedPath}"`);
+
+        const name = path.split(/[\\\/]/).filter(p => p).pop() || '';
         
-        try {
-            const name = path.split(/[\\\/]/).filter(p => p).pop() || '';
-            
-            if (normalizedPath === '/') {
-                return {
-                    name: '',
-                    hash: '',
-                    size: 0,
-                    isDirectory: true,
-                    isBlobOrClob: false,
-                    mode: 16877
-                };
-            }
-            
-            const info = await this.fileSystem.stat(normalizedPath);
-            // Determine if it's a directory from either isDirectory flag or mode field
-            const isDir = info.isDirectory || (info.mode && (info.mode & 0o040000) === 0o040000);
+        if (normalizedPath === '/') {
             return {
-                name: name,
-                hash: info.hash || '',
-                size: info.size || 0,
-                isDirectory: isDir,
+                name: '',
+                hash: '',
+                size: 0,
+                isDirectory: true,
                 isBlobOrClob: false,
-                mode: info.mode || (isDir ? 16877 : 33188)
+                mode: 16877
             };
-        } catch (error) {
-            log(`getFileInfo ERROR: ${error.message}`);
-            return null;
         }
+        
+        const info = await this.fileSystem.stat(normalizedPath);
+        if (!info) {
+            const error = new Error(`No such file: ${normalizedPath}`);
+            error.code = 'ENOENT';
+            throw error;
+        }
+        // Determine if it's a directory from either isDirectory flag or mode field
+        const isDir = info.isDirectory || (info.mode && (info.mode & 0o040000) === 0o040000);
+        return {
+            name: name,
+            hash: info.hash || '',
+            size: info.size || 0,
+            isDirectory: isDir,
+            isBlobOrClob: !isDir && Boolean(info.isBlobOrClob),
+            mode: info.mode || (isDir ? 16877 : 33188),
+            mtime: toMillis(info.mtime)
+        };
     }
     
     async readFile(path) {
@@ -225,6 +367,45 @@ class IFSProjFSProvider extends EventEmitter {
             return null;
         }
     }
+
+    /**
+     * Whether the file system reads ranges itself. Only then is readFileRange
+     * registered; otherwise large files are fetched whole, once per request,
+     * rather than loading the whole file again for every chunk.
+     */
+    canReadRanges() {
+        return !!this.fileSystem && typeof this.fileSystem.readFileInChunks === 'function';
+    }
+
+    /**
+     * Reads length bytes at offset for files too large to hand over whole.
+     * The native side caches the chunk itself, so nothing is stored here.
+     */
+    async readFileRange(path, offset, length) {
+        const normalizedPath = this.normalizePath(path);
+        log(`readFileRange: "${normalizedPath}" @${offset} +${length}`);
+
+        try {
+            if (!this.canReadRanges()) {
+                return null;
+            }
+            const file = await this.fileSystem.readFileInChunks(normalizedPath, length, offset);
+            const content = file && file.content;
+            if (!content) {
+                return null;
+            }
+            if (Buffer.isBuffer(content)) {
+                return content;
+            }
+            if (content instanceof ArrayBuffer) {
+                return Buffer.from(content);
+            }
+            return Buffer.from(content.buffer, content.byteOffset, content.byteLength);
+        } catch (error) {
+            log(`  readFileRange ERROR: ${error.message}`);
+            return null;
+        }
+    }
     
     async readDirectory(path) {
         enumerationCount.count++;
@@ -309,8 +490,9 @@ class IFSProjFSProvider extends EventEmitter {
                         hash: info.hash || '',
                         size: info.size || 0,
                         isDirectory: isDir,
-                        isBlobOrClob: false,
-                        mode: info.mode || (isDir ? 16877 : 33188)
+                        isBlobOrClob: !isDir && Boolean(info.isBlobOrClob),
+                        mode: info.mode || (isDir ? 16877 : 33188),
+                        mtime: toMillis(info.mtime)
                     };
                     
                     entries.push(entry);
@@ -334,20 +516,13 @@ class IFSProjFSProvider extends EventEmitter {
                 return true;
             });
 
-            // Push complete directory listing to native cache immediately
+            // Push complete directory listing to native cache immediately, together with
+            // the FileInfo of every entry so GetPlaceholderInfo can find them.
             // For /invites, we cache the directory listing so Explorer can see the files
             // The content will be fetched on-demand when files are accessed
-            this.setCachedDirectory(normalizedPath, validEntries);
+            this.setCachedTree([{ path: normalizedPath, entries: validEntries }]);
             log(`  Pushed ${validEntries.length} valid entries to native cache (${entries.length} total)`);
 
-            // Also cache individual FileInfo for each entry so GetPlaceholderInfo can find them
-            for (const entry of validEntries) {
-                // Avoid double slashes when normalizedPath is root
-                const entryPath = normalizedPath === '/' ? '/' + entry.name : normalizedPath + '/' + entry.name;
-                this.setCachedFileInfo(entryPath, entry);
-                log(`  Cached FileInfo for ${entryPath}`);
-            }
-
             // NOTE: /invites files are NOT pre-fetched or cached
             // They are dynamically generated and must always be read fresh from the filesystem
 
@@ -365,12 +540,55 @@ class IFSProjFSProvider extends EventEmitter {
         log(`createFile: "${path}" -> "${normalizedPath}"`);
         await this.fileSystem.writeFile(normalizedPath, content);
     }
+
+    async updateFile(path, content) {
+        const normalizedPath = this.normalizePath(path);
+        log(`updateFile: "${path}" -> "${normalizedPath}" (${content.length} bytes)`);
+        await this.fileSystem.writeFile(normalizedPath, content);
+    }
+
+    async deleteFile(path) {
+        const normalizedPath = this.normalizePath(path);
+        log(`deleteFile: "${path}" -> "${normalizedPath}"`);
+        if (typeof this.fileSystem.unlink !== 'function') {
+            throw new Error(`File system cannot delete ${normalizedPath}`);
+        }
+        await this.fileSystem.unlink(normalizedPath);
+    }
+
+    /**
+     * Answers a batch of native fetch requests in one round trip.
+     * The native side queues getFileInfo/readDirectory/readFile misses that
+     * arrive while JavaScript is busy and hands them over together; results
+     * line up with the requests, undefined marks a request that failed.
+     */
+    async readBatch(requests) {
+        log(`readBatch: ${requests.length} requests`);
+        return Promise.all(requests.map(async ({ kind, path }) => {
+            try {
+                switch (kind) {
+                    case 'fileInfo': return await this.getFileInfo(path);
+                    case 'directory': return await this.readDirectory(path);
+                    case 'content': return await this.readFile(path);
+                    default: return undefined;
+                }
+            } catch (error) {
+                log(`  readBatch ${kind} ERROR for ${path}: ${error.message}`);
+                return undefined;
+            }
+        }));
+    }
     
     getCacheStats() {
         // Return basic stats from native cache if available
         if (this.provider && typeof this.provider.getCacheStats === 'function') {
             return this.provider.getCacheStats();
         }
+        // Per-tier cache counters are reported as part of getStats()
+        const stats = this.getStats();
+        if (stats && stats.cache) {
+            return stats.cache;
+        }
         return {
             fileInfoCount: 0,
             directoryCount: 0,
@@ -420,6 +638,101 @@ class IFSProjFSProvider extends EventEmitter {
         }
     }
     
+    /**
+     * Cache many directory listings ([{ path, entries }]) and the FileInfo of
+     * each of their entries in a single native call
+     */
+    setCachedTree(directories) {
+        const normalized = directories.map(directory => ({
+            path: this.normalizePath(directory.path),
+            entries: directory.entries || []
+        }));
+
+        if (this.provider && typeof this.provider.setCachedTree === 'function') {
+            const stored = this.provider.setCachedTree(encodeCachedTree(normalized));
+            log(`setCachedTree: Cached ${normalized.length} directories with ${stored} entries`);
+            return;
+        }
+
+        // Older native modules: one call per listing and per entry
+        for (const directory of normalized) {
+            this.setCachedDirectory(directory.path, directory.entries);
+            for (const entry of directory.entries) {
+                const entryPath = directory.path === '/' ? '/' + entry.name : directory.path + '/' + entry.name;
+                this.setCachedFileInfo(entryPath, entry);
+            }
+        }
+    }
+    
+    /**
+     * Refresh the hydrated copies of paths that changed in ONE, e.g. chat
+     * messages arriving. Each path is stat'ed again; entries whose hash did not
+     * change and entries never hydrated cost nothing, vanished ones are deleted.
+     */
+    async updatePaths(paths) {
+        // Only a path the file system reports missing is deleted; any other
+        // error leaves the hydrated copy alone and counts as failed
+        let unknown = 0;
+        const updates = (await Promise.all(paths.map(async (path) => {
+            const normalizedPath = this.normalizePath(path);
+            try {
+                return { path: normalizedPath, info: await this.statFileInfo(normalizedPath) };
+            } catch (error) {
+                if (error && error.code === 'ENOENT') {
+                    return { path: normalizedPath, info: null };
+                }
+                log(`updatePaths: Leaving "${normalizedPath}" as it is: ${error && error.message}`);
+                unknown++;
+                return null;
+            }
+        }))).filter(update => update !== null);
+
+        if (!this.provider || typeof this.provider.updatePaths !== 'function') {
+            log(`  WARNING: Native updatePaths not available`);
+            return null;
+        }
+        const result = this.provider.updatePaths(updates);
+        result.failed += unknown;
+        log(`updatePaths: ${JSON.stringify(result)}`);
+        return result;
+    }
+
+    /**
+     * Apply ONE's change feed as per-directory deltas
+     * ([{ path, added, modified, removed }]) instead of resending listings.
+     * added/modified hold entries shaped like readDirectory's, removed holds names.
+     */
+    applyChanges(changes) {
+        const normalized = changes.map(change => ({
+            path: this.normalizePath(change.path),
+            added: (change.added || []).map(entry => ({ ...entry, mtime: toMillis(entry.mtime) })),
+            modified: (change.modified || []).map(entry => ({ ...entry, mtime: toMillis(entry.mtime) })),
+            removed: change.removed || []
+        }));
+
+        if (!this.provider || typeof this.provider.applyChanges !== 'function') {
+            log(`  WARNING: Native applyChanges not available`);
+            return null;
+        }
+        const result = this.provider.applyChanges(normalized);
+        log(`applyChanges: ${JSON.stringify(result)}`);
+        return result;
+    }
+
+    /**
+     * Enable or retune native read-ahead after directory enumeration.
+     * /objects is served from disk and /invites is generated per read, so
+     * neither is warmed unless options.exclude says otherwise.
+     */
+    setPrefetchOptions(options) {
+        if (this.provider && typeof this.provider.setPrefetchOptions === 'function') {
+            this.provider.setPrefetchOptions({ exclude: ['/objects', '/invites'], ...options });
+            log(`setPrefetchOptions: ${JSON.stringify(options)}`);
+        } else {
+            log(`  WARNING: Native setPrefetchOptions not available`);
+        }
+    }
+
     async mount() {
         log('\n=== MOUNT CALLED ===');
         log(`Mounting at: ${this.virtualRoot}`);
@@ -476,7 +789,10 @@ class IFSProjFSProvider extends EventEmitter {
         }
 
         log('>>> CHECKPOINT 3: About to start provider');
-        await this.provider.start(this.virtualRoot);
+        await this.provider.start(this.virtualRoot, {
+            preservePlaceholders: !!this.preservePlaceholders,
+            writable: !!this.writable
+        });
         log('Mount completed');
 
         // CRITICAL: Monitor /invites directory and auto-regenerate deleted files
@@ -623,8 +939,12 @@ class IFSProjFSProvider extends EventEmitter {
             this.provider.registerCallbacks({
                 getFileInfo: this.getFileInfo.bind(this),
                 readFile: this.readFile.bind(this),
+                ...(this.canReadRanges() ? { readFileRange: this.readFileRange.bind(this) } : {}),
                 readDirectory: this.readDirectory.bind(this),
                 createFile: this.createFile.bind(this),
+                updateFile: this.updateFile.bind(this),
+                deleteFile: this.deleteFile.bind(this),
+                readBatch: this.readBatch.bind(this),
                 onDebugMessage: this.onDebugMessage.bind(this)
             });
         }
@@ -0,0 +1,105 @@
+#ifndef BENCH_STATS_H
+#define BENCH_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace oneifsprojfs {
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+// Latency and throughput of one operation
+struct Summary {
+    size_t count = 0;
+    double p50Us = 0;
+    double p90Us = 0;
+    double p99Us = 0;
+    double maxUs = 0;
+    double opsPerSecond = 0;
+};
+
+// Every sample is kept, so percentiles are exact; a run records at most a few
+// million of them
+class Samples {
+public:
+    void Add(Clock::duration elapsed) {
+        nanoseconds_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+    void Merge(const Samples& other) {
+        nanoseconds_.insert(nanoseconds_.end(), other.nanoseconds_.begin(), other.nanoseconds_.end());
+    }
+    size_t Count() const { return nanoseconds_.size(); }
+
+    // wallSeconds is the time the whole run took, across all threads
+    Summary Summarize(double wallSeconds) {
+        Summary summary;
+        summary.count = nanoseconds_.size();
+        if (nanoseconds_.empty()) {
+            return summary;
+        }
+        std::sort(nanoseconds_.begin(), nanoseconds_.end());
+        auto at = [this](double quantile) {
+            size_t index = static_cast<size_t>(quantile * static_cast<double>(nanoseconds_.size() - 1));
+            return static_cast<double>(nanoseconds_[index]) / 1000.0;
+        };
+        summary.p50Us = at(0.50);
+        summary.p90Us = at(0.90);
+        summary.p99Us = at(0.99);
+        summary.maxUs = static_cast<double>(nanoseconds_.back()) / 1000.0;
+        summary.opsPerSecond = wallSeconds > 0 ? static_cast<double>(summary.count) / wallSeconds : 0;
+        return summary;
+    }
+
+private:
+    std::vector<long long> nanoseconds_;
+};
+
+inline void PrintHeader() {
+    std::printf("%-22s %10s %10s %10s %10s %10s %14s\n",
+                "operation", "count", "p50 us", "p90 us", "p99 us", "max us", "ops/sec");
+}
+
+inline void PrintRow(const char* name, const Summary& summary) {
+    std::printf("%-22s %10zu %10.2f %10.2f %10.2f %10.2f %14.0f\n", name, summary.count, summary.p50Us,
+                summary.p90Us, summary.p99Us, summary.maxUs, summary.opsPerSecond);
+}
+
+// Runs operation(thread, i) for i in [0, iterations) on each of threads
+// threads at once, timing every call
+template <typename Operation>
+Summary RunConcurrent(size_t threads, size_t iterations, Operation operation) {
+    std::vector<Samples> samples(threads);
+    std::vector<std::thread> workers;
+    auto start = Clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (size_t i = 0; i < iterations; i++) {
+                auto begin = Clock::now();
+                operation(t, i);
+                samples[t].Add(Clock::now() - begin);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (size_t t = 1; t < threads; t++) {
+        samples[0].Merge(samples[t]);
+    }
+    return samples[0].Summarize(wallSeconds);
+}
+
+template <typename Operation>
+Summary Run(size_t iterations, Operation operation) {
+    return RunConcurrent(1, iterations, [&](size_t, size_t i) { operation(i); });
+}
+
+} // namespace bench
+} // namespace oneifsprojfs
+
+#endif // BENCH_STATS_H
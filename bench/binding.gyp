@@ -0,0 +1,52 @@
+# Benchmarks, built on their own so installing the addon does not compile them:
+#   npm run bench:build
+{
+  "targets": [
+    {
+      "target_name": "scanner_bench",
+      "type": "executable",
+      "sources": [
+        "scanner_bench.cpp"
+      ],
+      "include_dirs": [
+        "../src"
+      ],
+      "cflags!": ["-fno-exceptions"],
+      "cflags_cc!": ["-fno-exceptions"],
+      "msvs_settings": {
+        "VCCLCompilerTool": {
+          "ExceptionHandling": 1,
+          "AdditionalOptions": ["/std:c++17"]
+        }
+      }
+    },
+    {
+      "target_name": "cache_bench",
+      "type": "executable",
+      "sources": [
+        "cache_bench.cpp",
+        "../src/content_cache.cpp",
+        "../src/content_store.cpp",
+        "../src/path_table.cpp",
+        "../src/packed_listing.cpp",
+        "../src/tree_batch.cpp",
+        "../src/sync_storage.cpp",
+        "../src/object_info_table.cpp",
+        "../src/object_index.cpp",
+        "../src/log.cpp"
+      ],
+      "include_dirs": [
+        "../src",
+        "."
+      ],
+      "cflags!": ["-fno-exceptions"],
+      "cflags_cc!": ["-fno-exceptions"],
+      "msvs_settings": {
+        "VCCLCompilerTool": {
+          "ExceptionHandling": 1,
+          "AdditionalOptions": ["/std:c++17"]
+        }
+      }
+    }
+  ]
+}
@@ -0,0 +1,319 @@
+// Synthetic workloads against ContentCache, SyncStorage and the object index,
+// without ProjFS or JavaScript, so changes to them can be measured in
+// isolation. Build with `npm run bench:build` and run
+//
+//   bench/build/Release/cache_bench[.exe] [--threads N] [--scale S] [workload...]
+//
+// Workloads: deep, wide, concurrent, blob, objects (all by default). --scale
+// multiplies the sizes below; every row reports p50/p90/p99 latency and the
+// throughput of the whole run. bench/provider-bench.js drives the real
+// callbacks through a mount.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench_stats.h"
+#include "content_cache.h"
+#include "object_index.h"
+#include "object_info_table.h"
+#include "sync_storage.h"
+
+using namespace oneifsprojfs;
+using namespace oneifsprojfs::bench;
+
+namespace {
+
+struct Options {
+    size_t threads = 4;
+    double scale = 1.0;
+    std::vector<std::string> workloads;
+};
+
+size_t Scaled(const Options& options, size_t value) {
+    return (std::max)(static_cast<size_t>(1), static_cast<size_t>(static_cast<double>(value) * options.scale));
+}
+
+FileInfo MakeFile(const std::string& name, size_t size) {
+    FileInfo info = {};
+    info.name = name;
+    info.hash = std::string(64, 'a');
+    info.size = size;
+    info.isDirectory = false;
+    info.isBlobOrClob = false;
+    info.mode = 0100644;
+    info.mtime = 1700000000000ull;
+    return info;
+}
+
+FileInfo MakeDirectory(const std::string& name) {
+    FileInfo info = MakeFile(name, 0);
+    info.hash.clear();
+    info.isDirectory = true;
+    info.mode = 040755;
+    return info;
+}
+
+std::string HexHash(std::mt19937_64& random) {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string hash(64, '0');
+    for (char& c : hash) {
+        c = kDigits[random() & 0xF];
+    }
+    return hash;
+}
+
+// A chain of directories, each holding a few files and the next level, as
+// ONE's versioned and per-chat paths nest
+void RunDeep(const Options& options) {
+    const size_t depth = 32;
+    const size_t filesPerLevel = Scaled(options, 64);
+    ContentCache cache;
+
+    std::vector<DirectoryUpdate> directories;
+    std::vector<std::string> files;
+    std::string path;
+    for (size_t level = 0; level < depth; level++) {
+        std::string directory = path.empty() ? "/" : path;
+        DirectoryUpdate update;
+        update.path = directory;
+        for (size_t i = 0; i < filesPerLevel; i++) {
+            std::string name = "file" + std::to_string(i) + ".txt";
+            update.listing.entries.push_back(MakeFile(name, 1024 + i));
+            files.push_back(path + "/" + name);
+        }
+        std::string next = "level" + std::to_string(level);
+        update.listing.entries.push_back(MakeDirectory(next));
+        directories.push_back(std::move(update));
+        path += "/" + next;
+    }
+
+    Summary store = Run(1, [&](size_t) { cache.SetDirectoryTree(std::move(directories)); });
+    PrintRow("deep.storeTree", store);
+
+    std::mt19937_64 random(1);
+    std::vector<size_t> picks(100000);
+    for (auto& pick : picks) {
+        pick = random() % files.size();
+    }
+    PrintRow("deep.fileInfo", Run(picks.size(), [&](size_t i) {
+        if (!cache.GetFileInfo(files[picks[i]])) {
+            std::abort();
+        }
+    }));
+    PrintRow("deep.listing", Run(picks.size(), [&](size_t i) {
+        const std::string& file = files[picks[i]];
+        std::string parent = file.substr(0, file.rfind('/'));
+        if (!cache.GetDirectoryListing(parent.empty() ? "/" : parent)) {
+            std::abort();
+        }
+    }));
+}
+
+// One directory of 100k entries: store it, probe names the way placeholder
+// requests do, and walk it the way an enumeration does
+void RunWide(const Options& options) {
+    const size_t entries = Scaled(options, 100000);
+    // Default budget: the listing has to be admitted as a mount would see it
+    ContentCache cache;
+
+    std::vector<DirectoryUpdate> directories(1);
+    directories[0].path = "/wide";
+    std::vector<std::string> names;
+    for (size_t i = 0; i < entries; i++) {
+        names.push_back("entry" + std::to_string(i) + ".txt");
+        directories[0].listing.entries.push_back(MakeFile(names.back(), i));
+    }
+
+    // As setCachedTree stores it: the listing plus a FileInfo per entry
+    PrintRow("wide.storeTree", Run(1, [&](size_t) { cache.SetDirectoryTree(std::move(directories)); }));
+    DirectoryListingPtr stored = cache.GetDirectoryListing("/wide");
+    if (!stored || stored->Size() != entries) {
+        std::abort();
+    }
+
+    std::mt19937_64 random(2);
+    PrintRow("wide.findEntry", Run(200000, [&](size_t) {
+        if (cache.FindEntry(*stored, names[random() % names.size()]) == PackedListing::kNotFound) {
+            std::abort();
+        }
+    }));
+    // FileInfos past the FileInfo budget are found in the listing instead, as
+    // placeholder requests do
+    PrintRow("wide.fileInfo", Run(200000, [&](size_t) {
+        const std::string& name = names[random() % names.size()];
+        if (!cache.GetFileInfo("/wide/" + name) && cache.FindEntry(*stored, name) == PackedListing::kNotFound) {
+            std::abort();
+        }
+    }));
+    size_t checksum = 0;
+    PrintRow("wide.walk", Run(20, [&](size_t) {
+        for (size_t i = 0; i < stored->Size(); i++) {
+            checksum += stored->WideName(i)[0] + stored->FileSize(i);
+        }
+    }));
+    if (checksum == 0) {
+        std::abort();
+    }
+}
+
+// Readers on every thread against a warm cache, with one write in twenty
+void RunReaders(const Options& options) {
+    const size_t files = Scaled(options, 2000);
+    ContentCache cache;
+
+    std::vector<PathId> paths;
+    std::vector<uint8_t> payload(4096, 0x5A);
+    for (size_t i = 0; i < files; i++) {
+        std::string path = "/concurrent/file" + std::to_string(i);
+        cache.SetFileInfo(path, MakeFile("file" + std::to_string(i), payload.size()));
+        cache.SetFileContent(path, FileContent::Copy(payload.data(), payload.size()));
+        paths.push_back(cache.Paths().Find(path));
+    }
+
+    std::vector<std::mt19937_64> randoms;
+    for (size_t t = 0; t < options.threads; t++) {
+        randoms.emplace_back(100 + t);
+    }
+    Summary mixed = RunConcurrent(options.threads, 200000, [&](size_t thread, size_t i) {
+        PathId path = paths[randoms[thread]() % paths.size()];
+        if (i % 20 == 0) {
+            cache.SetFileContent(path, FileContent::Copy(payload.data(), payload.size()));
+        } else if (i % 2 == 0) {
+            cache.GetFileContent(path);
+        } else {
+            cache.GetFileInfo(path);
+        }
+    });
+    PrintRow("concurrent.mixed", mixed);
+}
+
+// Random ranged reads of one large object, as ProjFS asks for them
+void RunBlob(const Options& options, const std::filesystem::path& instance) {
+    const size_t objectBytes = Scaled(options, 64) * 1024 * 1024;
+    const size_t readBytes = 64 * 1024;
+    std::mt19937_64 random(3);
+    std::string hash = HexHash(random);
+
+    std::filesystem::create_directories(instance / "objects");
+    {
+        std::ofstream out(instance / "objects" / hash, std::ios::binary);
+        std::vector<char> block(1024 * 1024);
+        for (size_t i = 0; i < block.size(); i++) {
+            block[i] = static_cast<char>(i * 31);
+        }
+        for (size_t written = 0; written < objectBytes; written += block.size()) {
+            out.write(block.data(), static_cast<std::streamsize>((std::min)(block.size(), objectBytes - written)));
+        }
+    }
+
+    SyncStorage storage(instance.string());
+    std::string path = "/objects/" + hash + "/raw.txt";
+    std::vector<std::mt19937_64> randoms;
+    for (size_t t = 0; t < options.threads; t++) {
+        randoms.emplace_back(200 + t);
+    }
+    std::vector<std::vector<uint8_t>> buffers(options.threads, std::vector<uint8_t>(readBytes));
+    PrintRow("blob.metadata", Run(100000, [&](size_t) {
+        if (!storage.GetVirtualPathMetadata(path).exists) {
+            std::abort();
+        }
+    }));
+    Summary reads = RunConcurrent(options.threads, 2000, [&](size_t thread, size_t) {
+        uint64_t offset = randoms[thread]() % (objectBytes - readBytes);
+        auto read = storage.ReadVirtualPathRange(path, offset, buffers[thread].data(), readBytes);
+        if (!read || *read != readBytes) {
+            std::abort();
+        }
+    });
+    PrintRow("blob.range64k", reads);
+    std::printf("%-22s %.1f MB/s\n", "blob.throughput", reads.opsPerSecond * readBytes / (1024.0 * 1024.0));
+}
+
+// /objects at the size of a large instance: enumerate the index, look up
+// sizes, and insert while readers walk it
+void RunObjects(const Options& options) {
+    const size_t objects = Scaled(options, 100000);
+    std::mt19937_64 random(4);
+    std::vector<ObjectIndex::Key> keys(objects);
+    ObjectInfoTable table;
+    for (auto& key : keys) {
+        ObjectInfoTable::ParseKey(HexHash(random), key);
+        table.SetSize(key, random() % 100000);
+    }
+
+    ObjectIndex index;
+    PrintRow("objects.publish", Run(1, [&](size_t) { index.Publish(keys); }));
+
+    size_t checksum = 0;
+    PrintRow("objects.enumerate", Run(10, [&](size_t) {
+        ObjectIndex::Snapshot snapshot = index.Take();
+        ObjectIndex::Snapshot::Cursor cursor = snapshot.After(nullptr);
+        ObjectIndex::Key key;
+        wchar_t name[ObjectIndex::kNameLength + 1];
+        while (snapshot.Next(cursor, key)) {
+            ObjectIndex::FormatName(key, name);
+            checksum += name[0];
+        }
+    }));
+    std::vector<std::mt19937_64> randoms;
+    for (size_t t = 0; t < options.threads; t++) {
+        randoms.emplace_back(300 + t);
+    }
+    PrintRow("objects.infoFind", RunConcurrent(options.threads, 200000, [&](size_t thread, size_t) {
+        ObjectInfoTable::Info info;
+        checksum += table.Find(keys[randoms[thread]() % keys.size()], info) ? 1 : 0;
+    }));
+    PrintRow("objects.insert", Run(20000, [&](size_t) {
+        ObjectIndex::Key key;
+        ObjectInfoTable::ParseKey(HexHash(random), key);
+        index.Insert(key);
+    }));
+    if (checksum == 0) {
+        std::abort();
+    }
+}
+
+bool Wanted(const Options& options, const char* workload) {
+    return options.workloads.empty() ||
+           std::find(options.workloads.begin(), options.workloads.end(), workload) != options.workloads.end();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = (std::max)(1ul, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            options.scale = std::strtod(argv[++i], nullptr);
+        } else if (argv[i][0] == '-') {
+            std::fprintf(stderr, "usage: cache_bench [--threads N] [--scale S] [deep|wide|concurrent|blob|objects...]\n");
+            return 2;
+        } else {
+            options.workloads.push_back(argv[i]);
+        }
+    }
+
+    std::mt19937_64 seed(static_cast<uint64_t>(Clock::now().time_since_epoch().count()));
+    std::filesystem::path instance =
+        std::filesystem::temp_directory_path() / ("projfs-cache-bench-" + std::to_string(seed() % 1000000));
+
+    std::printf("%zu threads, scale %.2f\n", options.threads, options.scale);
+    PrintHeader();
+    if (Wanted(options, "deep")) RunDeep(options);
+    if (Wanted(options, "wide")) RunWide(options);
+    if (Wanted(options, "concurrent")) RunReaders(options);
+    if (Wanted(options, "blob")) RunBlob(options, instance);
+    if (Wanted(options, "objects")) RunObjects(options);
+
+    std::error_code error;
+    std::filesystem::remove_all(instance, error);
+    return 0;
+}
@@ -0,0 +1,391 @@
+#!/usr/bin/env node
+
+/**
+ * Load test for the ProjFS callback paths
+ *
+ * Mounts IFSProjFSProvider over a synthetic IFileSystem and drives the mount
+ * with real Win32 file operations, so every request goes through ProjFS, the
+ * native callbacks, the caches and (on a miss) the JavaScript bridge. The
+ * workload runs twice, against a cold mount and then warm; each pass reports
+ * its throughput and the p50/p99 latency per operation kind, followed by the
+ * provider's getStats().
+ *
+ * Usage:
+ *   node bench/provider-bench.js [options]
+ *
+ * Options:
+ *   --concurrency N    Operations in flight at once (default 16)
+ *   --scale S          Multiplies the synthetic tree sizes (default 1)
+ *   --replay FILE      Replay a trace instead of the synthetic workload: JSON
+ *                      lines of { op, path, offset, length } with op one of
+ *                      stat, readdir, read, or a Process Monitor CSV export
+ *   --trace-root DIR   Prefix stripped from trace paths (e.g. C:\OneFiler)
+ *   --mount DIR        Mount point (default: a fresh directory under %TEMP%)
+ *   --keep             Leave the mount and instance directories behind
+ *
+ * Prerequisites: Windows 10 1809 or later with ProjFS enabled, `npm run build`.
+ */
+
+import fs from 'fs';
+import path from 'path';
+import os from 'os';
+
+// The provider logs every callback unless it believes it is under test
+process.env.NODE_ENV = 'test';
+const { IFSProjFSProvider } = await import('../IFSProjFSProvider.js');
+
+const args = process.argv.slice(2);
+function option(name, fallback) {
+    const index = args.indexOf(name);
+    return index >= 0 && index + 1 < args.length ? args[index + 1] : fallback;
+}
+
+const CONCURRENCY = Math.max(1, parseInt(option('--concurrency', '16'), 10) || 16);
+const SCALE = Math.max(0.001, parseFloat(option('--scale', '1')) || 1);
+const REPLAY = option('--replay', null);
+const TRACE_ROOT = option('--trace-root', '');
+const KEEP = args.includes('--keep');
+
+const BENCH_DIR = path.join(os.tmpdir(), `projfs-bench-${process.pid}`);
+const MOUNT_POINT = option('--mount', path.join(BENCH_DIR, 'mount'));
+const INSTANCE_PATH = path.join(BENCH_DIR, 'instance');
+
+const scaled = (value) => Math.max(1, Math.round(value * SCALE));
+
+/**
+ * In-memory tree with deterministic file content, shaped like the parts of
+ * IFileSystem the provider calls
+ */
+class SyntheticFileSystem {
+    constructor() {
+        this.directories = new Map([['/', new Set()]]);
+        this.files = new Map();
+    }
+
+    addDirectory(dirPath) {
+        if (this.directories.has(dirPath)) {
+            return;
+        }
+        this.directories.set(dirPath, new Set());
+        this.link(dirPath);
+    }
+
+    addFile(filePath, size) {
+        if (this.directories.has(filePath)) {
+            return;
+        }
+        this.files.set(filePath, Math.max(size, this.files.get(filePath) || 0));
+        this.link(filePath);
+    }
+
+    link(childPath) {
+        const parent = path.posix.dirname(childPath);
+        this.addDirectory(parent);
+        this.directories.get(parent).add(path.posix.basename(childPath));
+    }
+
+    async stat(p) {
+        if (this.directories.has(p)) {
+            return { mode: 0o040755, size: 0 };
+        }
+        if (this.files.has(p)) {
+            return { mode: 0o100644, size: this.files.get(p), mtime: 1700000000000 };
+        }
+        throw new Error(`ENOENT: ${p}`);
+    }
+
+    async readDir(p) {
+        const children = this.directories.get(p);
+        if (!children) {
+            throw new Error(`ENOENT: ${p}`);
+        }
+        return { children: [...children] };
+    }
+
+    async readFile(p) {
+        return this.readFileInChunks(p, this.files.get(p) || 0, 0);
+    }
+
+    async readFileInChunks(p, length, offset) {
+        const size = this.files.get(p);
+        if (size === undefined) {
+            throw new Error(`ENOENT: ${p}`);
+        }
+        const start = Math.min(offset, size);
+        const content = Buffer.alloc(Math.min(length, size - start));
+        for (let i = 0; i < content.length; i++) {
+            content[i] = (start + i) * 31;
+        }
+        return { content };
+    }
+}
+
+/**
+ * The tree the synthetic workload runs against: a deep chain of directories,
+ * one very wide directory and a large blob
+ */
+function syntheticWorkload(fileSystem) {
+    const ops = [];
+
+    let deep = '/deep';
+    for (let level = 0; level < 32; level++) {
+        for (let i = 0; i < scaled(16); i++) {
+            fileSystem.addFile(`${deep}/file${i}.txt`, 1024 + i);
+        }
+        ops.push({ op: 'readdir', path: deep });
+        ops.push({ op: 'stat', path: `${deep}/file0.txt` });
+        ops.push({ op: 'read', path: `${deep}/file0.txt`, offset: 0, length: 1024 });
+        deep += `/level${level}`;
+        fileSystem.addDirectory(deep);
+    }
+
+    const wide = scaled(100000);
+    for (let i = 0; i < wide; i++) {
+        fileSystem.addFile(`/wide/entry${i}.txt`, i % 4096);
+    }
+    ops.push({ op: 'readdir', path: '/wide' });
+    for (let i = 0; i < Math.min(wide, 2000); i++) {
+        ops.push({ op: 'stat', path: `/wide/entry${(i * 7919) % wide}.txt` });
+    }
+
+    const blobSize = scaled(64) * 1024 * 1024;
+    fileSystem.addFile('/blob/large.bin', blobSize);
+    for (let i = 0; i < 256; i++) {
+        const offset = ((i * 2654435761) % Math.max(1, blobSize - 65536)) & ~4095;
+        ops.push({ op: 'read', path: '/blob/large.bin', offset, length: 65536 });
+    }
+    return ops;
+}
+
+/**
+ * Parses a CSV line as Process Monitor writes it: every field quoted
+ */
+function parseCsvLine(line) {
+    const fields = [];
+    let field = '';
+    let quoted = false;
+    for (let i = 0; i < line.length; i++) {
+        const c = line[i];
+        if (quoted) {
+            if (c === '"' && line[i + 1] === '"') {
+                field += '"';
+                i++;
+            } else if (c === '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c === '"') {
+            quoted = true;
+        } else if (c === ',') {
+            fields.push(field);
+            field = '';
+        } else {
+            field += c;
+        }
+    }
+    fields.push(field);
+    return fields;
+}
+
+// Trace path -> virtual path, or null for paths outside the mount
+function toVirtualPath(tracePath) {
+    let p = tracePath.replace(/\\/g, '/');
+    const root = TRACE_ROOT.replace(/\\/g, '/').replace(/\/$/, '');
+    if (root) {
+        if (p.toLowerCase() !== root.toLowerCase() && !p.toLowerCase().startsWith(root.toLowerCase() + '/')) {
+            return null;
+        }
+        p = p.slice(root.length);
+    }
+    p = '/' + p.split('/').filter(Boolean).join('/');
+    return p;
+}
+
+const PROCMON_OPS = {
+    CreateFile: 'stat',
+    QueryBasicInformationFile: 'stat',
+    QueryStandardInformationFile: 'stat',
+    QueryNetworkOpenInformationFile: 'stat',
+    QueryDirectory: 'readdir',
+    ReadFile: 'read'
+};
+
+function loadTrace(file) {
+    const text = fs.readFileSync(file, 'utf8');
+    const lines = text.split(/\r?\n/).filter(line => line.trim());
+    const ops = [];
+
+    if (lines.length > 0 && lines[0].startsWith('{')) {
+        for (const line of lines) {
+            const record = JSON.parse(line);
+            const p = toVirtualPath(record.path || '');
+            if (p && ['stat', 'readdir', 'read'].includes(record.op)) {
+                ops.push({ op: record.op, path: p, offset: record.offset || 0, length: record.length || 4096 });
+            }
+        }
+        return ops;
+    }
+
+    const header = parseCsvLine(lines[0].replace(/^\uFEFF/, ''));
+    const operationColumn = header.indexOf('Operation');
+    const pathColumn = header.indexOf('Path');
+    const detailColumn = header.indexOf('Detail');
+    if (operationColumn < 0 || pathColumn < 0) {
+        throw new Error(`${file}: neither JSON lines nor a Process Monitor CSV`);
+    }
+    for (const line of lines.slice(1)) {
+        const fields = parseCsvLine(line);
+        const op = PROCMON_OPS[fields[operationColumn]];
+        const p = op && toVirtualPath(fields[pathColumn] || '');
+        if (!p) {
+            continue;
+        }
+        const detail = detailColumn >= 0 ? fields[detailColumn] || '' : '';
+        const offset = /Offset: ([\d,]+)/.exec(detail);
+        const length = /Length: ([\d,]+)/.exec(detail);
+        ops.push({
+            op,
+            path: p,
+            offset: offset ? parseInt(offset[1].replace(/,/g, ''), 10) : 0,
+            length: length ? parseInt(length[1].replace(/,/g, ''), 10) : 4096
+        });
+    }
+    return ops;
+}
+
+// A tree that holds every path the trace touches, with files large enough
+// for every read in it
+function treeForTrace(fileSystem, ops) {
+    for (const { op, path: p } of ops) {
+        if (op === 'readdir' && p !== '/') {
+            fileSystem.addDirectory(p);
+        }
+    }
+    for (const { op, path: p, offset, length } of ops) {
+        if (p !== '/' && !fileSystem.directories.has(p)) {
+            fileSystem.addFile(p, op === 'read' ? offset + length : 4096);
+        }
+    }
+}
+
+async function perform({ op, path: p, offset, length }) {
+    const target = path.join(MOUNT_POINT, ...p.split('/').filter(Boolean));
+    if (op === 'stat') {
+        await fs.promises.stat(target);
+    } else if (op === 'readdir') {
+        await fs.promises.readdir(target);
+    } else {
+        const handle = await fs.promises.open(target, 'r');
+        try {
+            await handle.read(Buffer.alloc(length), 0, length, offset);
+        } finally {
+            await handle.close();
+        }
+    }
+}
+
+/**
+ * Runs ops with CONCURRENCY of them in flight and returns per-kind latencies
+ * in microseconds
+ */
+async function runPass(ops) {
+    const latencies = new Map();
+    let errors = 0;
+    let next = 0;
+    const start = process.hrtime.bigint();
+
+    const worker = async () => {
+        while (next < ops.length) {
+            const op = ops[next++];
+            const begin = process.hrtime.bigint();
+            try {
+                await perform(op);
+            } catch (e) {
+                errors++;
+            }
+            const elapsed = Number(process.hrtime.bigint() - begin) / 1000;
+            if (!latencies.has(op.op)) {
+                latencies.set(op.op, []);
+            }
+            latencies.get(op.op).push(elapsed);
+        }
+    };
+    await Promise.all(Array.from({ length: CONCURRENCY }, worker));
+
+    const wallSeconds = Number(process.hrtime.bigint() - start) / 1e9;
+    return { latencies, errors, wallSeconds };
+}
+
+function report(phase, { latencies, errors, wallSeconds }) {
+    const at = (sorted, quantile) => sorted[Math.floor(quantile * (sorted.length - 1))];
+    let total = 0;
+    for (const samples of latencies.values()) {
+        total += samples.length;
+    }
+    console.log(`\n${phase}: ${total} operations in ${wallSeconds.toFixed(2)} s, ` +
+                `${(total / wallSeconds).toFixed(0)} ops/sec, ${errors} errors`);
+    console.log(`${'operation'.padEnd(10)}${'count'.padStart(10)}${'p50 us'.padStart(12)}` +
+                `${'p99 us'.padStart(12)}${'max us'.padStart(12)}${'mean us'.padStart(12)}`);
+    for (const [op, samples] of latencies) {
+        const sorted = Float64Array.from(samples).sort();
+        const mean = sorted.reduce((sum, us) => sum + us, 0) / sorted.length;
+        console.log(`${op.padEnd(10)}${String(sorted.length).padStart(10)}` +
+                    `${at(sorted, 0.5).toFixed(1).padStart(12)}${at(sorted, 0.99).toFixed(1).padStart(12)}` +
+                    `${sorted[sorted.length - 1].toFixed(1).padStart(12)}${mean.toFixed(1).padStart(12)}`);
+    }
+}
+
+async function main() {
+    // A mount point given on the command line is only removed if this run made it
+    const ownsMount = !fs.existsSync(MOUNT_POINT);
+    fs.mkdirSync(path.join(INSTANCE_PATH, 'objects'), { recursive: true });
+    fs.mkdirSync(MOUNT_POINT, { recursive: true });
+
+    const fileSystem = new SyntheticFileSystem();
+    let ops;
+    if (REPLAY) {
+        ops = loadTrace(REPLAY);
+        treeForTrace(fileSystem, ops);
+        console.log(`Replaying ${ops.length} operations from ${REPLAY}`);
+    } else {
+        ops = syntheticWorkload(fileSystem);
+        console.log(`Synthetic workload: ${ops.length} operations over ${fileSystem.files.size} files`);
+    }
+    console.log(`Mount: ${MOUNT_POINT}, concurrency ${CONCURRENCY}`);
+
+    const provider = new IFSProjFSProvider({
+        instancePath: INSTANCE_PATH,
+        virtualRoot: MOUNT_POINT,
+        fileSystem
+    });
+
+    // Parts of the provider still log with console.log; keep the report readable
+    const consoleLog = console.log;
+    console.log = () => {};
+    try {
+        await provider.mount();
+        const cold = await runPass(ops);
+        const warm = await runPass(ops);
+        console.log = consoleLog;
+
+        report('Cold', cold);
+        report('Warm', warm);
+        console.log('\ngetStats():');
+        console.log(JSON.stringify(provider.getStats(), null, 2));
+    } finally {
+        console.log = consoleLog;
+        await provider.unmount();
+        if (!KEEP) {
+            fs.rmSync(BENCH_DIR, { recursive: true, force: true });
+            if (ownsMount) {
+                fs.rmSync(MOUNT_POINT, { recursive: true, force: true });
+            }
+        }
+    }
+}
+
+main().catch(error => {
+    console.error(`provider-bench failed: ${error.stack || error.message}`);
+    process.exit(1);
+});
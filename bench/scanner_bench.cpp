@@ -0,0 +1,104 @@
+// Compares the object path and header scanners in src/object_scan.h with the
+// std::regex versions they replaced. Build with `npm run bench:build` and run
+// bench/build/Release/scanner_bench[.exe] [iterations].
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <vector>
+#include "object_scan.h"
+
+using namespace oneifsprojfs;
+
+namespace {
+
+std::string RegexHashOfPath(const std::string& virtualPath) {
+    static const std::regex hashPattern(R"(/objects/([0-9a-fA-F]{64})(?:/|$))");
+    std::smatch match;
+    if (std::regex_search(virtualPath, match, hashPattern)) {
+        return match[1].str();
+    }
+    return "";
+}
+
+std::string RegexItemType(const std::string& microdata) {
+    // The pattern as it was meant to be; the shipped one escaped the dot twice
+    static const std::regex typePattern("itemtype=\"//refin\\.io/([^\"]+)\"");
+    std::smatch match;
+    if (std::regex_search(microdata, match, typePattern)) {
+        return match[1].str();
+    }
+    return "";
+}
+
+template <typename Function>
+double NanosecondsPerCall(size_t iterations, const std::vector<std::string>& inputs, Function function,
+                          size_t& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        checksum += function(inputs[i % inputs.size()]);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+}
+
+void Report(const char* name, double regexNs, double scannerNs) {
+    std::printf("%-14s regex %9.1f ns   scanner %7.1f ns   %6.1fx\n", name, regexNs, scannerNs, regexNs / scannerNs);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    // What Explorer asks for when it walks /objects
+    const std::string hash = "0f1e2d3c4b5a69788796a5b4c3d2e1f00f1e2d3c4b5a69788796a5b4c3d2e1f0";
+    std::vector<std::string> paths = {
+        "/objects/" + hash,
+        "/objects/" + hash + "/raw.txt",
+        "/objects/" + hash + "/pretty.html",
+        "/objects/" + hash + "/desktop.ini",
+        "/objects/not-a-hash/raw.txt",
+        "/objects/" + hash.substr(0, 63) + "g/type.txt",
+    };
+    for (const auto& path : paths) {
+        if (RegexHashOfPath(path) != std::string(ObjectHashOfPath(path))) {
+            std::fprintf(stderr, "mismatch on %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    // First 100 bytes of typical objects
+    std::vector<std::string> headers = {
+        "<div itemscope itemtype=\"//refin.io/Person\"><span itemprop=\"email\">someone@example.com</span>",
+        "<div itemscope itemtype=\"//refin.io/ChatMessage\"><span itemprop=\"text\">hello</span><a itemprop=",
+        "<div itemscope itemtype=\"//refin.io/VersionNode\"><a itemprop=\"depth\">3</a><a itemprop=\"prev\">ab",
+        std::string("\x89PNG\r\n\x1a\n\0\0\0\rIHDR\0\0\x01\0\0\0\x01\0\x08\x06\0\0\0\x5c\x72\xa8\x66", 33),
+    };
+    for (const auto& header : headers) {
+        if (RegexItemType(header) != std::string(FindRefinItemType(header))) {
+            std::fprintf(stderr, "mismatch on header %s\n", header.c_str());
+            return 1;
+        }
+    }
+
+    size_t checksum = 0;
+    double regexPath = NanosecondsPerCall(iterations, paths,
+        [](const std::string& path) { return RegexHashOfPath(path).size(); }, checksum);
+    double scanPath = NanosecondsPerCall(iterations, paths,
+        [](const std::string& path) { return ObjectHashOfPath(path).size(); }, checksum);
+    double regexType = NanosecondsPerCall(iterations, headers,
+        [](const std::string& header) { return RegexItemType(header).size(); }, checksum);
+    double scanType = NanosecondsPerCall(iterations, headers,
+        [](const std::string& header) { return FindRefinItemType(header).size(); }, checksum);
+
+    std::printf("%zu iterations (checksum %zu)\n", iterations, checksum);
+    Report("hash of path", regexPath, scanPath);
+    Report("itemtype", regexType, scanType);
+    return 0;
+}
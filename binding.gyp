@@ -7,14 +7,27 @@
         "src/projfs_provider.cpp",
         "src/sync_storage.cpp",
         "src/content_cache.cpp",
-        "src/async_bridge.cpp"
+        "src/content_store.cpp",
+        "src/path_table.cpp",
+        "src/packed_listing.cpp",
+        "src/tree_batch.cpp",
+        "src/metadata_snapshot.cpp",
+        "src/object_info_table.cpp",
+        "src/object_index.cpp",
+        "src/thread_pool.cpp",
+        "src/prefetcher.cpp",
+        "src/shared_runtime.cpp",
+        "src/async_bridge.cpp",
+        "src/trace.cpp",
+        "src/log.cpp"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
         "src"
       ],
       "libraries": [
-        "ProjectedFSLib.lib"
+        "ProjectedFSLib.lib",
+        "advapi32.lib"
       ],
       "defines": [
         "NAPI_CPP_EXCEPTIONS"
@@ -34,4 +47,4 @@
       ]
     }
   ]
-}
\ No newline at end of file
+}
@@ -9,9 +9,51 @@ export interface IFSProjFSProviderOptions {
     virtualRoot: string;
     fileSystem: any; // IFileSystem interface from one.models
     cacheTTL?: number;
+    cacheBudget?: CacheBudget;
+    /** Warm listings and small files below each enumerated directory */
+    prefetch?: boolean | PrefetchOptions;
+    /** Keep hydrated files from the previous mount instead of wiping the virtual root */
+    preservePlaceholders?: boolean;
+    /**
+     * Let files outside /objects be created, overwritten and deleted; changes
+     * are written back through the file system once the handle closes
+     */
+    writable?: boolean;
+    /** Native log level; defaults to 'debug' when debug is set, otherwise 'info' */
+    logLevel?: LogLevel;
     debug?: boolean;
 }
 
+export type LogLevel = 'trace' | 'debug' | 'info' | 'warn' | 'error' | 'off';
+
+/**
+ * Byte budgets for the native cache tiers. Omitted tiers keep their defaults.
+ */
+export interface CacheBudget {
+    fileInfoBytes?: number;
+    directoryBytes?: number;
+    contentBytes?: number;
+    /** Chunks of files over 1 MB, which are never cached whole (default 128 MB) */
+    chunkBytes?: number;
+}
+
+/**
+ * Read-ahead after directory enumeration. Omitted settings keep their defaults.
+ */
+export interface PrefetchOptions {
+    enabled?: boolean;
+    /** Levels below the enumerated directory to warm (default 1) */
+    depth?: number;
+    /** Files larger than this are not prefetched (default 64 KB) */
+    maxFileBytes?: number;
+    /** File content warmed per enumeration (default 8 MB) */
+    budgetBytes?: number;
+    /** Prefetches waiting on JavaScript at once (default 4) */
+    concurrency?: number;
+    /** Subtrees never prefetched (default ['/objects', '/invites']) */
+    exclude?: string[];
+}
+
 export interface ProviderStats {
     placeholderRequests: number;
     fileDataRequests: number;
@@ -19,9 +61,247 @@ export interface ProviderStats {
     bytesRead: bigint;
     cacheHits: number;
     cacheMisses: number;
+    directoryFetches: number;
+    cancelledCommands: number;
+    /** Placeholder requests answered from the native negative-lookup cache */
+    negativeCacheHits: number;
+    /** Directory listings restored from the previous mount's metadata snapshot */
+    snapshotRestores: number;
+    snapshotSaves: number;
+    /** Preserved placeholders found unchanged, updated in place or deleted at mount */
+    placeholdersKept: number;
+    placeholdersUpdated: number;
+    placeholdersDeleted: number;
+    /** Preserved entries left alone because they were changed, created or deleted locally */
+    placeholdersLocal: number;
+    /** On-disk entries refreshed or deleted through updatePaths */
+    pathUpdates: number;
+    /** Chunks of large files read through readFileRange */
+    streamedChunks: number;
+    /** Closed modified or deleted files queued for write-back */
+    writeBacks: number;
+    /** Disk reads and placeholder writes completed from the native pool */
+    offloadedCommands: number;
+    /** /objects entries enumerated from the native object index */
+    indexedObjectEntries: number;
+    /** Files outside /objects read straight from storage by their BLOB/CLOB hash */
+    blobReads: number;
+    cache?: CacheStats;
+    fetch?: FetchStats;
+    write?: WriteStats;
+    prefetch?: PrefetchStats;
+    /** Shared by every provider in the process */
+    pool?: ThreadPoolStats;
+    objectInfo: ObjectInfoStats;
+    /** Time spent in each ProjFS callback, by how it was answered */
+    callbacks: CallbackStatsByKind;
+    /** Commands answered with ERROR_IO_PENDING and not completed yet */
+    pendingCommands: PendingCommandStats;
+    /** The runtime every provider in the process shares */
+    shared?: SharedRuntimeStats;
+}
+
+export interface SharedRuntimeStats {
+    /** Providers in this process that are not stopped */
+    roots: number;
+    /** Split evenly among the roots without a cacheBudget of their own */
+    budget: Required<CacheBudget>;
+    /** Content and chunks looked up by hash before they were cached */
+    contentLookups: number;
+    /** Lookups answered with a copy another path or root already held */
+    contentShared: number;
+    sharedBytes: number;
+    contentEntries: number;
+}
+
+export interface CallbackLatencyStats {
+    /** Answered from the native cache, the negative cache or the object index */
+    hit: LatencyStats;
+    /** Answered inline without the cache: storage, disk or not found */
+    miss: LatencyStats;
+    /** Returned ERROR_IO_PENDING; the callback's own time only */
+    pending: LatencyStats;
+    /** Pending commands, from being parked until PrjCompleteCommand */
+    completion: LatencyStats;
+}
+
+export interface CallbackStatsByKind {
+    placeholderInfo: CallbackLatencyStats;
+    fileData: CallbackLatencyStats;
+    queryFileName: CallbackLatencyStats;
+    startEnumeration: CallbackLatencyStats;
+    enumeration: CallbackLatencyStats;
+    endEnumeration: CallbackLatencyStats;
+    notification: CallbackLatencyStats;
+}
+
+export interface PendingCommandStats {
+    placeholders: number;
+    fileData: number;
+    /** Files larger than the content tier, read range by range */
+    streams: number;
+    enumerations: number;
+    /** Queued or running on the native pool */
+    offloaded: number;
+}
+
+export interface PathUpdateResult {
+    /** Rewritten, or already carrying the current hash as ContentID */
+    updated: number;
+    /** Only paths the file system reported missing (ENOENT) */
+    deleted: number;
+    notOnDisk: number;
+    /** Modified or created locally; the local copy is left alone */
+    local: number;
+    /** Including paths whose stat failed for any other reason */
+    failed: number;
+}
+
+export interface DirectoryEntry {
+    name: string;
+    hash?: string;
+    size?: number;
+    isDirectory?: boolean;
+    isBlobOrClob?: boolean;
+    mode?: number;
+    /** Milliseconds since the epoch, or a Date */
+    mtime?: number | Date;
+}
+
+export interface DirectoryChange {
+    path: string;
+    added?: DirectoryEntry[];
+    modified?: DirectoryEntry[];
+    /** Entry names; a name also in added or modified is removed */
+    removed?: string[];
+}
+
+export interface ChangeResult extends PathUpdateResult {
+    /** Cached listings patched in place */
+    patched: number;
+    /** Directories without a cached listing; only entry metadata was stored */
+    uncached: number;
+}
+
+export interface PrefetchStats {
+    scheduled: number;
+    directories: number;
+    files: number;
+    bytes: number;
+    skipped: number;
+    /** Times the worker backed off because ProjFS commands were pending */
+    deferred: number;
+    queued: number;
+    inflight: number;
+}
+
+/**
+ * Batched JavaScript fetches issued through readBatch.
+ */
+export interface FetchStats {
+    requests: number;
+    batches: number;
+    /** Fetches refused because the outstanding limit stayed full */
+    rejected: number;
+    queueDepth: number;
+    maxQueueDepth: number;
+    outstanding: number;
+    /** Time a request waited in the native queue before JavaScript saw it */
+    queueWait: LatencyStats;
+    /** Time from handing a batch to JavaScript until its promise settled */
+    roundTrip: LatencyStats;
+    /** Time each caller waited from asking until the fetch settled, by kind */
+    latency: {
+        fileInfo: LatencyStats;
+        directory: LatencyStats;
+        content: LatencyStats;
+        range: LatencyStats;
+    };
+}
+
+export interface WriteStats {
+    queued: number;
+    /** Folded into a write already queued for the same path */
+    coalesced: number;
+    written: number;
+    failed: number;
+    /** Dropped because the queued bytes were over the limit */
+    rejected: number;
+    /** Queued without their bytes, which are read back from disk when sent */
+    spilled: number;
+    queueDepth: number;
+    inflight: number;
+    /** Payload bytes queued or not yet answered by JavaScript */
+    queuedBytes: number;
+}
+
+export interface ObjectInfoStats {
+    hits: number;
+    misses: number;
+    /** Entries replaced because their bucket was full */
+    evictions: number;
+    entries: number;
+    capacity: number;
+    /** Distinct object types interned */
+    types: number;
+}
+
+export interface ThreadPoolStats {
+    threads: number;
+    executed: number;
+    /** Taken from another worker's queue */
+    stolen: number;
+    /** Ended by an exception */
+    failed: number;
+    foregroundQueued: number;
+    backgroundQueued: number;
+    /** Waiting for their start time, such as periodic snapshot saves */
+    delayed: number;
+}
+
+export interface LatencyStats {
+    count: number;
+    meanUs: number;
+    p50Us: number;
+    p90Us: number;
+    p99Us: number;
+    p999Us: number;
+    maxUs: number;
+}
+
+export interface CacheTierStats {
+    hits: number;
+    misses: number;
+    inserts: number;
+    evictions: number;
+    expirations: number;
+    entries: number;
+    bytes: number;
+    budget: number;
+    lookupLatency: LatencyStats;
+}
+
+export interface CacheStats {
+    hits: number;
+    misses: number;
+    entries: number;
+    memoryUsage: number;
+    fileInfo: CacheTierStats;
+    directory: CacheTierStats;
+    content: CacheTierStats;
+    chunks: CacheTierStats;
+    /** Names JavaScript reported as missing that are still remembered */
+    negativeEntries: number;
+    negativeHits: number;
 }
 
 export declare class IFSProjFSProvider extends EventEmitter {
+    /**
+     * Set the cache budget shared by every provider in this process that has
+     * no cacheBudget of its own; omitted tiers keep their current budget
+     */
+    static setSharedCacheBudget(budget: CacheBudget): void;
+
     /**
      * Create a new ProjFS provider for a ONE instance
      */
@@ -33,8 +313,17 @@ export declare class IFSProjFSProvider extends EventEmitter {
     registerCallbacks(callbacks: {
         getFileInfo?: (path: string) => Promise<any>;
         readFile?: (path: string) => Promise<Buffer>;
+        /**
+         * Serves files over 1 MB in 256 KB ranges instead of whole. Without it
+         * they go through readFile. A chunk shorter than the listed size fails the read.
+         */
+        readFileRange?: (path: string, offset: number, length: number) => Promise<Buffer | null>;
         readDirectory?: (path: string) => Promise<any[]>;
         createFile?: (path: string, content: Buffer) => Promise<void>;
+        updateFile?: (path: string, content: Buffer) => Promise<void>;
+        deleteFile?: (path: string) => Promise<void>;
+        /** Answers queued fetches together; replaces the three per-path callbacks natively */
+        readBatch?: (requests: Array<{ kind: 'fileInfo' | 'directory' | 'content'; path: string }>) => Promise<any[]>;
     }): void;
 
     /**
@@ -57,8 +346,34 @@ export declare class IFSProjFSProvider extends EventEmitter {
      */
     getStats(): ProviderStats;
 
+    /**
+     * Cache many directory listings and the FileInfo of each of their entries
+     * in a single native call. Entries use the shape returned by readDirectory.
+     */
+    setCachedTree(directories: Array<{ path: string; entries: any[] }>): void;
+
+    /**
+     * Enable, disable or retune read-ahead after directory enumeration
+     */
+    setPrefetchOptions(options: PrefetchOptions): void;
+    /** Refresh hydrated copies of changed paths; resolves to null without native support */
+    updatePaths(paths: string[]): Promise<PathUpdateResult | null>;
+    /** Patch cached listings with per-directory deltas; null without native support */
+    applyChanges(changes: DirectoryChange[]): ChangeResult | null;
+
     /**
      * Enable/disable debug mode
      */
     setDebug(enabled: boolean): void;
+
+    /**
+     * Set the native log level at runtime. Levels below the compiled-in
+     * minimum (debug, unless built with PROJFS_LOG_COMPILED_LEVEL=0) stay silent.
+     */
+    setLogLevel(level: LogLevel): void;
+
+    /**
+     * Get the current native log level
+     */
+    getLogLevel(): LogLevel;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "async_bridge.h"
+#include "log.h"
+#include "trace.h"
+#include <algorithm>
 #include <thread>
-#include <iostream>
 
 namespace oneifsprojfs {
 
@@ -13,11 +15,10 @@ AsyncBridge::~AsyncBridge() {
 }
 
 void AsyncBridge::EmitDebugMessage(const std::string& message) {
-    if (!onDebugMessageCallback_) return;
-    
-    onDebugMessageCallback_.NonBlockingCall([message](Napi::Env env, Napi::Function jsCallback) {
-        jsCallback.Call({Napi::String::New(env, message)});
-    });
+    // Goes through the logger so it is level-gated and reaches JavaScript batched
+    if (logging::Enabled(LogLevel::Debug)) {
+        logging::Write(LogLevel::Debug, message, true);
+    }
 }
 
 void AsyncBridge::RegisterCallbacks(const Napi::Object& callbacks) {
@@ -47,6 +48,18 @@ void AsyncBridge::RegisterCallbacks(const Napi::Object& callbacks) {
         );
     }
     
+    // Register ranged read callback; large files are streamed through it
+    if (callbacks.Has("readFileRange")) {
+        auto readFileRange = callbacks.Get("readFileRange").As<Napi::Function>();
+        readFileRangeCallback_ = Napi::ThreadSafeFunction::New(
+            env,
+            readFileRange,
+            "readFileRange",
+            0,
+            1
+        );
+    }
+    
     // Register read directory callback
     if (callbacks.Has("readDirectory")) {
         auto readDirectory = callbacks.Get("readDirectory").As<Napi::Function>();
@@ -70,6 +83,39 @@ void AsyncBridge::RegisterCallbacks(const Napi::Object& callbacks) {
             1
         );
     }
+    if (callbacks.Has("updateFile")) {
+        auto updateFile = callbacks.Get("updateFile").As<Napi::Function>();
+        updateFileCallback_ = Napi::ThreadSafeFunction::New(
+            env,
+            updateFile,
+            "updateFile",
+            0,
+            1
+        );
+    }
+    if (callbacks.Has("deleteFile")) {
+        auto deleteFile = callbacks.Get("deleteFile").As<Napi::Function>();
+        deleteFileCallback_ = Napi::ThreadSafeFunction::New(
+            env,
+            deleteFile,
+            "deleteFile",
+            0,
+            1
+        );
+    }
+    
+    // Register batched fetch callback; takes over getFileInfo, readDirectory and
+    // readFile requests when present
+    if (callbacks.Has("readBatch")) {
+        auto readBatch = callbacks.Get("readBatch").As<Napi::Function>();
+        readBatchCallback_ = Napi::ThreadSafeFunction::New(
+            env,
+            readBatch,
+            "readBatch",
+            0,
+            1
+        );
+    }
     
     // Register debug message callback
     if (callbacks.Has("onDebugMessage")) {
@@ -81,148 +127,679 @@ void AsyncBridge::RegisterCallbacks(const Napi::Object& callbacks) {
             0,
             1
         );
+
+        // Forwarded log records arrive here in batches from the log writer
+        // thread; each batch is a single call into JavaScript with an array
+        logging::SetForwardSink([this](std::vector<std::string>&& messages) {
+            auto batch = std::make_shared<std::vector<std::string>>(std::move(messages));
+            onDebugMessageCallback_.NonBlockingCall([batch](Napi::Env env, Napi::Function jsCallback) {
+                Napi::Array array = Napi::Array::New(env, batch->size());
+                for (size_t i = 0; i < batch->size(); i++) {
+                    array.Set(static_cast<uint32_t>(i), Napi::String::New(env, (*batch)[i]));
+                }
+                jsCallback.Call({array});
+            });
+        }, this);
+    }
+}
+
+bool AsyncBridge::JoinFetch(InflightTable& table, const std::string& path, FetchCallback onSettled) {
+    std::lock_guard<std::mutex> lock(inflightMutex_);
+    auto [it, inserted] = table.try_emplace(path);
+    if (onSettled) {
+        it->second.push_back(std::move(onSettled));
+    }
+    if (inserted) {
+        outstandingFetches_++;
+    }
+    return inserted;
+}
+
+void AsyncBridge::SettleFetch(InflightTable& table, const std::string& path, bool resolved) {
+    std::vector<FetchCallback> waiters;
+    {
+        std::lock_guard<std::mutex> lock(inflightMutex_);
+        auto it = table.find(path);
+        if (it == table.end()) {
+            return;
+        }
+        waiters = std::move(it->second);
+        table.erase(it);
+        outstandingFetches_--;
+    }
+    outstandingCv_.notify_all();
+
+    // Run outside the lock, waiters may start new fetches
+    for (auto& waiter : waiters) {
+        waiter(resolved);
+    }
+}
+
+AsyncBridge::InflightTable& AsyncBridge::TableFor(FetchKind kind) {
+    switch (kind) {
+        case FetchKind::FileInfo: return inflightFileInfo_;
+        case FetchKind::Directory: return inflightDirectories_;
+        case FetchKind::Content:
+        case FetchKind::Range: break;
+    }
+    return inflightContent_;
+}
+
+const char* AsyncBridge::FetchKindName(FetchKind kind) {
+    switch (kind) {
+        case FetchKind::FileInfo: return "fileInfo";
+        case FetchKind::Directory: return "directory";
+        case FetchKind::Content: return "content";
+        case FetchKind::Range: break;
+    }
+    return "range";
+}
+
+AsyncBridge::FetchCallback AsyncBridge::TimeFetch(FetchKind kind, const std::string& path, FetchCallback onSettled) {
+    auto askedAt = std::chrono::steady_clock::now();
+    return [this, kind, path, askedAt, onSettled = std::move(onSettled)](bool resolved) {
+        auto elapsed = std::chrono::steady_clock::now() - askedAt;
+        fetchLatency_[static_cast<size_t>(kind)].Record(elapsed);
+        trace::Fetch(FetchKindName(kind), path, resolved, elapsed);
+        if (onSettled) {
+            onSettled(resolved);
+        }
+    };
+}
+
+AsyncBridge::ChunkCallback AsyncBridge::TimeRange(const std::string& path, ChunkCallback onChunk) {
+    auto askedAt = std::chrono::steady_clock::now();
+    return [this, path, askedAt, onChunk = std::move(onChunk)](FileContentPtr chunk) {
+        auto elapsed = std::chrono::steady_clock::now() - askedAt;
+        fetchLatency_[static_cast<size_t>(FetchKind::Range)].Record(elapsed);
+        trace::Fetch(FetchKindName(FetchKind::Range), path, chunk != nullptr, elapsed);
+        onChunk(std::move(chunk));
+    };
+}
+
+bool AsyncBridge::EnqueueFetch(FetchKind kind, const std::string& path, FetchCallback onSettled) {
+    InflightTable& table = TableFor(kind);
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = now + kBackpressureWait;
+    bool schedule = false;
+
+    {
+        std::unique_lock<std::mutex> lock(inflightMutex_);
+        for (;;) {
+            auto it = table.find(path);
+            if (it != table.end()) {
+                // Already queued or in flight, share its answer
+                if (onSettled) {
+                    it->second.push_back(std::move(onSettled));
+                }
+                return true;
+            }
+            if (outstandingFetches_ < kMaxOutstandingFetches) {
+                break;
+            }
+            // Backpressure: hold the ProjFS thread until JavaScript catches up
+            if (outstandingCv_.wait_until(lock, deadline) == std::cv_status::timeout &&
+                outstandingFetches_ >= kMaxOutstandingFetches) {
+                rejectedFetches_.Add();
+                PROJFS_WARN("[AsyncBridge] Fetch queue full, rejecting " << path);
+                return false;
+            }
+        }
+
+        auto& waiters = table[path];
+        if (onSettled) {
+            waiters.push_back(std::move(onSettled));
+        }
+        outstandingFetches_++;
+        batchQueue_.push_back({kind, path, now});
+        maxQueueDepth_ = (std::max)(maxQueueDepth_, batchQueue_.size());
+
+        schedule = !batchScheduled_;
+        batchScheduled_ = true;
+    }
+
+    if (schedule) {
+        ScheduleBatch();
     }
+    return true;
 }
 
-void AsyncBridge::FetchFileInfo(const std::string& path) {
-    if (!getFileInfoCallback_) return;
+void AsyncBridge::ScheduleBatch() {
+    napi_status status = readBatchCallback_.NonBlockingCall([this](Napi::Env env, Napi::Function jsCallback) {
+        DispatchBatch(env, jsCallback);
+    });
+    if (status == napi_ok) {
+        return;
+    }
+
+    // The call never reached JavaScript (queue closing), fail what is queued
+    std::deque<QueuedFetch> queued;
+    {
+        std::lock_guard<std::mutex> lock(inflightMutex_);
+        std::swap(queued, batchQueue_);
+        batchScheduled_ = false;
+    }
+    for (const auto& fetch : queued) {
+        SettleFetch(TableFor(fetch.kind), fetch.path, false);
+    }
+}
+
+void AsyncBridge::DispatchBatch(Napi::Env env, Napi::Function jsCallback) {
+    // Everything queued since the last tick goes out together
+    auto batch = std::make_shared<std::vector<QueuedFetch>>();
+    bool more = false;
+    {
+        std::lock_guard<std::mutex> lock(inflightMutex_);
+        size_t count = (std::min)(batchQueue_.size(), kMaxBatchSize);
+        batch->reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            batch->push_back(std::move(batchQueue_.front()));
+            batchQueue_.pop_front();
+        }
+        more = !batchQueue_.empty();
+        batchScheduled_ = more;
+    }
+    if (more) {
+        ScheduleBatch();  // The rest goes out on the next tick
+    }
+    if (batch->empty()) {
+        return;
+    }
+
+    auto sentAt = std::chrono::steady_clock::now();
+    Napi::Array requests = Napi::Array::New(env, batch->size());
+    for (size_t i = 0; i < batch->size(); i++) {
+        const QueuedFetch& fetch = (*batch)[i];
+        queueWait_.Record(sentAt - fetch.queuedAt);
+
+        Napi::Object request = Napi::Object::New(env);
+        request.Set("kind", Napi::String::New(env, FetchKindName(fetch.kind)));
+        request.Set("path", Napi::String::New(env, fetch.path));
+        requests.Set(static_cast<uint32_t>(i), request);
+    }
+    fetchRequests_.Add(batch->size());
+    fetchBatches_.Add();
+
+    auto failAll = [this, batch]() {
+        for (const auto& fetch : *batch) {
+            SettleFetch(TableFor(fetch.kind), fetch.path, false);
+        }
+    };
+
+    Napi::Value result;
+    try {
+        result = jsCallback.Call({requests});
+    } catch (const Napi::Error& e) {
+        PROJFS_WARN("[AsyncBridge] readBatch threw for " << batch->size() << " requests: " << e.Message());
+        failAll();
+        return;
+    }
+    if (!result.IsPromise()) {
+        failAll();
+        return;
+    }
+
+    auto promise = result.As<Napi::Promise>();
+    auto thenFunc = promise.Get("then").As<Napi::Function>();
+
+    auto onResolve = Napi::Function::New(env, [this, batch, sentAt, failAll](const Napi::CallbackInfo& info) {
+        auto env = info.Env();
+        roundTrip_.Record(std::chrono::steady_clock::now() - sentAt);
+        if (info.Length() == 0 || !info[0].IsArray()) {
+            failAll();
+            return env.Undefined();
+        }
+
+        // Results line up with the requests; missing slots count as failures
+        Napi::Array results = info[0].As<Napi::Array>();
+        for (size_t i = 0; i < batch->size(); i++) {
+            Napi::Value value = i < results.Length() ? results.Get(static_cast<uint32_t>(i)) : env.Undefined();
+            SettleBatchEntry((*batch)[i], value);
+        }
+        return env.Undefined();
+    });
+
+    auto onReject = Napi::Function::New(env, [this, batch, sentAt, failAll](const Napi::CallbackInfo& info) {
+        auto env = info.Env();
+        roundTrip_.Record(std::chrono::steady_clock::now() - sentAt);
+        PROJFS_WARN("[AsyncBridge] readBatch rejected for " << batch->size() << " requests");
+        failAll();
+        return env.Undefined();
+    });
+
+    thenFunc.Call(promise, {onResolve, onReject});
+}
+
+void AsyncBridge::SettleBatchEntry(const QueuedFetch& fetch, const Napi::Value& result) {
+    // undefined marks a failed fetch; null means JavaScript found nothing
+    bool resolved = false;
+    switch (fetch.kind) {
+        case FetchKind::FileInfo:
+            if (result.IsObject()) {
+                cache_->SetFileInfo(fetch.path, ParseFileInfo(result.As<Napi::Object>()));
+                resolved = true;
+            } else if (result.IsNull()) {
+                // JavaScript answered: there is no such file
+                cache_->SetMissing(fetch.path);
+            }
+            break;
+
+        case FetchKind::Directory:
+            // JavaScript caches the listing itself before answering
+            resolved = !result.IsUndefined();
+            if (result.IsArray() && directoryListingUpdatedCallback_) {
+                directoryListingUpdatedCallback_(fetch.path);
+            }
+            break;
+
+        case FetchKind::Content:
+            if (result.IsBuffer()) {
+                auto buffer = result.As<Napi::Buffer<uint8_t>>();
+                cache_->SetFileContent(fetch.path, FileContent::Copy(buffer.Data(), buffer.Length(),
+                                                                     cache_->ContentHash(fetch.path, buffer.Length())));
+                resolved = true;
+            }
+            break;
+
+        case FetchKind::Range:
+            // Ranged reads go through readFileRange, never through readBatch
+            break;
+    }
+    SettleFetch(TableFor(fetch.kind), fetch.path, resolved);
+}
+
+AsyncBridge::FetchStats AsyncBridge::GetFetchStats() const {
+    FetchStats stats;
+    stats.requests = fetchRequests_.Load();
+    stats.batches = fetchBatches_.Load();
+    stats.rejected = rejectedFetches_.Load();
+    {
+        std::lock_guard<std::mutex> lock(inflightMutex_);
+        stats.queueDepth = batchQueue_.size();
+        stats.maxQueueDepth = maxQueueDepth_;
+        stats.outstanding = outstandingFetches_;
+    }
+    stats.queueWait = queueWait_.GetSnapshot();
+    stats.roundTrip = roundTrip_.GetSnapshot();
+    for (size_t kind = 0; kind < kFetchKindCount; kind++) {
+        stats.latency[kind] = fetchLatency_[kind].GetSnapshot();
+    }
+    return stats;
+}
+
+bool AsyncBridge::FetchFileInfo(const std::string& path, FetchCallback onSettled) {
+    onSettled = TimeFetch(FetchKind::FileInfo, path, std::move(onSettled));
+    if (readBatchCallback_) {
+        return EnqueueFetch(FetchKind::FileInfo, path, std::move(onSettled));
+    }
+    if (!getFileInfoCallback_) return false;
+
+    if (!JoinFetch(inflightFileInfo_, path, std::move(onSettled))) {
+        // Already being fetched
+        return true;
+    }
     
     // Call JavaScript async function
-    getFileInfoCallback_.NonBlockingCall([this, path](Napi::Env env, Napi::Function jsCallback) {
+    napi_status status = getFileInfoCallback_.NonBlockingCall([this, path](Napi::Env env, Napi::Function jsCallback) {
         // Call the JavaScript function with path
-        auto result = jsCallback.Call({Napi::String::New(env, path)});
+        Napi::Value result;
+        try {
+            result = jsCallback.Call({Napi::String::New(env, path)});
+        } catch (const Napi::Error& e) {
+            PROJFS_WARN("[AsyncBridge] getFileInfo threw for " << path << ": " << e.Message());
+            SettleFetch(inflightFileInfo_, path, false);
+            return;
+        }
         
         // Handle the promise
-        if (result.IsPromise()) {
-            auto promise = result.As<Napi::Promise>();
-            auto thenFunc = promise.Get("then").As<Napi::Function>();
-            
-            // Create callback for promise resolution
-            auto onResolve = Napi::Function::New(env, [this, path](const Napi::CallbackInfo& info) {
-                auto env = info.Env();
-                if (info.Length() > 0 && info[0].IsObject()) {
-                    auto fileInfo = ParseFileInfo(info[0].As<Napi::Object>());
-                    cache_->SetFileInfo(path, fileInfo);
-                }
-                return env.Undefined();
-            });
-            
-            thenFunc.Call(promise, {onResolve});
+        if (!result.IsPromise()) {
+            SettleFetch(inflightFileInfo_, path, false);
+            return;
         }
+
+        auto promise = result.As<Napi::Promise>();
+        auto thenFunc = promise.Get("then").As<Napi::Function>();
+        
+        // Create callback for promise resolution
+        auto onResolve = Napi::Function::New(env, [this, path](const Napi::CallbackInfo& info) {
+            auto env = info.Env();
+            bool found = info.Length() > 0 && info[0].IsObject();
+            if (found) {
+                auto fileInfo = ParseFileInfo(info[0].As<Napi::Object>());
+                cache_->SetFileInfo(path, fileInfo);
+            } else {
+                // JavaScript answered: there is no such file
+                cache_->SetMissing(path);
+            }
+            SettleFetch(inflightFileInfo_, path, found);
+            return env.Undefined();
+        });
+
+        auto onReject = Napi::Function::New(env, [this, path](const Napi::CallbackInfo& info) {
+            auto env = info.Env();
+            SettleFetch(inflightFileInfo_, path, false);
+            return env.Undefined();
+        });
+        
+        thenFunc.Call(promise, {onResolve, onReject});
     });
-}
 
-void AsyncBridge::FetchDirectoryListing(const std::string& path) {
-    std::cout << "[AsyncBridge-DEBUG] FetchDirectoryListing ENTRY for path: " << path << std::endl;
+    if (status != napi_ok) {
+        // The call never reached JavaScript (queue closing), do not leave waiters hanging
+        SettleFetch(inflightFileInfo_, path, false);
+    }
+    return true;
+}
 
+bool AsyncBridge::FetchDirectoryListing(const std::string& path, FetchCallback onSettled) {
+    onSettled = TimeFetch(FetchKind::Directory, path, std::move(onSettled));
+    if (readBatchCallback_) {
+        PROJFS_DEBUG_JS("[AsyncBridge] FetchDirectoryListing queued for path: " << path);
+        return EnqueueFetch(FetchKind::Directory, path, std::move(onSettled));
+    }
     if (!readDirectoryCallback_) {
-        std::cout << "[AsyncBridge-DEBUG] ERROR: No readDirectoryCallback registered!" << std::endl;
-        EmitDebugMessage("[AsyncBridge] FetchDirectoryListing called but no callback registered for path: " + path);
-        return;
+        PROJFS_WARN("[AsyncBridge] FetchDirectoryListing called but no callback registered for path: " << path);
+        return false;
     }
 
-    std::cout << "[AsyncBridge-DEBUG] readDirectoryCallback is registered, calling NonBlockingCall" << std::endl;
-    EmitDebugMessage("[AsyncBridge] FetchDirectoryListing called for path: " + path);
+    if (!JoinFetch(inflightDirectories_, path, std::move(onSettled))) {
+        // Someone is already fetching this directory, wait for the same result
+        return true;
+    }
 
-    readDirectoryCallback_.NonBlockingCall([this, path](Napi::Env env, Napi::Function jsCallback) {
-        std::cout << "[AsyncBridge-DEBUG] Inside NonBlockingCall lambda for path: " << path << std::endl;
-        EmitDebugMessage("[AsyncBridge] Calling JavaScript readDirectory for path: " + path);
-        std::cout << "[AsyncBridge-DEBUG] About to call jsCallback.Call" << std::endl;
-        auto result = jsCallback.Call({Napi::String::New(env, path)});
-        std::cout << "[AsyncBridge-DEBUG] jsCallback.Call returned" << std::endl;
+    PROJFS_DEBUG_JS("[AsyncBridge] FetchDirectoryListing called for path: " << path);
 
-        if (result.IsPromise()) {
-            std::cout << "[AsyncBridge-DEBUG] Result is a Promise" << std::endl;
-            auto promise = result.As<Napi::Promise>();
-            auto thenFunc = promise.Get("then").As<Napi::Function>();
-            
-            auto onResolve = Napi::Function::New(env, [this, path](const Napi::CallbackInfo& info) {
-                auto env = info.Env();
-                if (info.Length() > 0 && info[0].IsArray()) {
-                    // DISABLED: Let JavaScript handle caching via setCachedDirectory
-                    // This prevents double-caching and data corruption
-                    // auto listing = ParseDirectoryListing(info[0].As<Napi::Array>());
-                    // cache_->SetDirectoryListing(path, listing);
-                    
-                    // Still notify the provider that directory listing has been updated
-                    if (directoryListingUpdatedCallback_) {
-                        directoryListingUpdatedCallback_(path);
-                    }
-                }
-                return env.Undefined();
-            });
-            
-            thenFunc.Call(promise, {onResolve});
+    napi_status status = readDirectoryCallback_.NonBlockingCall([this, path](Napi::Env env, Napi::Function jsCallback) {
+        Napi::Value result;
+        try {
+            result = jsCallback.Call({Napi::String::New(env, path)});
+        } catch (const Napi::Error& e) {
+            PROJFS_WARN("[AsyncBridge] readDirectory threw for " << path << ": " << e.Message());
+            SettleFetch(inflightDirectories_, path, false);
+            return;
+        }
+
+        if (!result.IsPromise()) {
+            // Synchronous callbacks have already populated the cache
+            SettleFetch(inflightDirectories_, path, true);
+            return;
         }
+
+        auto promise = result.As<Napi::Promise>();
+        auto thenFunc = promise.Get("then").As<Napi::Function>();
+
+        auto onResolve = Napi::Function::New(env, [this, path](const Napi::CallbackInfo& info) {
+            auto env = info.Env();
+            // JavaScript caches the listing itself via setCachedDirectory before
+            // resolving, so only the waiters need to be told
+            if (info.Length() > 0 && info[0].IsArray() && directoryListingUpdatedCallback_) {
+                directoryListingUpdatedCallback_(path);
+            }
+            SettleFetch(inflightDirectories_, path, true);
+            return env.Undefined();
+        });
+
+        auto onReject = Napi::Function::New(env, [this, path](const Napi::CallbackInfo& info) {
+            auto env = info.Env();
+            PROJFS_WARN("[AsyncBridge] readDirectory rejected for " << path);
+            SettleFetch(inflightDirectories_, path, false);
+            return env.Undefined();
+        });
+
+        thenFunc.Call(promise, {onResolve, onReject});
     });
+
+    if (status != napi_ok) {
+        // The call never reached JavaScript (queue closing), do not leave waiters hanging
+        SettleFetch(inflightDirectories_, path, false);
+    }
+    return true;
 }
 
-void AsyncBridge::FetchFileContent(const std::string& path) {
-    std::cout << "[TEST-1.1] FetchFileContent ENTRY: path='" << path << "'" << std::endl;
+bool AsyncBridge::FetchFileContent(const std::string& path, FetchCallback onSettled) {
+    PROJFS_TRACE("[TEST-1.1] FetchFileContent ENTRY: path='" << path << "'");
+    onSettled = TimeFetch(FetchKind::Content, path, std::move(onSettled));
+
+    if (readBatchCallback_) {
+        return EnqueueFetch(FetchKind::Content, path, std::move(onSettled));
+    }
 
     if (!readFileCallback_) {
-        std::cout << "[TEST-1.1] ERROR: readFileCallback_ is NULL!" << std::endl;
-        return;
+        PROJFS_ERROR("[TEST-1.1] ERROR: readFileCallback_ is NULL!");
+        return false;
     }
-    std::cout << "[TEST-1.1] readFileCallback_ is valid" << std::endl;
+    PROJFS_TRACE("[TEST-1.1] readFileCallback_ is valid");
 
-    readFileCallback_.NonBlockingCall([this, path](Napi::Env env, Napi::Function jsCallback) {
-        std::cout << "[TEST-1.2] Lambda ENTRY: path='" << path << "'" << std::endl;
-        std::cout << "[TEST-1.2] Creating Napi::String from path..." << std::endl;
+    auto settle = std::make_shared<FetchCallback>(std::move(onSettled));
+    napi_status status = readFileCallback_.NonBlockingCall([this, path, settle](Napi::Env env, Napi::Function jsCallback) {
+        PROJFS_TRACE("[TEST-1.2] Lambda ENTRY: path='" << path << "'");
+        PROJFS_TRACE("[TEST-1.2] Creating Napi::String from path...");
 
         auto pathString = Napi::String::New(env, path);
 
-        std::cout << "[TEST-1.3] Napi::String created, value: '"
-                  << pathString.Utf8Value() << "'" << std::endl;
-        std::cout << "[TEST-1.4] jsCallback.IsFunction(): "
-                  << (jsCallback.IsFunction() ? "true" : "false") << std::endl;
-        std::cout << "[TEST-1.4] Calling jsCallback with 1 argument..." << std::endl;
+        PROJFS_TRACE("[TEST-1.3] Napi::String created, value: '"
+                  << pathString.Utf8Value() << "'");
+        PROJFS_TRACE("[TEST-1.4] jsCallback.IsFunction(): "
+                  << (jsCallback.IsFunction() ? "true" : "false"));
+        PROJFS_TRACE("[TEST-1.4] Calling jsCallback with 1 argument...");
 
         auto result = jsCallback.Call({pathString});
 
-        std::cout << "[TEST-1.4] jsCallback returned successfully" << std::endl;
-        std::cout << "[TEST-1.4] result.IsPromise(): "
-                  << (result.IsPromise() ? "true" : "false") << std::endl;
+        PROJFS_TRACE("[TEST-1.4] jsCallback returned successfully");
+        PROJFS_TRACE("[TEST-1.4] result.IsPromise(): "
+                  << (result.IsPromise() ? "true" : "false"));
         
         if (result.IsPromise()) {
             auto promise = result.As<Napi::Promise>();
             auto thenFunc = promise.Get("then").As<Napi::Function>();
             
-            auto onResolve = Napi::Function::New(env, [this, path](const Napi::CallbackInfo& info) {
+            auto onResolve = Napi::Function::New(env, [this, path, settle](const Napi::CallbackInfo& info) {
                 auto env = info.Env();
+                bool resolved = false;
                 if (info.Length() > 0 && info[0].IsBuffer()) {
                     auto buffer = info[0].As<Napi::Buffer<uint8_t>>();
-                    std::vector<uint8_t> data(buffer.Data(), buffer.Data() + buffer.Length());
-                    
-                    FileContent content;
-                    content.data = std::move(data);
-                    cache_->SetFileContent(path, content);
+                    cache_->SetFileContent(path, FileContent::Copy(buffer.Data(), buffer.Length(),
+                                                                   cache_->ContentHash(path, buffer.Length())));
+                    resolved = true;
                 }
+                if (*settle) (*settle)(resolved);
                 return env.Undefined();
             });
+
+            auto onReject = Napi::Function::New(env, [settle](const Napi::CallbackInfo& info) {
+                if (*settle) (*settle)(false);
+                return info.Env().Undefined();
+            });
             
-            thenFunc.Call(promise, {onResolve});
+            thenFunc.Call(promise, {onResolve, onReject});
+        } else if (*settle) {
+            (*settle)(false);
         }
     });
+    return status == napi_ok;
 }
 
-void AsyncBridge::QueueCreateFile(const std::string& path, const std::vector<uint8_t>& content) {
-    std::lock_guard<std::mutex> lock(writeQueueMutex_);
-    writeQueue_.push({WriteOperation::CREATE, path, content});
+bool AsyncBridge::FetchFileRange(const std::string& path, uint64_t offset, size_t length,
+                                 const std::string& hash, ChunkCallback onChunk) {
+    if (!readFileRangeCallback_) {
+        return false;
+    }
+    onChunk = TimeRange(path, std::move(onChunk));
+
+    std::string key = path;
+    key.push_back('\0');
+    key += std::to_string(offset);
+    {
+        std::lock_guard<std::mutex> lock(inflightMutex_);
+        auto [it, inserted] = inflightRanges_.try_emplace(key);
+        it->second.push_back(std::move(onChunk));
+        if (!inserted) {
+            return true;  // Someone already asked for this range
+        }
+    }
+    fetchRequests_.Add();
+
+    napi_status status = readFileRangeCallback_.NonBlockingCall(
+        [this, path, offset, length, hash, key](Napi::Env env, Napi::Function jsCallback) {
+        Napi::Value result;
+        try {
+            result = jsCallback.Call({Napi::String::New(env, path),
+                                      Napi::Number::New(env, static_cast<double>(offset)),
+                                      Napi::Number::New(env, static_cast<double>(length))});
+        } catch (const Napi::Error& e) {
+            PROJFS_WARN("[AsyncBridge] readFileRange threw for " << path << ": " << e.Message());
+            SettleRange(key, nullptr);
+            return;
+        }
+        if (!result.IsPromise()) {
+            SettleRange(key, nullptr);
+            return;
+        }
+
+        auto promise = result.As<Napi::Promise>();
+        auto thenFunc = promise.Get("then").As<Napi::Function>();
+
+        auto onResolve = Napi::Function::New(env, [this, key, length, hash](const Napi::CallbackInfo& info) {
+            FileContentPtr chunk;
+            if (info.Length() > 0 && info[0].IsBuffer()) {
+                // Copied once into an aligned block that ProjFS and the cache share
+                auto buffer = info[0].As<Napi::Buffer<uint8_t>>();
+                chunk = FileContent::Copy(buffer.Data(), (std::min)(buffer.Length(), length), hash);
+            }
+            SettleRange(key, std::move(chunk));
+            return info.Env().Undefined();
+        });
+
+        auto onReject = Napi::Function::New(env, [this, key, path](const Napi::CallbackInfo& info) {
+            PROJFS_WARN("[AsyncBridge] readFileRange rejected for " << path);
+            SettleRange(key, nullptr);
+            return info.Env().Undefined();
+        });
+
+        thenFunc.Call(promise, {onResolve, onReject});
+    });
+
+    if (status != napi_ok) {
+        // The call never reached JavaScript (queue closing), do not leave waiters hanging
+        SettleRange(key, nullptr);
+    }
+    return true;
 }
 
-void AsyncBridge::QueueUpdateFile(const std::string& path, const std::vector<uint8_t>& content) {
-    std::lock_guard<std::mutex> lock(writeQueueMutex_);
-    writeQueue_.push({WriteOperation::UPDATE, path, content});
+void AsyncBridge::SettleRange(const std::string& key, FileContentPtr chunk) {
+    std::vector<ChunkCallback> waiters;
+    {
+        std::lock_guard<std::mutex> lock(inflightMutex_);
+        auto it = inflightRanges_.find(key);
+        if (it == inflightRanges_.end()) {
+            return;
+        }
+        waiters = std::move(it->second);
+        inflightRanges_.erase(it);
+    }
+    // Run outside the lock, waiters ask for the next range
+    for (auto& waiter : waiters) {
+        waiter(chunk);
+    }
+}
+
+bool AsyncBridge::QueueCreateFile(const std::string& path, WritePayload content, WriteSource reread) {
+    return QueueWrite(WriteOperation::CREATE, path, std::move(content), std::move(reread));
+}
+
+bool AsyncBridge::QueueUpdateFile(const std::string& path, WritePayload content, WriteSource reread) {
+    return QueueWrite(WriteOperation::UPDATE, path, std::move(content), std::move(reread));
 }
 
-void AsyncBridge::QueueDeleteFile(const std::string& path) {
+bool AsyncBridge::QueueDeleteFile(const std::string& path) {
+    return QueueWrite(WriteOperation::DELETE_FILE, path, nullptr, nullptr);
+}
+
+bool AsyncBridge::QueueWrite(WriteOperation::Type type, const std::string& path, WritePayload content,
+                             WriteSource reread) {
+    if (!createFileCallback_ || (type == WriteOperation::DELETE_FILE && !deleteFileCallback_)) {
+        return false;
+    }
+    size_t bytes = content ? content->size() : 0;
+
+    std::unique_lock<std::mutex> lock(writeQueueMutex_);
+    if (writerStop_) {
+        return false;
+    }
+    // The payload replaces whatever is queued for the path, so that is room too.
+    // An empty queue always takes one, however large.
+    auto queued = writeQueue_.find(path);
+    size_t freed = queued != writeQueue_.end() ? queued->second.Bytes() : 0;
+    if (queuedWriteBytes_ - freed + bytes > kMaxQueuedWriteBytes && queuedWriteBytes_ != freed) {
+        if (!reread) {
+            writeStats_.rejected++;
+            PROJFS_WARN("[AsyncBridge] Write-back queue full, dropped write of " << path);
+            return false;
+        }
+        // The notification thread is not held up; the worker reads it again
+        writeStats_.spilled++;
+        content = nullptr;
+        bytes = 0;
+    } else {
+        reread = nullptr;
+    }
+    writeStats_.queued++;
+
+    auto [it, inserted] = writeQueue_.try_emplace(path);
+    WriteOperation& op = it->second;
+    if (inserted) {
+        op = {type, path, std::move(content), std::move(reread)};
+        writeOrder_.push_back(path);
+    } else {
+        writeStats_.coalesced++;
+        queuedWriteBytes_ -= op.Bytes();
+        if (op.type == WriteOperation::CREATE && type == WriteOperation::DELETE_FILE) {
+            // JavaScript never saw the file
+            writeQueue_.erase(it);
+            return true;
+        }
+        if (op.type != WriteOperation::CREATE) {
+            op.type = type;
+        }
+        op.content = std::move(content);
+        op.reread = std::move(reread);
+    }
+    queuedWriteBytes_ += bytes;
+    lock.unlock();
+    writeCv_.notify_all();
+    return true;
+}
+
+bool AsyncBridge::TakeNextWrite(WriteOperation& op, bool ignoreInflight) {
+    for (auto it = writeOrder_.begin(); it != writeOrder_.end();) {
+        auto queued = writeQueue_.find(*it);
+        if (queued == writeQueue_.end()) {
+            it = writeOrder_.erase(it);  // Dropped while queued
+            continue;
+        }
+        if (!ignoreInflight && writesInflight_.count(*it) > 0) {
+            ++it;
+            continue;
+        }
+        op = std::move(queued->second);
+        writeQueue_.erase(queued);
+        writeOrder_.erase(it);
+        return true;
+    }
+    return false;
+}
+
+AsyncBridge::WriteStats AsyncBridge::GetWriteStats() const {
     std::lock_guard<std::mutex> lock(writeQueueMutex_);
-    writeQueue_.push({WriteOperation::DELETE_FILE, path, {}});
+    WriteStats stats = writeStats_;
+    stats.queueDepth = writeQueue_.size();
+    stats.inflight = writesInflight_.size();
+    stats.queuedBytes = queuedWriteBytes_;
+    return stats;
 }
 
 FileInfo AsyncBridge::ParseFileInfo(const Napi::Object& jsObject) {
-    FileInfo info;
+    FileInfo info = {};
     
     if (jsObject.Has("name")) {
         info.name = jsObject.Get("name").As<Napi::String>().Utf8Value();
@@ -231,7 +808,7 @@ FileInfo AsyncBridge::ParseFileInfo(const Napi::Object& jsObject) {
         info.hash = jsObject.Get("hash").As<Napi::String>().Utf8Value();
     }
     if (jsObject.Has("size")) {
-        info.size = jsObject.Get("size").As<Napi::Number>().Uint32Value();
+        info.size = static_cast<size_t>(std::max<int64_t>(0, jsObject.Get("size").As<Napi::Number>().Int64Value()));
     }
     if (jsObject.Has("isDirectory")) {
         info.isDirectory = jsObject.Get("isDirectory").As<Napi::Boolean>().Value();
@@ -242,6 +819,9 @@ FileInfo AsyncBridge::ParseFileInfo(const Napi::Object& jsObject) {
     if (jsObject.Has("mode")) {
         info.mode = jsObject.Get("mode").As<Napi::Number>().Uint32Value();
     }
+    if (jsObject.Has("mtime") && jsObject.Get("mtime").IsNumber()) {
+        info.mtime = static_cast<uint64_t>(std::max<int64_t>(0, jsObject.Get("mtime").As<Napi::Number>().Int64Value()));
+    }
     
     return info;
 }
@@ -263,16 +843,56 @@ void AsyncBridge::Start() {
     running_ = true;
     
     // Start background thread for write queue processing
-    std::thread([this]() {
-        while (running_) {
-            ProcessWriteQueue();
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (!writeWorker_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(writeQueueMutex_);
+            writerStop_ = false;
         }
-    }).detach();
+        writeWorker_ = std::thread(&AsyncBridge::ProcessWriteQueue, this);
+    }
 }
 
 void AsyncBridge::Stop() {
     running_ = false;
+
+    // The worker hands every queued write to JavaScript before the callbacks
+    // are released below; the calls run once the JS thread is free again
+    {
+        std::lock_guard<std::mutex> lock(writeQueueMutex_);
+        writerStop_ = true;
+    }
+    writeCv_.notify_all();
+    if (writeWorker_.joinable()) {
+        writeWorker_.join();
+    }
+
+    // Fail any fetch that will no longer be answered
+    InflightTable fileInfo;
+    InflightTable directories;
+    InflightTable content;
+    std::unordered_map<std::string, std::vector<ChunkCallback>> ranges;
+    {
+        std::lock_guard<std::mutex> lock(inflightMutex_);
+        std::swap(fileInfo, inflightFileInfo_);
+        std::swap(directories, inflightDirectories_);
+        std::swap(content, inflightContent_);
+        std::swap(ranges, inflightRanges_);
+        batchQueue_.clear();
+        outstandingFetches_ = 0;
+    }
+    outstandingCv_.notify_all();
+    for (auto* table : {&fileInfo, &directories, &content}) {
+        for (auto& [path, waiters] : *table) {
+            for (auto& waiter : waiters) {
+                waiter(false);
+            }
+        }
+    }
+    for (auto& [key, waiters] : ranges) {
+        for (auto& waiter : waiters) {
+            waiter(nullptr);
+        }
+    }
     
     // Release callbacks
     if (getFileInfoCallback_) {
@@ -281,50 +901,154 @@ void AsyncBridge::Stop() {
     if (readFileCallback_) {
         readFileCallback_.Release();
     }
+    if (readFileRangeCallback_) {
+        readFileRangeCallback_.Release();
+    }
     if (readDirectoryCallback_) {
         readDirectoryCallback_.Release();
     }
     if (createFileCallback_) {
         createFileCallback_.Release();
     }
+    if (updateFileCallback_) {
+        updateFileCallback_.Release();
+    }
+    if (deleteFileCallback_) {
+        deleteFileCallback_.Release();
+    }
+    if (readBatchCallback_) {
+        readBatchCallback_.Release();
+    }
     if (onDebugMessageCallback_) {
+        // Detach from the logger before the callback goes away, unless another
+        // root's bridge has taken the sink over
+        logging::ClearForwardSink(this);
         onDebugMessageCallback_.Release();
     }
 }
 
 void AsyncBridge::ProcessWriteQueue() {
-    std::queue<WriteOperation> toProcess;
-    
-    {
+    std::unique_lock<std::mutex> lock(writeQueueMutex_);
+    for (;;) {
+        WriteOperation op;
+        bool taken = false;
+        while (!writerStop_ &&
+               !(writesInflight_.size() < kMaxWritesInFlight && (taken = TakeNextWrite(op, false)))) {
+            writeCv_.wait(lock);
+        }
+        if (!taken) {
+            break;
+        }
+        if (op.reread) {
+            // A spilled write goes out alone, so at most one payload is over the cap
+            writeCv_.wait(lock, [&] { return writerStop_ || writesInflight_.empty(); });
+        }
+        writesInflight_.insert(op.path);
+        lock.unlock();
+        DispatchWrite(std::move(op));
+        lock.lock();
+    }
+
+    // Stopping: nothing settles while Stop holds the JS thread, so the rest
+    // goes out without waiting for room
+    WriteOperation op;
+    while (TakeNextWrite(op, true)) {
+        writesInflight_.insert(op.path);
+        lock.unlock();
+        DispatchWrite(std::move(op));
+        lock.lock();
+    }
+}
+
+void AsyncBridge::DispatchWrite(WriteOperation op) {
+    if (op.reread) {
+        op.content = op.reread();
+        op.reread = nullptr;
+        if (!op.content) {
+            PROJFS_WARN("[AsyncBridge] Spilled write-back of " << op.path << " could not be read again");
+            SettleWrite(op.path, 0, false);
+            return;
+        }
         std::lock_guard<std::mutex> lock(writeQueueMutex_);
-        std::swap(toProcess, writeQueue_);
+        queuedWriteBytes_ += op.Bytes();
     }
-    
-    while (!toProcess.empty()) {
-        auto& op = toProcess.front();
-        
-        switch (op.type) {
-            case WriteOperation::CREATE:
-                if (createFileCallback_) {
-                    createFileCallback_.NonBlockingCall([op](Napi::Env env, Napi::Function jsCallback) {
-                        auto path = Napi::String::New(env, op.path);
-                        auto content = Napi::Buffer<uint8_t>::Copy(env, op.content.data(), op.content.size());
-                        jsCallback.Call({path, content});
-                    });
-                }
-                break;
-                
-            case WriteOperation::UPDATE:
-                // Similar for update
-                break;
-                
-            case WriteOperation::DELETE_FILE:
-                // Similar for delete
-                break;
+
+    Napi::ThreadSafeFunction* callback = &createFileCallback_;
+    if (op.type == WriteOperation::UPDATE && updateFileCallback_) {
+        callback = &updateFileCallback_;
+    } else if (op.type == WriteOperation::DELETE_FILE) {
+        callback = &deleteFileCallback_;
+    }
+
+    std::string path = op.path;
+    size_t bytes = op.Bytes();
+    auto shared = std::make_shared<WriteOperation>(std::move(op));
+    napi_status status = callback->NonBlockingCall([this, shared](Napi::Env env, Napi::Function jsCallback) {
+        const WriteOperation& op = *shared;
+        size_t bytes = op.Bytes();
+        std::vector<Napi::Value> args = {Napi::String::New(env, op.path)};
+        if (op.type != WriteOperation::DELETE_FILE) {
+            // JavaScript borrows the payload; the finalizer drops the reference.
+            // Where external buffers are not allowed this copies instead.
+            static const uint8_t kEmpty = 0;
+            auto* hold = new WritePayload(op.content);
+            uint8_t* data = op.content && !op.content->empty() ? const_cast<uint8_t*>(op.content->data())
+                                                                : const_cast<uint8_t*>(&kEmpty);
+            args.push_back(Napi::Buffer<uint8_t>::NewOrCopy(
+                env, data, bytes,
+                [](Napi::Env, uint8_t*, WritePayload* payload) { delete payload; },
+                hold));
+        }
+
+        Napi::Value result;
+        try {
+            result = jsCallback.Call(args);
+        } catch (const Napi::Error& e) {
+            PROJFS_WARN("[AsyncBridge] Write-back threw for " << op.path << ": " << e.Message());
+            SettleWrite(op.path, bytes, false);
+            return;
+        }
+        if (!result.IsPromise()) {
+            SettleWrite(op.path, bytes, true);
+            return;
+        }
+
+        auto promise = result.As<Napi::Promise>();
+        auto thenFunc = promise.Get("then").As<Napi::Function>();
+        std::string path = op.path;
+        auto onResolve = Napi::Function::New(env, [this, path, bytes](const Napi::CallbackInfo& info) {
+            SettleWrite(path, bytes, true);
+            return info.Env().Undefined();
+        });
+        auto onReject = Napi::Function::New(env, [this, path, bytes](const Napi::CallbackInfo& info) {
+            PROJFS_WARN("[AsyncBridge] Write-back rejected for " << path);
+            SettleWrite(path, bytes, false);
+            return info.Env().Undefined();
+        });
+        thenFunc.Call(promise, {onResolve, onReject});
+    });
+
+    if (status != napi_ok) {
+        PROJFS_WARN("[AsyncBridge] Write-back of " << path << " never reached JavaScript");
+        SettleWrite(path, bytes, false);
+    }
+}
+
+void AsyncBridge::SettleWrite(const std::string& path, size_t bytes, bool written) {
+    {
+        std::lock_guard<std::mutex> lock(writeQueueMutex_);
+        auto it = writesInflight_.find(path);
+        if (it != writesInflight_.end()) {
+            writesInflight_.erase(it);
+        }
+        queuedWriteBytes_ -= bytes;
+        if (written) {
+            writeStats_.written++;
+        } else {
+            writeStats_.failed++;
         }
-        
-        toProcess.pop();
     }
+    writeCv_.notify_all();
 }
 
 } // namespace oneifsprojfs
\ No newline at end of file
@@ -2,12 +2,21 @@
 #define ASYNC_BRIDGE_H
 
 #include <napi.h>
+#include <array>
 #include <string>
 #include <memory>
 #include <queue>
+#include <deque>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <functional>
 #include "content_cache.h"
+#include "stats.h"
 
 namespace oneifsprojfs {
 
@@ -22,15 +31,91 @@ public:
     // Emit debug message
     void EmitDebugMessage(const std::string& message);
     
-    // Async operations that update cache
-    void FetchFileInfo(const std::string& path);
-    void FetchDirectoryListing(const std::string& path);
-    void FetchFileContent(const std::string& path);
+    // Invoked on the JS thread once a fetch settles; true if the promise
+    // resolved and the result is now in the cache
+    using FetchCallback = std::function<void(bool resolved)>;
+
+    // Single-flight fetches: concurrent callers for the same path share one JS
+    // call and all of their callbacks run when it settles. When JavaScript
+    // registered readBatch, requests are queued and sent together, one call per
+    // event loop tick; once kMaxOutstandingFetches are unanswered, callers wait
+    // up to kBackpressureWait for room. Returns false, without ever invoking
+    // onSettled, if no JavaScript callback is registered or no room was found.
+    bool FetchFileInfo(const std::string& path, FetchCallback onSettled = nullptr);
+    bool FetchDirectoryListing(const std::string& path, FetchCallback onSettled = nullptr);
+
+    // Async operations that update cache. Without readBatch, content fetches are
+    // not coalesced; onSettled still runs once the readFile promise settles.
+    bool FetchFileContent(const std::string& path, FetchCallback onSettled = nullptr);
+
+    // Ranged reads through readFileRange(path, offset, length), for files too
+    // large to hand over whole. Concurrent callers for the same range share one
+    // JS call. onChunk runs on the JS thread with the bytes read, tagged with
+    // hash and fewer than asked at the end of the file, or with nullptr if the
+    // read failed. Returns false, without invoking onChunk, if readFileRange is
+    // not registered.
+    using ChunkCallback = std::function<void(FileContentPtr chunk)>;
+    bool CanReadRanges() const { return static_cast<bool>(readFileRangeCallback_); }
+    bool FetchFileRange(const std::string& path, uint64_t offset, size_t length,
+                        const std::string& hash, ChunkCallback onChunk);
+
+    enum class FetchKind { FileInfo, Directory, Content, Range };
+    static constexpr size_t kFetchKindCount = 4;
+    // As readBatch requests name them
+    static const char* FetchKindName(FetchKind kind);
+
+    struct FetchStats {
+        uint64_t requests = 0;   // Fetches handed to JavaScript
+        uint64_t batches = 0;    // readBatch calls
+        uint64_t rejected = 0;   // Refused because the outstanding limit held
+        size_t queueDepth = 0;   // Waiting for the next batch
+        size_t maxQueueDepth = 0;
+        size_t outstanding = 0;  // Queued or awaiting an answer
+        LatencyHistogram::Snapshot queueWait;  // Enqueue until sent to JavaScript
+        LatencyHistogram::Snapshot roundTrip;  // Sent until the batch settled
+        // Asked for until settled, per caller and by kind; joining callers are
+        // timed from when they joined
+        std::array<LatencyHistogram::Snapshot, kFetchKindCount> latency;
+    };
+    FetchStats GetFetchStats() const;
+
+    static constexpr size_t kMaxOutstandingFetches = 4096;
+    static constexpr size_t kMaxBatchSize = 256;
+    static constexpr std::chrono::milliseconds kBackpressureWait{100};
     
-    // Write operations (queued for async processing)
-    void QueueCreateFile(const std::string& path, const std::vector<uint8_t>& content);
-    void QueueUpdateFile(const std::string& path, const std::vector<uint8_t>& content);
-    void QueueDeleteFile(const std::string& path);
+    // Write-back through createFile(path, content), updateFile(path, content)
+    // and deleteFile(path); updateFile falls back to createFile when missing.
+    // Operations are coalesced per path until a worker hands them over: a newer
+    // write replaces the queued content, a delete replaces a queued write, and
+    // deleting a file whose creation was never sent drops both. Writes to one
+    // path reach JavaScript in order, at most kMaxWritesInFlight at a time.
+    // Payloads queued or unanswered are bounded by kMaxQueuedWriteBytes, and
+    // callers never wait for room: a payload that does not fit is spilled, that
+    // is queued without its bytes, and reread fetches them again on the worker
+    // once no write is in flight. Returns false if the write is not queued: no
+    // callback for it, no room and nothing to reread, or the bridge is stopping.
+    using WritePayload = std::shared_ptr<const std::vector<uint8_t>>;
+    using WriteSource = std::function<WritePayload()>;  // nullptr if the bytes are gone
+    bool CanWrite() const { return static_cast<bool>(createFileCallback_); }
+    bool QueueCreateFile(const std::string& path, WritePayload content, WriteSource reread = nullptr);
+    bool QueueUpdateFile(const std::string& path, WritePayload content, WriteSource reread = nullptr);
+    bool QueueDeleteFile(const std::string& path);
+
+    struct WriteStats {
+        uint64_t queued = 0;     // Operations accepted
+        uint64_t coalesced = 0;  // Folded into one already queued for the path
+        uint64_t written = 0;    // Settled successfully in JavaScript
+        uint64_t failed = 0;     // Rejected, threw or never reached JavaScript
+        uint64_t rejected = 0;   // Refused for lack of room
+        uint64_t spilled = 0;    // Queued without their bytes for lack of room
+        size_t queueDepth = 0;
+        size_t inflight = 0;
+        size_t queuedBytes = 0;
+    };
+    WriteStats GetWriteStats() const;
+
+    static constexpr size_t kMaxQueuedWriteBytes = 64 * 1024 * 1024;
+    static constexpr size_t kMaxWritesInFlight = 4;
     
     // Get cache reference
     std::shared_ptr<ContentCache> GetCache() { return cache_; }
@@ -44,34 +129,101 @@ public:
     void Start();
     void Stop();
 
+    // FileInfo from the object shape getFileInfo resolves with
+    static FileInfo ParseFileInfo(const Napi::Object& jsObject);
+
 private:
     // Callbacks from JavaScript
     Napi::ThreadSafeFunction getFileInfoCallback_;
     Napi::ThreadSafeFunction readFileCallback_;
+    Napi::ThreadSafeFunction readFileRangeCallback_;
     Napi::ThreadSafeFunction readDirectoryCallback_;
     Napi::ThreadSafeFunction createFileCallback_;
     Napi::ThreadSafeFunction updateFileCallback_;
     Napi::ThreadSafeFunction deleteFileCallback_;
     Napi::ThreadSafeFunction onDebugMessageCallback_;
+    Napi::ThreadSafeFunction readBatchCallback_;
     
     // Content cache
     std::shared_ptr<ContentCache> cache_;
     
-    // Write queue
+    // Write queue: one coalesced operation per path, sent in the order paths
+    // were first queued
     struct WriteOperation {
         enum Type { CREATE, UPDATE, DELETE_FILE };
         Type type;
         std::string path;
-        std::vector<uint8_t> content;
+        WritePayload content;
+        WriteSource reread;  // Set while spilled, until content is read again
+        size_t Bytes() const { return content ? content->size() : 0; }
     };
-    std::queue<WriteOperation> writeQueue_;
-    std::mutex writeQueueMutex_;
+    bool QueueWrite(WriteOperation::Type type, const std::string& path, WritePayload content, WriteSource reread);
+    // Takes the oldest operation whose path has no write unanswered, or the
+    // oldest of all when ignoreInflight
+    bool TakeNextWrite(WriteOperation& op, bool ignoreInflight);
+    void DispatchWrite(WriteOperation op);
+    void SettleWrite(const std::string& path, size_t bytes, bool written);
+
+    std::unordered_map<std::string, WriteOperation> writeQueue_;
+    std::deque<std::string> writeOrder_;  // May name paths no longer queued
+    std::unordered_multiset<std::string> writesInflight_;
+    size_t queuedWriteBytes_ = 0;         // Queued and unanswered payloads
+    bool writerStop_ = false;
+    WriteStats writeStats_;
+    mutable std::mutex writeQueueMutex_;
+    std::condition_variable writeCv_;     // Queue, room or in-flight writes changed
+    std::thread writeWorker_;
     
     // Helper methods
+    // Worker loop: sends writes as room allows; on stop hands over the rest
     void ProcessWriteQueue();
-    FileInfo ParseFileInfo(const Napi::Object& jsObject);
     DirectoryListing ParseDirectoryListing(const Napi::Array& jsArray);
     
+    // In-flight fetches keyed by path, with everyone waiting on each
+    using InflightTable = std::unordered_map<std::string, std::vector<FetchCallback>>;
+
+    // Adds a waiter; returns true if the caller has to start the fetch
+    bool JoinFetch(InflightTable& table, const std::string& path, FetchCallback onSettled);
+    // Runs every waiter of an in-flight fetch and forgets it
+    void SettleFetch(InflightTable& table, const std::string& path, bool resolved);
+
+    // Wraps a caller's callback so it records the fetch's latency and trace
+    FetchCallback TimeFetch(FetchKind kind, const std::string& path, FetchCallback onSettled);
+    ChunkCallback TimeRange(const std::string& path, ChunkCallback onChunk);
+
+    // Batched fetches through readBatch
+    struct QueuedFetch {
+        FetchKind kind;
+        std::string path;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+    InflightTable& TableFor(FetchKind kind);
+    bool EnqueueFetch(FetchKind kind, const std::string& path, FetchCallback onSettled);
+    void ScheduleBatch();
+    // Runs on the JS thread: sends up to kMaxBatchSize queued fetches in one call
+    void DispatchBatch(Napi::Env env, Napi::Function jsCallback);
+    void SettleBatchEntry(const QueuedFetch& fetch, const Napi::Value& result);
+
+    mutable std::mutex inflightMutex_;
+    std::condition_variable outstandingCv_;  // Signalled whenever a fetch settles
+    InflightTable inflightFileInfo_;
+    InflightTable inflightDirectories_;
+    InflightTable inflightContent_;
+    // Ranged reads keyed by path and offset
+    std::unordered_map<std::string, std::vector<ChunkCallback>> inflightRanges_;
+    void SettleRange(const std::string& key, FileContentPtr chunk);
+    size_t outstandingFetches_ = 0;
+    std::deque<QueuedFetch> batchQueue_;
+    bool batchScheduled_ = false;  // A DispatchBatch call is queued on the JS thread
+    size_t maxQueueDepth_ = 0;
+
+    StripedCounter fetchRequests_;
+    StripedCounter fetchBatches_;
+    StripedCounter rejectedFetches_;
+    LatencyHistogram queueWait_;
+    LatencyHistogram roundTrip_;
+    std::array<LatencyHistogram, kFetchKindCount> fetchLatency_;
+    
     // Background thread management
     bool running_ = false;
     
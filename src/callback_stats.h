@@ -0,0 +1,81 @@
+#ifndef CALLBACK_STATS_H
+#define CALLBACK_STATS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include "stats.h"
+
+namespace oneifsprojfs {
+
+// The ProjFS callbacks that are timed
+enum class CallbackKind : size_t {
+    PlaceholderInfo,
+    FileData,
+    QueryFileName,
+    StartEnumeration,
+    Enumeration,
+    EndEnumeration,
+    Notification,
+};
+constexpr size_t kCallbackKindCount = 7;
+
+// How a callback was answered: from the native cache, inline without it
+// (storage, disk, not found, or a callback that never consults the cache), or
+// with ERROR_IO_PENDING and completed later
+enum class CallbackOutcome : size_t {
+    Hit,
+    Miss,
+    Pending,
+};
+constexpr size_t kCallbackOutcomeCount = 3;
+
+inline const char* CallbackKindName(CallbackKind kind) {
+    static const char* const kNames[kCallbackKindCount] = {
+        "placeholderInfo", "fileData", "queryFileName", "startEnumeration",
+        "enumeration", "endEnumeration", "notification",
+    };
+    return kNames[static_cast<size_t>(kind)];
+}
+
+inline const char* CallbackOutcomeName(CallbackOutcome outcome) {
+    static const char* const kNames[kCallbackOutcomeCount] = {"hit", "miss", "pending"};
+    return kNames[static_cast<size_t>(outcome)];
+}
+
+// Latency of every ProjFS callback by kind and outcome, and of pending
+// commands from ERROR_IO_PENDING until PrjCompleteCommand
+class CallbackStats {
+public:
+    struct Snapshot {
+        std::array<std::array<LatencyHistogram::Snapshot, kCallbackOutcomeCount>, kCallbackKindCount> latency;
+        std::array<LatencyHistogram::Snapshot, kCallbackKindCount> completion;
+    };
+
+    void Record(CallbackKind kind, CallbackOutcome outcome, std::chrono::nanoseconds elapsed) {
+        latency_[static_cast<size_t>(kind)][static_cast<size_t>(outcome)].Record(elapsed);
+    }
+
+    void RecordCompletion(CallbackKind kind, std::chrono::nanoseconds waited) {
+        completion_[static_cast<size_t>(kind)].Record(waited);
+    }
+
+    Snapshot GetSnapshot() const {
+        Snapshot snapshot;
+        for (size_t kind = 0; kind < kCallbackKindCount; kind++) {
+            for (size_t outcome = 0; outcome < kCallbackOutcomeCount; outcome++) {
+                snapshot.latency[kind][outcome] = latency_[kind][outcome].GetSnapshot();
+            }
+            snapshot.completion[kind] = completion_[kind].GetSnapshot();
+        }
+        return snapshot;
+    }
+
+private:
+    std::array<std::array<LatencyHistogram, kCallbackOutcomeCount>, kCallbackKindCount> latency_;
+    std::array<LatencyHistogram, kCallbackKindCount> completion_;
+};
+
+} // namespace oneifsprojfs
+
+#endif // CALLBACK_STATS_H
@@ -1,190 +1,975 @@
 #include "content_cache.h"
 #include <algorithm>
-#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <unordered_set>
+#include "log.h"
 
 namespace oneifsprojfs {
 
-ContentCache::ContentCache() {
-    // Initialize cache
+namespace {
+
+// Per-entry bookkeeping overhead (list node, index slot, key, timestamps) that
+// is charged against the budget on top of the payload itself
+constexpr size_t kEntryOverhead = 64;
+
+size_t AccountedBytes(const FileInfo& info) {
+    return kEntryOverhead + sizeof(FileInfo) + info.name.size() + info.hash.size();
 }
 
-void ContentCache::SetFileInfo(const std::string& path, const FileInfo& info) {
-    std::unique_lock lock(mutex_);
-    fileInfoCache_[path] = {info, std::chrono::steady_clock::now()};
-    
-    // Periodically clean expired entries
-    static size_t insertCount = 0;
-    if (++insertCount % 100 == 0) {
-        CleanExpiredEntries();
+size_t AccountedBytes(const DirectoryListingPtr& listing) {
+    return kEntryOverhead + listing->Bytes();
+}
+
+size_t AccountedBytes(const FileContentPtr& content) {
+    return kEntryOverhead + sizeof(FileContent) + content->size() + content->hash().size();
+}
+
+uint8_t* AllocateAligned(size_t size) {
+#ifdef _MSC_VER
+    return static_cast<uint8_t*>(_aligned_malloc(size, FileContent::kAlignment));
+#else
+    // aligned_alloc requires the size to be a multiple of the alignment
+    size_t rounded = (size + FileContent::kAlignment - 1) & ~(FileContent::kAlignment - 1);
+    return static_cast<uint8_t*>(std::aligned_alloc(FileContent::kAlignment, rounded));
+#endif
+}
+
+// Orders entries for sorting and merging listings before they are packed
+struct NameLess {
+    NameCompare compare;
+    bool operator()(const FileInfo& a, const FileInfo& b) const { return compare(a.name, b.name) < 0; }
+};
+
+void FreeAligned(uint8_t* data) {
+#ifdef _MSC_VER
+    _aligned_free(data);
+#else
+    std::free(data);
+#endif
+}
+
+} // namespace
+
+int CompareNamesIgnoringCase(std::string_view a, std::string_view b) {
+    size_t length = std::min(a.size(), b.size());
+    for (size_t i = 0; i < length; i++) {
+        unsigned char ca = static_cast<unsigned char>(a[i]);
+        unsigned char cb = static_cast<unsigned char>(b[i]);
+        if (ca >= 'a' && ca <= 'z') ca -= 'a' - 'A';
+        if (cb >= 'a' && cb <= 'z') cb -= 'a' - 'A';
+        if (ca != cb) {
+            return ca < cb ? -1 : 1;
+        }
     }
+    return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
 }
 
-std::optional<FileInfo> ContentCache::GetFileInfo(const std::string& path) const {
-    std::shared_lock lock(mutex_);
-    
-    auto it = fileInfoCache_.find(path);
-    if (it != fileInfoCache_.end() && it->second.IsValid(ttl_)) {
-        hits_++;
-        return it->second.data;
-    }
-    
-    misses_++;
-    return std::nullopt;
-}
-
-void ContentCache::SetDirectoryListing(const std::string& path, const DirectoryListing& listing) {
-    std::unique_lock lock(mutex_);
-    directoryCache_[path] = {listing, std::chrono::steady_clock::now()};
-    
-    std::cout << "[Cache] SetDirectoryListing: Stored " << listing.entries.size() 
-              << " entries for path: '" << path << "'" << std::endl;
-    std::cout << "[Cache] Directory cache now has " << directoryCache_.size() << " paths" << std::endl;
-    
-    // Clean if cache is getting too large
-    if (directoryCache_.size() > 1000) {
-        CleanExpiredEntries();
-    }
-}
-
-std::optional<DirectoryListing> ContentCache::GetDirectoryListing(const std::string& path) const {
-    std::shared_lock lock(mutex_);
-    
-    std::cout << "[Cache] GetDirectoryListing: Looking for path: '" << path << "'" << std::endl;
-    std::cout << "[Cache] Cache contains " << directoryCache_.size() << " paths:" << std::endl;
-    for (const auto& [key, value] : directoryCache_) {
-        std::cout << "[Cache]   - '" << key << "' (" << value.data.entries.size() << " entries)" << std::endl;
-    }
-    
-    auto it = directoryCache_.find(path);
-    if (it != directoryCache_.end()) {
-        if (it->second.IsValid(ttl_)) {
-            hits_++;
-            std::cout << "[Cache] HIT: Found " << it->second.data.entries.size() 
-                      << " entries for '" << path << "'" << std::endl;
-            return it->second.data;
-        } else {
-            std::cout << "[Cache] EXPIRED: Entry for '" << path << "' is too old" << std::endl;
+// FileContent
+
+std::shared_ptr<const FileContent> FileContent::Copy(const uint8_t* data, size_t size, const std::string& hash) {
+    uint8_t* buffer = nullptr;
+    if (size > 0) {
+        buffer = AllocateAligned(size);
+        if (!buffer) {
+            throw std::bad_alloc();
         }
-    } else {
-        std::cout << "[Cache] MISS: No entry for '" << path << "'" << std::endl;
+        memcpy(buffer, data, size);
     }
-    
-    misses_++;
-    return std::nullopt;
+    return std::shared_ptr<const FileContent>(new FileContent(buffer, size, hash));
 }
 
-void ContentCache::SetFileContent(const std::string& path, const FileContent& content) {
-    std::unique_lock lock(mutex_);
-    
-    // Only cache small files to avoid memory bloat
-    if (content.data.size() <= 1024 * 1024) { // 1MB limit
-        contentCache_[path] = {content, std::chrono::steady_clock::now()};
-        
-        // Clean if content cache is getting too large
-        if (contentCache_.size() > 100) {
-            CleanExpiredEntries();
+FileContent::~FileContent() {
+    if (data_) {
+        FreeAligned(data_);
+    }
+}
+
+// LruTier
+
+template<typename T, typename Key>
+void LruTier<T, Key>::SetBudget(size_t totalBytes) {
+    budget_.store(totalBytes, std::memory_order_relaxed);
+    Trim(0, totalBytes);
+}
+
+template<typename T, typename Key>
+bool LruTier<T, Key>::Put(Key key, const T& value, size_t bytes) {
+    size_t budget = budget_.load(std::memory_order_relaxed);
+    size_t index = ShardIndex(key);
+    bool stored;
+    {
+        std::lock_guard<std::mutex> lock(shards_[index].mutex);
+        stored = PutLocked(shards_[index], key, value, bytes, budget);
+    }
+    Trim(index + 1, budget);
+    return stored;
+}
+
+template<typename T, typename Key>
+void LruTier<T, Key>::PutMany(std::vector<Item>& items) {
+    std::array<std::vector<Item*>, kShardCount> byShard;
+    for (auto& item : items) {
+        byShard[ShardIndex(item.key)].push_back(&item);
+    }
+
+    size_t budget = budget_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kShardCount; i++) {
+        if (byShard[i].empty()) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        for (Item* item : byShard[i]) {
+            PutLocked(shards_[i], item->key, std::move(item->value), item->bytes, budget);
         }
     }
+    Trim(0, budget);
 }
 
-std::optional<FileContent> ContentCache::GetFileContent(const std::string& path) const {
-    std::shared_lock lock(mutex_);
-    
-    auto it = contentCache_.find(path);
-    if (it != contentCache_.end() && it->second.IsValid(ttl_)) {
-        hits_++;
-        return it->second.data;
+template<typename T, typename Key>
+bool LruTier<T, Key>::PutLocked(Shard& shard, Key key, T value, size_t bytes, size_t budget) {
+    auto existing = shard.index.find(key);
+    if (existing != shard.index.end()) {
+        EraseLocked(shard, existing->second);
     }
-    
-    misses_++;
-    return std::nullopt;
+
+    if (bytes > budget) {
+        return false;
+    }
+
+    shard.lru.push_front({key, std::move(value), bytes, std::chrono::steady_clock::now()});
+    auto it = shard.lru.begin();
+    shard.index.emplace(key, it);
+    shard.bytes += bytes;
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    entries_.fetch_add(1, std::memory_order_relaxed);
+    inserts_.Add();
+
+    // Room comes from this shard's cold end first; Trim takes the rest
+    EvictLocked(shard, budget, 1);
+    return true;
 }
 
-void ContentCache::InvalidatePath(const std::string& path) {
-    std::unique_lock lock(mutex_);
-    
-    fileInfoCache_.erase(path);
-    directoryCache_.erase(path);
-    contentCache_.erase(path);
-    
-    // Also invalidate parent directory listing
-    auto lastSlash = path.rfind('/');
-    if (lastSlash != std::string::npos) {
-        std::string parentPath = path.substr(0, lastSlash);
-        directoryCache_.erase(parentPath);
+template<typename T, typename Key>
+std::optional<T> LruTier<T, Key>::Get(Key key, std::chrono::seconds ttl) {
+    ScopedLatency latency(lookupLatency_);
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        misses_.Add();
+        return std::nullopt;
+    }
+
+    auto it = found->second;
+    if (std::chrono::steady_clock::now() - it->timestamp >= ttl) {
+        // Expired entries are dropped lazily on lookup or by LRU pressure
+        EraseLocked(shard, it);
+        expirations_.Add();
+        misses_.Add();
+        return std::nullopt;
     }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it);
+    hits_.Add();
+    return it->data;
 }
 
-void ContentCache::InvalidateAll() {
-    std::unique_lock lock(mutex_);
-    fileInfoCache_.clear();
-    directoryCache_.clear();
-    contentCache_.clear();
+template<typename T, typename Key>
+bool LruTier<T, Key>::Contains(Key key, std::chrono::seconds ttl) {
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(key);
+    return found != shard.index.end() &&
+           std::chrono::steady_clock::now() - found->second->timestamp < ttl;
 }
 
-void ContentCache::SetCacheTTL(std::chrono::seconds ttl) {
-    std::unique_lock lock(mutex_);
-    ttl_ = ttl;
+template<typename T, typename Key>
+std::optional<T> LruTier<T, Key>::Peek(Key key, std::chrono::seconds ttl) {
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(key);
+    if (found == shard.index.end() || std::chrono::steady_clock::now() - found->second->timestamp >= ttl) {
+        return std::nullopt;
+    }
+    return found->second->data;
 }
 
-ContentCache::CacheStats ContentCache::GetStats() const {
-    std::shared_lock lock(mutex_);
-    
-    size_t memoryUsage = 0;
-    
-    // Estimate memory usage
-    for (const auto& [path, entry] : fileInfoCache_) {
-        memoryUsage += path.size() + sizeof(FileInfo) + entry.data.name.size() + entry.data.hash.size();
-    }
-    
-    for (const auto& [path, entry] : directoryCache_) {
-        memoryUsage += path.size() + sizeof(DirectoryListing);
-        for (const auto& file : entry.data.entries) {
-            memoryUsage += sizeof(FileInfo) + file.name.size() + file.hash.size();
-        }
-    }
-    
-    for (const auto& [path, entry] : contentCache_) {
-        memoryUsage += path.size() + entry.data.data.size();
-    }
-    
-    return {
-        hits_,
-        misses_,
-        fileInfoCache_.size() + directoryCache_.size() + contentCache_.size(),
-        memoryUsage
-    };
-}
-
-void ContentCache::CleanExpiredEntries() {
+template<typename T, typename Key>
+bool LruTier<T, Key>::Update(Key key, std::chrono::seconds ttl, const std::function<size_t(T&, size_t)>& mutate) {
+    size_t budget = budget_.load(std::memory_order_relaxed);
+    size_t index = ShardIndex(key);
+    Shard& shard = shards_[index];
+    std::unique_lock<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        return false;
+    }
+    auto it = found->second;
+    if (std::chrono::steady_clock::now() - it->timestamp >= ttl) {
+        EraseLocked(shard, it);
+        expirations_.Add();
+        return false;
+    }
+
+    size_t bytes = mutate(it->data, it->bytes);
+    shard.bytes = shard.bytes - it->bytes + bytes;
+    if (bytes >= it->bytes) {
+        bytes_.fetch_add(bytes - it->bytes, std::memory_order_relaxed);
+    } else {
+        bytes_.fetch_sub(it->bytes - bytes, std::memory_order_relaxed);
+    }
+    it->bytes = bytes;
+
+    // Grown entries make room from the cold end; the patched one is hottest
+    shard.lru.splice(shard.lru.begin(), shard.lru, it);
+    if (bytes > budget) {
+        EraseLocked(shard, it);
+        return false;
+    }
+    EvictLocked(shard, budget, 1);
+    lock.unlock();
+    Trim(index + 1, budget);
+    return true;
+}
+
+template<typename T, typename Key>
+void LruTier<T, Key>::ForEach(std::chrono::seconds ttl, const std::function<void(Key, const T&)>& visit) {
     auto now = std::chrono::steady_clock::now();
-    
-    // Clean file info cache
-    for (auto it = fileInfoCache_.begin(); it != fileInfoCache_.end();) {
-        if (!it->second.IsValid(ttl_)) {
-            it = fileInfoCache_.erase(it);
-        } else {
-            ++it;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& entry : shard.lru) {
+            if (now - entry.timestamp < ttl) {
+                visit(entry.key, entry.data);
+            }
         }
     }
-    
-    // Clean directory cache
-    for (auto it = directoryCache_.begin(); it != directoryCache_.end();) {
-        if (!it->second.IsValid(ttl_)) {
-            it = directoryCache_.erase(it);
-        } else {
-            ++it;
+}
+
+template<typename T, typename Key>
+bool LruTier<T, Key>::Erase(Key key) {
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        return false;
+    }
+    EraseLocked(shard, found->second);
+    return true;
+}
+
+template<typename T, typename Key>
+void LruTier<T, Key>::Clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        bytes_.fetch_sub(shard.bytes, std::memory_order_relaxed);
+        entries_.fetch_sub(shard.lru.size(), std::memory_order_relaxed);
+        shard.index.clear();
+        shard.lru.clear();
+        shard.bytes = 0;
+    }
+}
+
+template<typename T, typename Key>
+size_t LruTier<T, Key>::ShardIndex(Key key) {
+    // Ids are handed out sequentially, so scramble them before picking a shard
+    uint64_t hash = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull;
+    return (hash >> 48) % kShardCount;
+}
+
+template<typename T, typename Key>
+void LruTier<T, Key>::EraseLocked(Shard& shard, typename EntryList::iterator it) {
+    shard.bytes -= it->bytes;
+    bytes_.fetch_sub(it->bytes, std::memory_order_relaxed);
+    entries_.fetch_sub(1, std::memory_order_relaxed);
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+template<typename T, typename Key>
+void LruTier<T, Key>::EvictLocked(Shard& shard, size_t budget, size_t keep) {
+    while (bytes_.load(std::memory_order_relaxed) > budget && shard.lru.size() > keep) {
+        EraseLocked(shard, std::prev(shard.lru.end()));
+        evictions_.Add();
+    }
+}
+
+template<typename T, typename Key>
+void LruTier<T, Key>::Trim(size_t first, size_t budget) {
+    // One shard lock at a time, starting past the shard that just grew
+    for (size_t i = 0; i < kShardCount && bytes_.load(std::memory_order_relaxed) > budget; i++) {
+        Shard& shard = shards_[(first + i) % kShardCount];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        EvictLocked(shard, budget, 0);
+    }
+}
+
+template<typename T, typename Key>
+TierStats LruTier<T, Key>::GetStats() const {
+    TierStats stats;
+    stats.hits = hits_.Load();
+    stats.misses = misses_.Load();
+    stats.inserts = inserts_.Load();
+    stats.evictions = evictions_.Load();
+    stats.expirations = expirations_.Load();
+    stats.entries = Entries();
+    stats.bytes = Bytes();
+    stats.budget = GetBudget();
+    stats.lookupLatency = lookupLatency_.GetSnapshot();
+    return stats;
+}
+
+template class LruTier<FileInfo>;
+template class LruTier<DirectoryListingPtr>;
+template class LruTier<FileContentPtr, uint64_t>;
+
+// NegativeCache
+
+void NegativeCache::SetCapacity(size_t totalEntries) {
+    size_t shardCapacity = (std::max)(totalEntries / kShardCount, size_t(1));
+    shardCapacity_.store(shardCapacity, std::memory_order_relaxed);
+
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        while (shard.lru.size() > shardCapacity) {
+            EraseLocked(shard, std::prev(shard.lru.end()));
         }
     }
-    
-    // Clean content cache
-    for (auto it = contentCache_.begin(); it != contentCache_.end();) {
-        if (!it->second.IsValid(ttl_)) {
-            it = contentCache_.erase(it);
+}
+
+void NegativeCache::Add(PathId parent, std::string_view name) {
+    uint64_t key = KeyFor(parent, name);
+    size_t capacity = shardCapacity_.load(std::memory_order_relaxed);
+    Shard& shard = ShardFor(parent);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto existing = shard.index.find(key);
+    if (existing != shard.index.end()) {
+        EraseLocked(shard, existing->second);
+    }
+    while (shard.lru.size() >= capacity && !shard.lru.empty()) {
+        EraseLocked(shard, std::prev(shard.lru.end()));
+    }
+
+    uint32_t generation = shard.generations[parent];
+    shard.lru.push_front({key, parent, generation, std::string(name)});
+    shard.index.emplace(key, shard.lru.begin());
+    entries_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool NegativeCache::Contains(PathId parent, std::string_view name) {
+    Shard& shard = ShardFor(parent);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(KeyFor(parent, name));
+    if (found == shard.index.end()) {
+        return false;
+    }
+    auto it = found->second;
+    if (it->parent != parent || it->name != name) {
+        return false;  // Key collision with another name
+    }
+    if (shard.generations[parent] != it->generation) {
+        // The parent's listing changed since the name was recorded
+        EraseLocked(shard, it);
+        return false;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it);
+    hits_.Add();
+    return true;
+}
+
+void NegativeCache::Remove(PathId parent, std::string_view name) {
+    Shard& shard = ShardFor(parent);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(KeyFor(parent, name));
+    if (found != shard.index.end() && found->second->parent == parent && found->second->name == name) {
+        EraseLocked(shard, found->second);
+    }
+}
+
+void NegativeCache::InvalidateParent(PathId parent) {
+    Shard& shard = ShardFor(parent);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // Parents that never had a missing name have no generation to bump
+    auto generation = shard.generations.find(parent);
+    if (generation != shard.generations.end()) {
+        generation->second++;
+    }
+}
+
+void NegativeCache::Clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        entries_.fetch_sub(shard.lru.size(), std::memory_order_relaxed);
+        shard.index.clear();
+        shard.lru.clear();
+        shard.generations.clear();
+    }
+}
+
+uint64_t NegativeCache::KeyFor(PathId parent, std::string_view name) {
+    return std::hash<std::string_view>()(name) ^ (static_cast<uint64_t>(parent) * 0x9E3779B97F4A7C15ull);
+}
+
+NegativeCache::Shard& NegativeCache::ShardFor(PathId parent) {
+    // Every name of one parent lives in the same shard, next to its generation
+    uint32_t hash = parent * 0x9E3779B1u;
+    return shards_[(hash >> 16) % kShardCount];
+}
+
+void NegativeCache::EraseLocked(Shard& shard, EntryList::iterator it) {
+    entries_.fetch_sub(1, std::memory_order_relaxed);
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+// ContentCache
+
+ContentCache::ContentCache() {
+    SetBudget(CacheBudget{});
+}
+
+void ContentCache::SetFileInfo(PathId path, const FileInfo& info) {
+    fileInfoCache_.Put(path, info, AccountedBytes(info));
+    ForgetMissing(path);
+}
+
+std::optional<FileInfo> ContentCache::GetFileInfo(PathId path) const {
+    return fileInfoCache_.Get(path, TTL());
+}
+
+void ContentCache::SetDirectoryListing(PathId path, DirectoryListing listing) {
+    SortEntries(listing.entries);
+    auto packed = std::make_shared<const PackedListing>(listing.entries);
+    size_t bytes = AccountedBytes(packed);
+    size_t entries = packed->Size();
+    if (!directoryCache_.Put(path, packed, bytes)) {
+        PROJFS_WARN("[Cache] Listing of '" << paths_.PathOf(path) << "' (" << entries << " entries, " << bytes
+                  << " bytes) exceeds the whole directory budget; not cached");
+    }
+    ForgetMissing(path);
+    ListingChanged(path, packed);
+
+    PROJFS_TRACE("[Cache] SetDirectoryListing: Stored " << entries
+              << " entries for path: '" << paths_.PathOf(path) << "'");
+    PROJFS_TRACE("[Cache] Directory cache now has " << directoryCache_.Entries() << " paths");
+}
+
+DirectoryListingPtr ContentCache::GetDirectoryListing(PathId path) const {
+    auto listing = directoryCache_.Get(path, TTL());
+    if (listing) {
+        PROJFS_TRACE("[Cache] HIT: Found " << (*listing)->Size()
+                  << " entries for '" << paths_.PathOf(path) << "'");
+        return *listing;
+    }
+
+    PROJFS_TRACE("[Cache] MISS: No valid entry for path id " << path);
+    return nullptr;
+}
+
+std::pair<size_t, size_t> ContentCache::FindEntries(const PackedListing& listing, std::string_view name) const {
+    size_t low = 0;
+    size_t high = listing.Size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (compareNames_(listing.Name(middle), name) < 0) {
+            low = middle + 1;
         } else {
-            ++it;
+            high = middle;
+        }
+    }
+    size_t last = low;
+    while (last < listing.Size() && compareNames_(listing.Name(last), name) == 0) {
+        last++;
+    }
+    return {low, last};
+}
+
+size_t ContentCache::FindEntry(const PackedListing& listing, std::string_view name) const {
+    const auto& table = listing.NameIndex();
+    if (table.empty()) {
+        auto [first, last] = FindEntries(listing, name);
+        return first < last ? first : PackedListing::kNotFound;
+    }
+
+    // Slots fill in entry order, so the first equal entry is met first
+    size_t mask = table.size() - 1;
+    for (size_t slot = PackedListing::FoldedHash(name) & mask; table[slot] != PackedListing::kNoSlot;
+         slot = (slot + 1) & mask) {
+        if (compareNames_(listing.Name(table[slot]), name) == 0) {
+            return table[slot];
+        }
+    }
+    return PackedListing::kNotFound;
+}
+
+void ContentCache::SortEntries(std::vector<FileInfo>& entries) const {
+    std::stable_sort(entries.begin(), entries.end(), NameLess{compareNames_});
+}
+
+uint64_t ContentCache::HashContentKey(const std::string& hash, uint64_t size) {
+    // FNV-1a over the hash, then the size
+    uint64_t key = 0xCBF29CE484222325ull;
+    for (unsigned char c : hash) {
+        key = (key ^ c) * 0x100000001B3ull;
+    }
+    key ^= size * 0x9E3779B97F4A7C15ull;
+    return key | 1ull << 63;
+}
+
+bool ContentCache::DescribeFile(PathId path, ContentIdentity& identity) const {
+    if (path == kNoPath) {
+        return false;
+    }
+    if (auto info = fileInfoCache_.Peek(path, TTL())) {
+        if (info->isDirectory || info->hash.empty()) {
+            return false;
+        }
+        identity.hash = info->hash;
+        identity.size = info->size;
+        identity.blobOrClob = info->isBlobOrClob;
+        return true;
+    }
+
+    return DescribeListed(paths_.ParentOf(path), paths_.NameOf(path), identity);
+}
+
+bool ContentCache::DescribeListed(PathId parent, std::string_view name, ContentIdentity& identity) const {
+    auto listing = parent != kNoPath ? directoryCache_.Peek(parent, TTL()) : std::nullopt;
+    if (!listing || !*listing) {
+        return false;
+    }
+    size_t index = FindEntry(**listing, name);
+    if (index == PackedListing::kNotFound || (*listing)->IsDirectory(index)) {
+        return false;
+    }
+    identity.hash = (*listing)->Hash(index);
+    identity.size = (*listing)->FileSize(index);
+    identity.blobOrClob = (*listing)->IsBlobOrClob(index);
+    return !identity.hash.empty();
+}
+
+bool ContentCache::DescribePath(std::string_view canonicalPath, ContentIdentity& identity) const {
+    PathId id = paths_.Find(canonicalPath);
+    if (id != kNoPath || canonicalPath.size() <= 1) {
+        return DescribeFile(id, identity);
+    }
+
+    // Names that were only ever listed have no id of their own
+    size_t lastSlash = canonicalPath.rfind('/');
+    PathId parent = lastSlash == 0 ? kRootPath : paths_.Find(canonicalPath.substr(0, lastSlash));
+    return DescribeListed(parent, canonicalPath.substr(lastSlash + 1), identity);
+}
+
+FileContentPtr ContentCache::ContentByHash(const ContentIdentity& identity) const {
+    auto content = contentCache_.Get(HashContentKey(identity.hash, identity.size), TTL());
+    // The key is a digest of the hash, so check it is this very object
+    if (content && (*content)->hash() == identity.hash && (*content)->size() == identity.size) {
+        return *content;
+    }
+    return nullptr;
+}
+
+std::string ContentCache::ContentHash(PathId path, size_t size) const {
+    ContentIdentity identity;
+    if (!DescribeFile(path, identity) || !identity.blobOrClob || identity.size != size) {
+        return std::string();
+    }
+    return identity.hash;
+}
+
+void ContentCache::SetFileContent(PathId path, FileContentPtr content) {
+    // Only cache small files whole; large ones go through the chunk tier
+    if (content && content->size() <= kMaxContentBytes) {
+        uint64_t key = PathContentKey(path);
+        std::string storeKey = content->hash();
+        if (!storeKey.empty()) {
+            key = HashContentKey(storeKey, content->size());
+        } else if (contentStore_) {
+            // The renderings of one object differ, so they are told apart by
+            // a digest of their bytes; the store still compares the bytes
+            ContentIdentity identity;
+            if (DescribeFile(path, identity) && identity.size == content->size()) {
+                std::string_view bytes(reinterpret_cast<const char*>(content->data()), content->size());
+                storeKey = identity.hash + '#' + std::to_string(std::hash<std::string_view>()(bytes));
+            }
+        }
+        if (contentStore_ && !storeKey.empty()) {
+            content = contentStore_->Intern(storeKey, std::move(content));
+        }
+        size_t bytes = AccountedBytes(content);
+        contentCache_.Put(key, content, bytes);
+    } else if (content) {
+        PROJFS_DEBUG("[Cache] Not caching " << content->size() << " bytes of '" << paths_.PathOf(path)
+                  << "' whole; larger than " << kMaxContentBytes);
+    }
+    ForgetMissing(path);
+}
+
+FileContentPtr ContentCache::GetFileContent(PathId path) const {
+    ContentIdentity identity;
+    if (DescribeFile(path, identity) && identity.blobOrClob) {
+        // Served by whichever alias of the object was read first
+        if (auto content = ContentByHash(identity)) {
+            return content;
+        }
+        // Read before its hash was known
+        if (!contentCache_.Contains(PathContentKey(path), TTL())) {
+            return nullptr;
+        }
+    }
+    return contentCache_.Get(PathContentKey(path), TTL()).value_or(nullptr);
+}
+
+bool ContentCache::HasFileContent(PathId path) const {
+    ContentIdentity identity;
+    if (DescribeFile(path, identity) && identity.blobOrClob &&
+        contentCache_.Contains(HashContentKey(identity.hash, identity.size), TTL())) {
+        return true;
+    }
+    return contentCache_.Contains(PathContentKey(path), TTL());
+}
+
+void ContentCache::SetFileChunk(PathId path, uint32_t index, FileContentPtr chunk) {
+    if (chunk && !chunk->hash().empty()) {
+        if (contentStore_) {
+            std::string key = chunk->hash() + ':' + std::to_string(index);
+            chunk = contentStore_->Intern(key, std::move(chunk));
         }
+        size_t bytes = AccountedBytes(chunk);
+        chunkCache_.Put(ChunkKey(path, index), std::move(chunk), bytes);
+    }
+}
+
+FileContentPtr ContentCache::GetFileChunk(PathId path, uint32_t index, const std::string& hash) const {
+    if (hash.empty()) {
+        return nullptr;
+    }
+    auto chunk = chunkCache_.Get(ChunkKey(path, index), TTL());
+    if (!chunk) {
+        return nullptr;
+    }
+    if ((*chunk)->hash() != hash) {
+        chunkCache_.Erase(ChunkKey(path, index));  // Read from an older version of the file
+        return nullptr;
+    }
+    return *chunk;
+}
+
+void ContentCache::InvalidatePath(PathId path) {
+    if (path == kNoPath) {
+        return;
+    }
+    fileInfoCache_.Erase(path);
+    directoryCache_.Erase(path);
+    contentCache_.Erase(PathContentKey(path));  // Content filed by hash stays valid for the hash
+    ForgetMissing(path);
+
+    // Also invalidate parent directory listing
+    PathId parent = paths_.ParentOf(path);
+    if (parent != kNoPath) {
+        directoryCache_.Erase(parent);
+        negativeCache_.InvalidateParent(path);
+        ListingChanged(parent);
+    } else {
+        ListingChanged(path);
     }
 }
 
-} // namespace oneifsprojfs
\ No newline at end of file
+void ContentCache::SetDirectoryTree(std::vector<DirectoryUpdate>&& directories) {
+    std::vector<LruTier<DirectoryListingPtr>::Item> listings;
+    std::vector<DirectoryListingPtr> stored;  // PutMany moves the values out of listings
+    std::vector<LruTier<FileInfo>::Item> fileInfos;
+    std::vector<std::string_view> names;
+    std::vector<PathId> childIds;
+    listings.reserve(directories.size());
+    stored.reserve(directories.size());
+
+    for (auto& directory : directories) {
+        PathId directoryId = InternPath(directory.path);
+        const auto& entries = directory.listing.entries;
+
+        names.clear();
+        for (const auto& entry : entries) {
+            names.emplace_back(entry.name);
+        }
+        paths_.InternChildren(directoryId, names, childIds);
+
+        fileInfos.reserve(fileInfos.size() + entries.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            fileInfos.push_back({childIds[i], entries[i], AccountedBytes(entries[i])});
+        }
+
+        SortEntries(directory.listing.entries);
+        auto packed = std::make_shared<const PackedListing>(directory.listing.entries);
+        size_t bytes = AccountedBytes(packed);
+        listings.push_back({directoryId, packed, bytes});
+        stored.push_back(std::move(packed));
+    }
+
+    fileInfoCache_.PutMany(fileInfos);
+    directoryCache_.PutMany(listings);
+
+    // Missing names under each directory are retired by the listing change itself
+    for (size_t i = 0; i < listings.size(); i++) {
+        ForgetMissing(listings[i].key);
+        ListingChanged(listings[i].key, stored[i]);
+    }
+
+    PROJFS_TRACE("[Cache] SetDirectoryTree: Stored " << listings.size() << " directories with "
+              << fileInfos.size() << " entries");
+}
+
+bool ContentCache::ApplyDirectoryDelta(const DirectoryDelta& delta) {
+    PathId directory = InternPath(delta.path);
+
+    // Entries are matched by name in one pass over the listing. A name both
+    // upserted and removed is removed, as its FileInfo and missing entry are.
+    std::unordered_set<std::string_view> removals(delta.removals.begin(), delta.removals.end());
+    std::unordered_map<std::string_view, const FileInfo*> upserts;
+    for (const auto& info : delta.upserts) {
+        if (removals.count(info.name) == 0) {
+            upserts[info.name] = &info;
+        }
+    }
+    std::unordered_set<std::string_view> changedHashes;
+
+    // Listings are shared read-only, so the patched one is packed anew, but
+    // straight from the old one: survivors are copied as packed and keep their
+    // place, and the new names, sorted, are merged in as one run
+    bool patched = directoryCache_.Update(directory, TTL(), [&](DirectoryListingPtr& listing, size_t) {
+        // First pass: which names replace an entry, and which are new
+        auto pending = upserts;
+        std::vector<const FileInfo*> replacing(listing->Size(), nullptr);
+        size_t nameBytes = 0;
+        for (size_t i = 0; i < listing->Size(); i++) {
+            std::string_view name = listing->Name(i);
+            nameBytes += name.size();
+            auto upsert = pending.find(name);
+            if (upsert != pending.end()) {
+                if (upsert->second->hash != listing->Hash(i)) {
+                    changedHashes.insert(upsert->first);
+                }
+                replacing[i] = upsert->second;
+                pending.erase(upsert);
+            }
+        }
+
+        // In delta order, so names that compare equal keep it after the sort;
+        // a name sent twice is added once, as its last upsert
+        std::vector<const FileInfo*> added;
+        added.reserve(pending.size());
+        for (const auto& info : delta.upserts) {
+            auto upsert = pending.find(info.name);
+            if (upsert != pending.end() && upsert->second == &info) {
+                added.push_back(&info);
+                nameBytes += info.name.size();
+            }
+        }
+        std::stable_sort(added.begin(), added.end(),
+                         [this](const FileInfo* a, const FileInfo* b) { return compareNames_(a->name, b->name) < 0; });
+
+        PackedListing::Builder builder(listing->Size() + added.size(), nameBytes);
+        size_t next = 0;
+        for (size_t i = 0; i < listing->Size(); i++) {
+            std::string_view name = listing->Name(i);
+            // Ties keep the old entry first, as a stable merge would
+            while (next < added.size() && compareNames_(added[next]->name, name) < 0) {
+                builder.Add(*added[next++]);
+            }
+            if (replacing[i]) {
+                builder.Add(*replacing[i]);
+            } else if (removals.count(name) == 0) {
+                builder.Add(*listing, i);
+            }
+        }
+        while (next < added.size()) {
+            builder.Add(*added[next++]);
+        }
+        listing = builder.Build();
+        return AccountedBytes(listing);
+    });
+
+    std::vector<std::string_view> names;
+    names.reserve(delta.upserts.size() + delta.removals.size());
+    for (const auto& info : delta.upserts) {
+        names.emplace_back(info.name);
+    }
+    names.insert(names.end(), delta.removals.begin(), delta.removals.end());
+    std::vector<PathId> childIds;
+    paths_.InternChildren(directory, names, childIds);
+
+    for (size_t i = 0; i < delta.upserts.size(); i++) {
+        const FileInfo& info = delta.upserts[i];
+        // Without the old listing the old hash is unknown, so content goes too
+        if (!patched || changedHashes.count(info.name) > 0) {
+            contentCache_.Erase(PathContentKey(childIds[i]));
+        }
+        fileInfoCache_.Put(childIds[i], info, AccountedBytes(info));
+        ForgetMissing(childIds[i]);
+    }
+    for (size_t i = delta.upserts.size(); i < childIds.size(); i++) {
+        fileInfoCache_.Erase(childIds[i]);
+        directoryCache_.Erase(childIds[i]);
+        contentCache_.Erase(PathContentKey(childIds[i]));
+    }
+
+    // Retires the directory's missing names, then records the removed ones
+    ListingChanged(directory);
+    for (const auto& name : delta.removals) {
+        negativeCache_.Add(directory, name);
+    }
+
+    PROJFS_TRACE("[Cache] ApplyDirectoryDelta: " << delta.upserts.size() << " upserts, "
+              << delta.removals.size() << " removals for '" << delta.path << "'"
+              << (patched ? "" : " (listing not cached)"));
+    return patched;
+}
+
+std::vector<DirectoryUpdate> ContentCache::ExportDirectoryTree(const std::function<bool(PathId)>& include) const {
+    std::vector<DirectoryUpdate> directories;
+    directoryCache_.ForEach(TTL(), [&](PathId path, const DirectoryListingPtr& listing) {
+        if (include && !include(path)) {
+            return;
+        }
+        directories.push_back({paths_.PathOf(path), DirectoryListing{listing->Entries()}});
+    });
+    return directories;
+}
+
+void ContentCache::SetMissing(const std::string& path) {
+    std::string canonical = PathTable::Canonicalize(path);
+    if (canonical.size() <= 1) {
+        return;
+    }
+    size_t lastSlash = canonical.rfind('/');
+    PathId parent = lastSlash == 0 ? kRootPath : paths_.Intern(std::string_view(canonical).substr(0, lastSlash));
+    negativeCache_.Add(parent, std::string_view(canonical).substr(lastSlash + 1));
+}
+
+bool ContentCache::IsMissing(std::string_view canonicalPath) const {
+    if (canonicalPath.size() <= 1) {
+        return false;
+    }
+    size_t lastSlash = canonicalPath.rfind('/');
+    PathId parent = lastSlash == 0 ? kRootPath : paths_.Find(canonicalPath.substr(0, lastSlash));
+    return parent != kNoPath && negativeCache_.Contains(parent, canonicalPath.substr(lastSlash + 1));
+}
+
+void ContentCache::ForgetMissing(PathId path) {
+    if (path != kNoPath && path != kRootPath) {
+        negativeCache_.Remove(paths_.ParentOf(path), paths_.NameOf(path));
+    }
+}
+
+void ContentCache::ListingChanged(PathId directory, const DirectoryListingPtr& listing) {
+    negativeCache_.InvalidateParent(directory);
+    if (listingChanged_) {
+        listingChanged_(directory, listing);
+    }
+}
+
+void ContentCache::SetFileInfo(const std::string& path, const FileInfo& info) {
+    SetFileInfo(InternPath(path), info);
+}
+
+std::optional<FileInfo> ContentCache::GetFileInfo(const std::string& path) const {
+    return GetFileInfo(FindPath(path));
+}
+
+void ContentCache::SetDirectoryListing(const std::string& path, DirectoryListing listing) {
+    SetDirectoryListing(InternPath(path), std::move(listing));
+}
+
+DirectoryListingPtr ContentCache::GetDirectoryListing(const std::string& path) const {
+    return GetDirectoryListing(FindPath(path));
+}
+
+void ContentCache::SetFileContent(const std::string& path, FileContentPtr content) {
+    SetFileContent(InternPath(path), std::move(content));
+}
+
+FileContentPtr ContentCache::GetFileContent(const std::string& path) const {
+    std::string canonical = PathTable::Canonicalize(path);
+    PathId id = paths_.Find(canonical);
+    if (id != kNoPath) {
+        return GetFileContent(id);
+    }
+    // Only listed, so nothing was filed under the path itself
+    ContentIdentity identity;
+    return DescribePath(canonical, identity) && identity.blobOrClob ? ContentByHash(identity) : nullptr;
+}
+
+std::string ContentCache::ContentHash(const std::string& path, size_t size) const {
+    ContentIdentity identity;
+    if (!DescribePath(PathTable::Canonicalize(path), identity) || !identity.blobOrClob || identity.size != size) {
+        return std::string();
+    }
+    return identity.hash;
+}
+
+void ContentCache::InvalidatePath(const std::string& path) {
+    InvalidatePath(FindPath(path));
+}
+
+void ContentCache::InvalidateAll() {
+    fileInfoCache_.Clear();
+    directoryCache_.Clear();
+    contentCache_.Clear();
+    chunkCache_.Clear();
+    negativeCache_.Clear();
+
+    // Every listing is gone; report it as a change of the root
+    if (listingChanged_) {
+        listingChanged_(kRootPath, nullptr);
+    }
+}
+
+void ContentCache::SetCacheTTL(std::chrono::seconds ttl) {
+    ttlSeconds_.store(ttl.count(), std::memory_order_relaxed);
+}
+
+void ContentCache::SetBudget(const CacheBudget& budget) {
+    fileInfoCache_.SetBudget(budget.fileInfoBytes);
+    directoryCache_.SetBudget(budget.directoryBytes);
+    contentCache_.SetBudget(budget.contentBytes);
+    chunkCache_.SetBudget(budget.chunkBytes);
+}
+
+CacheBudget ContentCache::GetBudget() const {
+    CacheBudget budget;
+    budget.fileInfoBytes = fileInfoCache_.GetBudget();
+    budget.directoryBytes = directoryCache_.GetBudget();
+    budget.contentBytes = contentCache_.GetBudget();
+    budget.chunkBytes = chunkCache_.GetBudget();
+    return budget;
+}
+
+ContentCache::CacheStats ContentCache::GetStats() const {
+    CacheStats stats;
+    stats.fileInfo = fileInfoCache_.GetStats();
+    stats.directory = directoryCache_.GetStats();
+    stats.content = contentCache_.GetStats();
+    stats.chunks = chunkCache_.GetStats();
+
+    stats.hits = stats.fileInfo.hits + stats.directory.hits + stats.content.hits + stats.chunks.hits;
+    stats.misses = stats.fileInfo.misses + stats.directory.misses + stats.content.misses + stats.chunks.misses;
+    stats.entries = stats.fileInfo.entries + stats.directory.entries + stats.content.entries + stats.chunks.entries;
+    stats.memoryUsage = stats.fileInfo.bytes + stats.directory.bytes + stats.content.bytes + stats.chunks.bytes;
+    stats.negativeEntries = negativeCache_.Entries();
+    stats.negativeHits = negativeCache_.Hits();
+    return stats;
+}
+
+} // namespace oneifsprojfs
@@ -2,12 +2,22 @@
 #define CONTENT_CACHE_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <list>
+#include <memory>
+#include <array>
 #include <unordered_map>
-#include <shared_mutex>
+#include <mutex>
+#include <atomic>
 #include <chrono>
+#include <functional>
 #include <optional>
 #include <variant>
+#include "content_store.h"
+#include "packed_listing.h"
+#include "path_table.h"
+#include "stats.h"
 
 namespace oneifsprojfs {
 
@@ -18,15 +28,216 @@ struct FileInfo {
     bool isDirectory;
     bool isBlobOrClob;  // If true, can be read directly from disk
     uint32_t mode;
+    uint64_t mtime = 0;  // Milliseconds since the Unix epoch; 0 if unknown
 };
 
+// A listing as it crosses the JavaScript and snapshot boundaries. The cache
+// stores it packed (see PackedListing), in its name order (see SetNameOrder),
+// shared read-only by every enumeration of it.
 struct DirectoryListing {
     std::vector<FileInfo> entries;
 };
+using DirectoryListingPtr = std::shared_ptr<const PackedListing>;
 
-struct FileContent {
-    std::vector<uint8_t> data;
-    std::string hash;  // For direct disk access if BLOB/CLOB
+// Three-way name comparison; negative when a sorts first
+using NameCompare = int (*)(std::string_view a, std::string_view b);
+// The default order: ordinal after upcasing ASCII letters
+int CompareNamesIgnoringCase(std::string_view a, std::string_view b);
+
+// One directory of a bulk cache update
+struct DirectoryUpdate {
+    std::string path;
+    DirectoryListing listing;
+};
+
+// Entry-level changes to one directory, applied without resending its listing
+struct DirectoryDelta {
+    std::string path;
+    std::vector<FileInfo> upserts;      // Added, or replacing the entry of the same name
+    std::vector<std::string> removals;  // Names
+};
+
+// Immutable file content held in one page-aligned allocation. The cache hands
+// out shared_ptrs to it, so serving a read never copies the payload, and a
+// page-aligned base lets ProjFS write straight out of it.
+class FileContent {
+public:
+    static constexpr size_t kAlignment = 4096;
+
+    static std::shared_ptr<const FileContent> Copy(const uint8_t* data, size_t size,
+                                                   const std::string& hash = std::string());
+    ~FileContent();
+
+    FileContent(const FileContent&) = delete;
+    FileContent& operator=(const FileContent&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const std::string& hash() const { return hash_; }  // The ONE hash it is filed under, if known
+
+private:
+    FileContent(uint8_t* data, size_t size, const std::string& hash)
+        : data_(data), size_(size), hash_(hash) {}
+
+    uint8_t* data_;
+    size_t size_;
+    std::string hash_;
+};
+
+using FileContentPtr = std::shared_ptr<const FileContent>;
+
+// Byte budgets for the cache tiers. Each budget is split evenly across
+// the shards of its tier; an insert that pushes a shard over its share evicts
+// least-recently-used entries from that shard until it fits again.
+struct CacheBudget {
+    size_t fileInfoBytes = 16 * 1024 * 1024;    // 16 MB
+    size_t directoryBytes = 64 * 1024 * 1024;   // 64 MB
+    size_t contentBytes = 256 * 1024 * 1024;    // 256 MB
+    size_t chunkBytes = 128 * 1024 * 1024;      // 128 MB of streamed file chunks
+};
+
+// Point-in-time counters of one cache tier
+struct TierStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    uint64_t evictions = 0;    // Dropped by LRU pressure
+    uint64_t expirations = 0;  // Dropped because the TTL ran out
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t budget = 0;
+    LatencyHistogram::Snapshot lookupLatency;
+};
+
+// One cache tier: a fixed number of independently locked LRU shards selected
+// by key, a path id unless stated otherwise. Lookups only ever touch a single
+// shard. The budget covers the tier as a whole, so one entry may take any part
+// of it: an insert evicts from its own shard's cold end, and only when that
+// shard runs dry moves on to the others, one lock at a time.
+template<typename T, typename Key = PathId>
+class LruTier {
+public:
+    static constexpr size_t kShardCount = 16;
+
+    void SetBudget(size_t totalBytes);
+    size_t GetBudget() const { return budget_.load(std::memory_order_relaxed); }
+
+    struct Item {
+        Key key;
+        T value;
+        size_t bytes;
+    };
+
+    // Returns false if the entry is larger than the whole budget
+    bool Put(Key key, const T& value, size_t bytes);
+    // Stores every item, taking each shard's lock once; values are moved from
+    void PutMany(std::vector<Item>& items);
+    std::optional<T> Get(Key key, std::chrono::seconds ttl);
+    // Presence probe that leaves statistics and LRU order alone
+    bool Contains(Key key, std::chrono::seconds ttl);
+    // Lookup that leaves statistics and LRU order alone
+    std::optional<T> Peek(Key key, std::chrono::seconds ttl);
+    // Runs mutate(value, bytes) on a live entry in place, under its shard lock;
+    // mutate returns the entry's new byte count. False on a miss.
+    bool Update(Key key, std::chrono::seconds ttl, const std::function<size_t(T&, size_t)>& mutate);
+    // Calls visit(key, value) for every live entry, one shard lock at a time
+    void ForEach(std::chrono::seconds ttl, const std::function<void(Key, const T&)>& visit);
+    bool Erase(Key key);
+    void Clear();
+
+    size_t Bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    size_t Entries() const { return entries_.load(std::memory_order_relaxed); }
+    TierStats GetStats() const;
+
+private:
+    struct Entry {
+        Key key;
+        T data;
+        size_t bytes;
+        std::chrono::steady_clock::time_point timestamp;
+    };
+    using EntryList = std::list<Entry>;
+
+    struct Shard {
+        std::mutex mutex;
+        EntryList lru;  // Front is most recently used
+        std::unordered_map<Key, typename EntryList::iterator> index;
+        size_t bytes = 0;
+    };
+
+    static size_t ShardIndex(Key key);
+    Shard& ShardFor(Key key) { return shards_[ShardIndex(key)]; }
+    bool PutLocked(Shard& shard, Key key, T value, size_t bytes, size_t budget);
+    void EraseLocked(Shard& shard, typename EntryList::iterator it);
+    // Drops the shard's coldest entries, leaving at least keep, until the
+    // tier as a whole fits the budget
+    void EvictLocked(Shard& shard, size_t budget, size_t keep);
+    // Evicts across shards, from first on, until the tier fits the budget
+    void Trim(size_t first, size_t budget);
+
+    std::array<Shard, kShardCount> shards_;
+    std::atomic<size_t> budget_{0};
+    std::atomic<size_t> bytes_{0};
+    std::atomic<size_t> entries_{0};
+
+    // Statistics; striped so lookups on different shards never share a counter line
+    StripedCounter hits_;
+    StripedCounter misses_;
+    StripedCounter inserts_;
+    StripedCounter evictions_;
+    StripedCounter expirations_;
+    LatencyHistogram lookupLatency_;
+};
+
+// Bounded set of names JavaScript reported as missing, keyed by parent id and
+// name. Every parent that holds missing names carries a generation; changing
+// its listing bumps the generation, which retires all of its names at once
+// without finding them. Retired and least-recently-used names are dropped
+// lazily or when a shard runs out of slots.
+class NegativeCache {
+public:
+    static constexpr size_t kShardCount = 16;
+    static constexpr size_t kDefaultCapacity = 16384;
+
+    NegativeCache() { SetCapacity(kDefaultCapacity); }
+
+    void SetCapacity(size_t totalEntries);
+
+    void Add(PathId parent, std::string_view name);
+    bool Contains(PathId parent, std::string_view name);
+    void Remove(PathId parent, std::string_view name);
+    // Forgets every name recorded under the parent
+    void InvalidateParent(PathId parent);
+    void Clear();
+
+    size_t Entries() const { return entries_.load(std::memory_order_relaxed); }
+    uint64_t Hits() const { return hits_.Load(); }
+
+private:
+    struct Entry {
+        uint64_t key;
+        PathId parent;
+        uint32_t generation;
+        std::string name;
+    };
+    using EntryList = std::list<Entry>;
+
+    struct Shard {
+        std::mutex mutex;
+        EntryList lru;  // Front is most recently used
+        std::unordered_map<uint64_t, typename EntryList::iterator> index;
+        std::unordered_map<PathId, uint32_t> generations;
+    };
+
+    static uint64_t KeyFor(PathId parent, std::string_view name);
+    Shard& ShardFor(PathId parent);
+    void EraseLocked(Shard& shard, EntryList::iterator it);
+
+    std::array<Shard, kShardCount> shards_;
+    std::atomic<size_t> shardCapacity_{0};
+    std::atomic<size_t> entries_{0};
+    StripedCounter hits_;
 };
 
 class ContentCache {
@@ -34,58 +245,161 @@ public:
     ContentCache();
     ~ContentCache() = default;
 
+    // Every tier is keyed by the path's id in this table
+    PathTable& Paths() { return paths_; }
+    const PathTable& Paths() const { return paths_; }
+
     // Cache operations
+    void SetFileInfo(PathId path, const FileInfo& info);
+    std::optional<FileInfo> GetFileInfo(PathId path) const;
+
+    // The listing is sorted into name order before it is stored
+    void SetDirectoryListing(PathId path, DirectoryListing listing);
+    DirectoryListingPtr GetDirectoryListing(PathId path) const;
+
+    // Returns nullptr on a miss; the returned content stays valid after eviction.
+    // Files larger than kMaxContentBytes are not kept whole; they are streamed
+    // in chunks instead.
+    //
+    // Content that carries a hash is filed under the hash and its size, so one
+    // entry serves every path showing that object; content without one is
+    // filed under its path. Only BLOB/CLOB files carry one: every other file is
+    // one of several renderings of its object, and a hash does not tell them
+    // apart. A lookup finds the path's hash through its FileInfo or its entry
+    // in the cached parent listing.
+    static constexpr size_t kMaxContentBytes = 1024 * 1024;
+    void SetFileContent(PathId path, FileContentPtr content);
+    FileContentPtr GetFileContent(PathId path) const;
+    // The hash to create content of this size for the path with: the BLOB or
+    // CLOB hash of a file of that size, and otherwise empty
+    std::string ContentHash(PathId path, size_t size) const;
+
+    // Fixed-size pieces of large files, by index from the start of the file.
+    // A chunk carries the hash of the file it was read from and is only served
+    // for that hash, so a changed file never mixes old and new bytes; chunks of
+    // files without a hash are not kept.
+    static constexpr size_t kChunkBytes = 256 * 1024;
+    void SetFileChunk(PathId path, uint32_t index, FileContentPtr chunk);
+    FileContentPtr GetFileChunk(PathId path, uint32_t index, const std::string& hash) const;
+
+    // Background work (prefetching) asks with these so it does not count as traffic
+    bool HasDirectoryListing(PathId path) const { return directoryCache_.Contains(path, TTL()); }
+    bool HasFileContent(PathId path) const;
+
+    void InvalidatePath(PathId path);
+
+    // Stores each listing together with a FileInfo for every entry in it, in
+    // one pass: child paths are interned under a single table lock and each
+    // tier shard is locked once for the whole batch
+    void SetDirectoryTree(std::vector<DirectoryUpdate>&& directories);
+    // Patches a cached listing in place, touching only the named entries. The
+    // FileInfo of every touched entry follows, content of a changed hash is
+    // dropped and removed names are remembered as missing, whether or not the
+    // listing is cached. Returns false if it is not: a delta cannot stand in
+    // for the entries nobody sent.
+    bool ApplyDirectoryDelta(const DirectoryDelta& delta);
+    // Copies every live listing out, for persisting; the inverse of SetDirectoryTree.
+    // With include, only the directories it accepts; it runs under a shard lock.
+    std::vector<DirectoryUpdate> ExportDirectoryTree(const std::function<bool(PathId)>& include = nullptr) const;
+
+    // Negative lookups. A missing name is forgotten when its parent's listing is
+    // stored or invalidated, or when anything is stored under the path itself.
+    // IsMissing takes a canonical path and never allocates.
+    void SetMissing(const std::string& path);
+    bool IsMissing(std::string_view canonicalPath) const;
+
+    // Called with the directory's id whenever a stored listing is replaced or
+    // dropped, and with the listing just stored, if any: it may be too large to
+    // have been kept. Set before the cache is shared between threads.
+    using ListingChangedCallback = std::function<void(PathId, const DirectoryListingPtr&)>;
+    void SetListingChangedCallback(ListingChangedCallback callback) { listingChanged_ = std::move(callback); }
+
+    // Content whose path names a hash, and every chunk, is interned here, so
+    // roots holding the same bytes share one copy. Budgets still charge each
+    // cache for all it holds. Set before the cache is shared between threads.
+    void SetContentStore(std::shared_ptr<ContentStore> store) { contentStore_ = std::move(store); }
+
+    // Order listings are stored in, so enumerations can hand entries out as
+    // they are and find a name by binary search. Set before anything is stored.
+    void SetNameOrder(NameCompare compare) { compareNames_ = compare; }
+    // Index range of the entries equal to name in that order
+    std::pair<size_t, size_t> FindEntries(const PackedListing& listing, std::string_view name) const;
+    // Index of the first entry equal to name, through the name index when
+    // there is one; PackedListing::kNotFound otherwise
+    size_t FindEntry(const PackedListing& listing, std::string_view name) const;
+
+    // String forms for the JavaScript boundary. Paths are canonicalized; setters
+    // intern them, getters only look them up and miss for unknown paths.
     void SetFileInfo(const std::string& path, const FileInfo& info);
     std::optional<FileInfo> GetFileInfo(const std::string& path) const;
-    
-    void SetDirectoryListing(const std::string& path, const DirectoryListing& listing);
-    std::optional<DirectoryListing> GetDirectoryListing(const std::string& path) const;
-    
-    void SetFileContent(const std::string& path, const FileContent& content);
-    std::optional<FileContent> GetFileContent(const std::string& path) const;
-    
-    // Cache management
+    void SetDirectoryListing(const std::string& path, DirectoryListing listing);
+    DirectoryListingPtr GetDirectoryListing(const std::string& path) const;
+    void SetFileContent(const std::string& path, FileContentPtr content);
+    FileContentPtr GetFileContent(const std::string& path) const;
+    std::string ContentHash(const std::string& path, size_t size) const;
     void InvalidatePath(const std::string& path);
+
+    // Cache management
     void InvalidateAll();
     void SetCacheTTL(std::chrono::seconds ttl);
-    
+    void SetBudget(const CacheBudget& budget);
+    CacheBudget GetBudget() const;
+
     // Statistics
     struct CacheStats {
         size_t hits;
         size_t misses;
         size_t entries;
-        size_t memoryUsage;
+        size_t memoryUsage;  // Exact sum of the bytes accounted by each tier
+        TierStats fileInfo;
+        TierStats directory;
+        TierStats content;
+        TierStats chunks;
+        size_t negativeEntries;
+        uint64_t negativeHits;
     };
     CacheStats GetStats() const;
 
 private:
-    template<typename T>
-    struct CacheEntry {
-        T data;
-        std::chrono::steady_clock::time_point timestamp;
-        
-        bool IsValid(std::chrono::seconds ttl) const {
-            auto age = std::chrono::steady_clock::now() - timestamp;
-            return age < ttl;
-        }
+    std::chrono::seconds TTL() const { return std::chrono::seconds(ttlSeconds_.load(std::memory_order_relaxed)); }
+    PathId FindPath(const std::string& path) const { return paths_.Find(PathTable::Canonicalize(path)); }
+    PathId InternPath(const std::string& path) { return paths_.Intern(PathTable::Canonicalize(path)); }
+    void ForgetMissing(PathId path);
+    static uint64_t ChunkKey(PathId path, uint32_t index) { return static_cast<uint64_t>(path) << 32 | index; }
+    // Keys of the content tier: path ids stay below 2^32, hash keys have the top bit set
+    static uint64_t PathContentKey(PathId path) { return path; }
+    static uint64_t HashContentKey(const std::string& hash, uint64_t size);
+    // What the path's FileInfo, or its entry in the cached parent listing,
+    // says about a file; Describe* is false for directories and unknown hashes
+    struct ContentIdentity {
+        std::string hash;
+        uint64_t size = 0;
+        bool blobOrClob = false;  // Only then are the file's bytes the object named by the hash
     };
-    
-    mutable std::shared_mutex mutex_;
-    std::chrono::seconds ttl_ = std::chrono::seconds(3600); // 1 hour TTL
-    
+    bool DescribeFile(PathId path, ContentIdentity& identity) const;
+    bool DescribeListed(PathId parent, std::string_view name, ContentIdentity& identity) const;
+    // As DescribeFile, also for names that were only ever listed
+    bool DescribePath(std::string_view canonicalPath, ContentIdentity& identity) const;
+    FileContentPtr ContentByHash(const ContentIdentity& identity) const;
+    void ListingChanged(PathId directory, const DirectoryListingPtr& listing = nullptr);
+    void SortEntries(std::vector<FileInfo>& entries) const;
+
+    PathTable paths_;
+
+    std::atomic<std::chrono::seconds::rep> ttlSeconds_{3600}; // 1 hour TTL
+
     // Separate caches for different data types
-    std::unordered_map<std::string, CacheEntry<FileInfo>> fileInfoCache_;
-    std::unordered_map<std::string, CacheEntry<DirectoryListing>> directoryCache_;
-    std::unordered_map<std::string, CacheEntry<FileContent>> contentCache_;
-    
-    // Statistics
-    mutable size_t hits_ = 0;
-    mutable size_t misses_ = 0;
-    
-    // Helper to clean expired entries
-    void CleanExpiredEntries();
+    mutable LruTier<FileInfo> fileInfoCache_;
+    mutable LruTier<DirectoryListingPtr> directoryCache_;
+    mutable LruTier<FileContentPtr, uint64_t> contentCache_;  // Keyed by PathContentKey or HashContentKey
+    mutable LruTier<FileContentPtr, uint64_t> chunkCache_;  // Keyed by ChunkKey
+    mutable NegativeCache negativeCache_;
+
+    ListingChangedCallback listingChanged_;
+    std::shared_ptr<ContentStore> contentStore_;
+    NameCompare compareNames_ = CompareNamesIgnoringCase;
 };
 
 } // namespace oneifsprojfs
 
-#endif // CONTENT_CACHE_H
\ No newline at end of file
+#endif // CONTENT_CACHE_H
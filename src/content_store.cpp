@@ -0,0 +1,73 @@
+#include "content_store.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include "content_cache.h"
+
+namespace oneifsprojfs {
+
+ContentStore::Shard& ContentStore::ShardFor(const std::string& key) {
+    return shards_[std::hash<std::string>()(key) % kShardCount];
+}
+
+FileContentPtr ContentStore::Intern(const std::string& key, FileContentPtr content) {
+    if (!content || key.empty()) {
+        return content;
+    }
+    lookups_.Add();
+
+    Shard& shard = ShardFor(key);
+    FileContentPtr held;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found = shard.entries.find(key);
+        if (found != shard.entries.end()) {
+            held = found->second.lock();
+        }
+    }
+    if (held == content) {
+        return content;
+    }
+    if (held && held->size() == content->size() &&
+        (content->empty() || std::memcmp(held->data(), content->data(), content->size()) == 0)) {
+        shared_.Add();
+        sharedBytes_.Add(content->size());
+        return held;
+    }
+
+    // Unknown, gone, or a different payload under the same key: the newest wins
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.entries.try_emplace(key);
+    it->second = content;
+    if (inserted) {
+        entries_.fetch_add(1, std::memory_order_relaxed);
+        SweepLocked(shard);
+    }
+    return content;
+}
+
+void ContentStore::SweepLocked(Shard& shard) {
+    if (shard.entries.size() < shard.sweepAt) {
+        return;
+    }
+    for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+        if (it->second.expired()) {
+            it = shard.entries.erase(it);
+            entries_.fetch_sub(1, std::memory_order_relaxed);
+        } else {
+            ++it;
+        }
+    }
+    shard.sweepAt = (std::max)(kMinSweep, shard.entries.size() * 2);
+}
+
+ContentStore::Stats ContentStore::GetStats() const {
+    Stats stats;
+    stats.lookups = lookups_.Load();
+    stats.shared = shared_.Load();
+    stats.sharedBytes = sharedBytes_.Load();
+    stats.entries = entries_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace oneifsprojfs
@@ -0,0 +1,64 @@
+#ifndef CONTENT_STORE_H
+#define CONTENT_STORE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "stats.h"
+
+namespace oneifsprojfs {
+
+class FileContent;
+using FileContentPtr = std::shared_ptr<const FileContent>;
+
+// Content-addressed index of the file content every root's cache holds, so
+// roots (and paths) that cache the same object keep one copy of its bytes.
+// Entries are weak: content lives while some cache or reader holds it, and an
+// entry whose content is gone is replaced when next met or dropped when its
+// shard is swept.
+class ContentStore {
+public:
+    static constexpr size_t kShardCount = 16;
+
+    // Returns the content already held under the key if its bytes are equal,
+    // and otherwise records this content under the key and returns it. The
+    // bytes are compared outside the shard lock, so a key shared by two
+    // different payloads costs a comparison but never serves the wrong one.
+    FileContentPtr Intern(const std::string& key, FileContentPtr content);
+
+    struct Stats {
+        uint64_t lookups = 0;
+        uint64_t shared = 0;       // Answered with content already held
+        uint64_t sharedBytes = 0;  // Payload bytes those answers did not keep twice
+        size_t entries = 0;        // Including entries whose content is gone
+    };
+    Stats GetStats() const;
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::weak_ptr<const FileContent>> entries;
+        size_t sweepAt = kMinSweep;  // Size at which gone entries are dropped
+    };
+    static constexpr size_t kMinSweep = 64;
+
+    Shard& ShardFor(const std::string& key);
+    // Drops gone entries once the shard has doubled since the last sweep
+    void SweepLocked(Shard& shard);
+
+    std::array<Shard, kShardCount> shards_;
+    std::atomic<size_t> entries_{0};
+
+    StripedCounter lookups_;
+    StripedCounter shared_;
+    StripedCounter sharedBytes_;
+};
+
+} // namespace oneifsprojfs
+
+#endif // CONTENT_STORE_H
@@ -1,11 +1,102 @@
 #include <napi.h>
 #include "projfs_provider.h"
 #include "async_bridge.h"
+#include "shared_runtime.h"
+#include "tree_batch.h"
+#include <algorithm>
 #include <memory>
-#include <iostream>
+#include <optional>
+#include "log.h"
 
 using namespace oneifsprojfs;
 
+namespace {
+
+Napi::Object LatencyToJs(Napi::Env env, const LatencyHistogram::Snapshot& snapshot) {
+    Napi::Object latency = Napi::Object::New(env);
+    latency.Set("count", Napi::Number::New(env, static_cast<double>(snapshot.count)));
+    latency.Set("meanUs", Napi::Number::New(env, snapshot.MeanNs() / 1000.0));
+    latency.Set("p50Us", Napi::Number::New(env, snapshot.PercentileNs(50) / 1000.0));
+    latency.Set("p90Us", Napi::Number::New(env, snapshot.PercentileNs(90) / 1000.0));
+    latency.Set("p99Us", Napi::Number::New(env, snapshot.PercentileNs(99) / 1000.0));
+    latency.Set("p999Us", Napi::Number::New(env, snapshot.PercentileNs(99.9) / 1000.0));
+    latency.Set("maxUs", Napi::Number::New(env, snapshot.maxNs / 1000.0));
+    return latency;
+}
+
+Napi::Object TierStatsToJs(Napi::Env env, const TierStats& tier) {
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("hits", Napi::Number::New(env, static_cast<double>(tier.hits)));
+    stats.Set("misses", Napi::Number::New(env, static_cast<double>(tier.misses)));
+    stats.Set("inserts", Napi::Number::New(env, static_cast<double>(tier.inserts)));
+    stats.Set("evictions", Napi::Number::New(env, static_cast<double>(tier.evictions)));
+    stats.Set("expirations", Napi::Number::New(env, static_cast<double>(tier.expirations)));
+    stats.Set("entries", Napi::Number::New(env, static_cast<double>(tier.entries)));
+    stats.Set("bytes", Napi::Number::New(env, static_cast<double>(tier.bytes)));
+    stats.Set("budget", Napi::Number::New(env, static_cast<double>(tier.budget)));
+    stats.Set("lookupLatency", LatencyToJs(env, tier.lookupLatency));
+    return stats;
+}
+
+// Unspecified tiers keep the budget they have
+void ParseCacheBudget(const Napi::Object& obj, CacheBudget& budget) {
+    if (obj.Has("fileInfoBytes")) {
+        budget.fileInfoBytes = obj.Get("fileInfoBytes").As<Napi::Number>().Int64Value();
+    }
+    if (obj.Has("directoryBytes")) {
+        budget.directoryBytes = obj.Get("directoryBytes").As<Napi::Number>().Int64Value();
+    }
+    if (obj.Has("contentBytes")) {
+        budget.contentBytes = obj.Get("contentBytes").As<Napi::Number>().Int64Value();
+    }
+    if (obj.Has("chunkBytes")) {
+        budget.chunkBytes = obj.Get("chunkBytes").As<Napi::Number>().Int64Value();
+    }
+}
+
+Napi::Object BudgetToJs(Napi::Env env, const CacheBudget& budget) {
+    Napi::Object object = Napi::Object::New(env);
+    object.Set("fileInfoBytes", Napi::Number::New(env, static_cast<double>(budget.fileInfoBytes)));
+    object.Set("directoryBytes", Napi::Number::New(env, static_cast<double>(budget.directoryBytes)));
+    object.Set("contentBytes", Napi::Number::New(env, static_cast<double>(budget.contentBytes)));
+    object.Set("chunkBytes", Napi::Number::New(env, static_cast<double>(budget.chunkBytes)));
+    return object;
+}
+
+// One per module instance, so per Node environment (main thread or worker).
+// Every provider constructed in it virtualizes its own root on the same
+// runtime, which is created with the first of them.
+struct AddonData {
+    Napi::FunctionReference constructor;
+    std::shared_ptr<SharedRuntime> runtime;
+
+    const std::shared_ptr<SharedRuntime>& Runtime() {
+        if (!runtime) {
+            runtime = std::make_shared<SharedRuntime>();
+        }
+        return runtime;
+    }
+};
+
+// setSharedCacheBudget(budget): the cache budget every root without one of
+// its own shares
+Napi::Value SetSharedCacheBudget(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Budget object required").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto& runtime = env.GetInstanceData<AddonData>()->Runtime();
+    CacheBudget budget = runtime->GetBudget();
+    ParseCacheBudget(info[0].As<Napi::Object>(), budget);
+    runtime->SetBudget(budget);
+    return env.Undefined();
+}
+
+} // namespace
+
 class IFSProjFSBridge : public Napi::ObjectWrap<IFSProjFSBridge> {
 public:
     static Napi::Object Init(Napi::Env env, Napi::Object exports) {
@@ -18,21 +109,29 @@ public:
             InstanceMethod("setCachedDirectory", &IFSProjFSBridge::SetCachedDirectory),
             InstanceMethod("setCachedContent", &IFSProjFSBridge::SetCachedContent),
             InstanceMethod("setCachedFileInfo", &IFSProjFSBridge::SetCachedFileInfo),
+            InstanceMethod("setCachedTree", &IFSProjFSBridge::SetCachedTree),
+            InstanceMethod("setCacheBudget", &IFSProjFSBridge::SetCacheBudget),
+            InstanceMethod("setPrefetchOptions", &IFSProjFSBridge::SetPrefetchOptions),
+            InstanceMethod("setLogLevel", &IFSProjFSBridge::SetLogLevel),
+            InstanceMethod("getLogLevel", &IFSProjFSBridge::GetLogLevel),
             InstanceMethod("completePendingFileRequests", &IFSProjFSBridge::CompletePendingFileRequests),
-            InstanceMethod("invalidateTombstone", &IFSProjFSBridge::InvalidateTombstone)
+            InstanceMethod("invalidateTombstone", &IFSProjFSBridge::InvalidateTombstone),
+            InstanceMethod("updatePaths", &IFSProjFSBridge::UpdatePaths),
+            InstanceMethod("applyChanges", &IFSProjFSBridge::ApplyChanges)
         });
 
-        Napi::FunctionReference* constructor = new Napi::FunctionReference();
-        *constructor = Napi::Persistent(func);
-        env.SetInstanceData(constructor);
+        AddonData* data = new AddonData();
+        data->constructor = Napi::Persistent(func);
+        env.SetInstanceData(data);
 
         exports.Set("IFSProjFSProvider", func);
+        exports.Set("setSharedCacheBudget", Napi::Function::New(env, SetSharedCacheBudget, "setSharedCacheBudget"));
         return exports;
     }
 
     IFSProjFSBridge(const Napi::CallbackInfo& info) : Napi::ObjectWrap<IFSProjFSBridge>(info) {
         Napi::Env env = info.Env();
-        std::cout << "[Native] IFSProjFSBridge constructor start" << std::endl;
+        PROJFS_DEBUG("[Native] IFSProjFSBridge constructor start");
 
         if (info.Length() < 1 || !info[0].IsString()) {
             Napi::TypeError::New(env, "Instance path required").ThrowAsJavaScriptException();
@@ -40,24 +139,53 @@ public:
         }
 
         std::string instancePath = info[0].As<Napi::String>().Utf8Value();
-        std::cout << "[Native] instancePath: " << instancePath << std::endl;
+        PROJFS_DEBUG("[Native] instancePath: " << instancePath);
 
         try {
-            std::cout << "[Native] Creating ProjFSProvider..." << std::endl;
-            provider_ = std::make_unique<ProjFSProvider>(instancePath);
-            std::cout << "[Native] ProjFSProvider created" << std::endl;
+            runtime_ = env.GetInstanceData<AddonData>()->Runtime();
+            PROJFS_DEBUG("[Native] Creating ProjFSProvider...");
+            provider_ = std::make_unique<ProjFSProvider>(instancePath, runtime_->Pool());
+            PROJFS_DEBUG("[Native] ProjFSProvider created");
             asyncBridge_ = std::make_shared<AsyncBridge>(env);
-            std::cout << "[Native] AsyncBridge created" << std::endl;
+            asyncBridge_->GetCache()->SetContentStore(runtime_->Contents());
+            PROJFS_DEBUG("[Native] AsyncBridge created");
             provider_->SetAsyncBridge(asyncBridge_);
-            std::cout << "[Native] AsyncBridge set" << std::endl;
+            PROJFS_DEBUG("[Native] AsyncBridge set");
+            AttachToRuntime();
         } catch (const std::exception& e) {
-            std::cout << "[Native] Exception: " << e.what() << std::endl;
+            PROJFS_ERROR("[Native] Exception: " << e.what());
             Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
         }
-        std::cout << "[Native] IFSProjFSBridge constructor done" << std::endl;
+        PROJFS_DEBUG("[Native] IFSProjFSBridge constructor done");
+    }
+
+    ~IFSProjFSBridge() {
+        DetachFromRuntime();
     }
 
 private:
+    // A root takes part in the shared budget from construction, or a restart,
+    // until stop; a budget of its own set in between is kept across restarts
+    void AttachToRuntime() {
+        if (attached_ || !runtime_ || !asyncBridge_) {
+            return;
+        }
+        auto cache = asyncBridge_->GetCache();
+        runtime_->Attach(cache);
+        if (ownBudget_) {
+            runtime_->SetRootBudget(cache.get(), *ownBudget_);
+        }
+        attached_ = true;
+    }
+
+    void DetachFromRuntime() {
+        // The other roots take over this one's share of the budget
+        if (attached_) {
+            runtime_->Detach(asyncBridge_->GetCache().get());
+            attached_ = false;
+        }
+    }
+
     Napi::Value RegisterCallbacks(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
@@ -82,11 +210,24 @@ private:
 
         std::string virtualRoot = info[0].As<Napi::String>().Utf8Value();
 
+        StartOptions options;
+        if (info.Length() > 1 && info[1].IsObject()) {
+            Napi::Object startOptions = info[1].As<Napi::Object>();
+            if (startOptions.Has("preservePlaceholders")) {
+                options.preservePlaceholders = startOptions.Get("preservePlaceholders").ToBoolean().Value();
+            }
+            if (startOptions.Has("writable")) {
+                options.writable = startOptions.Get("writable").ToBoolean().Value();
+            }
+        }
+
+        AttachToRuntime();
+
         // Start async bridge first
         asyncBridge_->Start();
         
         // Then start ProjFS provider
-        bool success = provider_->Start(virtualRoot);
+        bool success = provider_->Start(virtualRoot, options);
         if (!success) {
             asyncBridge_->Stop();
             std::string error = "Failed to start ProjFS provider: " + provider_->GetLastError();
@@ -100,7 +241,10 @@ private:
         Napi::Env env = info.Env();
 
         provider_->Stop();
+        // Deliver what is still queued while the debug callback is alive
+        logging::Flush();
         asyncBridge_->Stop();
+        DetachFromRuntime();
         return Napi::Boolean::New(env, true);
     }
 
@@ -120,6 +264,147 @@ private:
         stats.Set("bytesRead", Napi::BigInt::New(env, providerStats.bytesRead.load()));
         stats.Set("cacheHits", Napi::Number::New(env, providerStats.cacheHits.load()));
         stats.Set("cacheMisses", Napi::Number::New(env, providerStats.cacheMisses.load()));
+        stats.Set("directoryFetches", Napi::Number::New(env, providerStats.directoryFetches.load()));
+        stats.Set("cancelledCommands", Napi::Number::New(env, providerStats.cancelledCommands.load()));
+        stats.Set("negativeCacheHits", Napi::Number::New(env, providerStats.negativeCacheHits.load()));
+        stats.Set("snapshotRestores", Napi::Number::New(env, providerStats.snapshotRestores.load()));
+        stats.Set("snapshotSaves", Napi::Number::New(env, providerStats.snapshotSaves.load()));
+        stats.Set("placeholdersKept", Napi::Number::New(env, providerStats.placeholdersKept.load()));
+        stats.Set("placeholdersUpdated", Napi::Number::New(env, providerStats.placeholdersUpdated.load()));
+        stats.Set("placeholdersDeleted", Napi::Number::New(env, providerStats.placeholdersDeleted.load()));
+        stats.Set("placeholdersLocal", Napi::Number::New(env, providerStats.placeholdersLocal.load()));
+        stats.Set("pathUpdates", Napi::Number::New(env, providerStats.pathUpdates.load()));
+        stats.Set("streamedChunks", Napi::Number::New(env, providerStats.streamedChunks.load()));
+        stats.Set("writeBacks", Napi::Number::New(env, providerStats.writeBacks.load()));
+        stats.Set("offloadedCommands", Napi::Number::New(env, providerStats.offloadedCommands.load()));
+        stats.Set("indexedObjectEntries", Napi::Number::New(env, providerStats.indexedObjectEntries.load()));
+        stats.Set("blobReads", Napi::Number::New(env, providerStats.blobReads.load()));
+
+        if (asyncBridge_ && asyncBridge_->GetCache()) {
+            ContentCache::CacheStats cacheStats = asyncBridge_->GetCache()->GetStats();
+
+            Napi::Object cache = Napi::Object::New(env);
+            cache.Set("hits", Napi::Number::New(env, static_cast<double>(cacheStats.hits)));
+            cache.Set("misses", Napi::Number::New(env, static_cast<double>(cacheStats.misses)));
+            cache.Set("entries", Napi::Number::New(env, static_cast<double>(cacheStats.entries)));
+            cache.Set("memoryUsage", Napi::Number::New(env, static_cast<double>(cacheStats.memoryUsage)));
+            cache.Set("fileInfo", TierStatsToJs(env, cacheStats.fileInfo));
+            cache.Set("directory", TierStatsToJs(env, cacheStats.directory));
+            cache.Set("content", TierStatsToJs(env, cacheStats.content));
+            cache.Set("chunks", TierStatsToJs(env, cacheStats.chunks));
+            cache.Set("negativeEntries", Napi::Number::New(env, static_cast<double>(cacheStats.negativeEntries)));
+            cache.Set("negativeHits", Napi::Number::New(env, static_cast<double>(cacheStats.negativeHits)));
+            stats.Set("cache", cache);
+        }
+
+        if (asyncBridge_) {
+            AsyncBridge::FetchStats fetchStats = asyncBridge_->GetFetchStats();
+
+            Napi::Object fetch = Napi::Object::New(env);
+            fetch.Set("requests", Napi::Number::New(env, static_cast<double>(fetchStats.requests)));
+            fetch.Set("batches", Napi::Number::New(env, static_cast<double>(fetchStats.batches)));
+            fetch.Set("rejected", Napi::Number::New(env, static_cast<double>(fetchStats.rejected)));
+            fetch.Set("queueDepth", Napi::Number::New(env, static_cast<double>(fetchStats.queueDepth)));
+            fetch.Set("maxQueueDepth", Napi::Number::New(env, static_cast<double>(fetchStats.maxQueueDepth)));
+            fetch.Set("outstanding", Napi::Number::New(env, static_cast<double>(fetchStats.outstanding)));
+            fetch.Set("queueWait", LatencyToJs(env, fetchStats.queueWait));
+            fetch.Set("roundTrip", LatencyToJs(env, fetchStats.roundTrip));
+            Napi::Object fetchLatency = Napi::Object::New(env);
+            for (size_t kind = 0; kind < AsyncBridge::kFetchKindCount; kind++) {
+                fetchLatency.Set(AsyncBridge::FetchKindName(static_cast<AsyncBridge::FetchKind>(kind)),
+                                 LatencyToJs(env, fetchStats.latency[kind]));
+            }
+            fetch.Set("latency", fetchLatency);
+            stats.Set("fetch", fetch);
+
+            AsyncBridge::WriteStats writeStats = asyncBridge_->GetWriteStats();
+
+            Napi::Object write = Napi::Object::New(env);
+            write.Set("queued", Napi::Number::New(env, static_cast<double>(writeStats.queued)));
+            write.Set("coalesced", Napi::Number::New(env, static_cast<double>(writeStats.coalesced)));
+            write.Set("written", Napi::Number::New(env, static_cast<double>(writeStats.written)));
+            write.Set("failed", Napi::Number::New(env, static_cast<double>(writeStats.failed)));
+            write.Set("rejected", Napi::Number::New(env, static_cast<double>(writeStats.rejected)));
+            write.Set("spilled", Napi::Number::New(env, static_cast<double>(writeStats.spilled)));
+            write.Set("queueDepth", Napi::Number::New(env, static_cast<double>(writeStats.queueDepth)));
+            write.Set("inflight", Napi::Number::New(env, static_cast<double>(writeStats.inflight)));
+            write.Set("queuedBytes", Napi::Number::New(env, static_cast<double>(writeStats.queuedBytes)));
+            stats.Set("write", write);
+        }
+
+        if (auto prefetcher = provider_->GetPrefetcher()) {
+            Prefetcher::Stats prefetchStats = prefetcher->GetStats();
+
+            Napi::Object prefetch = Napi::Object::New(env);
+            prefetch.Set("scheduled", Napi::Number::New(env, static_cast<double>(prefetchStats.scheduled)));
+            prefetch.Set("directories", Napi::Number::New(env, static_cast<double>(prefetchStats.directories)));
+            prefetch.Set("files", Napi::Number::New(env, static_cast<double>(prefetchStats.files)));
+            prefetch.Set("bytes", Napi::Number::New(env, static_cast<double>(prefetchStats.bytes)));
+            prefetch.Set("skipped", Napi::Number::New(env, static_cast<double>(prefetchStats.skipped)));
+            prefetch.Set("deferred", Napi::Number::New(env, static_cast<double>(prefetchStats.deferred)));
+            prefetch.Set("queued", Napi::Number::New(env, static_cast<double>(prefetchStats.queued)));
+            prefetch.Set("inflight", Napi::Number::New(env, static_cast<double>(prefetchStats.inflight)));
+            stats.Set("prefetch", prefetch);
+        }
+
+        if (auto pool = provider_->GetThreadPool()) {
+            ThreadPool::Stats poolStats = pool->GetStats();
+
+            Napi::Object poolObject = Napi::Object::New(env);
+            poolObject.Set("threads", Napi::Number::New(env, static_cast<double>(poolStats.threads)));
+            poolObject.Set("executed", Napi::Number::New(env, static_cast<double>(poolStats.executed)));
+            poolObject.Set("stolen", Napi::Number::New(env, static_cast<double>(poolStats.stolen)));
+            poolObject.Set("failed", Napi::Number::New(env, static_cast<double>(poolStats.failed)));
+            poolObject.Set("foregroundQueued", Napi::Number::New(env, static_cast<double>(poolStats.foregroundQueued)));
+            poolObject.Set("backgroundQueued", Napi::Number::New(env, static_cast<double>(poolStats.backgroundQueued)));
+            poolObject.Set("delayed", Napi::Number::New(env, static_cast<double>(poolStats.delayed)));
+            stats.Set("pool", poolObject);
+        }
+
+        ObjectInfoTable::Stats objectStats = provider_->GetObjectInfoStats();
+        Napi::Object objectInfo = Napi::Object::New(env);
+        objectInfo.Set("hits", Napi::Number::New(env, static_cast<double>(objectStats.hits)));
+        objectInfo.Set("misses", Napi::Number::New(env, static_cast<double>(objectStats.misses)));
+        objectInfo.Set("evictions", Napi::Number::New(env, static_cast<double>(objectStats.evictions)));
+        objectInfo.Set("entries", Napi::Number::New(env, static_cast<double>(objectStats.entries)));
+        objectInfo.Set("capacity", Napi::Number::New(env, static_cast<double>(objectStats.capacity)));
+        objectInfo.Set("types", Napi::Number::New(env, static_cast<double>(objectStats.types)));
+        stats.Set("objectInfo", objectInfo);
+
+        CallbackStats::Snapshot callbackStats = provider_->GetCallbackStats();
+        Napi::Object callbacks = Napi::Object::New(env);
+        for (size_t kind = 0; kind < kCallbackKindCount; kind++) {
+            Napi::Object callback = Napi::Object::New(env);
+            for (size_t outcome = 0; outcome < kCallbackOutcomeCount; outcome++) {
+                callback.Set(CallbackOutcomeName(static_cast<CallbackOutcome>(outcome)),
+                             LatencyToJs(env, callbackStats.latency[kind][outcome]));
+            }
+            callback.Set("completion", LatencyToJs(env, callbackStats.completion[kind]));
+            callbacks.Set(CallbackKindName(static_cast<CallbackKind>(kind)), callback);
+        }
+        stats.Set("callbacks", callbacks);
+
+        if (runtime_) {
+            SharedRuntime::Stats sharedStats = runtime_->GetStats();
+
+            Napi::Object shared = Napi::Object::New(env);
+            shared.Set("roots", Napi::Number::New(env, static_cast<double>(sharedStats.roots)));
+            shared.Set("budget", BudgetToJs(env, sharedStats.budget));
+            shared.Set("contentLookups", Napi::Number::New(env, static_cast<double>(sharedStats.contents.lookups)));
+            shared.Set("contentShared", Napi::Number::New(env, static_cast<double>(sharedStats.contents.shared)));
+            shared.Set("sharedBytes", Napi::Number::New(env, static_cast<double>(sharedStats.contents.sharedBytes)));
+            shared.Set("contentEntries", Napi::Number::New(env, static_cast<double>(sharedStats.contents.entries)));
+            stats.Set("shared", shared);
+        }
+
+        PendingCommandCounts pendingCounts = provider_->GetPendingCommandCounts();
+        Napi::Object pending = Napi::Object::New(env);
+        pending.Set("placeholders", Napi::Number::New(env, static_cast<double>(pendingCounts.placeholders)));
+        pending.Set("fileData", Napi::Number::New(env, static_cast<double>(pendingCounts.fileData)));
+        pending.Set("streams", Napi::Number::New(env, static_cast<double>(pendingCounts.streams)));
+        pending.Set("enumerations", Napi::Number::New(env, static_cast<double>(pendingCounts.enumerations)));
+        pending.Set("offloaded", Napi::Number::New(env, static_cast<double>(pendingCounts.offloaded)));
+        stats.Set("pendingCommands", pending);
 
         return stats;
     }
@@ -149,7 +434,7 @@ private:
                     fileInfo.hash = entry.Get("hash").As<Napi::String>().Utf8Value();
                 }
                 if (entry.Has("size")) {
-                    fileInfo.size = entry.Get("size").As<Napi::Number>().Int64Value();  // Use Int64Value for size_t
+                    fileInfo.size = static_cast<size_t>(std::max<int64_t>(0, entry.Get("size").As<Napi::Number>().Int64Value()));
                 }
                 if (entry.Has("isDirectory")) {
                     fileInfo.isDirectory = entry.Get("isDirectory").As<Napi::Boolean>().Value();
@@ -160,6 +445,9 @@ private:
                 if (entry.Has("mode")) {
                     fileInfo.mode = entry.Get("mode").As<Napi::Number>().Uint32Value();
                 }
+                if (entry.Has("mtime") && entry.Get("mtime").IsNumber()) {
+                    fileInfo.mtime = static_cast<uint64_t>(std::max<int64_t>(0, entry.Get("mtime").As<Napi::Number>().Int64Value()));
+                }
                 
                 listing.entries.push_back(fileInfo);
             }
@@ -167,7 +455,7 @@ private:
         
         // Store in cache
         if (asyncBridge_ && asyncBridge_->GetCache()) {
-            asyncBridge_->GetCache()->SetDirectoryListing(path, listing);
+            asyncBridge_->GetCache()->SetDirectoryListing(path, std::move(listing));
         }
         
         return env.Undefined();
@@ -186,9 +474,10 @@ private:
 
         // Store content in cache
         if (asyncBridge_ && asyncBridge_->GetCache()) {
-            FileContent content;
-            content.data = std::vector<uint8_t>(buffer.Data(), buffer.Data() + buffer.Length());
-            asyncBridge_->GetCache()->SetFileContent(path, content);
+            // The only copy on the content path: JS memory into the aligned cache blob
+            auto cache = asyncBridge_->GetCache();
+            cache->SetFileContent(path, FileContent::Copy(buffer.Data(), buffer.Length(),
+                                                          cache->ContentHash(path, buffer.Length())));
         }
 
         return env.Undefined();
@@ -213,7 +502,7 @@ private:
             fileInfo.hash = obj.Get("hash").As<Napi::String>().Utf8Value();
         }
         if (obj.Has("size")) {
-            fileInfo.size = obj.Get("size").As<Napi::Number>().Uint32Value();
+            fileInfo.size = static_cast<size_t>(std::max<int64_t>(0, obj.Get("size").As<Napi::Number>().Int64Value()));
         }
         if (obj.Has("isDirectory")) {
             fileInfo.isDirectory = obj.Get("isDirectory").As<Napi::Boolean>().Value();
@@ -224,6 +513,9 @@ private:
         if (obj.Has("mode")) {
             fileInfo.mode = obj.Get("mode").As<Napi::Number>().Uint32Value();
         }
+        if (obj.Has("mtime") && obj.Get("mtime").IsNumber()) {
+            fileInfo.mtime = static_cast<uint64_t>(std::max<int64_t>(0, obj.Get("mtime").As<Napi::Number>().Int64Value()));
+        }
 
         // Store file info in cache
         if (asyncBridge_ && asyncBridge_->GetCache()) {
@@ -233,6 +525,136 @@ private:
         return env.Undefined();
     }
     
+    // Stores listings and per-entry FileInfo for many directories from one
+    // packed buffer (see tree_batch.h); returns the number of entries stored
+    Napi::Value SetCachedTree(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        if (info.Length() >= 1 && info[0].IsTypedArray()) {
+            Napi::TypedArray array = info[0].As<Napi::TypedArray>();
+            data = static_cast<const uint8_t*>(array.ArrayBuffer().Data()) + array.ByteOffset();
+            size = array.ByteLength();
+        } else if (info.Length() >= 1 && info[0].IsArrayBuffer()) {
+            Napi::ArrayBuffer buffer = info[0].As<Napi::ArrayBuffer>();
+            data = static_cast<const uint8_t*>(buffer.Data());
+            size = buffer.ByteLength();
+        } else {
+            Napi::TypeError::New(env, "Packed tree buffer required").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        std::vector<DirectoryUpdate> directories;
+        std::string error;
+        if (!tree_batch::Decode(data, size, directories, error)) {
+            Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        size_t entries = 0;
+        for (const auto& directory : directories) {
+            entries += directory.listing.entries.size();
+        }
+
+        if (asyncBridge_ && asyncBridge_->GetCache()) {
+            asyncBridge_->GetCache()->SetDirectoryTree(std::move(directories));
+        }
+
+        return Napi::Number::New(env, static_cast<double>(entries));
+    }
+    
+    Napi::Value SetCacheBudget(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            Napi::TypeError::New(env, "Budget object required").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Object obj = info[0].As<Napi::Object>();
+
+        // This root leaves the shared split and keeps the budget it asked for
+        if (asyncBridge_ && asyncBridge_->GetCache()) {
+            auto cache = asyncBridge_->GetCache();
+            CacheBudget budget = ownBudget_ ? *ownBudget_ : cache->GetBudget();
+            ParseCacheBudget(obj, budget);
+            ownBudget_ = budget;
+            if (attached_) {
+                runtime_->SetRootBudget(cache.get(), budget);
+            } else {
+                cache->SetBudget(budget);
+            }
+        }
+
+        return env.Undefined();
+    }
+
+    Napi::Value SetPrefetchOptions(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            Napi::TypeError::New(env, "Prefetch options object required").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Object obj = info[0].As<Napi::Object>();
+        auto prefetcher = provider_->GetPrefetcher();
+        if (!prefetcher) {
+            return env.Undefined();
+        }
+
+        // Unspecified settings keep their current value; enabled defaults to true
+        PrefetchOptions options = prefetcher->GetOptions();
+        options.enabled = obj.Has("enabled") ? obj.Get("enabled").ToBoolean().Value() : true;
+        if (obj.Has("depth")) {
+            options.depth = obj.Get("depth").As<Napi::Number>().Uint32Value();
+        }
+        if (obj.Has("maxFileBytes")) {
+            options.maxFileBytes = obj.Get("maxFileBytes").As<Napi::Number>().Int64Value();
+        }
+        if (obj.Has("budgetBytes")) {
+            options.budgetBytes = obj.Get("budgetBytes").As<Napi::Number>().Int64Value();
+        }
+        if (obj.Has("concurrency")) {
+            options.concurrency = obj.Get("concurrency").As<Napi::Number>().Uint32Value();
+        }
+        if (obj.Has("exclude") && obj.Get("exclude").IsArray()) {
+            Napi::Array exclude = obj.Get("exclude").As<Napi::Array>();
+            options.excludePrefixes.clear();
+            for (uint32_t i = 0; i < exclude.Length(); i++) {
+                if (exclude.Get(i).IsString()) {
+                    options.excludePrefixes.push_back(exclude.Get(i).As<Napi::String>().Utf8Value());
+                }
+            }
+        }
+        prefetcher->Configure(options);
+
+        return env.Undefined();
+    }
+
+    Napi::Value SetLogLevel(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        LogLevel level;
+        if (info.Length() < 1 || !info[0].IsString() ||
+            !logging::ParseLevel(info[0].As<Napi::String>().Utf8Value(), level)) {
+            Napi::TypeError::New(env, "Log level required: trace, debug, info, warn, error or off").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        if (level < static_cast<LogLevel>(PROJFS_LOG_COMPILED_LEVEL)) {
+            PROJFS_WARN("[Native] Log level " << logging::LevelName(level) << " requested but only "
+                << logging::LevelName(static_cast<LogLevel>(PROJFS_LOG_COMPILED_LEVEL)) << " and above are compiled in");
+        }
+        logging::SetLevel(level);
+        return env.Undefined();
+    }
+
+    Napi::Value GetLogLevel(const Napi::CallbackInfo& info) {
+        return Napi::String::New(info.Env(), logging::LevelName(logging::GetLevel()));
+    }
+
     Napi::Value CompletePendingFileRequests(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
@@ -268,8 +690,127 @@ private:
         return Napi::Boolean::New(env, success);
     }
 
+    // updatePaths([path | { path, info }]): an info object is stored first,
+    // a null info marks the path as removed, a bare path uses what is cached
+    Napi::Value UpdatePaths(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsArray()) {
+            Napi::TypeError::New(env, "Array of paths required").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Array updates = info[0].As<Napi::Array>();
+        std::shared_ptr<ContentCache> cache = asyncBridge_ ? asyncBridge_->GetCache() : nullptr;
+        std::vector<std::string> paths;
+        paths.reserve(updates.Length());
+        for (uint32_t i = 0; i < updates.Length(); i++) {
+            Napi::Value update = updates.Get(i);
+            if (update.IsString()) {
+                paths.push_back(update.As<Napi::String>().Utf8Value());
+                continue;
+            }
+            if (!update.IsObject() || !update.As<Napi::Object>().Get("path").IsString()) {
+                continue;
+            }
+            Napi::Object object = update.As<Napi::Object>();
+            std::string path = PathTable::Canonicalize(object.Get("path").As<Napi::String>().Utf8Value());
+            if (cache && object.Has("info")) {
+                Napi::Value value = object.Get("info");
+                if (value.IsObject()) {
+                    cache->SetFileInfo(path, AsyncBridge::ParseFileInfo(value.As<Napi::Object>()));
+                } else if (value.IsNull() || value.IsUndefined()) {
+                    cache->InvalidatePath(path);
+                    cache->SetMissing(path);
+                }
+            }
+            paths.push_back(std::move(path));
+        }
+
+        PathUpdateResult result;
+        if (provider_) {
+            result = provider_->UpdatePaths(paths);
+        }
+
+        Napi::Object counts = Napi::Object::New(env);
+        counts.Set("updated", Napi::Number::New(env, static_cast<double>(result.updated)));
+        counts.Set("deleted", Napi::Number::New(env, static_cast<double>(result.deleted)));
+        counts.Set("notOnDisk", Napi::Number::New(env, static_cast<double>(result.notOnDisk)));
+        counts.Set("local", Napi::Number::New(env, static_cast<double>(result.local)));
+        counts.Set("failed", Napi::Number::New(env, static_cast<double>(result.failed)));
+        return counts;
+    }
+
+    // applyChanges([{ path, added, modified, removed }]): added and modified
+    // hold FileInfo objects, removed holds names
+    Napi::Value ApplyChanges(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsArray()) {
+            Napi::TypeError::New(env, "Array of directory changes required").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Array changes = info[0].As<Napi::Array>();
+        std::vector<DirectoryDelta> deltas;
+        deltas.reserve(changes.Length());
+        for (uint32_t i = 0; i < changes.Length(); i++) {
+            if (!changes.Get(i).IsObject()) {
+                continue;
+            }
+            Napi::Object change = changes.Get(i).As<Napi::Object>();
+            if (!change.Get("path").IsString()) {
+                continue;
+            }
+
+            DirectoryDelta delta;
+            delta.path = change.Get("path").As<Napi::String>().Utf8Value();
+            for (const char* key : {"added", "modified"}) {
+                if (!change.Get(key).IsArray()) {
+                    continue;
+                }
+                Napi::Array entries = change.Get(key).As<Napi::Array>();
+                for (uint32_t e = 0; e < entries.Length(); e++) {
+                    if (entries.Get(e).IsObject()) {
+                        FileInfo entry = AsyncBridge::ParseFileInfo(entries.Get(e).As<Napi::Object>());
+                        if (!entry.name.empty()) {
+                            delta.upserts.push_back(std::move(entry));
+                        }
+                    }
+                }
+            }
+            if (change.Get("removed").IsArray()) {
+                Napi::Array names = change.Get("removed").As<Napi::Array>();
+                for (uint32_t n = 0; n < names.Length(); n++) {
+                    if (names.Get(n).IsString()) {
+                        delta.removals.push_back(names.Get(n).As<Napi::String>().Utf8Value());
+                    }
+                }
+            }
+            deltas.push_back(std::move(delta));
+        }
+
+        ChangeResult result;
+        if (provider_) {
+            result = provider_->ApplyChanges(deltas);
+        }
+
+        Napi::Object counts = Napi::Object::New(env);
+        counts.Set("patched", Napi::Number::New(env, static_cast<double>(result.patched)));
+        counts.Set("uncached", Napi::Number::New(env, static_cast<double>(result.uncached)));
+        counts.Set("updated", Napi::Number::New(env, static_cast<double>(result.placeholders.updated)));
+        counts.Set("deleted", Napi::Number::New(env, static_cast<double>(result.placeholders.deleted)));
+        counts.Set("notOnDisk", Napi::Number::New(env, static_cast<double>(result.placeholders.notOnDisk)));
+        counts.Set("local", Napi::Number::New(env, static_cast<double>(result.placeholders.local)));
+        counts.Set("failed", Napi::Number::New(env, static_cast<double>(result.placeholders.failed)));
+        return counts;
+    }
+
+    std::shared_ptr<SharedRuntime> runtime_;  // Outlives the provider that uses its pool
     std::unique_ptr<ProjFSProvider> provider_;
     std::shared_ptr<AsyncBridge> asyncBridge_;
+    bool attached_ = false;
+    std::optional<CacheBudget> ownBudget_;
 };
 
 // Module initialization
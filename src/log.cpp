@@ -0,0 +1,254 @@
+#include "log.h"
+#include "stats.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace oneifsprojfs {
+namespace logging {
+
+std::atomic<int> g_level{static_cast<int>(LogLevel::Info)};
+
+namespace {
+
+constexpr size_t kRingCapacity = 8192;  // Must be a power of two
+constexpr std::chrono::milliseconds kDrainInterval{20};
+constexpr std::chrono::milliseconds kFlushTimeout{1000};
+
+struct Record {
+    LogLevel level = LogLevel::Info;
+    bool forward = false;
+    std::string message;
+};
+
+// Bounded multi-producer, single-consumer ring. Every slot carries a sequence
+// number saying whose turn it is, so producers claim slots with one CAS and
+// never take a lock; a full ring makes TryPush fail instead of waiting.
+class RecordRing {
+public:
+    RecordRing() {
+        for (size_t i = 0; i < kRingCapacity; i++) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool TryPush(Record&& record) {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & (kRingCapacity - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.record = std::move(record);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Only ever called from the writer thread
+    bool TryPop(Record& record) {
+        Slot& slot = slots_[dequeuePos_ & (kRingCapacity - 1)];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != dequeuePos_ + 1) {
+            return false;
+        }
+        record = std::move(slot.record);
+        slot.sequence.store(dequeuePos_ + kRingCapacity, std::memory_order_release);
+        dequeuePos_++;
+        return true;
+    }
+
+    size_t Claimed() const { return enqueuePos_.load(std::memory_order_acquire); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        Record record;
+    };
+
+    std::array<Slot, kRingCapacity> slots_;
+    alignas(kCacheLineSize) std::atomic<size_t> enqueuePos_{0};
+    alignas(kCacheLineSize) size_t dequeuePos_ = 0;
+};
+
+class Logger {
+public:
+    Logger() {
+        std::thread([this]() { Run(); }).detach();
+    }
+
+    void Write(Record&& record) {
+        if (!ring_.TryPush(std::move(record))) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void SetForwardSink(ForwardSink sink, const void* owner) {
+        std::lock_guard<std::mutex> lock(sinkMutex_);
+        sink_ = std::move(sink);
+        sinkOwner_ = owner;
+    }
+
+    void ClearForwardSink(const void* owner) {
+        std::lock_guard<std::mutex> lock(sinkMutex_);
+        if (sinkOwner_ == owner) {
+            sink_ = nullptr;
+            sinkOwner_ = nullptr;
+        }
+    }
+
+    void Flush() {
+        size_t target = ring_.Claimed();
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            wakeRequested_ = true;
+        }
+        wakeCv_.notify_one();
+
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        flushCv_.wait_for(lock, kFlushTimeout, [this, target] {
+            return written_.load(std::memory_order_acquire) >= target;
+        });
+    }
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void Run() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                wakeCv_.wait_for(lock, kDrainInterval, [this] { return wakeRequested_; });
+                wakeRequested_ = false;
+            }
+            Drain();
+            flushCv_.notify_all();
+        }
+    }
+
+    void Drain() {
+        std::string console;
+        std::vector<std::string> forwarded;
+        size_t popped = 0;
+
+        // Hold the sink for the whole batch so ClearForwardSink returns only
+        // once the sink is no longer in use
+        std::lock_guard<std::mutex> lock(sinkMutex_);
+
+        Record record;
+        while (ring_.TryPop(record)) {
+            popped++;
+            if (record.forward && sink_) {
+                forwarded.push_back(std::move(record.message));
+            } else {
+                console.append(record.message);
+                console.push_back('\n');
+            }
+        }
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reportedDropped_) {
+            console.append("[Log] Ring buffer full, dropped " + std::to_string(dropped - reportedDropped_) + " records\n");
+            reportedDropped_ = dropped;
+        }
+
+        if (!console.empty()) {
+            fwrite(console.data(), 1, console.size(), stdout);
+            fflush(stdout);
+        }
+        if (!forwarded.empty()) {
+            sink_(std::move(forwarded));
+        }
+
+        written_.fetch_add(popped, std::memory_order_release);
+    }
+
+    RecordRing ring_;
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t reportedDropped_ = 0;
+    std::atomic<size_t> written_{0};
+
+    std::mutex sinkMutex_;
+    ForwardSink sink_;
+    const void* sinkOwner_ = nullptr;
+
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+    std::condition_variable flushCv_;
+    bool wakeRequested_ = false;
+};
+
+// Never destroyed: the writer thread is detached and may outlive static destruction
+Logger& Instance() {
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+} // namespace
+
+void SetLevel(LogLevel level) {
+    g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel GetLevel() {
+    return static_cast<LogLevel>(g_level.load(std::memory_order_relaxed));
+}
+
+const char* LevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Trace: return "trace";
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Info: return "info";
+        case LogLevel::Warn: return "warn";
+        case LogLevel::Error: return "error";
+        case LogLevel::Off: return "off";
+    }
+    return "unknown";
+}
+
+bool ParseLevel(const std::string& name, LogLevel& level) {
+    for (int i = static_cast<int>(LogLevel::Trace); i <= static_cast<int>(LogLevel::Off); i++) {
+        if (name == LevelName(static_cast<LogLevel>(i))) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Write(LogLevel level, std::string message, bool forward) {
+    Record record;
+    record.level = level;
+    record.forward = forward;
+    record.message = std::move(message);
+    Instance().Write(std::move(record));
+}
+
+void SetForwardSink(ForwardSink sink, const void* owner) {
+    Instance().SetForwardSink(std::move(sink), owner);
+}
+
+void ClearForwardSink(const void* owner) {
+    Instance().ClearForwardSink(owner);
+}
+
+void Flush() {
+    Instance().Flush();
+}
+
+uint64_t DroppedRecords() {
+    return Instance().Dropped();
+}
+
+} // namespace logging
+} // namespace oneifsprojfs
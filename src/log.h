@@ -0,0 +1,85 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+
+// Lowest level compiled into the module; statements below it vanish entirely.
+// 0 = trace, 1 = debug, 2 = info, 3 = warn, 4 = error
+#ifndef PROJFS_LOG_COMPILED_LEVEL
+#define PROJFS_LOG_COMPILED_LEVEL 1
+#endif
+
+namespace oneifsprojfs {
+
+enum class LogLevel : int {
+    Trace = 0,
+    Debug = 1,
+    Info = 2,
+    Warn = 3,
+    Error = 4,
+    Off = 5
+};
+
+// Process-wide logger. Statements below the runtime level cost one relaxed
+// atomic load and never format their message. Records that pass are pushed
+// into a lock-free ring buffer and written by a background thread, so
+// ProjFS callbacks never wait on console I/O; if the ring is full the record
+// is dropped and counted instead.
+namespace logging {
+
+extern std::atomic<int> g_level;
+
+inline bool Enabled(LogLevel level) {
+    return static_cast<int>(level) >= g_level.load(std::memory_order_relaxed);
+}
+
+void SetLevel(LogLevel level);
+LogLevel GetLevel();
+const char* LevelName(LogLevel level);
+// Accepts "trace", "debug", "info", "warn", "error" or "off"
+bool ParseLevel(const std::string& name, LogLevel& level);
+
+// Queues a record; forward also hands it to the forward sink (JavaScript)
+void Write(LogLevel level, std::string message, bool forward = false);
+
+// Receives forwarded records in batches on the writer thread. There is one
+// sink per process; with several roots the one registered last receives them.
+using ForwardSink = std::function<void(std::vector<std::string>&& messages)>;
+void SetForwardSink(ForwardSink sink, const void* owner = nullptr);
+// Removes the sink only if the owner is still the one that set it
+void ClearForwardSink(const void* owner);
+
+// Blocks until every record queued before the call has been written
+void Flush();
+
+uint64_t DroppedRecords();
+
+} // namespace logging
+
+} // namespace oneifsprojfs
+
+#define PROJFS_LOG(level, forward, expr) \
+    do { \
+        if (static_cast<int>(level) >= PROJFS_LOG_COMPILED_LEVEL && ::oneifsprojfs::logging::Enabled(level)) { \
+            std::ostringstream projfsLogStream; \
+            projfsLogStream << expr; \
+            ::oneifsprojfs::logging::Write(level, projfsLogStream.str(), forward); \
+        } \
+    } while (0)
+
+#define PROJFS_TRACE(expr) PROJFS_LOG(::oneifsprojfs::LogLevel::Trace, false, expr)
+#define PROJFS_DEBUG(expr) PROJFS_LOG(::oneifsprojfs::LogLevel::Debug, false, expr)
+#define PROJFS_INFO(expr) PROJFS_LOG(::oneifsprojfs::LogLevel::Info, false, expr)
+#define PROJFS_WARN(expr) PROJFS_LOG(::oneifsprojfs::LogLevel::Warn, false, expr)
+#define PROJFS_ERROR(expr) PROJFS_LOG(::oneifsprojfs::LogLevel::Error, false, expr)
+
+// Debug records that are also delivered to the JavaScript onDebugMessage callback
+#define PROJFS_DEBUG_JS(expr) PROJFS_LOG(::oneifsprojfs::LogLevel::Debug, true, expr)
+#define PROJFS_TRACE_JS(expr) PROJFS_LOG(::oneifsprojfs::LogLevel::Trace, true, expr)
+
+#endif // LOG_H
@@ -0,0 +1,280 @@
+#include "metadata_snapshot.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace oneifsprojfs {
+
+namespace {
+
+uint64_t ReadU64(const uint8_t* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+void WriteU64(uint8_t* p, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+// Maps the whole file read-only; the mapping outlives the handles
+const uint8_t* MapFile(const std::filesystem::path& file, size_t& size, std::string& error) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(file.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        error = "No metadata snapshot";
+        return nullptr;
+    }
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(handle);
+        error = "Metadata snapshot is empty";
+        return nullptr;
+    }
+    HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(handle);
+    if (!mapping) {
+        error = "Failed to map metadata snapshot";
+        return nullptr;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view) {
+        error = "Failed to map metadata snapshot";
+        return nullptr;
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+    return static_cast<const uint8_t*>(view);
+#else
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "No metadata snapshot";
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        error = "Metadata snapshot is empty";
+        return nullptr;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        error = "Failed to map metadata snapshot";
+        return nullptr;
+    }
+    size = static_cast<size_t>(info.st_size);
+    return static_cast<const uint8_t*>(view);
+#endif
+}
+
+void UnmapFile(const uint8_t* data, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<uint8_t*>(data), size);
+#endif
+}
+
+// Writes the whole buffer and flushes it to the disk, so a rename that
+// follows never exposes a file whose bytes were lost in a crash
+bool WriteFileDurably(const std::filesystem::path& file, const std::vector<uint8_t>& buffer) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(file.wstring().c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    size_t position = 0;
+    while (position < buffer.size()) {
+        DWORD want = static_cast<DWORD>((std::min<size_t>)(buffer.size() - position, 1 << 30));
+        DWORD written = 0;
+        if (!WriteFile(handle, buffer.data() + position, want, &written, nullptr) || written == 0) {
+            CloseHandle(handle);
+            return false;
+        }
+        position += written;
+    }
+    bool flushed = FlushFileBuffers(handle) != 0;
+    CloseHandle(handle);
+    return flushed;
+#else
+    int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t position = 0;
+    while (position < buffer.size()) {
+        ssize_t written = write(fd, buffer.data() + position, buffer.size() - position);
+        if (written <= 0) {
+            close(fd);
+            return false;
+        }
+        position += static_cast<size_t>(written);
+    }
+    bool flushed = fsync(fd) == 0;
+    close(fd);
+    return flushed;
+#endif
+}
+
+} // namespace
+
+std::unique_ptr<MetadataSnapshot> MetadataSnapshot::Open(const std::filesystem::path& file,
+                                                         uint64_t fingerprint,
+                                                         std::string& error) {
+    std::unique_ptr<MetadataSnapshot> snapshot(new MetadataSnapshot());
+    snapshot->data_ = MapFile(file, snapshot->size_, error);
+    if (!snapshot->data_) {
+        return nullptr;
+    }
+
+    const uint8_t* header = snapshot->data_;
+    if (snapshot->size_ < kHeaderSize ||
+        ReadU64(header) != (static_cast<uint64_t>(kVersion) << 32 | kMagic)) {
+        error = "Not a metadata snapshot of version " + std::to_string(kVersion);
+        return nullptr;
+    }
+    snapshot->fingerprint_ = ReadU64(header + 8);
+    if (fingerprint != kAnyFingerprint && snapshot->fingerprint_ != fingerprint) {
+        error = "Metadata snapshot was taken against other version heads";
+        return nullptr;
+    }
+    if (ReadU64(header + 16) != snapshot->size_ - kHeaderSize ||
+        !snapshot->view_.Open(header + kHeaderSize, snapshot->size_ - kHeaderSize, error)) {
+        error = "Metadata snapshot is truncated";
+        return nullptr;
+    }
+
+    snapshot->used_.assign(snapshot->view_.DirectoryCount(), false);
+    return snapshot;
+}
+
+bool MetadataSnapshot::Write(const std::filesystem::path& file,
+                             uint64_t fingerprint,
+                             std::vector<DirectoryUpdate> directories,
+                             std::string& error) {
+    // Sorted so a lookup is a binary search over the mapped records
+    std::stable_sort(directories.begin(), directories.end(),
+                     [](const DirectoryUpdate& a, const DirectoryUpdate& b) { return a.path < b.path; });
+    directories.erase(std::unique(directories.begin(), directories.end(),
+                                  [](const DirectoryUpdate& a, const DirectoryUpdate& b) { return a.path == b.path; }),
+                      directories.end());
+
+    std::vector<uint8_t> buffer(kHeaderSize);
+    tree_batch::Encode(directories, buffer);
+    WriteU64(buffer.data(), static_cast<uint64_t>(kVersion) << 32 | kMagic);
+    WriteU64(buffer.data() + 8, fingerprint);
+    WriteU64(buffer.data() + 16, buffer.size() - kHeaderSize);
+
+    std::filesystem::path temporary = file;
+    temporary += ".tmp";
+    try {
+        std::filesystem::create_directories(file.parent_path());
+        if (!WriteFileDurably(temporary, buffer)) {
+            error = "Failed to write " + temporary.string();
+            return false;
+        }
+        std::filesystem::rename(temporary, file);
+    } catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+    return true;
+}
+
+MetadataSnapshot::~MetadataSnapshot() {
+    if (data_) {
+        UnmapFile(data_, size_);
+    }
+}
+
+uint32_t MetadataSnapshot::Find(std::string_view path) const {
+    uint32_t low = 0;
+    uint32_t high = view_.DirectoryCount();
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        std::string_view candidate;
+        if (!view_.DirectoryPath(middle, candidate)) {
+            return kNotFound;  // Corrupt record; treat the snapshot as not holding it
+        }
+        int order = candidate.compare(path);
+        if (order == 0) {
+            return middle;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return kNotFound;
+}
+
+bool MetadataSnapshot::Take(std::string_view canonicalPath, DirectoryUpdate& update) {
+    uint32_t index = Find(canonicalPath);
+    if (index == kNotFound) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (used_[index]) {
+            return false;
+        }
+        used_[index] = true;
+    }
+    std::string error;
+    return view_.ReadDirectory(index, update, error);
+}
+
+bool MetadataSnapshot::Read(std::string_view canonicalPath, DirectoryUpdate& update) const {
+    uint32_t index = Find(canonicalPath);
+    std::string error;
+    return index != kNotFound && view_.ReadDirectory(index, update, error);
+}
+
+void MetadataSnapshot::Discard(std::string_view canonicalPath) {
+    uint32_t index = Find(canonicalPath);
+    if (index != kNotFound) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        used_[index] = true;
+    }
+}
+
+void MetadataSnapshot::CollectRemaining(std::vector<DirectoryUpdate>& directories) const {
+    std::vector<uint32_t> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (uint32_t i = 0; i < used_.size(); i++) {
+            if (!used_[i]) {
+                remaining.push_back(i);
+            }
+        }
+    }
+
+    std::string error;
+    for (uint32_t index : remaining) {
+        DirectoryUpdate update;
+        if (view_.ReadDirectory(index, update, error)) {
+            directories.push_back(std::move(update));
+        }
+    }
+}
+
+} // namespace oneifsprojfs
@@ -0,0 +1,88 @@
+#ifndef METADATA_SNAPSHOT_H
+#define METADATA_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "content_cache.h"
+#include "tree_batch.h"
+
+namespace oneifsprojfs {
+
+// Directory listings persisted across mounts, so a restarted provider can
+// answer Explorer without asking JavaScript for every level again. The file
+// is a small header followed by a tree_batch payload whose directories are
+// sorted by path:
+//
+//   header   magic "PJS1", version, fingerprint (uint64), payloadBytes (uint64)
+//   payload  tree_batch buffer
+//
+// Opening maps the file and checks only the header, so it costs the same for
+// any instance size; each directory is decoded and range-checked the first
+// time it is asked for. The fingerprint is SyncStorage's version heads
+// fingerprint from when the listings were captured; a snapshot taken against
+// other heads is never opened.
+class MetadataSnapshot {
+public:
+    static constexpr uint32_t kMagic = 0x31534A50;  // "PJS1"
+    static constexpr uint32_t kVersion = 2;
+    static constexpr size_t kHeaderSize = 24;
+    // Accepts a snapshot taken against any heads, to learn what was served before
+    static constexpr uint64_t kAnyFingerprint = 0;
+
+    // Returns nullptr, with the reason in error, if the file is missing,
+    // malformed, of another version or was taken against other heads
+    static std::unique_ptr<MetadataSnapshot> Open(const std::filesystem::path& file,
+                                                  uint64_t fingerprint,
+                                                  std::string& error);
+
+    // Writes to a temporary file next to file, flushes it to the disk and
+    // renames it into place, so a crash leaves the old file or the new. When
+    // two directories share a path the first one wins. On Windows a mapped
+    // snapshot cannot be replaced, so close the old one first.
+    static bool Write(const std::filesystem::path& file,
+                      uint64_t fingerprint,
+                      std::vector<DirectoryUpdate> directories,
+                      std::string& error);
+
+    ~MetadataSnapshot();
+
+    MetadataSnapshot(const MetadataSnapshot&) = delete;
+    MetadataSnapshot& operator=(const MetadataSnapshot&) = delete;
+
+    // Hands out a directory once; afterwards it misses, so whatever JavaScript
+    // stored since takes over
+    bool Take(std::string_view canonicalPath, DirectoryUpdate& update);
+    // Decodes a directory without handing it out
+    bool Read(std::string_view canonicalPath, DirectoryUpdate& update) const;
+    // Forgets a directory whose listing changed without decoding it
+    void Discard(std::string_view canonicalPath);
+    // Appends every directory neither taken nor discarded
+    void CollectRemaining(std::vector<DirectoryUpdate>& directories) const;
+
+    uint64_t Fingerprint() const { return fingerprint_; }
+    size_t DirectoryCount() const { return view_.DirectoryCount(); }
+
+private:
+    MetadataSnapshot() = default;
+
+    static constexpr uint32_t kNotFound = UINT32_MAX;
+    uint32_t Find(std::string_view path) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    tree_batch::View view_;
+    uint64_t fingerprint_ = 0;
+
+    mutable std::mutex mutex_;
+    std::vector<bool> used_;  // Taken or discarded, by directory index
+};
+
+} // namespace oneifsprojfs
+
+#endif // METADATA_SNAPSHOT_H
@@ -0,0 +1,162 @@
+#include "object_index.h"
+#include <algorithm>
+#include <iterator>
+
+namespace oneifsprojfs {
+
+namespace {
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+using Keys = std::vector<ObjectIndex::Key>;
+
+const ObjectIndex::Run& EmptyRun() {
+    static const ObjectIndex::Run empty = std::make_shared<const Keys>();
+    return empty;
+}
+
+bool RunContains(const Keys& run, const ObjectIndex::Key& key) {
+    return std::binary_search(run.begin(), run.end(), key);
+}
+
+// The run without key, or nullptr if key is not in it
+std::shared_ptr<Keys> Without(const Keys& run, const ObjectIndex::Key& key) {
+    auto it = std::lower_bound(run.begin(), run.end(), key);
+    if (it == run.end() || *it != key) {
+        return nullptr;
+    }
+    auto copy = std::make_shared<Keys>();
+    copy->reserve(run.size() - 1);
+    copy->insert(copy->end(), run.begin(), it);
+    copy->insert(copy->end(), it + 1, run.end());
+    return copy;
+}
+
+} // namespace
+
+ObjectIndex::Snapshot::Cursor ObjectIndex::Snapshot::After(const Key* key) const {
+    Cursor cursor;
+    if (key) {
+        cursor.base = std::upper_bound(base_->begin(), base_->end(), *key) - base_->begin();
+        cursor.recent = std::upper_bound(recent_->begin(), recent_->end(), *key) - recent_->begin();
+    }
+    return cursor;
+}
+
+bool ObjectIndex::Snapshot::Next(Cursor& cursor, Key& key) const {
+    bool haveBase = cursor.base < base_->size();
+    bool haveRecent = cursor.recent < recent_->size();
+    if (!haveBase && !haveRecent) {
+        return false;
+    }
+    // The runs never share a key
+    if (haveBase && (!haveRecent || (*base_)[cursor.base] < (*recent_)[cursor.recent])) {
+        key = (*base_)[cursor.base++];
+    } else {
+        key = (*recent_)[cursor.recent++];
+    }
+    return true;
+}
+
+bool ObjectIndex::Snapshot::Contains(const Key& key) const {
+    return RunContains(*base_, key) || RunContains(*recent_, key);
+}
+
+ObjectIndex::ObjectIndex() : base_(EmptyRun()), recent_(EmptyRun()) {}
+
+bool ObjectIndex::Ready() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ready_;
+}
+
+void ObjectIndex::Publish(std::vector<Key> keys) {
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Objects inserted while the scan ran may have been missed by it
+    if (!recent_->empty()) {
+        Keys merged;
+        merged.reserve(keys.size() + recent_->size());
+        std::set_union(keys.begin(), keys.end(), recent_->begin(), recent_->end(), std::back_inserter(merged));
+        keys = std::move(merged);
+    }
+    base_ = std::make_shared<const Keys>(std::move(keys));
+    recent_ = EmptyRun();
+    ready_ = true;
+}
+
+bool ObjectIndex::Insert(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (RunContains(*base_, key) || RunContains(*recent_, key)) {
+        return false;
+    }
+
+    if (recent_->size() < kMergeThreshold) {
+        auto recent = std::make_shared<Keys>();
+        recent->reserve(recent_->size() + 1);
+        auto at = std::lower_bound(recent_->begin(), recent_->end(), key);
+        recent->insert(recent->end(), recent_->begin(), at);
+        recent->push_back(key);
+        recent->insert(recent->end(), at, recent_->end());
+        recent_ = std::move(recent);
+        return true;
+    }
+
+    // Fold the small run into the large one; snapshots keep the old pair
+    auto base = std::make_shared<Keys>();
+    base->reserve(base_->size() + recent_->size() + 1);
+    std::merge(base_->begin(), base_->end(), recent_->begin(), recent_->end(), std::back_inserter(*base));
+    base->insert(std::upper_bound(base->begin(), base->end(), key), key);
+    base_ = std::move(base);
+    recent_ = EmptyRun();
+    return true;
+}
+
+bool ObjectIndex::Remove(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Objects are rarely deleted, so copying a run here is fine
+    if (auto recent = Without(*recent_, key)) {
+        recent_ = std::move(recent);
+        return true;
+    }
+    if (auto base = Without(*base_, key)) {
+        base_ = std::move(base);
+        return true;
+    }
+    return false;
+}
+
+ObjectIndex::Snapshot ObjectIndex::Take() const {
+    Snapshot snapshot;
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshot.base_ = base_;
+    snapshot.recent_ = recent_;
+    return snapshot;
+}
+
+size_t ObjectIndex::Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return base_->size() + recent_->size();
+}
+
+void ObjectIndex::FormatName(const Key& key, wchar_t (&name)[kNameLength + 1]) {
+    for (size_t word = 0; word < key.size(); word++) {
+        for (size_t i = 0; i < 16; i++) {
+            name[word * 16 + i] = static_cast<wchar_t>(kHexDigits[(key[word] >> (60 - 4 * i)) & 0xF]);
+        }
+    }
+    name[kNameLength] = L'\0';
+}
+
+std::string ObjectIndex::Name(const Key& key) {
+    std::string name(kNameLength, '0');
+    for (size_t word = 0; word < key.size(); word++) {
+        for (size_t i = 0; i < 16; i++) {
+            name[word * 16 + i] = kHexDigits[(key[word] >> (60 - 4 * i)) & 0xF];
+        }
+    }
+    return name;
+}
+
+} // namespace oneifsprojfs
@@ -0,0 +1,80 @@
+#ifndef OBJECT_INDEX_H
+#define OBJECT_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "object_info_table.h"
+
+namespace oneifsprojfs {
+
+// Every object hash under <instance>/objects, sorted, so /objects can be
+// enumerated without asking JavaScript or listing the directory again. Hashes
+// are lowercase hex of one length, so key order is ProjFS name order.
+//
+// The index is built once by a scan and then kept current one hash at a time:
+// insertions go to a small sorted run next to the large one, and the two are
+// merged when the small run outgrows kMergeThreshold. Both runs are immutable
+// once published, so a reader holds a Snapshot and walks it without the lock.
+class ObjectIndex {
+public:
+    using Key = ObjectInfoTable::Key;
+    using Run = std::shared_ptr<const std::vector<Key>>;
+
+    static constexpr size_t kMergeThreshold = 4096;
+    static constexpr size_t kNameLength = 64;
+
+    // The two runs at one point in time, walked in merged order
+    class Snapshot {
+    public:
+        // A position between keys; Next hands out the key after it
+        struct Cursor {
+            size_t base = 0;
+            size_t recent = 0;
+        };
+
+        size_t Size() const { return base_->size() + recent_->size(); }
+        // The position just after key, or the start if there is no key
+        Cursor After(const Key* key) const;
+        bool Next(Cursor& cursor, Key& key) const;
+        bool Contains(const Key& key) const;
+
+    private:
+        friend class ObjectIndex;
+        Run base_;
+        Run recent_;
+    };
+
+    ObjectIndex();
+
+    // False until the first scan has been published; until then callers fall
+    // back to whatever listed /objects before
+    bool Ready() const;
+    // Publishes a full scan, replacing the previous one. Insertions that are
+    // still in the small run are kept, as the scan may have passed them.
+    void Publish(std::vector<Key> keys);
+
+    // Both return whether the index changed
+    bool Insert(const Key& key);
+    bool Remove(const Key& key);
+
+    Snapshot Take() const;
+    size_t Size() const;
+
+    // NUL-terminated lowercase hex, as PrjFillDirEntryBuffer wants it
+    static void FormatName(const Key& key, wchar_t (&name)[kNameLength + 1]);
+    static std::string Name(const Key& key);
+
+private:
+    mutable std::mutex mutex_;
+    Run base_;
+    Run recent_;
+    bool ready_ = false;
+};
+
+} // namespace oneifsprojfs
+
+#endif // OBJECT_INDEX_H
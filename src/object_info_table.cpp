@@ -0,0 +1,167 @@
+#include "object_info_table.h"
+#include "object_scan.h"
+
+namespace oneifsprojfs {
+
+namespace {
+
+const std::string kEmptyName;
+
+} // namespace
+
+ObjectInfoTable::ObjectInfoTable() : buckets_(new Bucket[kBuckets]) {
+    // ID 0 stands for "not known"
+    typeNames_.emplace_back();
+    types_[kNoType].store(&typeNames_.back(), std::memory_order_relaxed);
+}
+
+bool ObjectInfoTable::ParseKey(std::string_view hash, Key& key) {
+    if (!IsObjectHash(hash)) {
+        return false;
+    }
+    for (size_t word = 0; word < key.size(); word++) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < 16; i++) {
+            value = value << 4 | static_cast<uint64_t>(HexDigitValue(hash[word * 16 + i]));
+        }
+        key[word] = value;
+    }
+    return true;
+}
+
+bool ObjectInfoTable::Find(const Key& key, Info& info) const {
+    const Bucket& bucket = buckets_[BucketIndex(key)];
+    for (const Slot& slot : bucket.slots) {
+        Key slotKey;
+        uint32_t slotInfo;
+        uint64_t size;
+        for (;;) {
+            uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;  // A writer is in the middle of it
+            }
+            for (size_t i = 0; i < slotKey.size(); i++) {
+                slotKey[i] = slot.key[i].load(std::memory_order_relaxed);
+            }
+            slotInfo = slot.info.load(std::memory_order_relaxed);
+            size = slot.size.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+
+        if ((slotInfo & (kFlagSize | kFlagType)) != 0 && slotKey == key) {
+            info.hasSize = (slotInfo & kFlagSize) != 0;
+            info.size = info.hasSize ? size : 0;
+            info.type = (slotInfo & kFlagType) ? static_cast<TypeId>(slotInfo >> 16) : kNoType;
+            hits_.Add();
+            return true;
+        }
+    }
+    misses_.Add();
+    return false;
+}
+
+void ObjectInfoTable::SetSize(const Key& key, uint64_t size) {
+    std::lock_guard<std::mutex> lock(writers_[BucketIndex(key) % kWriterStripes]);
+    Store(key, kFlagSize, size, kNoType);
+}
+
+void ObjectInfoTable::SetType(const Key& key, TypeId type) {
+    if (type == kNoType) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(writers_[BucketIndex(key) % kWriterStripes]);
+    Store(key, kFlagType, 0, type);
+}
+
+void ObjectInfoTable::Store(const Key& key, uint32_t flags, uint64_t size, TypeId type) {
+    Bucket& bucket = buckets_[BucketIndex(key)];
+
+    // Writers of this bucket are excluded, so its fields can be read plainly
+    Slot* target = nullptr;
+    Slot* free = nullptr;
+    for (Slot& slot : bucket.slots) {
+        uint32_t slotInfo = slot.info.load(std::memory_order_relaxed);
+        if ((slotInfo & (kFlagSize | kFlagType)) == 0) {
+            if (!free) {
+                free = &slot;
+            }
+            continue;
+        }
+        bool match = true;
+        for (size_t i = 0; i < key.size() && match; i++) {
+            match = slot.key[i].load(std::memory_order_relaxed) == key[i];
+        }
+        if (match) {
+            target = &slot;
+            break;
+        }
+    }
+
+    uint32_t info = flags | (flags & kFlagType ? static_cast<uint32_t>(type) << 16 : 0);
+    if (target) {
+        // Merge what the entry already knows about the other field
+        uint32_t old = target->info.load(std::memory_order_relaxed);
+        if (!(flags & kFlagSize) && (old & kFlagSize)) {
+            info |= kFlagSize;
+            size = target->size.load(std::memory_order_relaxed);
+        }
+        if (!(flags & kFlagType) && (old & kFlagType)) {
+            info |= old & (0xFFFF0000u | kFlagType);
+        }
+    } else if (free) {
+        target = free;
+        entries_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        target = &bucket.slots[bucket.nextVictim];
+        bucket.nextVictim = static_cast<uint8_t>((bucket.nextVictim + 1) % kWays);
+        evictions_.Add();
+    }
+
+    uint32_t sequence = target->sequence.load(std::memory_order_relaxed);
+    target->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < key.size(); i++) {
+        target->key[i].store(key[i], std::memory_order_relaxed);
+    }
+    target->info.store(info, std::memory_order_relaxed);
+    target->size.store(size, std::memory_order_relaxed);
+    target->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+ObjectInfoTable::TypeId ObjectInfoTable::InternType(std::string_view name) {
+    std::lock_guard<std::mutex> lock(typesMutex_);
+    auto it = typeIds_.find(name);
+    if (it != typeIds_.end()) {
+        return it->second;
+    }
+    if (typeNames_.size() >= kMaxTypes) {
+        return kNoType;
+    }
+    TypeId id = static_cast<TypeId>(typeNames_.size());
+    typeNames_.emplace_back(name);
+    const std::string& stored = typeNames_.back();
+    typeIds_.emplace(stored, id);
+    types_[id].store(&stored, std::memory_order_release);
+    return id;
+}
+
+const std::string& ObjectInfoTable::TypeName(TypeId type) const {
+    const std::string* name = type < kMaxTypes ? types_[type].load(std::memory_order_acquire) : nullptr;
+    return name ? *name : kEmptyName;
+}
+
+ObjectInfoTable::Stats ObjectInfoTable::GetStats() const {
+    Stats stats;
+    stats.hits = hits_.Load();
+    stats.misses = misses_.Load();
+    stats.evictions = evictions_.Load();
+    stats.entries = entries_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(typesMutex_);
+    stats.types = typeNames_.size() - 1;
+    return stats;
+}
+
+} // namespace oneifsprojfs
@@ -0,0 +1,111 @@
+#ifndef OBJECT_INFO_TABLE_H
+#define OBJECT_INFO_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "stats.h"
+
+namespace oneifsprojfs {
+
+// Size and type of ONE objects by hash, shared by every thread that stats or
+// sniffs an object. The table is a fixed number of 4-way buckets picked by
+// the first hash bytes, so its memory is bounded whatever the store holds: a
+// full bucket replaces its entries round robin.
+//
+// Readers take no lock. Each slot carries a sequence number that is odd while
+// a writer fills it; a reader copies the slot and retries if the number moved
+// meanwhile. Writers are serialized per group of buckets. Keys are the 32 raw
+// bytes of the hash and types are interned to 16-bit IDs, so a slot is a few
+// words and needs no allocation.
+class ObjectInfoTable {
+public:
+    using Key = std::array<uint64_t, 4>;
+    using TypeId = uint16_t;
+
+    static constexpr size_t kWays = 4;
+    static constexpr size_t kBuckets = 16384;
+    static constexpr size_t kCapacity = kWays * kBuckets;
+    static constexpr TypeId kNoType = 0;
+    static constexpr size_t kMaxTypes = 1024;
+
+    struct Info {
+        uint64_t size = 0;
+        bool hasSize = false;
+        TypeId type = kNoType;
+    };
+
+    ObjectInfoTable();
+
+    ObjectInfoTable(const ObjectInfoTable&) = delete;
+    ObjectInfoTable& operator=(const ObjectInfoTable&) = delete;
+
+    // Packs a 64-digit hex hash, either case. False for anything else.
+    static bool ParseKey(std::string_view hash, Key& key);
+
+    bool Find(const Key& key, Info& info) const;
+    // Both keep whatever the entry already knows about the other field
+    void SetSize(const Key& key, uint64_t size);
+    void SetType(const Key& key, TypeId type);
+
+    // kNoType once kMaxTypes names are taken; such types are not cached
+    TypeId InternType(std::string_view name);
+    const std::string& TypeName(TypeId type) const;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t capacity = kCapacity;
+        size_t types = 0;
+    };
+    Stats GetStats() const;
+
+private:
+    static constexpr uint32_t kFlagSize = 1;
+    static constexpr uint32_t kFlagType = 2;
+    static constexpr size_t kWriterStripes = 64;
+
+    struct Slot {
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<uint32_t> info{0};  // Type ID << 16 | flags; no flags means free
+        std::array<std::atomic<uint64_t>, 4> key{};
+        std::atomic<uint64_t> size{0};
+    };
+
+    struct Bucket {
+        std::array<Slot, kWays> slots;
+        uint8_t nextVictim = 0;  // Under the bucket's writer stripe
+    };
+
+    static size_t BucketIndex(const Key& key) { return static_cast<size_t>(key[0]) & (kBuckets - 1); }
+    // Writes key and fields into a way of the bucket; called with its writer stripe held
+    void Store(const Key& key, uint32_t flags, uint64_t size, TypeId type);
+
+    std::unique_ptr<Bucket[]> buckets_;
+    std::array<std::mutex, kWriterStripes> writers_;
+    std::atomic<size_t> entries_{0};
+
+    mutable StripedCounter hits_;
+    mutable StripedCounter misses_;
+    StripedCounter evictions_;
+
+    // Interned type names. Names never move once added, so readers index the
+    // pointer array without the lock.
+    mutable std::mutex typesMutex_;
+    std::deque<std::string> typeNames_;
+    std::unordered_map<std::string_view, TypeId> typeIds_;
+    std::array<std::atomic<const std::string*>, kMaxTypes> types_{};
+};
+
+} // namespace oneifsprojfs
+
+#endif // OBJECT_INFO_TABLE_H
@@ -0,0 +1,102 @@
+#ifndef OBJECT_SCAN_H
+#define OBJECT_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ONEIFSPROJFS_SSE2 1
+#endif
+
+namespace oneifsprojfs {
+
+// Scanners for ONE object paths and headers, run on every /objects lookup.
+// They replace std::regex, which allocated and backtracked on each call.
+
+constexpr size_t kObjectHashLength = 64;
+
+// 0-15 for a hex digit of either case, -1 for anything else
+constexpr int HexDigitValue(char c) {
+    return c >= '0' && c <= '9' ? c - '0'
+         : c >= 'a' && c <= 'f' ? c - 'a' + 10
+         : c >= 'A' && c <= 'F' ? c - 'A' + 10
+         : -1;
+}
+
+namespace detail {
+
+constexpr bool IsHexDigitsScalar(const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (HexDigitValue(text[i]) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef ONEIFSPROJFS_SSE2
+// All 16 bytes are hex digits. Bytes of 0x80 and above compare as negative,
+// so they fall outside both ranges.
+inline bool IsHexDigits16(const char* text) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(bytes, _mm_set1_epi8('9' + 1)));
+    __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                   _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    return _mm_movemask_epi8(_mm_or_si128(digit, letter)) == 0xFFFF;
+}
+#endif
+
+} // namespace detail
+
+// True if text is exactly an object hash: 64 hex digits of either case
+inline bool IsObjectHash(std::string_view text) {
+    if (text.size() != kObjectHashLength) {
+        return false;
+    }
+#ifdef ONEIFSPROJFS_SSE2
+    return detail::IsHexDigits16(text.data()) && detail::IsHexDigits16(text.data() + 16) &&
+           detail::IsHexDigits16(text.data() + 32) && detail::IsHexDigits16(text.data() + 48);
+#else
+    return detail::IsHexDigitsScalar(text.data(), text.size());
+#endif
+}
+
+// The hash of /objects/<hash> or /objects/<hash>/..., or empty
+inline std::string_view ObjectHashOfPath(std::string_view virtualPath) {
+    constexpr std::string_view kPrefix = "/objects/";
+    if (virtualPath.size() < kPrefix.size() + kObjectHashLength ||
+        virtualPath.compare(0, kPrefix.size(), kPrefix) != 0) {
+        return {};
+    }
+    std::string_view hash = virtualPath.substr(kPrefix.size(), kObjectHashLength);
+    size_t end = kPrefix.size() + kObjectHashLength;
+    if ((end != virtualPath.size() && virtualPath[end] != '/') || !IsObjectHash(hash)) {
+        return {};
+    }
+    return hash;
+}
+
+// The type name of the first itemtype="//refin.io/<type>" in a microdata
+// header, or empty if there is none or it is not closed
+inline std::string_view FindRefinItemType(std::string_view microdata) {
+    constexpr std::string_view kMarker = "itemtype=\"//refin.io/";
+    for (size_t at = microdata.find(kMarker); at != std::string_view::npos; at = microdata.find(kMarker, at + 1)) {
+        size_t begin = at + kMarker.size();
+        size_t end = microdata.find('"', begin);
+        if (end == std::string_view::npos) {
+            return {};
+        }
+        if (end > begin) {
+            return microdata.substr(begin, end - begin);
+        }
+    }
+    return {};
+}
+
+} // namespace oneifsprojfs
+
+#endif // OBJECT_SCAN_H
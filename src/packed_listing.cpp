@@ -0,0 +1,291 @@
+#include "packed_listing.h"
+#include "content_cache.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace oneifsprojfs {
+
+namespace {
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;  // Upper case hex would not round-trip, so it stays text
+}
+
+#ifdef _WIN32
+// The conversion ProjFSProvider::ToWide makes, written straight into the arena
+void AppendWide(std::string_view text, std::vector<wchar_t>& out) {
+    if (!text.empty()) {
+        int length = MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), nullptr, 0);
+        size_t at = out.size();
+        out.resize(at + static_cast<size_t>(length));
+        MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), out.data() + at, length);
+    }
+    out.push_back(L'\0');
+}
+#else
+// Decodes one UTF-8 sequence starting at text[i], advancing i. Malformed
+// input yields U+FFFD, as MultiByteToWideChar does.
+char32_t DecodeUtf8(std::string_view text, size_t& i) {
+    unsigned char lead = static_cast<unsigned char>(text[i++]);
+    if (lead < 0x80) {
+        return lead;
+    }
+    size_t extra;
+    char32_t codePoint;
+    char32_t minimum;
+    if ((lead & 0xE0) == 0xC0) {
+        extra = 1; codePoint = lead & 0x1F; minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        extra = 2; codePoint = lead & 0x0F; minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        extra = 3; codePoint = lead & 0x07; minimum = 0x10000;
+    } else {
+        return 0xFFFD;
+    }
+    for (size_t k = 0; k < extra; k++) {
+        if (i >= text.size() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+            return 0xFFFD;
+        }
+        codePoint = (codePoint << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+    }
+    if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        return 0xFFFD;
+    }
+    return codePoint;
+}
+
+// Elsewhere, as for the benchmark, the same conversion by hand
+void AppendWide(std::string_view text, std::vector<wchar_t>& out) {
+    for (size_t i = 0; i < text.size();) {
+        char32_t codePoint = DecodeUtf8(text, i);
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            out.push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+            out.push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+        } else {
+            out.push_back(static_cast<wchar_t>(codePoint));
+        }
+    }
+    out.push_back(L'\0');
+}
+#endif
+
+bool PackHash(const std::string& hash, uint8_t* out) {
+    if (hash.size() != 64) {
+        return false;
+    }
+    for (size_t i = 0; i < 32; i++) {
+        int high = HexValue(hash[2 * i]);
+        int low = HexValue(hash[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+template <typename T>
+size_t CapacityBytes(const std::vector<T>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+} // namespace
+
+PackedListing::PackedListing(const std::vector<FileInfo>& entries) {
+    size_t nameBytes = 0;
+    for (const auto& entry : entries) {
+        nameBytes += entry.name.size();
+    }
+    Reserve(entries.size(), nameBytes);
+    for (const auto& entry : entries) {
+        Append(entry);
+    }
+    Finish();
+}
+
+PackedListing::Builder::Builder(size_t entries, size_t nameBytes) : listing_(std::make_shared<PackedListing>()) {
+    listing_->Reserve(entries, nameBytes);
+}
+
+void PackedListing::Builder::Add(const FileInfo& entry) {
+    listing_->Append(entry);
+}
+
+void PackedListing::Builder::Add(const PackedListing& from, size_t index) {
+    listing_->Append(from, index);
+}
+
+std::shared_ptr<const PackedListing> PackedListing::Builder::Build() {
+    listing_->Finish();
+    return std::move(listing_);
+}
+
+void PackedListing::Reserve(size_t entries, size_t nameBytes) {
+    names_.reserve(nameBytes);
+    nameOffsets_.reserve(entries + 1);
+    // Names are mostly ASCII, so one unit per byte plus the terminators is close
+    wideNames_.reserve(nameBytes + entries);
+    wideOffsets_.reserve(entries);
+    hashes_.reserve(entries * kHashBytes);
+    sizes_.reserve(entries);
+    mtimes_.reserve(entries);
+    modes_.reserve(entries);
+    flags_.reserve(entries);
+}
+
+void PackedListing::Append(const FileInfo& entry) {
+    size_t index = sizes_.size();
+    nameOffsets_.push_back(static_cast<uint32_t>(names_.size()));
+    names_.insert(names_.end(), entry.name.begin(), entry.name.end());
+    wideOffsets_.push_back(static_cast<uint32_t>(wideNames_.size()));
+    AppendWide(entry.name, wideNames_);
+
+    uint8_t flags = (entry.isDirectory ? kFlagDirectory : 0) | (entry.isBlobOrClob ? kFlagBlobOrClob : 0);
+    hashes_.resize(hashes_.size() + kHashBytes, 0);
+    if (PackHash(entry.hash, hashes_.data() + index * kHashBytes)) {
+        flags |= kFlagPackedHash;
+    } else if (!entry.hash.empty()) {
+        otherHashes_.emplace_back(static_cast<uint32_t>(index), entry.hash);
+    }
+    sizes_.push_back(entry.size);
+    mtimes_.push_back(entry.mtime);
+    modes_.push_back(entry.mode);
+    flags_.push_back(flags);
+}
+
+void PackedListing::Append(const PackedListing& from, size_t index) {
+    size_t to = sizes_.size();
+    std::string_view name = from.Name(index);
+    nameOffsets_.push_back(static_cast<uint32_t>(names_.size()));
+    names_.insert(names_.end(), name.begin(), name.end());
+    // Terminator included
+    size_t wideEnd = index + 1 < from.Size() ? from.wideOffsets_[index + 1] : from.wideNames_.size();
+    wideOffsets_.push_back(static_cast<uint32_t>(wideNames_.size()));
+    wideNames_.insert(wideNames_.end(), from.wideNames_.begin() + from.wideOffsets_[index],
+                      from.wideNames_.begin() + wideEnd);
+
+    const uint8_t* hash = from.hashes_.data() + index * kHashBytes;
+    hashes_.insert(hashes_.end(), hash, hash + kHashBytes);
+    if (!(from.flags_[index] & kFlagPackedHash)) {
+        std::string other = from.Hash(index);
+        if (!other.empty()) {
+            otherHashes_.emplace_back(static_cast<uint32_t>(to), std::move(other));
+        }
+    }
+    sizes_.push_back(from.sizes_[index]);
+    mtimes_.push_back(from.mtimes_[index]);
+    modes_.push_back(from.modes_[index]);
+    flags_.push_back(from.flags_[index]);
+}
+
+void PackedListing::Finish() {
+    size_t count = sizes_.size();
+    nameOffsets_.push_back(static_cast<uint32_t>(names_.size()));
+    // Reservations are estimates, and a patched listing may have lost entries
+    names_.shrink_to_fit();
+    nameOffsets_.shrink_to_fit();
+    wideNames_.shrink_to_fit();
+    wideOffsets_.shrink_to_fit();
+    hashes_.shrink_to_fit();
+    sizes_.shrink_to_fit();
+    mtimes_.shrink_to_fit();
+    modes_.shrink_to_fit();
+    flags_.shrink_to_fit();
+
+    if (count < kIndexedEntries) {
+        return;
+    }
+    // At most half full, so chains stay short; slots fill in entry order
+    size_t slots = 1;
+    while (slots < count * 2) {
+        slots <<= 1;
+    }
+    nameIndex_.assign(slots, kNoSlot);
+    size_t mask = slots - 1;
+    for (uint32_t i = 0; i < count; i++) {
+        size_t slot = FoldedHash(Name(i)) & mask;
+        while (nameIndex_[slot] != kNoSlot) {
+            slot = (slot + 1) & mask;
+        }
+        nameIndex_[slot] = i;
+    }
+}
+
+std::string_view PackedListing::Name(size_t index) const {
+    return std::string_view(names_.data() + nameOffsets_[index], nameOffsets_[index + 1] - nameOffsets_[index]);
+}
+
+std::string PackedListing::Hash(size_t index) const {
+    if (flags_[index] & kFlagPackedHash) {
+        std::string hash(kHashBytes * 2, '0');
+        const uint8_t* bytes = hashes_.data() + index * kHashBytes;
+        for (size_t i = 0; i < kHashBytes; i++) {
+            hash[2 * i] = kHexDigits[bytes[i] >> 4];
+            hash[2 * i + 1] = kHexDigits[bytes[i] & 0x0F];
+        }
+        return hash;
+    }
+    auto other = std::lower_bound(otherHashes_.begin(), otherHashes_.end(), static_cast<uint32_t>(index),
+                                  [](const auto& item, uint32_t value) { return item.first < value; });
+    return other != otherHashes_.end() && other->first == index ? other->second : std::string();
+}
+
+FileInfo PackedListing::Entry(size_t index) const {
+    FileInfo info = {};
+    info.name = std::string(Name(index));
+    info.hash = Hash(index);
+    info.size = static_cast<size_t>(sizes_[index]);
+    info.isDirectory = IsDirectory(index);
+    info.isBlobOrClob = IsBlobOrClob(index);
+    info.mode = modes_[index];
+    info.mtime = mtimes_[index];
+    return info;
+}
+
+std::vector<FileInfo> PackedListing::Entries() const {
+    std::vector<FileInfo> entries;
+    entries.reserve(Size());
+    for (size_t i = 0; i < Size(); i++) {
+        entries.push_back(Entry(i));
+    }
+    return entries;
+}
+
+uint64_t PackedListing::FoldedHash(std::string_view name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (byte >= 0x80) {
+            continue;
+        }
+        if (byte >= 'a' && byte <= 'z') {
+            byte -= 'a' - 'A';
+        }
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t PackedListing::Bytes() const {
+    size_t bytes = sizeof(PackedListing) + CapacityBytes(names_) + CapacityBytes(nameOffsets_) +
+                   CapacityBytes(wideNames_) + CapacityBytes(wideOffsets_) + CapacityBytes(hashes_) +
+                   CapacityBytes(otherHashes_) + CapacityBytes(sizes_) + CapacityBytes(mtimes_) +
+                   CapacityBytes(modes_) + CapacityBytes(flags_) + CapacityBytes(nameIndex_);
+    for (const auto& other : otherHashes_) {
+        bytes += other.second.capacity();
+    }
+    return bytes;
+}
+
+} // namespace oneifsprojfs
@@ -0,0 +1,103 @@
+#ifndef PACKED_LISTING_H
+#define PACKED_LISTING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace oneifsprojfs {
+
+struct FileInfo;
+
+// Compact, immutable form of a cached directory listing. A FileInfo costs two
+// heap strings per entry; here the fields live in parallel arrays instead:
+//
+//   names      one UTF-8 arena, sliced by offset
+//   wideNames  one NUL-terminated UTF-16 arena, handed to ProjFS as is
+//   hashes     32 raw bytes per entry for 64-char lowercase hex hashes; the
+//              rare other hash is kept as text on the side
+//   sizes, mtimes, modes, flags
+//
+// Entries keep the order they were built in. Listings of kIndexedEntries or
+// more also carry an open-addressed table of entry indexes keyed by the
+// case-folded name (see FoldedHash); callers confirm candidates with their
+// own name comparison.
+class PackedListing {
+public:
+    static constexpr size_t kNotFound = SIZE_MAX;
+    static constexpr size_t kIndexedEntries = 64;
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+    PackedListing() = default;
+    explicit PackedListing(const std::vector<FileInfo>& entries);
+
+    // Packs entries one at a time, in the order they are added. An entry taken
+    // from another listing is copied as packed, so patching a listing costs no
+    // conversion for the entries it keeps.
+    class Builder {
+    public:
+        Builder(size_t entries, size_t nameBytes);
+        void Add(const FileInfo& entry);
+        void Add(const PackedListing& from, size_t index);
+        std::shared_ptr<const PackedListing> Build();
+
+    private:
+        std::shared_ptr<PackedListing> listing_;
+    };
+
+    size_t Size() const { return sizes_.size(); }
+    bool Empty() const { return sizes_.empty(); }
+
+    std::string_view Name(size_t index) const;
+    const wchar_t* WideName(size_t index) const { return wideNames_.data() + wideOffsets_[index]; }
+    std::string Hash(size_t index) const;
+    uint64_t FileSize(size_t index) const { return sizes_[index]; }
+    uint64_t Mtime(size_t index) const { return mtimes_[index]; }
+    uint32_t Mode(size_t index) const { return modes_[index]; }
+    bool IsDirectory(size_t index) const { return (flags_[index] & kFlagDirectory) != 0; }
+    bool IsBlobOrClob(size_t index) const { return (flags_[index] & kFlagBlobOrClob) != 0; }
+
+    // Materializes entries for callers that need a FileInfo
+    FileInfo Entry(size_t index) const;
+    std::vector<FileInfo> Entries() const;
+
+    const std::vector<uint32_t>& NameIndex() const { return nameIndex_; }
+    // FNV-1a over the name with ASCII letters upcased. Other bytes are left
+    // out, so names equal through non-ASCII case folding share a chain.
+    static uint64_t FoldedHash(std::string_view name);
+
+    // Heap bytes held, for cache accounting
+    size_t Bytes() const;
+
+private:
+    static constexpr uint8_t kFlagDirectory = 1;
+    static constexpr uint8_t kFlagBlobOrClob = 2;
+    static constexpr uint8_t kFlagPackedHash = 4;
+    static constexpr size_t kHashBytes = 32;
+
+    void Reserve(size_t entries, size_t nameBytes);
+    void Append(const FileInfo& entry);
+    void Append(const PackedListing& from, size_t index);
+    // Trims the arrays and builds the name index once every entry is in
+    void Finish();
+
+    std::vector<char> names_;
+    std::vector<uint32_t> nameOffsets_;  // Size() + 1, so lengths are differences
+    std::vector<wchar_t> wideNames_;
+    std::vector<uint32_t> wideOffsets_;
+    std::vector<uint8_t> hashes_;        // kHashBytes per entry, zero when not packed
+    std::vector<std::pair<uint32_t, std::string>> otherHashes_;  // By entry index
+    std::vector<uint64_t> sizes_;
+    std::vector<uint64_t> mtimes_;
+    std::vector<uint32_t> modes_;
+    std::vector<uint8_t> flags_;
+    std::vector<uint32_t> nameIndex_;
+};
+
+} // namespace oneifsprojfs
+
+#endif // PACKED_LISTING_H
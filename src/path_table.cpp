@@ -0,0 +1,110 @@
+#include "path_table.h"
+#include <mutex>
+#include <stdexcept>
+
+namespace oneifsprojfs {
+
+PathTable::PathTable() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    // Slot 0 is the kNoPath sentinel, slot 1 the root
+    chunks_[0].store(new Entry[kChunkSize], std::memory_order_release);
+    Entry* first = chunks_[0].load(std::memory_order_relaxed);
+    first[kRootPath].path = "/";
+    first[kRootPath].parent = kNoPath;
+    index_.emplace(std::string_view(first[kRootPath].path), kRootPath);
+    size_.store(kRootPath + 1, std::memory_order_release);
+}
+
+PathTable::~PathTable() {
+    for (auto& chunk : chunks_) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+PathId PathTable::Intern(std::string_view path) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = index_.find(path);
+        if (it != index_.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    return InternLocked(path);
+}
+
+void PathTable::InternChildren(PathId parent, const std::vector<std::string_view>& names, std::vector<PathId>& ids) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::string path = parent == kRootPath ? std::string() : EntryAt(parent).path;
+    size_t prefixLength = path.size();
+
+    ids.clear();
+    ids.reserve(names.size());
+    for (std::string_view name : names) {
+        path.resize(prefixLength);
+        path.push_back('/');
+        path.append(name.data(), name.size());
+        ids.push_back(InternLocked(path));
+    }
+}
+
+PathId PathTable::Find(std::string_view path) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(path);
+    return it != index_.end() ? it->second : kNoPath;
+}
+
+std::string_view PathTable::NameOf(PathId id) const {
+    std::string_view path = PathOf(id);
+    if (id == kRootPath) {
+        return std::string_view();
+    }
+    return path.substr(path.rfind('/') + 1);
+}
+
+PathId PathTable::InternLocked(std::string_view path) {
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+        return it->second;
+    }
+
+    size_t lastSlash = path.rfind('/');
+    PathId parent = (lastSlash == 0 || lastSlash == std::string_view::npos)
+        ? kRootPath
+        : InternLocked(path.substr(0, lastSlash));
+
+    size_t id = size_.load(std::memory_order_relaxed);
+    size_t chunkIndex = id >> kChunkBits;
+    if (chunkIndex >= kMaxChunks) {
+        throw std::length_error("PathTable is full");
+    }
+    Entry* chunk = chunks_[chunkIndex].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Entry[kChunkSize];
+        chunks_[chunkIndex].store(chunk, std::memory_order_release);
+    }
+
+    Entry& entry = chunk[id & (kChunkSize - 1)];
+    entry.path.assign(path.data(), path.size());
+    entry.parent = parent;
+    index_.emplace(std::string_view(entry.path), static_cast<PathId>(id));
+    size_.store(id + 1, std::memory_order_release);
+    return static_cast<PathId>(id);
+}
+
+std::string PathTable::Canonicalize(std::string_view path) {
+    std::string canonical;
+    canonical.reserve(path.size() + 1);
+    canonical.push_back('/');
+    for (char c : path) {
+        if (c == '\\') c = '/';
+        if (c == '/' && canonical.back() == '/') continue;
+        canonical.push_back(c);
+    }
+    if (canonical.size() > 1 && canonical.back() == '/') {
+        canonical.pop_back();
+    }
+    return canonical;
+}
+
+} // namespace oneifsprojfs
@@ -0,0 +1,76 @@
+#ifndef PATH_TABLE_H
+#define PATH_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace oneifsprojfs {
+
+// Compact identifier of an interned canonical virtual path
+using PathId = uint32_t;
+constexpr PathId kNoPath = 0;
+constexpr PathId kRootPath = 1;  // "/"
+
+// Append-only table of canonical virtual paths ("/", "/dir", "/dir/file").
+// Every path is stored once together with its parent's id, so callers can key
+// their tables by a 32-bit id and walk to the parent without string work.
+// Paths are only interned when something is stored under them; lookups use
+// Find, which never allocates, so probes for names that were never stored do
+// not grow the table. Ids are never reused and PathOf stays valid forever.
+class PathTable {
+public:
+    PathTable();
+    ~PathTable();
+
+    PathTable(const PathTable&) = delete;
+    PathTable& operator=(const PathTable&) = delete;
+
+    // Interns a canonical path and all of its ancestors
+    PathId Intern(std::string_view path);
+    // Interns parent + "/" + name for every name under one lock; ids[i] belongs to names[i]
+    void InternChildren(PathId parent, const std::vector<std::string_view>& names, std::vector<PathId>& ids);
+    // Returns kNoPath if the path has never been interned
+    PathId Find(std::string_view path) const;
+
+    const std::string& PathOf(PathId id) const { return EntryAt(id).path; }
+    PathId ParentOf(PathId id) const { return EntryAt(id).parent; }
+    std::string_view NameOf(PathId id) const;
+
+    size_t Size() const { return size_.load(std::memory_order_acquire); }
+
+    // Rewrites any virtual path into canonical form: forward slashes, a single
+    // leading slash, no duplicate or trailing slashes
+    static std::string Canonicalize(std::string_view path);
+
+private:
+    struct Entry {
+        std::string path;
+        PathId parent = kNoPath;
+    };
+
+    // Entries live in fixed-size chunks that never move, so PathOf needs no lock
+    static constexpr size_t kChunkBits = 12;
+    static constexpr size_t kChunkSize = size_t(1) << kChunkBits;  // 4096 paths
+    static constexpr size_t kMaxChunks = 4096;                     // 16M paths
+
+    const Entry& EntryAt(PathId id) const {
+        return chunks_[id >> kChunkBits].load(std::memory_order_acquire)[id & (kChunkSize - 1)];
+    }
+    PathId InternLocked(std::string_view path);
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string_view, PathId> index_;  // Keys point into entries
+    std::array<std::atomic<Entry*>, kMaxChunks> chunks_{};
+    std::atomic<size_t> size_{0};
+};
+
+} // namespace oneifsprojfs
+
+#endif // PATH_TABLE_H
@@ -0,0 +1,281 @@
+#include "prefetcher.h"
+#include "log.h"
+
+namespace oneifsprojfs {
+
+namespace {
+
+// Queued work is bounded so one huge directory cannot pin memory
+constexpr size_t kMaxQueuedWork = 4096;
+
+bool IsExcluded(const std::vector<std::string>& prefixes, const std::string& path) {
+    for (const auto& prefix : prefixes) {
+        if (path.compare(0, prefix.size(), prefix) == 0 &&
+            (path.size() == prefix.size() || path[prefix.size()] == '/')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+Prefetcher::Prefetcher(std::shared_ptr<AsyncBridge> bridge, std::shared_ptr<ThreadPool> pool, BusyProbe foregroundBusy)
+    : bridge_(std::move(bridge)), foregroundBusy_(std::move(foregroundBusy)), pool_(std::move(pool)) {
+    cache_ = bridge_->GetCache();
+}
+
+Prefetcher::~Prefetcher() {
+    Stop();
+}
+
+void Prefetcher::Configure(const PrefetchOptions& options) {
+    bool stop = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_ = options;
+        for (auto& prefix : options_.excludePrefixes) {
+            prefix = PathTable::Canonicalize(prefix);
+        }
+        if (options_.enabled && !running_) {
+            running_ = true;
+            pumpScheduled_ = false;  // Tasks of an earlier generation no longer count
+        }
+        stop = !options_.enabled && running_;
+        if (!stop) {
+            ScheduleLocked();  // The concurrency limit may have grown
+        }
+    }
+    if (stop) {
+        Stop();
+    }
+}
+
+PrefetchOptions Prefetcher::GetOptions() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return options_;
+}
+
+void Prefetcher::OnDirectoryEnumerated(PathId directory) {
+    if (directory == kNoPath) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || options_.depth == 0 || queue_.size() >= kMaxQueuedWork ||
+            IsExcluded(options_.excludePrefixes, cache_->Paths().PathOf(directory)) ||
+            !pending_.insert(directory).second) {
+            return;
+        }
+        auto wave = std::make_shared<Wave>(Wave{options_.budgetBytes});
+        queue_.push_back({Work::Expand, directory, 0, std::move(wave)});
+        ScheduleLocked();
+    }
+    scheduled_.Add();
+}
+
+void Prefetcher::Cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.clear();
+    pending_.clear();
+}
+
+void Prefetcher::ScheduleLocked() {
+    if (!running_ || pumpScheduled_ || queue_.empty() || inflight_ >= options_.concurrency) {
+        return;
+    }
+    std::weak_ptr<Prefetcher> weak = weak_from_this();
+    uint64_t generation = generation_;
+    pumpScheduled_ = pool_->Submit([weak, generation] {
+        if (auto self = weak.lock()) {
+            self->Pump(generation);
+        }
+    }, ThreadPool::Priority::Background);
+}
+
+void Prefetcher::Pump(uint64_t generation) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != generation_) {
+            return;
+        }
+        pumpActive_ = true;
+    }
+
+    for (;;) {
+        // Foreground commands go first; probe without holding our lock
+        bool busy = foregroundBusy_ && foregroundBusy_();
+
+        Work work;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (busy && running_) {
+                deferred_.Add();
+                std::weak_ptr<Prefetcher> weak = weak_from_this();
+                pumpScheduled_ = pool_->SubmitAfter(kBackoff, [weak, generation] {
+                    if (auto self = weak.lock()) {
+                        self->Pump(generation);
+                    }
+                }, ThreadPool::Priority::Background);
+                pumpActive_ = false;
+                break;
+            }
+            if (!running_ || queue_.empty() || inflight_ >= options_.concurrency) {
+                // Settled and OnDirectoryEnumerated schedule the next run
+                pumpScheduled_ = false;
+                pumpActive_ = false;
+                break;
+            }
+            work = std::move(queue_.front());
+            queue_.pop_front();
+            if (work.kind != Work::Expand) {
+                inflight_++;
+            }
+        }
+        Process(work);
+    }
+    cv_.notify_all();
+}
+
+void Prefetcher::Process(const Work& work) {
+    if (work.kind == Work::Expand) {
+        Expand(work);
+        return;
+    }
+
+    std::weak_ptr<Prefetcher> weak = weak_from_this();
+    auto onSettled = [weak, work](bool resolved) {
+        if (auto self = weak.lock()) {
+            self->Settled(work, resolved);
+        }
+    };
+
+    const std::string& path = cache_->Paths().PathOf(work.path);
+    bool sent = false;
+    if (work.kind == Work::Listing) {
+        if (cache_->HasDirectoryListing(work.path)) {
+            Settled(work, true);
+            return;
+        }
+        directories_.Add();
+        sent = bridge_->FetchDirectoryListing(path, onSettled);
+    } else {
+        if (cache_->HasFileContent(work.path)) {
+            Settled(work, false);
+            return;
+        }
+        files_.Add();
+        sent = bridge_->FetchFileContent(path, onSettled);
+    }
+
+    if (!sent) {
+        Settled(work, false);
+    }
+}
+
+void Prefetcher::Settled(const Work& work, bool resolved) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inflight_--;
+
+        // Keep walking down unless the work was cancelled meanwhile
+        bool live = running_ && pending_.count(work.path) > 0;
+        if (live && resolved && work.kind == Work::Listing && work.depth < options_.depth) {
+            queue_.push_back({Work::Expand, work.path, work.depth, work.wave});
+        } else {
+            pending_.erase(work.path);
+        }
+        ScheduleLocked();
+    }
+}
+
+void Prefetcher::Expand(const Work& work) {
+    PrefetchOptions options = GetOptions();
+    auto listing = cache_->GetDirectoryListing(work.path);
+    std::vector<Work> children;
+
+    if (listing && work.depth < options.depth) {
+        const std::string& parent = cache_->Paths().PathOf(work.path);
+        unsigned childDepth = work.depth + 1;
+        for (size_t i = 0; i < listing->Size(); i++) {
+            std::string_view name = listing->Name(i);
+            if (name.empty()) {
+                continue;
+            }
+            std::string childPath = parent == "/" ? std::string() : parent;
+            childPath.append("/").append(name);
+            if (IsExcluded(options.excludePrefixes, childPath)) {
+                skipped_.Add();
+                continue;
+            }
+
+            if (listing->IsDirectory(i)) {
+                children.push_back({Work::Listing, cache_->Paths().Intern(childPath), childDepth, work.wave});
+                continue;
+            }
+
+            // Only the one Pump task touches a wave, so its budget needs no lock
+            size_t size = static_cast<size_t>(listing->FileSize(i));
+            if (size == 0 || size > options.maxFileBytes || size > work.wave->remainingBytes) {
+                skipped_.Add();
+                continue;
+            }
+            PathId child = cache_->Paths().Intern(childPath);
+            if (cache_->HasFileContent(child)) {
+                skipped_.Add();
+                continue;
+            }
+            work.wave->remainingBytes -= size;
+            bytes_.Add(size);
+            children.push_back({Work::Content, child, childDepth, work.wave});
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // A cancelled directory does not hand out its children
+        if (pending_.erase(work.path) > 0 && running_) {
+            for (auto& child : children) {
+                if (queue_.size() >= kMaxQueuedWork) {
+                    skipped_.Add();
+                    continue;
+                }
+                if (pending_.insert(child.path).second) {
+                    queue_.push_back(std::move(child));
+                }
+            }
+        }
+    }
+
+    PROJFS_TRACE("[Prefetch] Expanded '" << cache_->Paths().PathOf(work.path) << "' at depth "
+        << work.depth << " into " << children.size() << " prefetches");
+}
+
+void Prefetcher::Stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    running_ = false;
+    queue_.clear();
+    pending_.clear();
+    generation_++;
+    // A running task probes the provider, so it has to be done before we are;
+    // queued ones see the new generation and return
+    cv_.wait(lock, [this] { return !pumpActive_; });
+}
+
+Prefetcher::Stats Prefetcher::GetStats() const {
+    Stats stats;
+    stats.scheduled = scheduled_.Load();
+    stats.directories = directories_.Load();
+    stats.files = files_.Load();
+    stats.bytes = bytes_.Load();
+    stats.skipped = skipped_.Load();
+    stats.deferred = deferred_.Load();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.queued = queue_.size();
+        stats.inflight = inflight_;
+    }
+    return stats;
+}
+
+} // namespace oneifsprojfs
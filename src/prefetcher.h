@@ -0,0 +1,128 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_set>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include "async_bridge.h"
+#include "content_cache.h"
+#include "path_table.h"
+#include "stats.h"
+#include "thread_pool.h"
+
+namespace oneifsprojfs {
+
+// Read-ahead settings. Depth counts levels below the enumerated directory:
+// depth 1 warms the listings of its subdirectories and its small files, depth
+// 2 also their children, and so on.
+struct PrefetchOptions {
+    bool enabled = false;
+    unsigned depth = 1;
+    size_t maxFileBytes = 64 * 1024;        // Larger files are left to GetFileData
+    size_t budgetBytes = 8 * 1024 * 1024;   // File content warmed per enumeration
+    size_t concurrency = 4;                 // Prefetches waiting on JavaScript at once
+    std::vector<std::string> excludePrefixes;  // Canonical subtrees never prefetched
+};
+
+// Low-priority read-ahead after a directory enumeration. A background task on
+// the native pool walks the enumerated directory breadth first and asks
+// AsyncBridge for the listings and small file contents below it, so the next
+// level a user opens is already in the ContentCache. At most one such task is
+// queued or running at a time. Nothing is sent while foregroundBusy reports
+// ProjFS commands waiting on JavaScript; the task then comes back after
+// kBackoff. Prefetches share the same fetch tables, so a foreground request
+// for a path being prefetched simply joins it.
+class Prefetcher : public std::enable_shared_from_this<Prefetcher> {
+public:
+    using BusyProbe = std::function<bool()>;
+
+    Prefetcher(std::shared_ptr<AsyncBridge> bridge, std::shared_ptr<ThreadPool> pool, BusyProbe foregroundBusy);
+    ~Prefetcher();
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+    // Starts or stops read-ahead as options.enabled changes
+    void Configure(const PrefetchOptions& options);
+    PrefetchOptions GetOptions() const;
+
+    // Called once a directory's listing has been handed to ProjFS
+    void OnDirectoryEnumerated(PathId directory);
+
+    // Drops queued work; fetches already sent settle on their own
+    void Cancel();
+    // Cancel and wait for a running task; Configure can start again
+    void Stop();
+
+    struct Stats {
+        uint64_t scheduled = 0;    // Enumerations that started a read-ahead
+        uint64_t directories = 0;  // Listings fetched from JavaScript
+        uint64_t files = 0;        // File contents fetched from JavaScript
+        uint64_t bytes = 0;        // Content bytes reserved for those files
+        uint64_t skipped = 0;      // Already cached, excluded or over budget
+        uint64_t deferred = 0;     // Backed off for foreground commands
+        size_t queued = 0;
+        size_t inflight = 0;
+    };
+    Stats GetStats() const;
+
+    // How long read-ahead waits while foreground commands are pending
+    static constexpr std::chrono::milliseconds kBackoff{20};
+
+private:
+    // Content bytes left for the files below one enumerated directory
+    struct Wave {
+        size_t remainingBytes;
+    };
+
+    struct Work {
+        enum Kind { Listing, Expand, Content };
+        Kind kind;
+        PathId path;
+        unsigned depth;  // Levels below the enumerated directory
+        std::shared_ptr<Wave> wave;
+    };
+
+    // Posts the task unless one is queued or running; called with mutex_ held
+    void ScheduleLocked();
+    // The pool task: processes work until the queue or the fetch window runs out
+    void Pump(uint64_t generation);
+    void Process(const Work& work);
+    // Queues the children of a directory whose listing is cached
+    void Expand(const Work& work);
+    // Frees a fetch slot; a fetched listing is queued for expansion
+    void Settled(const Work& work, bool resolved);
+
+    std::shared_ptr<AsyncBridge> bridge_;
+    std::shared_ptr<ContentCache> cache_;
+    BusyProbe foregroundBusy_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    PrefetchOptions options_;
+    std::deque<Work> queue_;
+    std::unordered_set<PathId> pending_;  // Queued or in flight
+    size_t inflight_ = 0;
+    bool running_ = false;
+    std::shared_ptr<ThreadPool> pool_;
+    bool pumpScheduled_ = false;   // A Pump task is queued or running
+    bool pumpActive_ = false;      // ...and running
+    uint64_t generation_ = 0;      // Bumped by Stop, so stale tasks do nothing
+
+    StripedCounter scheduled_;
+    StripedCounter directories_;
+    StripedCounter files_;
+    StripedCounter bytes_;
+    StripedCounter skipped_;
+    StripedCounter deferred_;
+};
+
+} // namespace oneifsprojfs
+
+#endif // PREFETCHER_H
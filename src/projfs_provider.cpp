@@ -1,9 +1,12 @@
 #include "projfs_provider.h"
-#include <iostream>
+#include "log.h"
+#include "trace.h"
 #include <vector>
 #include <algorithm>
 #include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <sstream>
 #include <thread>
 #include <chrono>
@@ -12,25 +15,145 @@
 
 namespace oneifsprojfs {
 
-ProjFSProvider::ProjFSProvider(const std::string& instancePath)
+namespace {
+
+// Only evaluated inside log statements, so disabled levels never pay for it
+std::string GuidToString(const GUID& guid) {
+    char guidStr[40];
+    sprintf_s(guidStr, sizeof(guidStr), "%08lX-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+        guid.Data1, guid.Data2, guid.Data3,
+        guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3],
+        guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7]);
+    return guidStr;
+}
+
+// Turns a ProjFS relative path ("dir\\file") into the canonical virtual path
+// ("/dir/file") used as the PathTable key: one UTF-8 conversion into a
+// per-thread buffer, then separators are rewritten and collapsed in place.
+// The view stays valid until the next call on the same thread.
+std::string_view ToVirtualPath(PCWSTR filePathName) {
+    thread_local std::string buffer;
+    size_t wideLength = filePathName ? wcslen(filePathName) : 0;
+    buffer.resize(1 + wideLength * 3);  // UTF-8 needs at most 3 bytes per UTF-16 unit
+    buffer[0] = '/';
+
+    int converted = 0;
+    if (wideLength > 0) {
+        converted = WideCharToMultiByte(CP_UTF8, 0, filePathName, static_cast<int>(wideLength),
+                                        &buffer[1], static_cast<int>(wideLength * 3), nullptr, nullptr);
+    }
+
+    size_t length = 1;
+    for (int i = 0; i < converted; i++) {
+        char c = buffer[1 + i];
+        if (c == '\\') c = '/';
+        if (c == '/' && buffer[length - 1] == '/') continue;
+        buffer[length++] = c;
+    }
+    if (length > 1 && buffer[length - 1] == '/') {
+        length--;
+    }
+    return std::string_view(buffer.data(), length);
+}
+
+// Identifies placeholders written by this provider; bump when ContentID changes meaning
+constexpr char kProviderId[] = "one.projfs/1";
+
+// ONE hashes are hex SHA-256, stored as their 32 raw bytes; anything else is
+// copied as is, truncated to the ContentID length
+void FillVersionInfo(const std::string& hash, PRJ_PLACEHOLDER_VERSION_INFO& versionInfo) {
+    // An all-zero ContentID would match every other file without a hash
+    if (hash.empty()) {
+        return;
+    }
+    memcpy(versionInfo.ProviderID, kProviderId, sizeof(kProviderId) - 1);
+
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    bool hex = !hash.empty() && hash.size() % 2 == 0 && hash.size() / 2 <= PRJ_PLACEHOLDER_ID_LENGTH;
+    for (size_t i = 0; hex && i < hash.size(); i++) {
+        hex = nibble(hash[i]) >= 0;
+    }
+    if (hex) {
+        for (size_t i = 0; i < hash.size() / 2; i++) {
+            versionInfo.ContentID[i] = static_cast<UINT8>(nibble(hash[2 * i]) << 4 | nibble(hash[2 * i + 1]));
+        }
+    } else {
+        memcpy(versionInfo.ContentID, hash.data(), std::min<size_t>(hash.size(), PRJ_PLACEHOLDER_ID_LENGTH));
+    }
+}
+
+// ProjFS relative path ("dir\\file") of a canonical virtual path
+std::wstring ToRelativePath(const std::wstring& widePath) {
+    std::wstring relative = widePath.empty() || widePath[0] != L'/' ? widePath : widePath.substr(1);
+    std::replace(relative.begin(), relative.end(), L'/', L'\\');
+    return relative;
+}
+
+// NUL-terminated UTF-16 of text in buffer, or in spill if it does not fit;
+// neither allocates once spill has grown to the longest name seen
+const wchar_t* WidenName(std::string_view text, wchar_t* buffer, size_t capacity, std::vector<wchar_t>& spill) {
+    int size = static_cast<int>(text.size());
+    int length = size == 0 ? 0 : MultiByteToWideChar(CP_UTF8, 0, text.data(), size, buffer, static_cast<int>(capacity) - 1);
+    if (length == 0 && size > 0) {
+        // Longer than any path component; measured, then converted again
+        length = MultiByteToWideChar(CP_UTF8, 0, text.data(), size, nullptr, 0);
+        spill.resize(static_cast<size_t>(length) + 1);
+        MultiByteToWideChar(CP_UTF8, 0, text.data(), size, spill.data(), length);
+        buffer = spill.data();
+    }
+    buffer[length] = L'\0';
+    return buffer;
+}
+
+bool IsAscii(std::string_view text) {
+    for (char c : text) {
+        if (static_cast<unsigned char>(c) >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ProjFSProvider::ProjFSProvider(const std::string& instancePath, std::shared_ptr<ThreadPool> pool)
     : storage_(std::make_unique<SyncStorage>(instancePath)),
+      pool_(pool ? std::move(pool) : std::make_shared<ThreadPool>()),
       virtualizationContext_(nullptr),
+      writeAlignment_(FileContent::kAlignment),
       isRunning_(false),
       lastError_("") {
     CoCreateGuid(&virtualizationInstanceId_);
+    tasks_ = std::make_unique<TaskGroup>(pool_);
 }
 
 ProjFSProvider::~ProjFSProvider() {
     Stop();
+    // Read-ahead probes our pending tables and pool tasks use the provider, so
+    // both must be gone before the members are; the pool may serve other roots
+    if (prefetcher_) {
+        prefetcher_->Stop();
+    }
+    tasks_->Close();
 }
 
-bool ProjFSProvider::Start(const std::string& virtualRoot) {
+bool ProjFSProvider::Start(const std::string& virtualRoot, const StartOptions& startOptions) {
     if (isRunning_) {
         return false;
     }
 
     virtualRoot_ = ToWide(virtualRoot);
 
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    mountTime_.LowPart = now.dwLowDateTime;
+    mountTime_.HighPart = now.dwHighDateTime;
+
     // Ensure the virtualization root exists
     if (!CreateDirectoryW(virtualRoot_.c_str(), nullptr)) {
         DWORD lastErr = static_cast<DWORD>(::GetLastError());
@@ -40,39 +163,20 @@ bool ProjFSProvider::Start(const std::string& virtualRoot) {
         }
     }
 
-    // CRITICAL FIX: Clear any stale virtualization state from previous crashed instances
-    // If the directory was previously a virtualization root with a different instance ID,
-    // Windows will ignore our callbacks. We MUST clear the stale state first.
-    std::cout << "[ProjFS] Clearing stale virtualization state for: " << virtualRoot << std::endl;
-
-    // Delete the virtualization marker file if it exists
-    // This forces Windows to forget the old instance ID
-    std::wstring markerPath = virtualRoot_ + L"\\.projfs\\placeholder";
-    DeleteFileW(markerPath.c_str());
-
-    // Also try to remove the .projfs directory
-    std::wstring projfsDir = virtualRoot_ + L"\\.projfs";
-    RemoveDirectoryW(projfsDir.c_str());
-
-    // CRITICAL: Remove ALL hydrated/tombstone directories and files
-    // ProjFS creates physical directories/files when accessed, and these remain after unmount
-    // If we don't remove them, Windows will read from disk instead of calling our callbacks!
-    std::cout << "[ProjFS] Removing all hydrated files and directories..." << std::endl;
-    try {
-        std::filesystem::path rootPath(virtualRoot_);
-        if (std::filesystem::exists(rootPath)) {
-            // Remove all contents but keep the root directory
-            for (const auto& entry : std::filesystem::directory_iterator(rootPath)) {
-                std::filesystem::remove_all(entry.path());
-                std::cout << "[ProjFS]   Removed: " << entry.path().filename().string() << std::endl;
-            }
-        }
-    } catch (const std::exception& e) {
-        std::cout << "[ProjFS] Warning: Failed to remove some hydrated content: " << e.what() << std::endl;
-        // Continue anyway - ProjFS might still work
+    // Placeholders can only be kept by the instance that created them; without
+    // its ID the root has to be wiped as before
+    bool preserve = startOptions.preservePlaceholders && LoadInstanceId();
+    writable_ = startOptions.writable && asyncBridge_ && asyncBridge_->CanWrite();
+    if (startOptions.writable && !writable_) {
+        PROJFS_WARN("[ProjFS] Writable mount asked for without a createFile callback; mounting read-only");
+    }
+    if (preserve) {
+        PROJFS_INFO("[ProjFS] Preserving placeholders of instance " << GuidToString(virtualizationInstanceId_));
+    } else {
+        RemoveHydratedContent();
     }
 
-    // Mark the directory as the virtualization root with our NEW instance ID
+    // Mark the directory as the virtualization root with our instance ID
     HRESULT hr = PrjMarkDirectoryAsPlaceholder(
         virtualRoot_.c_str(),
         nullptr,  // targetPathName
@@ -82,21 +186,30 @@ bool ProjFSProvider::Start(const std::string& virtualRoot) {
 
     if (FAILED(hr) && hr != HRESULT_FROM_WIN32(ERROR_REPARSE_POINT_ENCOUNTERED)) {
         lastError_ = "PrjMarkDirectoryAsPlaceholder failed with HRESULT: " + std::to_string(hr);
-        std::cout << "[ProjFS] ERROR: PrjMarkDirectoryAsPlaceholder failed: " << lastError_ << std::endl;
+        PROJFS_ERROR("[ProjFS] ERROR: PrjMarkDirectoryAsPlaceholder failed: " << lastError_);
         return false;
     }
 
-    std::cout << "[ProjFS] Directory marked as virtualization root successfully" << std::endl;
+    PROJFS_INFO("[ProjFS] Directory marked as virtualization root successfully");
+    SaveInstanceId();
+
+    // Listings from the previous mount, if ONE's version heads have not moved since
+    OpenMetadataSnapshot();
+    if (preserve) {
+        CollectOnDiskEntries();
+    }
 
     // Set up callbacks
     PRJ_CALLBACKS callbacks = {};
-    callbacks.GetPlaceholderInfoCallback = GetPlaceholderInfoCallback;
-    callbacks.GetFileDataCallback = GetFileDataCallback;
-    callbacks.QueryFileNameCallback = QueryFileNameCallback;
-    callbacks.StartDirectoryEnumerationCallback = StartDirectoryEnumerationCallback;
-    callbacks.GetDirectoryEnumerationCallback = GetDirectoryEnumerationCallback;
-    callbacks.EndDirectoryEnumerationCallback = EndDirectoryEnumerationCallback;
-    callbacks.NotificationCallback = NotificationCallback;
+    callbacks.GetPlaceholderInfoCallback = Timed<CallbackKind::PlaceholderInfo, &GetPlaceholderInfoCallback>;
+    callbacks.GetFileDataCallback = Timed<CallbackKind::FileData, &GetFileDataCallback>;
+    callbacks.QueryFileNameCallback = Timed<CallbackKind::QueryFileName, &QueryFileNameCallback>;
+    callbacks.StartDirectoryEnumerationCallback =
+        Timed<CallbackKind::StartEnumeration, &StartDirectoryEnumerationCallback>;
+    callbacks.GetDirectoryEnumerationCallback = Timed<CallbackKind::Enumeration, &GetDirectoryEnumerationCallback>;
+    callbacks.EndDirectoryEnumerationCallback = Timed<CallbackKind::EndEnumeration, &EndDirectoryEnumerationCallback>;
+    callbacks.NotificationCallback = Timed<CallbackKind::Notification, &NotificationCallback>;
+    callbacks.CancelCommandCallback = CancelCommandCallback;
 
     // Configure notification mappings to intercept write operations
     // CRITICAL: Without this, Windows won't call NotificationCallback for file creation/modification
@@ -104,15 +217,15 @@ bool ProjFSProvider::Start(const std::string& virtualRoot) {
     PRJ_NOTIFICATION_MAPPING notificationMapping = {};
     notificationMapping.NotificationRoot = L"";  // Apply to entire virtualization root
     notificationMapping.NotificationBitMask =
-        PRJ_NOTIFY_NEW_FILE_CREATED |           // Block file creation
-        PRJ_NOTIFY_FILE_OVERWRITTEN |           // Block overwrites
-        PRJ_NOTIFY_PRE_DELETE |                 // Block deletions
+        PRJ_NOTIFY_NEW_FILE_CREATED |           // Block file creation unless writable
+        PRJ_NOTIFY_FILE_OVERWRITTEN |           // Block overwrites unless writable
+        PRJ_NOTIFY_PRE_DELETE |                 // Block deletions unless writable
         PRJ_NOTIFY_PRE_RENAME |                 // Block renames
         PRJ_NOTIFY_PRE_SET_HARDLINK |           // Block hardlinks
         PRJ_NOTIFY_FILE_RENAMED |               // Track renames
         PRJ_NOTIFY_HARDLINK_CREATED |           // Track hardlinks
-        PRJ_NOTIFY_FILE_HANDLE_CLOSED_FILE_MODIFIED |  // Track modifications
-        PRJ_NOTIFY_FILE_HANDLE_CLOSED_FILE_DELETED;    // Track deletions
+        PRJ_NOTIFY_FILE_HANDLE_CLOSED_FILE_MODIFIED |  // Track modifications, written back if writable
+        PRJ_NOTIFY_FILE_HANDLE_CLOSED_FILE_DELETED;    // Track deletions, written back if writable
 
     // Start virtualization
     PRJ_STARTVIRTUALIZING_OPTIONS options = {};
@@ -120,7 +233,9 @@ bool ProjFSProvider::Start(const std::string& virtualRoot) {
     options.ConcurrentThreadCount = 0;  // Use default
     options.NotificationMappings = &notificationMapping;
     options.NotificationMappingsCount = 1;
-    // options.EnableNegativePathCache = TRUE; // May not be available in all SDK versions
+    // Let ProjFS remember names we report as missing so repeated probes (desktop.ini,
+    // thumbs.db, ...) never reach us; cleared whenever a cached listing changes
+    options.Flags = PRJ_FLAG_USE_NEGATIVE_PATH_CACHE;
 
     hr = PrjStartVirtualizing(
         virtualRoot_.c_str(),
@@ -135,7 +250,37 @@ bool ProjFSProvider::Start(const std::string& virtualRoot) {
         return false;
     }
 
+    // Cached content can be handed to PrjWriteFileData directly whenever it meets
+    // the volume's write alignment; otherwise it goes through an aligned bounce buffer
+    PRJ_VIRTUALIZATION_INSTANCE_INFO instanceInfo = {};
+    if (SUCCEEDED(PrjGetVirtualizationInstanceInfo(virtualizationContext_, &instanceInfo)) &&
+        instanceInfo.WriteAlignment > 0) {
+        writeAlignment_ = instanceInfo.WriteAlignment;
+    }
+
+    trace::Register();
     isRunning_ = true;
+
+    uint64_t snapshotGeneration;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        snapshotGeneration = snapshotGeneration_;
+        savedListingChanges_ = listingChanges_.load();
+    }
+    ScheduleSnapshotSave(snapshotGeneration);
+
+    // Index the objects directory in one pass, so /objects is enumerated and
+    // its placeholders are answered without touching the disk each time, then
+    // keep the index current as ONE writes objects
+    objectScanCancelled_ = false;
+    objectWatcher_ = std::thread([this] {
+        storage_->WatchObjects(objectScanCancelled_, [](size_t found) {
+            PROJFS_INFO("[ProjFS] Indexed " << found << " objects");
+        });
+    });
+    if (reconcilePending_) {
+        BeginReconcile();
+    }
     return true;
 }
 
@@ -144,6 +289,45 @@ void ProjFSProvider::Stop() {
         PrjStopVirtualizing(virtualizationContext_);
         virtualizationContext_ = nullptr;
         isRunning_ = false;
+        trace::Unregister();
+
+        if (prefetcher_) {
+            prefetcher_->Cancel();
+        }
+        objectScanCancelled_ = true;
+        if (objectWatcher_.joinable()) {
+            objectWatcher_.join();
+        }
+
+        // Whatever was not reconciled is revisited on the next preserving start
+        reconcilePending_ = false;
+        if (reconcileFetcher_.joinable()) {
+            reconcileFetcher_.join();
+        }
+        {
+            std::lock_guard<std::mutex> lock(reconcileMutex_);
+            reconcile_.clear();
+        }
+
+        {
+            // Queued periodic saves see the new generation and do nothing
+            std::unique_lock<std::mutex> lock(snapshotMutex_);
+            snapshotGeneration_++;
+            snapshotCv_.wait(lock, [this] { return !snapshotSaveActive_; });
+        }
+        SaveMetadataSnapshot(false);
+
+        // Stopping cancels every outstanding command
+        std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+        pendingFileRequests_.Clear();
+        streamedFileRequests_.clear();
+        offloadedCommands_.clear();
+        pendingPlaceholderRequests_.Clear();
+        pendingEnumerations_.Clear();
+        fetchedListings_.clear();
+
+        std::lock_guard<std::mutex> createdLock(createdFilesMutex_);
+        createdFiles_.clear();
     }
 }
 
@@ -151,128 +335,548 @@ bool ProjFSProvider::IsRunning() const {
     return isRunning_;
 }
 
-// ProjFS Callbacks
+bool ProjFSProvider::HasPendingCommands() const {
+    std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+    return pendingFileRequests_.Size() > 0 ||
+           !streamedFileRequests_.empty() ||
+           pendingPlaceholderRequests_.Size() > 0 ||
+           pendingEnumerations_.Size() > 0;
+}
 
-HRESULT CALLBACK ProjFSProvider::GetPlaceholderInfoCallback(const PRJ_CALLBACK_DATA* callbackData) {
-    auto* provider = static_cast<ProjFSProvider*>(callbackData->InstanceContext);
-    provider->stats_.placeholderRequests++;
+std::filesystem::path ProjFSProvider::SnapshotPath() const {
+    return storage_->InstancePath() / "projfs" / "metadata.snapshot";
+}
 
-    // Convert Windows path to Unix-style path
-    std::string relativePath = provider->ToUtf8(callbackData->FilePathName);
-    std::replace(relativePath.begin(), relativePath.end(), '\\', '/');
-    std::string virtualPath = relativePath.empty() ? "/" : "/" + relativePath;
-    
-    std::cout << "[ProjFS] GetPlaceholderInfo for: " << virtualPath << std::endl;
+std::filesystem::path ProjFSProvider::InstanceIdPath() const {
+    return storage_->InstancePath() / "projfs" / "instance-id";
+}
 
-    // Get cache reference for both root mount point check and file info lookup
-    auto cache = provider->asyncBridge_ ? provider->asyncBridge_->GetCache() : nullptr;
+bool ProjFSProvider::LoadInstanceId() {
+    GUID previous = {};
+    std::ifstream in(InstanceIdPath(), std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&previous), sizeof(previous))) {
+        PROJFS_INFO("[ProjFS] No previous instance ID, the virtualization root is wiped instead");
+        return false;
+    }
+    virtualizationInstanceId_ = previous;
+    return true;
+}
 
-    // Check if this is a root-level mount point by querying the cached root directory listing
-    // This avoids hardcoding directory names and automatically handles any mount points
-    if (cache && virtualPath.length() > 1 && virtualPath.find('/', 1) == std::string::npos) {
-        // Path is of form "/something" (single level, potential root mount point)
-        auto rootListing = cache->GetDirectoryListing("/");
-        if (rootListing) {
-            std::string pathName = virtualPath.substr(1); // Remove leading '/'
-
-            // Check if this path exists in the root directory listing
-            for (const auto& entry : rootListing->entries) {
-                if (entry.name == pathName && entry.isDirectory) {
-                    std::cout << "[ProjFS] Detected root mount point: " << virtualPath << std::endl;
-
-                    // This is a root-level mount point - return consistent directory metadata
-                    ObjectMetadata dirMetadata;
-                    dirMetadata.exists = true;
-                    dirMetadata.isDirectory = true;
-                    dirMetadata.size = 0;
-                    dirMetadata.type = "DIRECTORY";
-
-                    PRJ_PLACEHOLDER_INFO placeholderInfo = {};
-                    placeholderInfo.FileBasicInfo = provider->CreateFileBasicInfo(dirMetadata);
-
-                    return PrjWritePlaceholderInfo(
-                        callbackData->NamespaceVirtualizationContext,
-                        callbackData->FilePathName,
-                        &placeholderInfo,
-                        sizeof(placeholderInfo)
-                    );
+void ProjFSProvider::SaveInstanceId() {
+    std::filesystem::path file = InstanceIdPath();
+    try {
+        std::filesystem::create_directories(file.parent_path());
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&virtualizationInstanceId_), sizeof(virtualizationInstanceId_));
+        if (!out) {
+            PROJFS_WARN("[ProjFS] Failed to write " << file.string());
+        }
+    } catch (const std::exception& e) {
+        PROJFS_WARN("[ProjFS] Failed to save the instance ID: " << e.what());
+    }
+}
+
+void ProjFSProvider::RemoveHydratedContent() {
+    // CRITICAL FIX: Clear any stale virtualization state from previous crashed instances
+    // If the directory was previously a virtualization root with a different instance ID,
+    // Windows will ignore our callbacks. We MUST clear the stale state first.
+    PROJFS_INFO("[ProjFS] Clearing stale virtualization state for: " << ToUtf8(virtualRoot_));
+
+    // Delete the virtualization marker file if it exists
+    // This forces Windows to forget the old instance ID
+    std::wstring markerPath = virtualRoot_ + L"\\.projfs\\placeholder";
+    DeleteFileW(markerPath.c_str());
+
+    // Also try to remove the .projfs directory
+    std::wstring projfsDir = virtualRoot_ + L"\\.projfs";
+    RemoveDirectoryW(projfsDir.c_str());
+
+    // CRITICAL: Remove ALL hydrated/tombstone directories and files
+    // ProjFS creates physical directories/files when accessed, and these remain after unmount
+    // If we don't remove them, Windows will read from disk instead of calling our callbacks!
+    PROJFS_INFO("[ProjFS] Removing all hydrated files and directories...");
+    try {
+        std::filesystem::path rootPath(virtualRoot_);
+        if (std::filesystem::exists(rootPath)) {
+            // Remove all contents but keep the root directory
+            for (const auto& entry : std::filesystem::directory_iterator(rootPath)) {
+                std::filesystem::remove_all(entry.path());
+                PROJFS_DEBUG("[ProjFS]   Removed: " << entry.path().filename().string());
+            }
+        }
+    } catch (const std::exception& e) {
+        PROJFS_WARN("[ProjFS] Warning: Failed to remove some hydrated content: " << e.what());
+        // Continue anyway - ProjFS might still work
+    }
+}
+
+void ProjFSProvider::CollectOnDiskEntries() {
+    std::shared_ptr<MetadataSnapshot> current;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        current = snapshot_;
+    }
+
+    // What the previous mount served, even if the heads have moved since
+    std::string error;
+    std::unique_ptr<MetadataSnapshot> served;
+    if (!current && cache_) {
+        served = MetadataSnapshot::Open(SnapshotPath(), MetadataSnapshot::kAnyFingerprint, error);
+    }
+
+    std::unordered_map<PathId, std::vector<OnDiskEntry>> entries;
+    std::unordered_map<PathId, std::vector<FileInfo>> servedListings;
+    size_t count = 0;
+    try {
+        std::filesystem::path rootPath(virtualRoot_);
+        for (auto it = std::filesystem::recursive_directory_iterator(
+                 rootPath, std::filesystem::directory_options::skip_permission_denied);
+             it != std::filesystem::recursive_directory_iterator(); ++it) {
+            std::filesystem::path relative = it->path().lexically_relative(rootPath);
+            if (it.depth() == 0 && relative == L".projfs") {
+                it.disable_recursion_pending();
+                continue;
+            }
+            count++;
+            if (current || !cache_) {
+                continue;  // Same heads as the previous mount: everything on disk still holds
+            }
+
+            std::string parent = PathTable::Canonicalize(ToUtf8(relative.parent_path().generic_wstring()));
+            PathId parentId = cache_->Paths().Intern(parent);
+            OnDiskEntry entry{ToUtf8(it->path().filename().wstring()), it->is_directory(), std::nullopt};
+
+            // Each served listing is decoded once, on the first entry of its directory
+            auto listing = servedListings.find(parentId);
+            if (listing == servedListings.end()) {
+                DirectoryUpdate update;
+                if (served) {
+                    served->Read(parent, update);
+                }
+                listing = servedListings.emplace(parentId, std::move(update.listing.entries)).first;
+            }
+            for (const auto& info : listing->second) {
+                if (info.name == entry.name) {
+                    entry.served = info;
+                    break;
                 }
             }
+            entries[parentId].push_back(std::move(entry));
         }
+    } catch (const std::exception& e) {
+        PROJFS_WARN("[ProjFS] Failed to walk preserved placeholders: " << e.what());
     }
 
-    // Try to get file info from cache
-    if (cache) {
-        // First check if we have specific file info
-        auto fileInfo = cache->GetFileInfo(virtualPath);
-        if (fileInfo) {
-            // Convert cached FileInfo to ObjectMetadata
-            ObjectMetadata metadata;
-            metadata.exists = true;
-            metadata.isDirectory = fileInfo->isDirectory;
-            metadata.size = fileInfo->size;
-            metadata.type = fileInfo->isDirectory ? "DIRECTORY" : "FILE";
-            
-            PRJ_PLACEHOLDER_INFO placeholderInfo = {};
-            placeholderInfo.FileBasicInfo = provider->CreateFileBasicInfo(metadata);
+    if (current || !cache_) {
+        stats_.placeholdersKept += count;
+        PROJFS_INFO("[ProjFS] Kept " << count << " placeholders, version heads are unchanged");
+        return;
+    }
 
-            provider->stats_.cacheHits++;
-            std::cout << "[ProjFS] GetPlaceholderInfo: Found FileInfo in cache for " << virtualPath
-                      << " (size: " << metadata.size << ")" << std::endl;
-            return PrjWritePlaceholderInfo(
-                callbackData->NamespaceVirtualizationContext,
-                callbackData->FilePathName,
-                &placeholderInfo,
-                sizeof(placeholderInfo)
-            );
+    PROJFS_INFO("[ProjFS] Reconciling " << count << " placeholders in " << entries.size() << " directories"
+        << (served ? "" : " without a snapshot of what was served"));
+    std::lock_guard<std::mutex> lock(reconcileMutex_);
+    reconcile_ = std::move(entries);
+    reconcilePending_ = !reconcile_.empty();
+}
+
+void ProjFSProvider::BeginReconcile() {
+    std::vector<PathId> directories;
+    {
+        std::lock_guard<std::mutex> lock(reconcileMutex_);
+        for (const auto& pending : reconcile_) {
+            directories.push_back(pending.first);
         }
-        
-        // Check if file exists in parent directory listing
-        size_t lastSlash = virtualPath.find_last_of('/');
-        if (lastSlash != std::string::npos) {
-            std::string parentPath = virtualPath.substr(0, lastSlash);
-            std::string fileName = virtualPath.substr(lastSlash + 1);
-            
-            if (parentPath.empty()) parentPath = "/";
-            
-            auto dirListing = cache->GetDirectoryListing(parentPath);
-            if (dirListing) {
-                // Look for this file in the directory listing
-                for (const auto& entry : dirListing->entries) {
-                    if (entry.name == fileName) {
-                        // Found it! Create placeholder info from directory entry
-                        ObjectMetadata metadata;
-                        metadata.exists = true;
-                        metadata.isDirectory = entry.isDirectory;
-                        metadata.size = entry.size;
-                        metadata.type = entry.isDirectory ? "DIRECTORY" : "FILE";
-                        
-                        PRJ_PLACEHOLDER_INFO placeholderInfo = {};
-                        placeholderInfo.FileBasicInfo = provider->CreateFileBasicInfo(metadata);
-
-                        provider->stats_.cacheHits++;
-                        std::cout << "[ProjFS] GetPlaceholderInfo: Found in parent directory listing: "
-                                  << virtualPath << " (size: " << entry.size << ")" << std::endl;
-                        return PrjWritePlaceholderInfo(
-                            callbackData->NamespaceVirtualizationContext,
-                            callbackData->FilePathName,
-                            &placeholderInfo,
-                            sizeof(placeholderInfo)
-                        );
-                    }
-                }
+    }
+
+    // Parents first, so a vanished directory takes its preserved subtree with it
+    std::sort(directories.begin(), directories.end(), [this](PathId a, PathId b) {
+        return cache_->Paths().PathOf(a).size() < cache_->Paths().PathOf(b).size();
+    });
+    std::vector<PathId> missing;
+    for (PathId directory : directories) {
+        if (cache_->HasDirectoryListing(directory)) {
+            ReconcileDirectory(directory);
+        } else {
+            missing.push_back(directory);
+        }
+    }
+    if (missing.empty() || !asyncBridge_) {
+        return;
+    }
+
+    // Never from the JavaScript thread: a full fetch queue waits for it to drain
+    reconcileFetcher_ = std::thread([this, missing = std::move(missing)] {
+        for (PathId directory : missing) {
+            if (!reconcilePending_) {
+                break;
             }
+            asyncBridge_->FetchDirectoryListing(cache_->Paths().PathOf(directory));
+        }
+    });
+}
+
+void ProjFSProvider::ReconcileDirectory(PathId directory) {
+    if (!reconcilePending_ || !virtualizationContext_) {
+        return;
+    }
+    auto listing = cache_->GetDirectoryListing(directory);
+    if (!listing) {
+        return;  // Invalidated rather than stored; wait for the next listing
+    }
+
+    std::vector<OnDiskEntry> entries;
+    {
+        std::lock_guard<std::mutex> lock(reconcileMutex_);
+        auto pending = reconcile_.find(directory);
+        if (pending == reconcile_.end()) {
+            return;
+        }
+        entries = std::move(pending->second);
+        reconcile_.erase(pending);
+        reconcilePending_ = !reconcile_.empty();
+    }
+
+    const std::string& parent = cache_->Paths().PathOf(directory);
+    for (const auto& entry : entries) {
+        std::string childPath = parent == "/" ? "/" + entry.name : parent + "/" + entry.name;
+        PathId child = cache_->Paths().Intern(childPath);
+
+        size_t index = cache_->FindEntry(*listing, entry.name);
+        if (index == PackedListing::kNotFound || listing->IsDirectory(index) != entry.isDirectory) {
+            DeletePreserved(child, entry.isDirectory);
+            continue;
+        }
+        if (entry.isDirectory ||
+            (entry.served && entry.served->hash == listing->Hash(index) &&
+             entry.served->size == listing->FileSize(index))) {
+            stats_.placeholdersKept++;
+            continue;
+        }
+
+        std::wstring relativePath = ToRelativePath(ToWide(childPath));
+        if (HasLocalChanges(relativePath)) {
+            PROJFS_INFO("[ProjFS] Keeping local changes to " << childPath << " over the new version");
+            stats_.placeholdersLocal++;
+            continue;
+        }
+
+        PRJ_PLACEHOLDER_INFO placeholderInfo = {};
+        FillPlaceholderInfo(listing->Entry(index), placeholderInfo);
+
+        PRJ_UPDATE_FAILURE_CAUSES failure = PRJ_UPDATE_FAILURE_CAUSE_NONE;
+        HRESULT hr = PrjUpdateFileIfNeeded(virtualizationContext_, relativePath.c_str(),
+                                           &placeholderInfo, sizeof(placeholderInfo),
+                                           PRJ_UPDATE_ALLOW_DIRTY_METADATA | PRJ_UPDATE_ALLOW_READ_ONLY,
+                                           &failure);
+        if (SUCCEEDED(hr)) {
+            stats_.placeholdersUpdated++;
+        } else {
+            PROJFS_WARN("[ProjFS] Failed to update preserved " << childPath << ": HRESULT " << hr
+                << ", failure cause " << failure);
         }
-        
-        provider->stats_.cacheMisses++;
-        std::cout << "[ProjFS] GetPlaceholderInfo: Cache miss for " << virtualPath << std::endl;
+    }
+    PROJFS_DEBUG("[ProjFS] Reconciled " << entries.size() << " preserved entries in " << parent);
+}
+
+bool ProjFSProvider::HasLocalChanges(const std::wstring& relativePath) const {
+    std::wstring fullPath = virtualRoot_ + L"\\" + relativePath;
+    PRJ_FILE_STATE fileState = {};
+    if (FAILED(PrjGetOnDiskFileState(fullPath.c_str(), &fileState))) {
+        return false;  // Not on disk
+    }
+    return (fileState & (PRJ_FILE_STATE_DIRTY_PLACEHOLDER | PRJ_FILE_STATE_FULL | PRJ_FILE_STATE_TOMBSTONE)) != 0;
+}
+
+bool ProjFSProvider::DeletePreserved(PathId path, bool isDirectory) {
+    // A directory only goes once the preserved entries below it are gone
+    bool childrenGone = true;
+    if (isDirectory) {
+        std::vector<OnDiskEntry> children;
+        {
+            std::lock_guard<std::mutex> lock(reconcileMutex_);
+            auto pending = reconcile_.find(path);
+            if (pending != reconcile_.end()) {
+                children = std::move(pending->second);
+                reconcile_.erase(pending);
+                reconcilePending_ = !reconcile_.empty();
+            }
+        }
+        const std::string& parent = cache_->Paths().PathOf(path);
+        for (const auto& child : children) {
+            childrenGone &= DeletePreserved(cache_->Paths().Intern(parent + "/" + child.name), child.isDirectory);
+        }
+    }
+
+    const std::string& virtualPath = cache_->Paths().PathOf(path);
+    std::wstring relativePath = ToRelativePath(ToWide(virtualPath));
+    if (!childrenGone || HasLocalChanges(relativePath)) {
+        PROJFS_INFO("[ProjFS] Keeping " << virtualPath << ", gone from the namespace but changed locally");
+        stats_.placeholdersLocal++;
+        return false;
+    }
+    PRJ_UPDATE_FAILURE_CAUSES failure = PRJ_UPDATE_FAILURE_CAUSE_NONE;
+    HRESULT hr = PrjDeleteFile(virtualizationContext_, relativePath.c_str(),
+                               PRJ_UPDATE_ALLOW_DIRTY_METADATA | PRJ_UPDATE_ALLOW_READ_ONLY, &failure);
+    if (FAILED(hr)) {
+        PROJFS_WARN("[ProjFS] Failed to delete preserved " << virtualPath << ": HRESULT " << hr
+            << ", failure cause " << failure);
+        return false;
+    }
+    stats_.placeholdersDeleted++;
+    return true;
+}
+
+void ProjFSProvider::OpenMetadataSnapshot() {
+    std::string error;
+    uint64_t fingerprint = storage_->VersionHeadsFingerprint();
+    std::shared_ptr<MetadataSnapshot> snapshot = MetadataSnapshot::Open(SnapshotPath(), fingerprint, error);
+    if (snapshot) {
+        PROJFS_INFO("[ProjFS] Metadata snapshot holds " << snapshot->DirectoryCount() << " directories");
+    } else {
+        PROJFS_DEBUG("[ProjFS] Metadata snapshot not used: " << error);
+    }
+
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    snapshot_ = std::move(snapshot);
+    if (headsFingerprint_ != fingerprint) {
+        headsFingerprint_ = fingerprint;
+        currentListings_.clear();
+    }
+}
+
+bool ProjFSProvider::RestoreFromSnapshot(std::string_view directoryPath) {
+    std::shared_ptr<MetadataSnapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        snapshot = snapshot_;
+    }
+
+    DirectoryUpdate update;
+    if (!snapshot || !cache_ || !snapshot->Take(directoryPath, update)) {
+        return false;
+    }
+    std::vector<DirectoryUpdate> updates;
+    updates.push_back(std::move(update));
+    cache_->SetDirectoryTree(std::move(updates));
+
+    stats_.snapshotRestores++;
+    PROJFS_DEBUG("[ProjFS] Restored " << directoryPath << " from the metadata snapshot");
+    return true;
+}
+
+void ProjFSProvider::DiscardSnapshotListing(PathId directory, const DirectoryListingPtr& listing) {
+    listingChanges_++;
+
+    const std::string& path = cache_->Paths().PathOf(directory);
+    std::shared_ptr<MetadataSnapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        if (listing) {
+            currentListings_.insert(directory);
+        }
+        if (snapshotSaving_) {
+            snapshotDiscards_.push_back(path);
+        }
+        snapshot = snapshot_;
+    }
+    if (snapshot) {
+        snapshot->Discard(path);
+    }
+}
+
+void ProjFSProvider::SaveMetadataSnapshot(bool reopen) {
+    if (!cache_) {
+        return;
+    }
+
+    // Sampled before the export, so heads that move meanwhile invalidate the file
+    uint64_t fingerprint = storage_->VersionHeadsFingerprint();
+    if (fingerprint == 0) {
+        return;
+    }
+
+    std::shared_ptr<MetadataSnapshot> previous;
+    std::unordered_set<PathId> current;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        previous = std::move(snapshot_);
+        snapshotSaving_ = true;
+        // Whatever was cached under other heads may be stale under these
+        if (headsFingerprint_ != fingerprint) {
+            headsFingerprint_ = fingerprint;
+            currentListings_.clear();
+        }
+        current = currentListings_;
+    }
+    std::vector<DirectoryUpdate> directories =
+        cache_->ExportDirectoryTree([&current](PathId path) { return current.count(path) > 0; });
+    // Listings nobody asked for this session are carried over while still valid
+    if (previous && previous->Fingerprint() == fingerprint) {
+        previous->CollectRemaining(directories);
+    }
+    previous.reset();  // Unmapped, so the file can be replaced
+
+    std::string error;
+    std::filesystem::path file = SnapshotPath();
+    size_t count = directories.size();
+    if (MetadataSnapshot::Write(file, fingerprint, std::move(directories), error)) {
+        stats_.snapshotSaves++;
+        PROJFS_DEBUG("[ProjFS] Saved metadata snapshot with " << count << " directories");
+    } else {
+        PROJFS_WARN("[ProjFS] Failed to save metadata snapshot: " << error);
+    }
+
+    std::shared_ptr<MetadataSnapshot> reopened;
+    if (reopen) {
+        reopened = MetadataSnapshot::Open(file, fingerprint, error);
+    }
+
+    std::vector<std::string> discards;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        snapshotSaving_ = false;
+        std::swap(discards, snapshotDiscards_);
+        snapshot_ = reopened;
+    }
+    // Listings that changed while the file was written must not come back from it
+    if (reopened) {
+        for (const auto& path : discards) {
+            reopened->Discard(path);
+        }
+    }
+}
+
+void ProjFSProvider::ScheduleSnapshotSave(uint64_t generation) {
+    tasks_->SubmitAfter(kSnapshotInterval, [this, generation] { RunSnapshotSave(generation); },
+                        ThreadPool::Priority::Background);
+}
+
+void ProjFSProvider::RunSnapshotSave(uint64_t generation) {
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        if (generation != snapshotGeneration_) {
+            return;
+        }
+        snapshotSaveActive_ = true;
+    }
+    uint64_t changes = listingChanges_.load();
+    if (changes != savedListingChanges_) {
+        SaveMetadataSnapshot(true);
+        savedListingChanges_ = changes;
+    }
+    bool again;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        snapshotSaveActive_ = false;
+        again = generation == snapshotGeneration_;
+    }
+    snapshotCv_.notify_all();
+    if (again) {
+        ScheduleSnapshotSave(generation);
+    }
+}
+
+// ProjFS Callbacks
+
+thread_local bool ProjFSProvider::answeredFromCache_ = false;
+
+template <CallbackKind Kind, auto Callback, typename... Args>
+HRESULT CALLBACK ProjFSProvider::Timed(const PRJ_CALLBACK_DATA* callbackData, Args... args) {
+    auto* provider = static_cast<ProjFSProvider*>(callbackData->InstanceContext);
+    // A pending command may be completed, and its callback data released,
+    // before the callback returns
+    INT32 commandId = callbackData->CommandId;
+    std::wstring tracedPath;
+    if (trace::Enabled() && callbackData->FilePathName) {
+        tracedPath = callbackData->FilePathName;
+    }
+
+    answeredFromCache_ = false;
+    auto start = std::chrono::steady_clock::now();
+    HRESULT hr = Callback(callbackData, args...);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    CallbackOutcome outcome = hr == HRESULT_FROM_WIN32(ERROR_IO_PENDING) ? CallbackOutcome::Pending
+                            : answeredFromCache_ ? CallbackOutcome::Hit
+                            : CallbackOutcome::Miss;
+    provider->callbackStats_.Record(Kind, outcome, elapsed);
+    trace::Callback(Kind, outcome, commandId, tracedPath.c_str(), elapsed);
+    return hr;
+}
+
+void ProjFSProvider::RecordCompletion(CallbackKind kind, INT32 commandId, HRESULT hr,
+                                      std::chrono::steady_clock::time_point startedAt) {
+    auto waited = std::chrono::steady_clock::now() - startedAt;
+    callbackStats_.RecordCompletion(kind, waited);
+    trace::CommandCompleted(kind, commandId, hr, waited);
+}
+
+PendingCommandCounts ProjFSProvider::GetPendingCommandCounts() const {
+    PendingCommandCounts counts;
+    std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+    counts.placeholders = pendingPlaceholderRequests_.Size();
+    counts.fileData = pendingFileRequests_.Size();
+    counts.streams = streamedFileRequests_.size();
+    counts.enumerations = pendingEnumerations_.Size();
+    counts.offloaded = offloadedCommands_.size();
+    return counts;
+}
+
+bool ProjFSProvider::TakeOffloadedCommand(INT32 commandId, std::chrono::steady_clock::time_point& startedAt) {
+    auto offloaded = offloadedCommands_.find(commandId);
+    if (offloaded == offloadedCommands_.end()) {
+        return false;
+    }
+    // Timed from when the callback handed it to the pool
+    startedAt = offloaded->second;
+    offloadedCommands_.erase(offloaded);
+    return true;
+}
+
+HRESULT CALLBACK ProjFSProvider::GetPlaceholderInfoCallback(const PRJ_CALLBACK_DATA* callbackData) {
+    auto* provider = static_cast<ProjFSProvider*>(callbackData->InstanceContext);
+    provider->stats_.placeholderRequests++;
+
+    std::string_view virtualPath = ToVirtualPath(callbackData->FilePathName);
+    PROJFS_DEBUG("[ProjFS] GetPlaceholderInfo for: " << virtualPath);
+
+    // Names JavaScript already reported as missing are answered before any other
+    // lookup. /objects entries can appear on disk without a listing change, so
+    // storage stays authoritative there.
+    bool objectPath = virtualPath.compare(0, 9, "/objects/") == 0;
+    if (!objectPath && provider->cache_ && provider->cache_->IsMissing(virtualPath)) {
+        provider->stats_.negativeCacheHits++;
+        answeredFromCache_ = true;
+        PROJFS_DEBUG("[ProjFS] GetPlaceholderInfo: Known missing " << virtualPath);
+        return provider->ReportPathNotFound();
+    }
+
+    PRJ_PLACEHOLDER_INFO placeholderInfo = {};
+    if (provider->LookupCachedPlaceholder(virtualPath, placeholderInfo)) {
+        return PrjWritePlaceholderInfo(
+            callbackData->NamespaceVirtualizationContext,
+            callbackData->FilePathName,
+            &placeholderInfo,
+            sizeof(placeholderInfo)
+        );
     }
     
-    // Fall back to disk storage for BLOB/CLOB if it's in /objects path
-    if (virtualPath.compare(0, 9, "/objects/") == 0) {
-        ObjectMetadata metadata = provider->storage_->GetVirtualPathMetadata(virtualPath);
+    // Fall back to disk storage for BLOB/CLOB if it's in /objects path. Sniffing
+    // the object type reads the file, so that runs on the pool.
+    if (objectPath) {
+        INT32 commandId = callbackData->CommandId;
+        PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context = callbackData->NamespaceVirtualizationContext;
+        std::wstring filePathName = callbackData->FilePathName;
+        std::string path(virtualPath);
+        if (provider->OffloadCommand(CallbackKind::PlaceholderInfo, callbackData,
+                                     [provider, commandId, context, filePathName, path] {
+                return provider->WriteObjectPlaceholder(commandId, context, filePathName, path);
+            })) {
+            return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+        }
+        ObjectMetadata metadata = provider->storage_->GetVirtualPathMetadata(path);
         if (metadata.exists) {
-            PRJ_PLACEHOLDER_INFO placeholderInfo = {};
             placeholderInfo.FileBasicInfo = provider->CreateFileBasicInfo(metadata);
 
             // File size is handled by FileBasicInfo for ProjFS
@@ -286,15 +890,183 @@ HRESULT CALLBACK ProjFSProvider::GetPlaceholderInfoCallback(const PRJ_CALLBACK_D
         }
     }
     
-    // Request async fetch from JavaScript
-    if (provider->asyncBridge_) {
-        provider->asyncBridge_->FetchFileInfo(virtualPath);
-        // Return file not found for now - the cache will be populated for next access
-        // Returning ERROR_IO_PENDING can cause Explorer to hang
-        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    // Not cached: ask JavaScript and complete the command once it answers, so the
+    // worker thread is released immediately instead of blocking on the JS thread
+    if (provider->QueuePlaceholderFetch(callbackData->CommandId, callbackData->NamespaceVirtualizationContext,
+                                        callbackData->FilePathName, virtualPath, false)) {
+        return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
     }
     
-    return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    return provider->ReportPathNotFound();
+}
+
+bool ProjFSProvider::QueuePlaceholderFetch(INT32 commandId,
+                                           PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context,
+                                           const std::wstring& filePathName,
+                                           std::string_view virtualPath,
+                                           bool fromPool) {
+    if (!asyncBridge_ || !cache_) {
+        return false;
+    }
+    PathId pathId = cache_->Paths().Intern(virtualPath);
+    {
+        std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+        PendingPlaceholderRequest request;
+        request.startedAt = std::chrono::steady_clock::now();
+        if (fromPool && !TakeOffloadedCommand(commandId, request.startedAt)) {
+            return true;  // Cancelled while on the pool; nobody completes it
+        }
+        request.filePathName = filePathName;
+        request.virtualizationContext = context;
+        pendingPlaceholderRequests_.Add(commandId, pathId, std::move(request));
+    }
+
+    bool pending = asyncBridge_->FetchFileInfo(std::string(virtualPath), [this, pathId](bool resolved) {
+        CompletePendingPlaceholderRequests(pathId, resolved);
+    });
+    if (pending) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+    pendingPlaceholderRequests_.Remove(commandId);
+    return false;
+}
+
+HRESULT ProjFSProvider::WriteObjectPlaceholder(INT32 commandId,
+                                               PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context,
+                                               const std::wstring& filePathName,
+                                               const std::string& virtualPath) {
+    ObjectMetadata metadata = storage_->GetVirtualPathMetadata(virtualPath);
+    if (metadata.exists) {
+        PRJ_PLACEHOLDER_INFO placeholderInfo = {};
+        placeholderInfo.FileBasicInfo = CreateFileBasicInfo(metadata);
+        return PrjWritePlaceholderInfo(context, filePathName.c_str(), &placeholderInfo, sizeof(placeholderInfo));
+    }
+
+    if (QueuePlaceholderFetch(commandId, context, filePathName, virtualPath, true)) {
+        return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+    }
+    // Not parked, so we still own the command
+    return ReportPathNotFound();
+}
+
+bool ProjFSProvider::LookupCachedPlaceholder(std::string_view virtualPath, PRJ_PLACEHOLDER_INFO& placeholderInfo) {
+    FileInfo info;
+    if (!LookupCachedEntry(virtualPath, info)) {
+        return false;
+    }
+    FillPlaceholderInfo(info, placeholderInfo);
+    return true;
+}
+
+bool ProjFSProvider::LookupCachedEntry(std::string_view virtualPath, FileInfo& info) {
+    if (!cache_ || virtualPath.size() <= 1) {
+        return false;
+    }
+
+    // Names that were only ever listed are not interned themselves, so resolve
+    // the parent from the path when the entry has no id of its own
+    const PathTable& paths = cache_->Paths();
+    PathId pathId = paths.Find(virtualPath);
+    size_t lastSlash = virtualPath.rfind('/');
+    std::string_view fileName = virtualPath.substr(lastSlash + 1);
+    PathId parentId = pathId != kNoPath
+        ? paths.ParentOf(pathId)
+        : (lastSlash == 0 ? kRootPath : paths.Find(virtualPath.substr(0, lastSlash)));
+
+    // Check if this is a root-level mount point by querying the cached root directory listing
+    // This avoids hardcoding directory names and automatically handles any mount points
+    DirectoryListingPtr parentListing;
+    if (parentId == kRootPath) {
+        parentListing = cache_->GetDirectoryListing(kRootPath);
+        if (!parentListing && RestoreFromSnapshot("/")) {
+            parentListing = cache_->GetDirectoryListing(kRootPath);
+        }
+    }
+    if (parentListing) {
+        size_t index = cache_->FindEntry(*parentListing, fileName);
+        if (index != PackedListing::kNotFound && parentListing->IsDirectory(index)) {
+            PROJFS_DEBUG("[ProjFS] Detected root mount point: " << virtualPath);
+
+            // This is a root-level mount point - return consistent directory metadata
+            info = parentListing->Entry(index);
+            return true;
+        }
+    }
+
+    // First check if we have specific file info
+    auto fileInfo = pathId != kNoPath ? cache_->GetFileInfo(pathId) : std::nullopt;
+    if (fileInfo) {
+        info = std::move(*fileInfo);
+
+        CountCacheHit();
+        PROJFS_DEBUG("[ProjFS] GetPlaceholderInfo: Found FileInfo in cache for " << virtualPath
+                  << " (size: " << info.size << ")");
+        return true;
+    }
+    
+    // Check if file exists in parent directory listing. After a restart the
+    // parent may only be known to the metadata snapshot.
+    if (!parentListing && parentId != kRootPath) {
+        if (parentId != kNoPath) {
+            parentListing = cache_->GetDirectoryListing(parentId);
+        }
+        std::string_view parentPath = virtualPath.substr(0, lastSlash);
+        if (!parentListing && RestoreFromSnapshot(parentPath)) {
+            parentListing = cache_->GetDirectoryListing(paths.Find(parentPath));
+        }
+    }
+    if (parentListing) {
+        size_t index = cache_->FindEntry(*parentListing, fileName);
+        if (index != PackedListing::kNotFound) {
+            // Found it! Take the entry from the directory listing
+            info = parentListing->Entry(index);
+
+            CountCacheHit();
+            PROJFS_DEBUG("[ProjFS] GetPlaceholderInfo: Found in parent directory listing: "
+                      << virtualPath << " (size: " << parentListing->FileSize(index) << ")");
+            return true;
+        }
+    }
+    
+    stats_.cacheMisses++;
+    PROJFS_DEBUG("[ProjFS] GetPlaceholderInfo: Cache miss for " << virtualPath);
+    return false;
+}
+
+void ProjFSProvider::CompletePendingPlaceholderRequests(PathId path, bool resolved) {
+    std::vector<std::pair<INT32, PendingPlaceholderRequest>> completed;
+    {
+        std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+        completed = pendingPlaceholderRequests_.Take(path);
+    }
+    if (completed.empty() || !isRunning_) {
+        return;
+    }
+
+    const std::string& virtualPath = cache_->Paths().PathOf(path);
+    PRJ_PLACEHOLDER_INFO placeholderInfo = {};
+    bool found = resolved && LookupCachedPlaceholder(virtualPath, placeholderInfo);
+
+    for (auto& [commandId, request] : completed) {
+        HRESULT hr;
+        if (found) {
+            hr = PrjWritePlaceholderInfo(
+                request.virtualizationContext,
+                request.filePathName.c_str(),
+                &placeholderInfo,
+                sizeof(placeholderInfo)
+            );
+        } else {
+            hr = ReportPathNotFound();
+        }
+        PrjCompleteCommand(request.virtualizationContext, commandId, hr, nullptr);
+        RecordCompletion(CallbackKind::PlaceholderInfo, commandId, hr, request.startedAt);
+    }
+
+    PROJFS_DEBUG("[ProjFS] Completed " << completed.size() << " pending placeholder requests for "
+              << virtualPath << (found ? "" : " (not found)"));
 }
 
 HRESULT CALLBACK ProjFSProvider::GetFileDataCallback(
@@ -302,99 +1074,72 @@ HRESULT CALLBACK ProjFSProvider::GetFileDataCallback(
     UINT64 byteOffset,
     UINT32 length) {
     
-    std::cout << "[ProjFS] GetFileDataCallback CALLED! Path: " << callbackData->FilePathName 
-              << " Offset: " << byteOffset << " Length: " << length << std::endl;
+    PROJFS_DEBUG("[ProjFS] GetFileDataCallback CALLED! Path: " << callbackData->FilePathName 
+              << " Offset: " << byteOffset << " Length: " << length);
     
     auto* provider = static_cast<ProjFSProvider*>(callbackData->InstanceContext);
     provider->stats_.fileDataRequests++;
 
-    // Convert Windows path to Unix-style path
-    std::string relativePath = provider->ToUtf8(callbackData->FilePathName);
-    std::replace(relativePath.begin(), relativePath.end(), '\\', '/');
-    std::string virtualPath = relativePath.empty() ? "/" : "/" + relativePath;
-    
-    std::cout << "[ProjFS] GetFileDataCallback virtualPath: " << virtualPath << std::endl;
+    std::string_view virtualPath = ToVirtualPath(callbackData->FilePathName);
+    PROJFS_DEBUG("[ProjFS] GetFileDataCallback virtualPath: " << virtualPath);
     
     // Check cache first
-    auto cache = provider->asyncBridge_ ? provider->asyncBridge_->GetCache() : nullptr;
+    auto& cache = provider->cache_;
+    PathId pathId = cache ? cache->Paths().Find(virtualPath) : kNoPath;
     if (cache) {
-        std::cout << "[ProjFS] GetFileData: Checking cache for " << virtualPath << std::endl;
-        auto content = cache->GetFileContent(virtualPath);
-        if (content && !content->data.empty()) {
-            std::cout << "[ProjFS] GetFileData: Found cached content, size: " << content->data.size() << std::endl;
+        PROJFS_DEBUG("[ProjFS] GetFileData: Checking cache for " << virtualPath);
+        // A name that was only listed may still alias an object read elsewhere
+        auto content = pathId != kNoPath ? cache->GetFileContent(pathId)
+                                         : cache->GetFileContent(std::string(virtualPath));
+        if (content && !content->empty()) {
+            PROJFS_DEBUG("[ProjFS] GetFileData: Found cached content, size: " << content->size());
             // Use cached content
-            size_t contentSize = content->data.size();
-            if (byteOffset >= contentSize) {
-                return S_OK;  // Nothing to write
-            }
-
-            size_t bytesToWrite = (std::min)((size_t)length, contentSize - (size_t)byteOffset);
-            provider->stats_.bytesRead += bytesToWrite;
-            provider->stats_.cacheHits++;
-
-            // Allocate aligned buffer for ProjFS
-            void* buffer = PrjAllocateAlignedBuffer(
+            size_t bytesWritten = 0;
+            HRESULT hr = provider->WriteContentRange(
                 callbackData->NamespaceVirtualizationContext,
-                bytesToWrite
-            );
-
-            if (!buffer) {
-                return E_OUTOFMEMORY;
-            }
-
-            // Copy data to buffer
-            memcpy(buffer, content->data.data() + byteOffset, bytesToWrite);
-
-            // Write data
-            HRESULT hr = PrjWriteFileData(
-                callbackData->NamespaceVirtualizationContext,
-                &callbackData->DataStreamId,
-                buffer,
+                callbackData->DataStreamId,
+                *content,
+                0,
                 byteOffset,
-                bytesToWrite
+                length,
+                &bytesWritten
             );
 
-            PrjFreeAlignedBuffer(buffer);
-            std::cout << "[ProjFS] GetFileData: Successfully served " << bytesToWrite << " bytes from cache" << std::endl;
+            provider->stats_.bytesRead += bytesWritten;
+            provider->CountCacheHit();
+            PROJFS_DEBUG("[ProjFS] GetFileData: Successfully served " << bytesWritten << " bytes from cache");
             return hr;
         } else {
-            std::cout << "[ProjFS] GetFileData: No cached content found for " << virtualPath << std::endl;
+            PROJFS_DEBUG("[ProjFS] GetFileData: No cached content found for " << virtualPath);
         }
         provider->stats_.cacheMisses++;
     }
     
-    // For /objects paths, try direct disk access for BLOB/CLOB
+    // For /objects paths, try direct disk access for BLOB/CLOB. The read runs on
+    // the pool so this thread is free for callbacks that the cache can answer.
     if (virtualPath.compare(0, 9, "/objects/") == 0) {
-        auto content = provider->storage_->ReadVirtualPath(virtualPath);
-        if (content) {
-            size_t contentSize = content->size();
-            if (byteOffset >= contentSize) {
-                return S_OK;  // Nothing to write
-            }
-
-            size_t bytesToWrite = (std::min)((size_t)length, contentSize - (size_t)byteOffset);
-            provider->stats_.bytesRead += bytesToWrite;
-
-            void* buffer = PrjAllocateAlignedBuffer(
-                callbackData->NamespaceVirtualizationContext,
-                bytesToWrite
-            );
-
-            if (!buffer) {
-                return E_OUTOFMEMORY;
-            }
-
-            memcpy(buffer, content->data() + byteOffset, bytesToWrite);
-
-            HRESULT hr = PrjWriteFileData(
-                callbackData->NamespaceVirtualizationContext,
-                &callbackData->DataStreamId,
-                buffer,
-                byteOffset,
-                bytesToWrite
-            );
+        INT32 commandId = callbackData->CommandId;
+        PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context = callbackData->NamespaceVirtualizationContext;
+        GUID dataStreamId = callbackData->DataStreamId;
+        std::string objectPath(virtualPath);
+        if (provider->OffloadCommand(CallbackKind::FileData, callbackData,
+                                     [provider, commandId, context, dataStreamId, objectPath, byteOffset, length] {
+                bool found = true;
+                HRESULT hr = provider->WriteObjectRange(context, dataStreamId, objectPath, byteOffset, length, found);
+                if (found) {
+                    return hr;
+                }
+                if (provider->QueueFileFetch(commandId, context, dataStreamId, objectPath, byteOffset, length, true)) {
+                    return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+                }
+                return hr;
+            })) {
+            return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+        }
 
-            PrjFreeAlignedBuffer(buffer);
+        bool found = true;
+        HRESULT hr = provider->WriteObjectRange(context, dataStreamId, objectPath, byteOffset, length, found);
+        if (found) {
             return hr;
         }
     }
@@ -402,148 +1147,444 @@ HRESULT CALLBACK ProjFSProvider::GetFileDataCallback(
     
     // For other paths, content should have been prefetched
     // If content is not in cache, return ERROR_IO_PENDING and fetch async
-    std::cout << "[ProjFS] Content not cached for " << virtualPath 
-              << " - returning ERROR_IO_PENDING and fetching" << std::endl;
+    PROJFS_DEBUG("[ProjFS] Content not cached for " << virtualPath 
+              << " - returning ERROR_IO_PENDING and fetching");
     
-    if (provider->asyncBridge_) {
-        // Store pending request for later completion
-        {
-            std::lock_guard<std::mutex> lock(provider->pendingRequestsMutex_);
-            ProjFSProvider::PendingFileRequest request;
-            request.virtualPath = virtualPath;
-            request.byteOffset = byteOffset;
-            request.length = length;
-            request.virtualizationContext = callbackData->NamespaceVirtualizationContext;
-            request.dataStreamId = callbackData->DataStreamId;
-            
-            provider->pendingFileRequests_[callbackData->CommandId] = request;
-            std::cout << "[ProjFS] Stored pending request for CommandId: " << callbackData->CommandId
-                      << ", path: " << virtualPath << std::endl;
+    if (provider->asyncBridge_ && cache) {
+        if (pathId == kNoPath) {
+            pathId = cache->Paths().Intern(virtualPath);
         }
-        
-        // Trigger async fetch
-        std::cout << "[ProjFS] GetFileData: Triggering background fetch for " << virtualPath << std::endl;
-        provider->asyncBridge_->FetchFileContent(virtualPath);
-        
+
+        FileInfo info;
+        bool described = virtualPath.compare(0, 9, "/objects/") != 0 &&
+                         provider->LookupCachedEntry(virtualPath, info) && !info.isDirectory;
+
+        // Any path showing a BLOB or CLOB reads the object itself, whatever
+        // it is called, before JavaScript is asked
+        if (described && info.isBlobOrClob && !info.hash.empty()) {
+            INT32 commandId = callbackData->CommandId;
+            PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context = callbackData->NamespaceVirtualizationContext;
+            GUID dataStreamId = callbackData->DataStreamId;
+            std::string filePath(virtualPath);
+            std::string objectPath = "/objects/" + info.hash + "/raw.txt";
+            auto readBlob = [provider, context, dataStreamId, objectPath, byteOffset, length](bool& found) {
+                HRESULT hr = provider->WriteObjectRange(context, dataStreamId, objectPath, byteOffset, length, found);
+                if (found) {
+                    provider->stats_.blobReads++;
+                }
+                return hr;
+            };
+            if (provider->OffloadCommand(CallbackKind::FileData, callbackData,
+                                         [provider, commandId, context, dataStreamId, filePath, byteOffset, length,
+                                          readBlob] {
+                    bool found = true;
+                    HRESULT hr = readBlob(found);
+                    if (found) {
+                        return hr;
+                    }
+                    if (provider->QueueFileFetch(commandId, context, dataStreamId, filePath, byteOffset, length,
+                                                 true)) {
+                        return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+                    }
+                    return hr;
+                })) {
+                return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+            }
+
+            bool found = true;
+            HRESULT hr = readBlob(found);
+            if (found) {
+                return hr;
+            }
+        }
+
+        // Files too large for the content tier are read in chunks instead of
+        // being handed over whole
+        if (provider->asyncBridge_->CanReadRanges() && described && info.size > ContentCache::kMaxContentBytes) {
+            return provider->StreamFileData(callbackData, byteOffset, length, pathId, info);
+        }
+
         // Return ERROR_IO_PENDING so Windows knows to wait for completion
-        return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+        if (provider->QueueFileFetch(callbackData->CommandId, callbackData->NamespaceVirtualizationContext,
+                                     callbackData->DataStreamId, virtualPath, byteOffset, length, false)) {
+            return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+        }
+        // Not parked, so we still own the command
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
     }
     
     // Fallback if no async bridge
-    std::cout << "[ProjFS] No async bridge available for " << virtualPath << std::endl;
+    PROJFS_DEBUG("[ProjFS] No async bridge available for " << virtualPath);
     return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
 }
 
-void ProjFSProvider::CompletePendingFileRequests(const std::string& virtualPath) {
+bool ProjFSProvider::QueueFileFetch(INT32 commandId,
+                                    PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context,
+                                    const GUID& dataStreamId,
+                                    std::string_view virtualPath,
+                                    UINT64 byteOffset,
+                                    UINT32 length,
+                                    bool fromPool) {
+    if (!asyncBridge_ || !cache_) {
+        return false;
+    }
+    PathId pathId = cache_->Paths().Intern(virtualPath);
+
+    // Store pending request for later completion
+    {
+        std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+        PendingFileRequest request;
+        request.startedAt = std::chrono::steady_clock::now();
+        if (fromPool && !TakeOffloadedCommand(commandId, request.startedAt)) {
+            return true;  // Cancelled while on the pool; nobody completes it
+        }
+        request.byteOffset = byteOffset;
+        request.length = length;
+        request.virtualizationContext = context;
+        request.dataStreamId = dataStreamId;
+
+        pendingFileRequests_.Add(commandId, pathId, request);
+        PROJFS_DEBUG("[ProjFS] Stored pending request for CommandId: " << commandId
+                  << ", path: " << virtualPath);
+    }
+
+    // Trigger async fetch; a failed or empty read fails the waiters instead
+    // of leaving them parked
+    PROJFS_DEBUG("[ProjFS] GetFileData: Triggering background fetch for " << virtualPath);
+    bool pending = asyncBridge_->FetchFileContent(std::string(virtualPath), [this, pathId](bool resolved) {
+        CompletePendingFileRequests(pathId, resolved);
+    });
+    if (pending) {
+        return true;
+    }
+
     std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+    pendingFileRequests_.Remove(commandId);
+    return false;
+}
 
-    // Normalize the incoming path for comparison
-    std::string normalizedIncomingPath = virtualPath;
-    std::replace(normalizedIncomingPath.begin(), normalizedIncomingPath.end(), '\\', '/');
-    if (!normalizedIncomingPath.empty() && normalizedIncomingPath[0] != '/') {
-        normalizedIncomingPath = "/" + normalizedIncomingPath;
-    }
-
-    // Find all pending requests for this path
-    std::vector<INT32> completedCommands;
-
-    for (auto& [commandId, request] : pendingFileRequests_) {
-        // Normalize the stored path for comparison
-        std::string normalizedStoredPath = request.virtualPath;
-        std::replace(normalizedStoredPath.begin(), normalizedStoredPath.end(), '\\', '/');
-        if (!normalizedStoredPath.empty() && normalizedStoredPath[0] != '/') {
-            normalizedStoredPath = "/" + normalizedStoredPath;
-        }
-
-        if (normalizedStoredPath == normalizedIncomingPath) {
-            std::cout << "[ProjFS] Completing pending request for CommandId: " << commandId
-                      << ", stored path: " << request.virtualPath
-                      << ", incoming path: " << virtualPath
-                      << ", normalized: " << normalizedIncomingPath << std::endl;
-            
-            // Get the cached content now that it should be available
-            auto cache = asyncBridge_ ? asyncBridge_->GetCache() : nullptr;
-            if (cache) {
-                auto content = cache->GetFileContent(virtualPath);
-                if (content && !content->data.empty()) {
-                    // Prepare the data
-                    size_t contentSize = content->data.size();
-                    UINT64 byteOffset = request.byteOffset;
-                    UINT32 length = request.length;
-                    
-                    if (byteOffset < contentSize) {
-                        size_t bytesToWrite = (std::min)((size_t)length, contentSize - (size_t)byteOffset);
-                        
-                        // Allocate aligned buffer for ProjFS
-                        void* buffer = PrjAllocateAlignedBuffer(
-                            request.virtualizationContext,
-                            bytesToWrite
-                        );
-                        
-                        if (buffer) {
-                            // Copy data to buffer
-                            memcpy(buffer, content->data.data() + byteOffset, bytesToWrite);
-                            
-                            // Write data
-                            HRESULT dataHr = PrjWriteFileData(
-                                request.virtualizationContext,
-                                &request.dataStreamId,
-                                buffer,
-                                byteOffset,
-                                bytesToWrite
-                            );
-                            
-                            PrjFreeAlignedBuffer(buffer);
-                            
-                            // Complete the command
-                            HRESULT completeHr = PrjCompleteCommand(
-                                request.virtualizationContext,
-                                commandId,
-                                dataHr,
-                                nullptr
-                            );
-                            
-                            std::cout << "[ProjFS] Completed command " << commandId 
-                                      << " with " << bytesToWrite << " bytes, dataHr=" << std::hex << dataHr 
-                                      << ", completeHr=" << std::hex << completeHr << std::endl;
-                            
-                            stats_.bytesRead += bytesToWrite;
-                            stats_.cacheHits++;
-                        } else {
-                            // Complete with error
-                            PrjCompleteCommand(request.virtualizationContext, commandId, E_OUTOFMEMORY, nullptr);
-                            std::cout << "[ProjFS] Completed command " << commandId << " with E_OUTOFMEMORY" << std::endl;
-                        }
-                    } else {
-                        // Complete with success but no data
-                        PrjCompleteCommand(request.virtualizationContext, commandId, S_OK, nullptr);
-                        std::cout << "[ProjFS] Completed command " << commandId << " with S_OK (no data)" << std::endl;
-                    }
-                } else {
-                    // Complete with file not found
-                    PrjCompleteCommand(request.virtualizationContext, commandId, HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), nullptr);
-                    std::cout << "[ProjFS] Completed command " << commandId << " with ERROR_FILE_NOT_FOUND" << std::endl;
-                }
+HRESULT ProjFSProvider::WriteObjectRange(PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context,
+                                         const GUID& dataStreamId,
+                                         const std::string& objectPath,
+                                         UINT64 byteOffset,
+                                         UINT32 length,
+                                         bool& found) {
+    // Read exactly the requested range from disk, in bounded chunks, straight
+    // into one aligned buffer that is reused for every chunk
+    size_t chunkSize = (std::min)(static_cast<size_t>(length), kObjectReadChunkSize);
+    void* buffer = PrjAllocateAlignedBuffer(context, chunkSize);
+    if (!buffer) {
+        return E_OUTOFMEMORY;
+    }
+
+    HRESULT hr = S_OK;
+    UINT64 position = byteOffset;
+    UINT64 end = byteOffset + length;
+    found = true;
+
+    while (position < end) {
+        size_t want = (std::min)(chunkSize, static_cast<size_t>(end - position));
+        auto read = storage_->ReadVirtualPathRange(objectPath, position, static_cast<uint8_t*>(buffer), want);
+        if (!read) {
+            found = (position != byteOffset);  // Unknown path vs. failure mid-stream
+            hr = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+            break;
+        }
+        if (*read == 0) {
+            break;  // End of object
+        }
+
+        hr = PrjWriteFileData(context, &dataStreamId, buffer, position, static_cast<UINT32>(*read));
+        if (FAILED(hr)) {
+            break;
+        }
+
+        stats_.bytesRead += *read;
+        position += *read;
+        if (*read < want) {
+            break;  // Short read: end of object
+        }
+    }
+
+    PrjFreeAlignedBuffer(buffer);
+    return hr;
+}
+
+bool ProjFSProvider::OffloadCommand(CallbackKind kind, const PRJ_CALLBACK_DATA* callbackData,
+                                    std::function<HRESULT()> work) {
+    INT32 commandId = callbackData->CommandId;
+    PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context = callbackData->NamespaceVirtualizationContext;
+    auto startedAt = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+        offloadedCommands_[commandId] = startedAt;
+    }
+
+    bool submitted = tasks_->Submit([this, kind, commandId, context, startedAt, work = std::move(work)] {
+        {
+            // Cancelled before a worker got to it
+            std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+            if (offloadedCommands_.count(commandId) == 0) {
+                return;
+            }
+        }
+        HRESULT hr = work();
+
+        // A command the work parked elsewhere was already taken off the table
+        bool owned;
+        {
+            std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+            owned = offloadedCommands_.erase(commandId) > 0;
+        }
+        if (owned && hr != HRESULT_FROM_WIN32(ERROR_IO_PENDING) && isRunning_) {
+            PrjCompleteCommand(context, commandId, hr, nullptr);
+            RecordCompletion(kind, commandId, hr, startedAt);
+        }
+    }, ThreadPool::Priority::Foreground);
+
+    if (!submitted) {
+        std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+        offloadedCommands_.erase(commandId);
+        return false;
+    }
+    stats_.offloadedCommands++;
+    return true;
+}
+
+HRESULT ProjFSProvider::StreamFileData(const PRJ_CALLBACK_DATA* callbackData,
+                                       UINT64 byteOffset,
+                                       UINT32 length,
+                                       PathId path,
+                                       const FileInfo& info) {
+    auto stream = std::make_shared<StreamedFileRequest>();
+    stream->startedAt = std::chrono::steady_clock::now();
+    stream->commandId = callbackData->CommandId;
+    stream->virtualizationContext = callbackData->NamespaceVirtualizationContext;
+    stream->dataStreamId = callbackData->DataStreamId;
+    stream->path = path;
+    stream->virtualPath = cache_->Paths().PathOf(path);
+    stream->hash = info.hash;
+    stream->fileSize = info.size;
+    stream->begin = (std::min)(byteOffset, static_cast<UINT64>(info.size));
+    stream->end = (std::min)(byteOffset + length, static_cast<UINT64>(info.size));
+    stream->nextChunk = static_cast<uint32_t>(stream->begin / ContentCache::kChunkBytes);
+    stream->endChunk = static_cast<uint32_t>((stream->end + ContentCache::kChunkBytes - 1) / ContentCache::kChunkBytes);
+
+    // Whatever leads the range from the chunk tier is written before returning,
+    // so a re-read of a cached range never waits on JavaScript
+    while (stream->nextChunk < stream->endChunk) {
+        FileContentPtr chunk = cache_->GetFileChunk(path, stream->nextChunk, stream->hash);
+        if (!chunk) {
+            break;
+        }
+        HRESULT hr = WriteStreamChunk(*stream, stream->nextChunk, *chunk);
+        if (FAILED(hr)) {
+            return hr;
+        }
+        stream->nextChunk++;
+    }
+    if (stream->nextChunk == stream->endChunk) {
+        CountCacheHit();
+        return S_OK;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+        streamedFileRequests_[stream->commandId] = stream;
+    }
+    PROJFS_DEBUG("[ProjFS] Streaming chunks " << stream->nextChunk << "-" << stream->endChunk
+              << " of " << stream->virtualPath << " for CommandId: " << stream->commandId);
+    PumpStream(stream);
+    return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+}
+
+void ProjFSProvider::PumpStream(const std::shared_ptr<StreamedFileRequest>& stream) {
+    std::vector<uint32_t> fetches;
+    bool complete = false;
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (stream->finished) {
+            return;
+        }
+        while (SUCCEEDED(stream->result) && stream->nextChunk < stream->endChunk &&
+               stream->inflight < kStreamWindow) {
+            uint32_t index = stream->nextChunk++;
+            if (FileContentPtr chunk = cache_->GetFileChunk(stream->path, index, stream->hash)) {
+                stream->result = WriteStreamChunk(*stream, index, *chunk);
             } else {
-                // Complete with error
-                PrjCompleteCommand(request.virtualizationContext, commandId, HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), nullptr);
-                std::cout << "[ProjFS] Completed command " << commandId << " with ERROR_FILE_NOT_FOUND (no cache)" << std::endl;
+                stream->inflight++;
+                fetches.push_back(index);
             }
-            
-            completedCommands.push_back(commandId);
+        }
+        if (stream->inflight == 0 && (FAILED(stream->result) || stream->nextChunk == stream->endChunk)) {
+            stream->finished = true;
+            complete = true;
         }
     }
-    
-    // Remove completed requests
-    for (INT32 commandId : completedCommands) {
-        pendingFileRequests_.erase(commandId);
+
+    if (complete) {
+        // Cancellation and Stop take the command out of the table; those are
+        // not completed
+        bool registered;
+        {
+            std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+            registered = streamedFileRequests_.erase(stream->commandId) > 0;
+        }
+        if (registered && isRunning_) {
+            PrjCompleteCommand(stream->virtualizationContext, stream->commandId, stream->result, nullptr);
+            RecordCompletion(CallbackKind::FileData, stream->commandId, stream->result, stream->startedAt);
+            PROJFS_DEBUG("[ProjFS] Completed streamed command " << stream->commandId
+                      << ", hr=" << std::hex << stream->result << std::dec);
+        }
+        return;
+    }
+
+    for (uint32_t index : fetches) {
+        uint64_t offset = static_cast<uint64_t>(index) * ContentCache::kChunkBytes;
+        bool sent = asyncBridge_->FetchFileRange(stream->virtualPath, offset, ContentCache::kChunkBytes, stream->hash,
+            [this, stream, index](FileContentPtr chunk) { OnStreamChunk(stream, index, std::move(chunk)); });
+        if (!sent) {
+            OnStreamChunk(stream, index, nullptr);
+        }
+    }
+}
+
+void ProjFSProvider::OnStreamChunk(const std::shared_ptr<StreamedFileRequest>& stream,
+                                   uint32_t index,
+                                   FileContentPtr chunk) {
+    // A short chunk is not cached, so the next read asks for it again
+    uint64_t offset = static_cast<uint64_t>(index) * ContentCache::kChunkBytes;
+    uint64_t expected = (std::min)(static_cast<uint64_t>(ContentCache::kChunkBytes),
+                                   stream->fileSize > offset ? stream->fileSize - offset : 0);
+    if (chunk && chunk->size() >= expected) {
+        cache_->SetFileChunk(stream->path, index, chunk);
+        stats_.streamedChunks++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->inflight--;
+        if (!stream->finished && SUCCEEDED(stream->result)) {
+            stream->result = chunk ? WriteStreamChunk(*stream, index, *chunk)
+                                   : HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+        }
+    }
+    // Pumped after a failure too, so the last chunk in flight completes the command
+    PumpStream(stream);
+}
+
+HRESULT ProjFSProvider::WriteStreamChunk(StreamedFileRequest& stream, uint32_t index, const FileContent& chunk) {
+    UINT64 chunkStart = static_cast<UINT64>(index) * ContentCache::kChunkBytes;
+    UINT64 writeStart = (std::max)(stream.begin, chunkStart);
+    UINT64 wantEnd = (std::min)(stream.end, chunkStart + ContentCache::kChunkBytes);
+    UINT64 writeEnd = (std::min)(wantEnd, chunkStart + chunk.size());
+
+    HRESULT hr = S_OK;
+    if (writeEnd > writeStart) {
+        size_t bytesWritten = 0;
+        hr = WriteContentRange(stream.virtualizationContext, stream.dataStreamId, chunk, chunkStart,
+                               writeStart, static_cast<UINT32>(writeEnd - writeStart), &bytesWritten);
+        stats_.bytesRead += bytesWritten;
+    }
+    if (SUCCEEDED(hr) && writeEnd < wantEnd) {
+        // The file is shorter than its listing said; ProjFS must not be told
+        // the range was filled
+        PROJFS_WARN("[ProjFS] Chunk " << index << " of " << stream.virtualPath << " ends at byte "
+                  << chunkStart + chunk.size() << ", before " << wantEnd);
+        hr = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    }
+    return hr;
+}
+
+void ProjFSProvider::CompletePendingFileRequests(const std::string& virtualPath) {
+    // Pending requests are keyed by interned canonical path, so JavaScript may
+    // pass either separator; a path that was never interned has no waiters
+    if (!cache_) {
+        return;
+    }
+    PathId pathId = cache_->Paths().Find(PathTable::Canonicalize(virtualPath));
+    if (pathId == kNoPath) {
+        return;
+    }
+    CompletePendingFileRequests(pathId, true);
+}
+
+void ProjFSProvider::CompletePendingFileRequests(PathId pathId, bool resolved) {
+    std::vector<std::pair<INT32, PendingFileRequest>> completed;
+    {
+        std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+        completed = pendingFileRequests_.Take(pathId);
+    }
+    if (completed.empty() || !isRunning_) {
+        return;
+    }
+
+    // One lookup serves every waiter; the content is shared, not copied
+    FileContentPtr content = resolved ? cache_->GetFileContent(pathId) : nullptr;
+
+    for (auto& [commandId, request] : completed) {
+        if (content && !content->empty()) {
+            size_t bytesWritten = 0;
+            HRESULT dataHr = WriteContentRange(
+                request.virtualizationContext,
+                request.dataStreamId,
+                *content,
+                0,
+                request.byteOffset,
+                request.length,
+                &bytesWritten
+            );
+
+            // Complete the command
+            HRESULT completeHr = PrjCompleteCommand(
+                request.virtualizationContext,
+                commandId,
+                dataHr,
+                nullptr
+            );
+
+            PROJFS_DEBUG("[ProjFS] Completed command " << commandId
+                      << " with " << bytesWritten << " bytes, dataHr=" << std::hex << dataHr
+                      << ", completeHr=" << std::hex << completeHr << std::dec);
+
+            stats_.bytesRead += bytesWritten;
+            stats_.cacheHits++;
+            RecordCompletion(CallbackKind::FileData, commandId, dataHr, request.startedAt);
+        } else {
+            // Complete with file not found
+            HRESULT hr = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+            PrjCompleteCommand(request.virtualizationContext, commandId, hr, nullptr);
+            RecordCompletion(CallbackKind::FileData, commandId, hr, request.startedAt);
+            PROJFS_DEBUG("[ProjFS] Completed command " << commandId << " with ERROR_FILE_NOT_FOUND");
+        }
     }
     
-    std::cout << "[ProjFS] Completed " << completedCommands.size() << " pending requests for " << virtualPath << std::endl;
+    PROJFS_DEBUG("[ProjFS] Completed " << completed.size() << " pending requests for "
+              << cache_->Paths().PathOf(pathId));
 }
 
-HRESULT CALLBACK ProjFSProvider::QueryFileNameCallback(const PRJ_CALLBACK_DATA* callbackData) {
-    // We don't support case-insensitive matching
+HRESULT CALLBACK ProjFSProvider::QueryFileNameCallback(const PRJ_CALLBACK_DATA* callbackData) {
+    auto* provider = static_cast<ProjFSProvider*>(callbackData->InstanceContext);
+    std::string_view virtualPath = ToVirtualPath(callbackData->FilePathName);
+    if (virtualPath.size() <= 1) {
+        return S_OK;
+    }
+
+    // Answered from what is already cached, matching names case-insensitively
+    // through the parent listing's name index; nothing is fetched for it
+    bool objectPath = virtualPath.compare(0, 9, "/objects/") == 0;
+    if (!objectPath && provider->cache_ && provider->cache_->IsMissing(virtualPath)) {
+        answeredFromCache_ = true;
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+    PRJ_PLACEHOLDER_INFO placeholderInfo = {};
+    if (provider->LookupCachedPlaceholder(virtualPath, placeholderInfo)) {
+        return S_OK;
+    }
+    if (objectPath && provider->storage_->GetVirtualPathMetadata(std::string(virtualPath)).exists) {
+        return S_OK;
+    }
+
+    PROJFS_DEBUG("[ProjFS] QueryFileName: Not found " << virtualPath);
     return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
 }
 
@@ -555,27 +1596,9 @@ HRESULT CALLBACK ProjFSProvider::StartDirectoryEnumerationCallback(
     // Track active enumerations
     provider->stats_.activeEnumerations++;
     
-    // Debug: Log enumeration start
-    char guidStr[40];
-    sprintf_s(guidStr, sizeof(guidStr), "%08lX-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
-        enumerationId->Data1, enumerationId->Data2, enumerationId->Data3,
-        enumerationId->Data4[0], enumerationId->Data4[1], enumerationId->Data4[2], enumerationId->Data4[3],
-        enumerationId->Data4[4], enumerationId->Data4[5], enumerationId->Data4[6], enumerationId->Data4[7]);
-    
-    // Convert Windows path to Unix-style path
-    std::string relativePath = provider->ToUtf8(callbackData->FilePathName);
-    std::replace(relativePath.begin(), relativePath.end(), '\\', '/');
-    std::string path = relativePath.empty() ? "[ROOT]" : "/" + relativePath;
-    
-    std::cout << "[ProjFS] START ENUM " << guidStr << " for path: " << path
-        << " (active: " << provider->stats_.activeEnumerations << ")" << std::endl;
-
-    if (provider->asyncBridge_) {
-        std::stringstream msg;
-        msg << "[ProjFS] START ENUM " << guidStr << " for path: " << path
-            << " (active: " << provider->stats_.activeEnumerations << ")";
-        provider->asyncBridge_->EmitDebugMessage(msg.str());
-    }
+    PROJFS_DEBUG_JS("[ProjFS] START ENUM " << GuidToString(*enumerationId)
+        << " for path: " << ToVirtualPath(callbackData->FilePathName)
+        << " (active: " << provider->stats_.activeEnumerations << ")");
     
     // Reset enumeration state for this session
     std::lock_guard<std::mutex> lock(provider->enumerationMutex_);
@@ -583,11 +1606,7 @@ HRESULT CALLBACK ProjFSProvider::StartDirectoryEnumerationCallback(
     // Check if this enumeration already exists (shouldn't happen normally)
     auto it = provider->enumerationStates_.find(*enumerationId);
     if (it != provider->enumerationStates_.end()) {
-        if (provider->asyncBridge_) {
-            std::stringstream msg;
-            msg << "[ProjFS] WARNING: Enumeration already exists - this might cause issues!";
-            provider->asyncBridge_->EmitDebugMessage(msg.str());
-        }
+        PROJFS_WARN("[ProjFS] WARNING: Enumeration already exists - this might cause issues!");
     }
     
     provider->enumerationStates_[*enumerationId] = EnumerationState{};
@@ -605,26 +1624,14 @@ HRESULT CALLBACK ProjFSProvider::GetDirectoryEnumerationCallback(
     provider->stats_.directoryEnumerations++;
     provider->stats_.enumerationCallbacks++;
 
-    std::cout << "[GetDirEnum-ENTRY] =========== CALLED ===========" << std::endl;
+    PROJFS_DEBUG("[GetDirEnum-ENTRY] =========== CALLED ===========");
 
-    // Convert Windows path to Unix-style path
-    std::string relativePath = provider->ToUtf8(callbackData->FilePathName);
-
-    std::cout << "[GetDirEnum-ENTRY] relativePath: '" << relativePath << "'" << std::endl;
-    
-    // Replace backslashes with forward slashes
-    std::replace(relativePath.begin(), relativePath.end(), '\\', '/');
-    
-    // Ensure path starts with / for IFileSystem
-    std::string virtualPath = relativePath.empty() ? "/" : "/" + relativePath;
-    
-    // Log the path transformation
-    std::cout << "[ProjFS] GetDirEnum - FilePathName: '" << provider->ToUtf8(callbackData->FilePathName) 
-              << "' -> virtualPath: '" << virtualPath << "'" << std::endl;
+    std::string_view virtualPath = ToVirtualPath(callbackData->FilePathName);
+    PROJFS_DEBUG("[ProjFS] GetDirEnum - virtualPath: '" << virtualPath << "'");
     
     // Log search expression
     std::wstring searchExpr = searchExpression ? searchExpression : L"*";
-    std::cout << "[ProjFS] searchExpr: " << provider->ToUtf8(searchExpr) << std::endl;
+    PROJFS_DEBUG("[ProjFS] searchExpr: " << provider->ToUtf8(searchExpr));
     
     // Get or create enumeration state
     std::unique_lock<std::mutex> lock(provider->enumerationMutex_);
@@ -633,12 +1640,8 @@ HRESULT CALLBACK ProjFSProvider::GetDirectoryEnumerationCallback(
     auto it = provider->enumerationStates_.find(*enumerationId);
     if (it == provider->enumerationStates_.end()) {
         // This shouldn't happen - StartDirectoryEnumerationCallback should have created it
-        if (provider->asyncBridge_) {
-            std::stringstream msg;
-            msg << "[ProjFS] WARNING: Enumeration ID not found for " << virtualPath 
-                << " - creating new state (this might indicate a bug!)";
-            provider->asyncBridge_->EmitDebugMessage(msg.str());
-        }
+        PROJFS_WARN("[ProjFS] WARNING: Enumeration ID not found for " << virtualPath 
+            << " - creating new state (this might indicate a bug!)");
         // Create a new state
         provider->enumerationStates_[*enumerationId] = EnumerationState{};
     }
@@ -646,64 +1649,48 @@ HRESULT CALLBACK ProjFSProvider::GetDirectoryEnumerationCallback(
     auto& enumState = provider->enumerationStates_[*enumerationId];
     
     // CRITICAL: Log the current state before any modifications
-    {
-        std::stringstream msg;
-        msg << "[ProjFS] ENUM STATE BEFORE for " << virtualPath 
-            << " - entries.size: " << enumState.entries.size()
-            << ", nextIndex: " << enumState.nextIndex
-            << ", isComplete: " << enumState.isComplete
-            << ", callCount: " << enumState.callCount;
-        std::cout << msg.str() << std::endl;  // Direct console output
-        if (provider->asyncBridge_) {
-            provider->asyncBridge_->EmitDebugMessage(msg.str());
-        }
-    }
+    PROJFS_DEBUG_JS("[ProjFS] ENUM STATE BEFORE for " << virtualPath 
+        << " - entries.size: " << (enumState.listing ? enumState.listing->Size() : 0)
+        << ", nextIndex: " << enumState.nextIndex
+        << ", isComplete: " << enumState.isComplete
+        << ", callCount: " << enumState.callCount);
     
     // Check for restart scan flag
     if (callbackData->Flags & PRJ_CB_DATA_FLAG_ENUM_RESTART_SCAN) {
         // Explorer wants to restart the enumeration from the beginning
         enumState.nextIndex = 0;
         enumState.callCount = 0;  // Reset call count on restart
-        enumState.entries.clear();  // Clear entries to force re-fetch
+        enumState.listing.reset();  // Drop the listing to force re-fetch
+        enumState.matches.clear();
+        enumState.matchesResolved = false;
         enumState.isComplete = false;  // Reset completion state
         enumState.isLoading = false;  // Reset loading state
-        if (provider->asyncBridge_) {
-            std::stringstream msg;
-            msg << "[ProjFS] RESTART SCAN requested for " << virtualPath << " - clearing state";
-            provider->asyncBridge_->EmitDebugMessage(msg.str());
-        }
+        enumState.objectCursorSet = false;
+        PROJFS_DEBUG_JS("[ProjFS] RESTART SCAN requested for " << virtualPath << " - clearing state");
+    }
+
+    // /objects comes from the object index once the startup scan is in. The
+    // cursor only moves forward, so it is exempt from the loop guard below.
+    if (virtualPath == "/objects" && provider->storage_->Objects().Ready()) {
+        return provider->FillObjectEntries(enumState, searchExpr, dirEntryBufferHandle);
     }
     
     // Safety check to prevent infinite loops
     enumState.callCount++;
     if (enumState.callCount > EnumerationState::MAX_CALLS_PER_ENUM) {
-        if (provider->asyncBridge_) {
-            std::stringstream msg;
-            msg << "[ProjFS] ERROR: Enumeration loop detected for " << virtualPath 
-                << " - aborting after " << enumState.callCount << " calls";
-            provider->asyncBridge_->EmitDebugMessage(msg.str());
-        }
+        PROJFS_ERROR("[ProjFS] ERROR: Enumeration loop detected for " << virtualPath 
+            << " - aborting after " << enumState.callCount << " calls");
         return S_OK;  // Return empty to break the loop
     }
     
-    // Debug: log enumeration info
-    char guidStr[40];
-    sprintf_s(guidStr, sizeof(guidStr), "%08lX-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
-        enumerationId->Data1, enumerationId->Data2, enumerationId->Data3,
-        enumerationId->Data4[0], enumerationId->Data4[1], enumerationId->Data4[2], enumerationId->Data4[3],
-        enumerationId->Data4[4], enumerationId->Data4[5], enumerationId->Data4[6], enumerationId->Data4[7]);
-    if (provider->asyncBridge_) {
-        std::stringstream msg;
-        msg << "[ProjFS] GetDirEnum for " << virtualPath << " enum: " << guidStr 
-            << " nextIndex: " << enumState.nextIndex 
-            << " entries: " << enumState.entries.size()
-            << " isLoading: " << enumState.isLoading
-            << " isComplete: " << enumState.isComplete;
-        provider->asyncBridge_->EmitDebugMessage(msg.str());
-    }
+    PROJFS_DEBUG_JS("[ProjFS] GetDirEnum for " << virtualPath << " enum: " << GuidToString(*enumerationId)
+        << " nextIndex: " << enumState.nextIndex 
+        << " entries: " << (enumState.listing ? enumState.listing->Size() : 0)
+        << " isLoading: " << enumState.isLoading
+        << " isComplete: " << enumState.isComplete);
     
     // If this is the first call for this enumeration, populate the entries
-    if (enumState.entries.empty() && !enumState.isComplete) {
+    if (!enumState.listing && !enumState.isComplete) {
         // Check if already loading to prevent duplicate fetches
         if (enumState.isLoading) {
             // Another thread is loading, wait for it to complete
@@ -711,119 +1698,212 @@ HRESULT CALLBACK ProjFSProvider::GetDirectoryEnumerationCallback(
                 return !enumState.isLoading;
             });
             // After waiting, check if we now have entries
-            if (!enumState.entries.empty() || enumState.isComplete) {
+            if (enumState.listing || enumState.isComplete) {
                 // Entries are now available, continue with enumeration
-                goto process_entries;
+                return provider->FillDirEntryBuffer(enumState, searchExpr, dirEntryBufferHandle, virtualPath);
             }
             // If still no entries, something went wrong, return empty
             return S_OK;
         }
         
-        enumState.isLoading = true;
-        lock.unlock(); // Release lock while getting entries
-        
-        // Try cache first
-        auto cache = provider->asyncBridge_ ? provider->asyncBridge_->GetCache() : nullptr;
-        bool gotEntries = false;
+        auto& cache = provider->cache_;
+        PathId pathId = cache ? cache->Paths().Find(virtualPath) : kNoPath;
+        DirectoryListingPtr listing;
         
         if (cache) {
-            auto listing = cache->GetDirectoryListing(virtualPath);
+            if (pathId != kNoPath) {
+                listing = cache->GetDirectoryListing(pathId);
+            }
+            if (!listing && provider->RestoreFromSnapshot(virtualPath)) {
+                pathId = cache->Paths().Find(virtualPath);
+                listing = cache->GetDirectoryListing(pathId);
+            }
             if (listing) {
-                provider->stats_.cacheHits++;
-                // Store full FileInfo, not just names
-                enumState.entries = listing->entries;
-                gotEntries = true;
+                provider->CountCacheHit();
             } else {
                 provider->stats_.cacheMisses++;
             }
         }
-        
-        // REMOVED: Special case for /objects that used SyncStorage
-        // /objects should go through async bridge to JavaScript like all other paths
-        // since ONE.core objects are not stored in instancePath/objects/
-
-        // For all paths (including /objects and /types), request async fetch if not in cache
-        if (!gotEntries && provider->asyncBridge_) {
-            std::cout << "[ProjFS-DEBUG] About to call FetchDirectoryListing for: " << virtualPath << std::endl;
-            // Request the directory listing first
-            provider->asyncBridge_->FetchDirectoryListing(virtualPath);
-            std::cout << "[ProjFS-DEBUG] FetchDirectoryListing returned for: " << virtualPath << std::endl;
-            
-            // Wait for the async operation to complete with timeout
-            auto timeout = std::chrono::milliseconds(5000); // 5 second timeout
-            auto startTime = std::chrono::steady_clock::now();
-            
-            // Poll for the listing to appear in cache
-            while (std::chrono::steady_clock::now() - startTime < timeout) {
-                // Check cache for the listing (no lock needed for cache reads)
-                if (cache) {
-                    auto listing = cache->GetDirectoryListing(virtualPath);
-                    if (listing) {
-                        provider->stats_.cacheHits++;
-                        // Store full FileInfo, not just names
-                        enumState.entries = listing->entries;
-                        gotEntries = true;
-
-                        if (provider->asyncBridge_) {
-                            std::stringstream msg;
-                            msg << "[ProjFS] Async load completed for " << virtualPath
-                                << " - got " << enumState.entries.size() << " entries from cache";
-                            provider->asyncBridge_->EmitDebugMessage(msg.str());
-                        }
-                        break;
-                    }
-                }
-                
-                // Wait a bit before checking again
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        // For all paths (including /objects and /types), fetch from JavaScript if not in cache.
+        // The command is completed from CompletePendingEnumerations once the readDirectory
+        // promise settles, so cold directories never hold a ProjFS worker thread.
+        if (!listing && provider->asyncBridge_ && cache) {
+            enumState.isLoading = true;
+            lock.unlock();
+
+            if (pathId == kNoPath) {
+                pathId = cache->Paths().Intern(virtualPath);
             }
-            
-            if (!gotEntries) {
-                // Timeout - log warning
-                if (provider->asyncBridge_) {
-                    std::stringstream msg;
-                    msg << "[ProjFS] WARNING: Timeout waiting for directory listing for " << virtualPath;
-                    provider->asyncBridge_->EmitDebugMessage(msg.str());
-                }
+
+            {
+                std::lock_guard<std::mutex> pendingLock(provider->pendingRequestsMutex_);
+                PendingEnumeration request;
+                request.enumerationId = *enumerationId;
+                request.searchExpression = searchExpr;
+                request.dirEntryBufferHandle = dirEntryBufferHandle;
+                request.virtualizationContext = callbackData->NamespaceVirtualizationContext;
+                request.startedAt = std::chrono::steady_clock::now();
+                provider->pendingEnumerations_.Add(callbackData->CommandId, pathId, std::move(request));
             }
-        }
-        
-        // Re-acquire lock before modifying enumeration state
-        lock.lock();
-
-        // CRITICAL FIX: Cache the directory listing we just fetched
-        // This allows GetPlaceholderInfo to find these entries later when Windows tries to stat them
-        if (gotEntries && cache && !enumState.entries.empty()) {
-            DirectoryListing listing;
-            listing.entries = enumState.entries;
-            cache->SetDirectoryListing(virtualPath, listing);
-
-            if (provider->asyncBridge_) {
-                std::stringstream msg;
-                msg << "[ProjFS] CACHED directory listing for " << virtualPath
-                    << " with " << enumState.entries.size() << " entries";
-                provider->asyncBridge_->EmitDebugMessage(msg.str());
+
+            provider->stats_.directoryFetches++;
+            bool pending = provider->asyncBridge_->FetchDirectoryListing(std::string(virtualPath), [provider, pathId](bool resolved) {
+                provider->CompletePendingEnumerations(pathId, resolved);
+            });
+            if (pending) {
+                return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
+            }
+
+            {
+                std::lock_guard<std::mutex> pendingLock(provider->pendingRequestsMutex_);
+                provider->pendingEnumerations_.Remove(callbackData->CommandId);
             }
+            lock.lock();
+            enumState.isLoading = false;
+            provider->enumerationCv_.notify_all();
         }
 
-        // Only mark as complete if we're not loading entries
-        enumState.isLoading = false;
+        if (listing) {
+            enumState.listing = std::move(listing);
+            enumState.directory = pathId;
+            if (provider->prefetcher_) {
+                provider->prefetcher_->OnDirectoryEnumerated(pathId);
+            }
+        }
         enumState.isComplete = true;
-
-        // Notify any waiting threads that loading is complete
-        provider->enumerationCv_.notify_all();
     }
     
-process_entries:
-    
-    // Sanity check: ensure nextIndex is valid
-    if (enumState.nextIndex >= enumState.entries.size()) {
-        if (provider->asyncBridge_) {
-            std::stringstream msg;
-            msg << "[ProjFS] ENUMERATION COMPLETE for " << virtualPath 
-                << " - all " << enumState.entries.size() << " entries returned";
-            provider->asyncBridge_->EmitDebugMessage(msg.str());
+    return provider->FillDirEntryBuffer(enumState, searchExpr, dirEntryBufferHandle, virtualPath);
+}
+
+HRESULT ProjFSProvider::FillObjectEntries(EnumerationState& enumState,
+                                          const std::wstring& searchExpression,
+                                          PRJ_DIR_ENTRY_BUFFER_HANDLE dirEntryBufferHandle) {
+    // The object index is as good as a cached listing
+    answeredFromCache_ = true;
+    ObjectIndex::Snapshot objects = storage_->Objects().Take();
+    bool matchAll = searchExpression.empty() || searchExpression == L"*";
+
+    // Every object is a directory of views, stamped with the mount time
+    ObjectMetadata metadata;
+    metadata.exists = true;
+    metadata.isDirectory = true;
+    metadata.size = 0;
+    metadata.type = "DIRECTORY";
+    PRJ_FILE_BASIC_INFO fileInfo = CreateFileBasicInfo(metadata);
+    wchar_t name[ObjectIndex::kNameLength + 1];
+
+    if (!matchAll && !PrjDoesNameContainWildCards(searchExpression.c_str())) {
+        // A literal name: one lookup instead of a pass over every hash
+        ObjectIndex::Key key;
+        if (enumState.objectCursorSet || !ObjectInfoTable::ParseKey(ToUtf8(searchExpression), key) ||
+            !objects.Contains(key)) {
+            enumState.isComplete = true;
+            return S_OK;
+        }
+        ObjectIndex::FormatName(key, name);
+        HRESULT hr = PrjFillDirEntryBuffer(name, &fileInfo, dirEntryBufferHandle);
+        if (hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER)) {
+            return hr;  // Not even one entry fits; ProjFS must offer more room
+        }
+        if (SUCCEEDED(hr)) {
+            stats_.indexedObjectEntries++;
+        }
+        enumState.objectCursor = key;
+        enumState.objectCursorSet = true;
+        return S_OK;
+    }
+
+    ObjectIndex::Snapshot::Cursor cursor = objects.After(enumState.objectCursorSet ? &enumState.objectCursor : nullptr);
+    ObjectIndex::Key key;
+    size_t entriesAdded = 0;
+    while (objects.Next(cursor, key)) {
+        ObjectIndex::FormatName(key, name);
+        if (matchAll || PrjFileNameMatch(name, searchExpression.c_str())) {
+            HRESULT hr = PrjFillDirEntryBuffer(name, &fileInfo, dirEntryBufferHandle);
+            if (hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER)) {
+                if (entriesAdded == 0) {
+                    return hr;  // Not even one entry fits; ProjFS must offer more room
+                }
+                break;  // Resume at this hash next time
+            }
+            if (FAILED(hr)) {
+                PROJFS_ERROR("[ProjFS] ERROR: PrjFillDirEntryBuffer failed for object " << ObjectIndex::Name(key)
+                    << " with HRESULT 0x" << std::hex << hr << std::dec);
+            } else {
+                entriesAdded++;
+            }
+        }
+        enumState.objectCursor = key;
+        enumState.objectCursorSet = true;
+    }
+    stats_.indexedObjectEntries += entriesAdded;
+    enumState.isComplete = true;
+
+    PROJFS_DEBUG_JS("[ProjFS] ENUM CALLBACK COMPLETE for /objects: returned " << entriesAdded
+        << " of " << objects.Size() << " indexed objects");
+    return S_OK;
+}
+
+void ProjFSProvider::ResolveMatches(EnumerationState& enumState, const std::wstring& searchExpression) {
+    enumState.matchesResolved = true;
+    enumState.matches.clear();
+    enumState.matchAll = searchExpression.empty() || searchExpression == L"*";
+    if (enumState.matchAll || !enumState.listing) {
+        return;
+    }
+
+    const PackedListing& listing = *enumState.listing;
+    if (!PrjDoesNameContainWildCards(searchExpression.c_str())) {
+        // A literal name, as Explorer and most tools probe with
+        auto [first, last] = cache_->FindEntries(listing, ToUtf8(searchExpression));
+        for (size_t i = first; i < last; i++) {
+            enumState.matches.push_back(static_cast<uint32_t>(i));
         }
+        return;
+    }
+
+    for (size_t i = 0; i < listing.Size(); i++) {
+        if (PrjFileNameMatch(listing.WideName(i), searchExpression.c_str())) {
+            enumState.matches.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+int ProjFSProvider::CompareFileNames(std::string_view a, std::string_view b) {
+    // PrjFileNameCompare upcases and compares code units, which for ASCII is
+    // the cache's own ordering; anything else is widened on the stack
+    if (IsAscii(a) && IsAscii(b)) {
+        return CompareNamesIgnoringCase(a, b);
+    }
+    constexpr size_t kNameUnits = MAX_PATH + 1;
+    wchar_t bufferA[kNameUnits];
+    wchar_t bufferB[kNameUnits];
+    thread_local std::vector<wchar_t> spillA;
+    thread_local std::vector<wchar_t> spillB;
+    return PrjFileNameCompare(WidenName(a, bufferA, kNameUnits, spillA), WidenName(b, bufferB, kNameUnits, spillB));
+}
+
+HRESULT ProjFSProvider::FillDirEntryBuffer(EnumerationState& enumState,
+                                           const std::wstring& searchPattern,
+                                           PRJ_DIR_ENTRY_BUFFER_HANDLE dirEntryBufferHandle,
+                                           std::string_view virtualPath) {
+    // The search expression only changes on a restart, which drops the matches
+    if (!enumState.matchesResolved) {
+        ResolveMatches(enumState, searchPattern);
+    }
+    static const PackedListing kNoEntries;
+    const PackedListing& entries = enumState.listing ? *enumState.listing : kNoEntries;
+    if (enumState.listing) {
+        answeredFromCache_ = true;
+    }
+    size_t totalEntries = enumState.matchAll ? entries.Size() : enumState.matches.size();
+
+    // Sanity check: ensure nextIndex is valid
+    if (enumState.nextIndex >= totalEntries) {
+        PROJFS_DEBUG_JS("[ProjFS] ENUMERATION COMPLETE for " << virtualPath 
+            << " - all " << totalEntries << " entries returned");
         // Mark enumeration as truly complete
         enumState.isComplete = true;
         return S_OK;  // No more entries to return
@@ -831,78 +1911,52 @@ process_entries:
     
     // Return entries starting from nextIndex
     size_t entriesAdded = 0;
-    size_t totalEntries = enumState.entries.size();
     
     // Debug log at start of enumeration
-    std::cout << "[ProjFS] Starting enumeration return for " << virtualPath 
-              << " - nextIndex: " << enumState.nextIndex 
-              << ", totalEntries: " << totalEntries << std::endl;
-    if (provider->asyncBridge_) {
-        std::stringstream msg;
-        msg << "[ProjFS] Starting enumeration return for " << virtualPath 
-            << " - nextIndex: " << enumState.nextIndex 
-            << ", totalEntries: " << totalEntries;
-        provider->asyncBridge_->EmitDebugMessage(msg.str());
-    }
+    PROJFS_DEBUG_JS("[ProjFS] Starting enumeration return for " << virtualPath 
+        << " - nextIndex: " << enumState.nextIndex 
+        << ", totalEntries: " << totalEntries);
     
-    // Convert search expression to string for filtering
-    std::wstring searchPattern = searchExpression ? searchExpression : L"*";
-    
-    while (enumState.nextIndex < enumState.entries.size()) {
-        const auto& entryInfo = enumState.entries[enumState.nextIndex];
+    while (enumState.nextIndex < totalEntries) {
+        size_t entry = enumState.matchAll ? enumState.nextIndex : enumState.matches[enumState.nextIndex];
+        std::string_view entryName = entries.Name(entry);
 
         // Skip empty entries (shouldn't happen but be safe)
-        if (entryInfo.name.empty()) {
-            enumState.nextIndex++;
-            continue;
-        }
-
-        // Check if entry matches search pattern
-        std::wstring wideEntry = provider->ToWide(entryInfo.name);
-        if (!PrjFileNameMatch(wideEntry.c_str(), searchPattern.c_str())) {
-            // Entry doesn't match search pattern, skip it
+        if (entryName.empty()) {
             enumState.nextIndex++;
             continue;
         }
 
-        // Convert FileInfo to ObjectMetadata
+        // Convert the packed entry to ObjectMetadata
         ObjectMetadata entryMeta;
         entryMeta.exists = true;
-        entryMeta.isDirectory = entryInfo.isDirectory;
-        entryMeta.size = entryInfo.size;
-        entryMeta.type = entryInfo.isDirectory ? "DIRECTORY" : "FILE";
+        entryMeta.isDirectory = entries.IsDirectory(entry);
+        entryMeta.size = static_cast<size_t>(entries.FileSize(entry));
+        entryMeta.type = entryMeta.isDirectory ? "DIRECTORY" : "FILE";
+        entryMeta.mtime = entries.Mtime(entry);
         
-        PRJ_FILE_BASIC_INFO fileInfo = provider->CreateFileBasicInfo(entryMeta);
-        // wideEntry already defined above for pattern matching
+        PRJ_FILE_BASIC_INFO fileInfo = CreateFileBasicInfo(entryMeta);
 
         // Debug log the file attributes being set
-        if (provider->asyncBridge_) {
-            std::stringstream msg;
-            msg << "[ProjFS] Filling entry: " << entryInfo.name
-                << " IsDirectory=" << (fileInfo.IsDirectory ? "TRUE" : "FALSE")
-                << " FileSize=" << fileInfo.FileSize
-                << " FileAttributes=0x" << std::hex << fileInfo.FileAttributes << std::dec
-                << " (entryMeta.size=" << entryMeta.size
-                << ", entryInfo.size=" << entryInfo.size << ")";
-            provider->asyncBridge_->EmitDebugMessage(msg.str());
-        }
+        PROJFS_TRACE_JS("[ProjFS] Filling entry: " << entryName
+            << " IsDirectory=" << (fileInfo.IsDirectory ? "TRUE" : "FALSE")
+            << " FileSize=" << fileInfo.FileSize
+            << " FileAttributes=0x" << std::hex << fileInfo.FileAttributes << std::dec
+            << " (entryMeta.size=" << entryMeta.size << ")");
 
+        // The listing keeps NUL-terminated wide names for exactly this call
         HRESULT hr = PrjFillDirEntryBuffer(
-            wideEntry.c_str(),
+            entries.WideName(entry),
             &fileInfo,
             dirEntryBufferHandle
         );
 
         if (hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER)) {
             // Buffer is full, we'll continue from this index next time
-            if (provider->asyncBridge_) {
-                std::stringstream msg;
-                msg << "[ProjFS] BUFFER FULL for " << virtualPath
-                    << " after " << entriesAdded << " entries"
-                    << ", nextIndex stays at " << enumState.nextIndex
-                    << " (entry: " << entryInfo.name << ")";
-                provider->asyncBridge_->EmitDebugMessage(msg.str());
-            }
+            PROJFS_DEBUG_JS("[ProjFS] BUFFER FULL for " << virtualPath
+                << " after " << entriesAdded << " entries"
+                << ", nextIndex stays at " << enumState.nextIndex
+                << " (entry: " << entryName << ")");
             // CRITICAL: Do NOT increment nextIndex when buffer is full
             // We need to retry this same entry next time
             break;
@@ -910,15 +1964,11 @@ process_entries:
 
         if (FAILED(hr)) {
             // Other error - log it and skip this entry
-            if (provider->asyncBridge_) {
-                std::stringstream msg;
-                msg << "[ProjFS] ERROR: PrjFillDirEntryBuffer failed for " << entryInfo.name
-                    << " in " << virtualPath << " with HRESULT 0x"
-                    << std::hex << hr << std::dec
-                    << " (isDirectory=" << entryInfo.isDirectory
-                    << ", size=" << entryInfo.size << ")";
-                provider->asyncBridge_->EmitDebugMessage(msg.str());
-            }
+            PROJFS_ERROR("[ProjFS] ERROR: PrjFillDirEntryBuffer failed for " << entryName
+                << " in " << virtualPath << " with HRESULT 0x"
+                << std::hex << hr << std::dec
+                << " (isDirectory=" << entryMeta.isDirectory
+                << ", size=" << entryMeta.size << ")");
             // Skip this entry and continue
             enumState.nextIndex++;
             continue;
@@ -928,49 +1978,182 @@ process_entries:
         enumState.nextIndex++;
         entriesAdded++;
 
-        if (provider->asyncBridge_) {
-            std::stringstream msg;
-            msg << "[ProjFS] Added entry #" << entriesAdded << ": " << entryInfo.name
-                << " (nextIndex now: " << enumState.nextIndex << ")";
-            provider->asyncBridge_->EmitDebugMessage(msg.str());
-        }
+        PROJFS_TRACE_JS("[ProjFS] Added entry #" << entriesAdded << ": " << entryName
+            << " (nextIndex now: " << enumState.nextIndex << ")");
     }
     
-    if (provider->asyncBridge_) {
-        std::stringstream msg;
-        msg << "[ProjFS] ENUM CALLBACK COMPLETE for " << virtualPath 
-            << ": returned " << entriesAdded << " entries"
-            << ", nextIndex=" << enumState.nextIndex
-            << ", total=" << enumState.entries.size()
-            << ", hasMore=" << (enumState.nextIndex < enumState.entries.size())
-            << ", totalCallbacks=" << provider->stats_.enumerationCallbacks;
-        provider->asyncBridge_->EmitDebugMessage(msg.str());
-    }
+    PROJFS_DEBUG_JS("[ProjFS] ENUM CALLBACK COMPLETE for " << virtualPath 
+        << ": returned " << entriesAdded << " entries"
+        << ", nextIndex=" << enumState.nextIndex
+        << ", total=" << totalEntries
+        << ", hasMore=" << (enumState.nextIndex < totalEntries)
+        << ", totalCallbacks=" << stats_.enumerationCallbacks);
     
     return S_OK;
 }
 
+void ProjFSProvider::HoldFetchedListing(PathId path, const DirectoryListingPtr& listing) {
+    std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+    if (pendingEnumerations_.Waiting(path)) {
+        fetchedListings_[path] = listing;
+    }
+}
+
+void ProjFSProvider::CompletePendingEnumerations(PathId path, bool resolved) {
+    std::vector<std::pair<INT32, PendingEnumeration>> completed;
+    DirectoryListingPtr listing;
+    {
+        std::lock_guard<std::mutex> lock(pendingRequestsMutex_);
+        completed = pendingEnumerations_.Take(path);
+        auto fetched = fetchedListings_.find(path);
+        if (fetched != fetchedListings_.end()) {
+            listing = std::move(fetched->second);
+            fetchedListings_.erase(fetched);
+        }
+    }
+    if (completed.empty() || !isRunning_) {
+        return;
+    }
+
+    // A failed fetch completes the enumeration empty, as a timeout used to
+    const std::string& virtualPath = cache_->Paths().PathOf(path);
+    if (!resolved) {
+        listing = nullptr;
+    } else if (!listing) {
+        listing = cache_->GetDirectoryListing(path);
+    }
+
+    for (auto& [commandId, request] : completed) {
+        HRESULT hr = S_OK;
+        {
+            std::lock_guard<std::mutex> lock(enumerationMutex_);
+            auto it = enumerationStates_.find(request.enumerationId);
+            if (it == enumerationStates_.end()) {
+                hr = HRESULT_FROM_WIN32(ERROR_INVALID_PARAMETER);
+            } else {
+                EnumerationState& enumState = it->second;
+                if (listing) {
+                    enumState.listing = listing;
+                    enumState.matchesResolved = false;
+                    enumState.directory = path;
+                }
+                enumState.isLoading = false;
+                enumState.isComplete = true;
+                hr = FillDirEntryBuffer(enumState, request.searchExpression, request.dirEntryBufferHandle, virtualPath);
+            }
+            enumerationCv_.notify_all();
+        }
+
+        PRJ_COMPLETE_COMMAND_EXTENDED_PARAMETERS extendedParameters = {};
+        extendedParameters.CommandType = PRJ_COMPLETE_COMMAND_TYPE_ENUMERATION;
+        extendedParameters.Enumeration.DirEntryBufferHandle = request.dirEntryBufferHandle;
+        PrjCompleteCommand(request.virtualizationContext, commandId, hr, &extendedParameters);
+        RecordCompletion(CallbackKind::Enumeration, commandId, hr, request.startedAt);
+    }
+
+    PROJFS_DEBUG("[ProjFS] Completed " << completed.size() << " pending enumerations for " << virtualPath
+              << " with " << (listing ? listing->Size() : 0) << " entries");
+
+    if (listing && prefetcher_) {
+        prefetcher_->OnDirectoryEnumerated(path);
+    }
+}
+
+void ProjFSProvider::RefreshOpenEnumerations(PathId directory) {
+    // Commands still waiting on a fetch of the directory can finish right away
+    CompletePendingEnumerations(directory, true);
+
+    DirectoryListingPtr listing;
+    size_t refreshed = 0;
+    {
+        std::lock_guard<std::mutex> lock(enumerationMutex_);
+        for (auto& [enumerationId, enumState] : enumerationStates_) {
+            // Sessions that handed out entries stay consistent until Explorer restarts the scan
+            if (enumState.directory != directory || enumState.nextIndex > 0 || enumState.isLoading) {
+                continue;
+            }
+            if (!listing) {
+                listing = cache_->GetDirectoryListing(directory);
+                if (!listing) {
+                    break;
+                }
+            }
+            enumState.listing = listing;
+            enumState.matchesResolved = false;
+            refreshed++;
+        }
+    }
+    enumerationCv_.notify_all();
+
+    if (refreshed > 0) {
+        PROJFS_DEBUG("[ProjFS] Refreshed " << refreshed << " open enumerations of "
+            << cache_->Paths().PathOf(directory));
+    }
+}
+
+void CALLBACK ProjFSProvider::CancelCommandCallback(const PRJ_CALLBACK_DATA* callbackData) {
+    auto* provider = static_cast<ProjFSProvider*>(callbackData->InstanceContext);
+    INT32 commandId = callbackData->CommandId;
+
+    // A cancelled command must not be completed; its fetch keeps running and
+    // simply finds nothing to complete when it settles
+    bool cancelled = false;
+    std::optional<GUID> enumerationId;
+    std::shared_ptr<StreamedFileRequest> stream;
+    {
+        std::lock_guard<std::mutex> lock(provider->pendingRequestsMutex_);
+        cancelled |= provider->pendingFileRequests_.Remove(commandId).has_value();
+
+        auto streamed = provider->streamedFileRequests_.find(commandId);
+        if (streamed != provider->streamedFileRequests_.end()) {
+            stream = std::move(streamed->second);
+            provider->streamedFileRequests_.erase(streamed);
+            cancelled = true;
+        }
+        cancelled |= provider->pendingPlaceholderRequests_.Remove(commandId).has_value();
+        cancelled |= provider->offloadedCommands_.erase(commandId) > 0;
+
+        if (auto request = provider->pendingEnumerations_.Remove(commandId)) {
+            enumerationId = request->enumerationId;
+            cancelled = true;
+        }
+    }
+
+    if (stream) {
+        // Chunks still in flight land in the chunk tier but are not written
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->finished = true;
+    }
+
+    if (enumerationId) {
+        // Let the next call on this enumeration start the fetch again
+        std::lock_guard<std::mutex> lock(provider->enumerationMutex_);
+        auto it = provider->enumerationStates_.find(*enumerationId);
+        if (it != provider->enumerationStates_.end()) {
+            it->second.isLoading = false;
+        }
+        provider->enumerationCv_.notify_all();
+    }
+
+    if (cancelled) {
+        provider->stats_.cancelledCommands++;
+        PROJFS_DEBUG("[ProjFS] Cancelled command " << commandId);
+    }
+}
+
 HRESULT CALLBACK ProjFSProvider::EndDirectoryEnumerationCallback(
     const PRJ_CALLBACK_DATA* callbackData,
     const GUID* enumerationId) {
     auto* provider = static_cast<ProjFSProvider*>(callbackData->InstanceContext);
     
     // Debug: Log enumeration end
-    if (provider->asyncBridge_) {
-        char guidStr[40];
-        sprintf_s(guidStr, sizeof(guidStr), "%08lX-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
-            enumerationId->Data1, enumerationId->Data2, enumerationId->Data3,
-            enumerationId->Data4[0], enumerationId->Data4[1], enumerationId->Data4[2], enumerationId->Data4[3],
-            enumerationId->Data4[4], enumerationId->Data4[5], enumerationId->Data4[6], enumerationId->Data4[7]);
-        
+    if (logging::Enabled(LogLevel::Debug)) {
         std::lock_guard<std::mutex> lock(provider->enumerationMutex_);
         auto it = provider->enumerationStates_.find(*enumerationId);
         if (it != provider->enumerationStates_.end()) {
-            std::stringstream msg;
-            msg << "[ProjFS] END ENUM " << guidStr 
+            PROJFS_DEBUG_JS("[ProjFS] END ENUM " << GuidToString(*enumerationId)
                 << " - processed " << it->second.nextIndex 
-                << " of " << it->second.entries.size() << " entries";
-            provider->asyncBridge_->EmitDebugMessage(msg.str());
+                << " of " << (it->second.listing ? it->second.listing->Size() : 0) << " entries");
         }
     }
     
@@ -991,10 +2174,7 @@ HRESULT CALLBACK ProjFSProvider::NotificationCallback(
     PCWSTR destinationFileName,
     PRJ_NOTIFICATION_PARAMETERS* operationParameters) {
 
-    auto* provider = static_cast<ProjFSProvider*>(callbackData->InstanceContext);
-    std::string relativePath = provider->ToUtf8(callbackData->FilePathName);
-    std::replace(relativePath.begin(), relativePath.end(), '\\', '/');
-    std::string virtualPath = relativePath.empty() ? "/" : "/" + relativePath;
+    std::string_view virtualPath = ToVirtualPath(callbackData->FilePathName);
 
     // Log the notification for debugging
     const char* notificationName = "UNKNOWN";
@@ -1013,11 +2193,14 @@ HRESULT CALLBACK ProjFSProvider::NotificationCallback(
         case PRJ_NOTIFICATION_FILE_PRE_CONVERT_TO_FULL: notificationName = "PRE_CONVERT_TO_FULL"; break;
     }
 
-    std::cout << "[ProjFS] NOTIFICATION: " << notificationName
+    PROJFS_DEBUG("[ProjFS] NOTIFICATION: " << notificationName
               << " for path: " << virtualPath
-              << " (isDirectory: " << (isDirectory ? "TRUE" : "FALSE") << ")" << std::endl;
+              << " (isDirectory: " << (isDirectory ? "TRUE" : "FALSE") << ")");
+
+    auto* provider = static_cast<ProjFSProvider*>(callbackData->InstanceContext);
 
-    // For read-only virtual filesystem, deny all modifications
+    // Read-only unless the mount is writable; then plain files outside
+    // /objects may be created, overwritten and deleted
     switch (notification) {
         case PRJ_NOTIFICATION_FILE_OPENED:
         case PRJ_NOTIFICATION_FILE_HANDLE_CLOSED_NO_MODIFICATION:
@@ -1026,30 +2209,125 @@ HRESULT CALLBACK ProjFSProvider::NotificationCallback(
             return S_OK;
 
         case PRJ_NOTIFICATION_NEW_FILE_CREATED:
+            if (provider->AllowsWrite(virtualPath, isDirectory)) {
+                std::lock_guard<std::mutex> lock(provider->createdFilesMutex_);
+                provider->createdFiles_.emplace(virtualPath);
+                return S_OK;
+            }
+            PROJFS_DEBUG("[ProjFS] BLOCKED " << notificationName << " for: " << virtualPath);
+            return HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED);
+
         case PRJ_NOTIFICATION_FILE_OVERWRITTEN:
         case PRJ_NOTIFICATION_PRE_DELETE:
+            if (provider->AllowsWrite(virtualPath, isDirectory)) {
+                return S_OK;
+            }
+            PROJFS_DEBUG("[ProjFS] BLOCKED " << notificationName << " for: " << virtualPath);
+            return HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED);
+
         case PRJ_NOTIFICATION_PRE_RENAME:
         case PRJ_NOTIFICATION_PRE_SET_HARDLINK:
             // DENY all write operations with detailed logging
-            std::cout << "[ProjFS] BLOCKED " << notificationName << " for: " << virtualPath << std::endl;
+            PROJFS_DEBUG("[ProjFS] BLOCKED " << notificationName << " for: " << virtualPath);
             return HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED);
 
-        case PRJ_NOTIFICATION_FILE_RENAMED:
-        case PRJ_NOTIFICATION_HARDLINK_CREATED:
         case PRJ_NOTIFICATION_FILE_HANDLE_CLOSED_FILE_MODIFIED:
         case PRJ_NOTIFICATION_FILE_HANDLE_CLOSED_FILE_DELETED:
+            if (provider->AllowsWrite(virtualPath, isDirectory)) {
+                provider->WriteBack(callbackData, virtualPath,
+                                    notification == PRJ_NOTIFICATION_FILE_HANDLE_CLOSED_FILE_DELETED);
+                return S_OK;
+            }
+            PROJFS_DEBUG("[ProjFS] POST-OP notification: " << notificationName << " for: " << virtualPath);
+            return S_OK;
+
+        case PRJ_NOTIFICATION_FILE_RENAMED:
+        case PRJ_NOTIFICATION_HARDLINK_CREATED:
             // Post-operation notifications - just log them
-            std::cout << "[ProjFS] POST-OP notification: " << notificationName << " for: " << virtualPath << std::endl;
+            PROJFS_DEBUG("[ProjFS] POST-OP notification: " << notificationName << " for: " << virtualPath);
             return S_OK;
 
         default:
             // Unknown notification - deny it to be safe
-            std::cout << "[ProjFS] BLOCKED unknown notification 0x" << std::hex << notification
-                      << std::dec << " for: " << virtualPath << std::endl;
+            PROJFS_DEBUG("[ProjFS] BLOCKED unknown notification 0x" << std::hex << notification
+                      << std::dec << " for: " << virtualPath);
             return HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED);
     }
 }
 
+bool ProjFSProvider::AllowsWrite(std::string_view virtualPath, BOOLEAN isDirectory) const {
+    return writable_ && !isDirectory && virtualPath.size() > 1 &&
+           virtualPath.compare(0, 9, "/objects/") != 0 && virtualPath != "/objects";
+}
+
+void ProjFSProvider::WriteBack(const PRJ_CALLBACK_DATA* callbackData, std::string_view virtualPath, bool deleted) {
+    std::string path(virtualPath);
+    bool created;
+    {
+        std::lock_guard<std::mutex> lock(createdFilesMutex_);
+        created = createdFiles_.erase(path) > 0;
+    }
+    // What was served for the path no longer matches the file
+    if (cache_) {
+        cache_->InvalidatePath(cache_->Paths().Find(path));
+    }
+
+    if (deleted) {
+        stats_.writeBacks++;
+        if (!asyncBridge_->QueueDeleteFile(path)) {
+            PROJFS_WARN("[ProjFS] Could not queue delete of " << path);
+        }
+        return;
+    }
+
+    // The file is full now, so its bytes are on disk under the root; if the
+    // queue has no room they are read again from there later
+    std::wstring diskPath = virtualRoot_ + L"\\" + callbackData->FilePathName;
+    AsyncBridge::WritePayload content = ReadBack(diskPath, path);
+    if (!content) {
+        return;
+    }
+    auto reread = [diskPath, path] { return ReadBack(diskPath, path); };
+
+    stats_.writeBacks++;
+    bool queued = created ? asyncBridge_->QueueCreateFile(path, std::move(content), reread)
+                          : asyncBridge_->QueueUpdateFile(path, std::move(content), reread);
+    if (!queued) {
+        PROJFS_WARN("[ProjFS] Could not queue write-back of " << path);
+    }
+}
+
+AsyncBridge::WritePayload ProjFSProvider::ReadBack(const std::wstring& diskPath, const std::string& path) {
+    HANDLE handle = CreateFileW(diskPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        PROJFS_WARN("[ProjFS] Could not open " << path << " for write-back, error " << ::GetLastError());
+        return nullptr;
+    }
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(handle, &fileSize) ||
+        static_cast<ULONGLONG>(fileSize.QuadPart) > AsyncBridge::kMaxQueuedWriteBytes) {
+        CloseHandle(handle);
+        PROJFS_WARN("[ProjFS] Not writing back " << path << ": larger than "
+                  << AsyncBridge::kMaxQueuedWriteBytes << " bytes");
+        return nullptr;
+    }
+
+    auto content = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(fileSize.QuadPart));
+    size_t position = 0;
+    while (position < content->size()) {
+        DWORD want = static_cast<DWORD>((std::min)(kWriteBackReadChunkSize, content->size() - position));
+        DWORD read = 0;
+        if (!ReadFile(handle, content->data() + position, want, &read, nullptr) || read == 0) {
+            break;  // Truncated since the size was taken
+        }
+        position += read;
+    }
+    CloseHandle(handle);
+    content->resize(position);
+    return content;
+}
+
 // Helper methods
 
 std::wstring ProjFSProvider::ToWide(const std::string& str) {
@@ -1082,11 +2360,14 @@ PRJ_FILE_BASIC_INFO ProjFSProvider::CreateFileBasicInfo(const ObjectMetadata& me
         info.FileSize = metadata.size;
     }
     
-    // Set timestamps to current time
-    FILETIME ft;
-    GetSystemTimeAsFileTime(&ft);
-    info.CreationTime.LowPart = ft.dwLowDateTime;
-    info.CreationTime.HighPart = ft.dwHighDateTime;
+    // ONE objects are immutable, so their metadata time serves as every
+    // timestamp; without one, the mount time keeps entries stable between queries
+    if (metadata.mtime > 0) {
+        constexpr int64_t kUnixEpochAsFileTime = 116444736000000000LL;  // 100 ns ticks
+        info.CreationTime.QuadPart = static_cast<int64_t>(metadata.mtime) * 10000 + kUnixEpochAsFileTime;
+    } else {
+        info.CreationTime = mountTime_;
+    }
     info.LastWriteTime = info.CreationTime;
     info.LastAccessTime = info.CreationTime;
     info.ChangeTime = info.CreationTime;
@@ -1094,31 +2375,100 @@ PRJ_FILE_BASIC_INFO ProjFSProvider::CreateFileBasicInfo(const ObjectMetadata& me
     return info;
 }
 
-void ProjFSProvider::OnDirectoryListingUpdated(const std::string& path) {
-    // When a directory listing is updated in the cache, notify any waiting enumeration threads
-    std::lock_guard<std::mutex> lock(enumerationMutex_);
+void ProjFSProvider::FillPlaceholderInfo(const FileInfo& info, PRJ_PLACEHOLDER_INFO& placeholderInfo) {
+    ObjectMetadata metadata;
+    metadata.exists = true;
+    metadata.isDirectory = info.isDirectory;
+    metadata.size = info.isDirectory ? 0 : info.size;
+    metadata.type = info.isDirectory ? "DIRECTORY" : "FILE";
+    metadata.mtime = info.mtime;
+    placeholderInfo.FileBasicInfo = CreateFileBasicInfo(metadata);
+    FillVersionInfo(info.hash, placeholderInfo.VersionInfo);
+}
 
-    // Find any enumeration states that might be waiting for this path
-    for (auto& [guid, enumState] : enumerationStates_) {
-        if (enumState.isLoading) {
-            // Mark as no longer loading since the data is now in cache
-            enumState.isLoading = false;
+HRESULT ProjFSProvider::WriteContentRange(
+    PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context,
+    const GUID& dataStreamId,
+    const FileContent& content,
+    UINT64 contentStart,
+    UINT64 byteOffset,
+    UINT32 length,
+    size_t* bytesWritten) {
+
+    *bytesWritten = 0;
+    UINT64 contentEnd = contentStart + content.size();
+    if (byteOffset < contentStart || byteOffset >= contentEnd) {
+        return S_OK;  // Nothing to write
+    }
+
+    size_t bytesToWrite = static_cast<size_t>((std::min)(static_cast<UINT64>(length), contentEnd - byteOffset));
+    const uint8_t* source = content.data() + (byteOffset - contentStart);
+
+    HRESULT hr;
+    if (reinterpret_cast<uintptr_t>(source) % writeAlignment_ == 0) {
+        // Zero-copy: the cached blob is page-aligned, so ProjFS can take it as is.
+        // PrjWriteFileData only reads from the buffer despite the non-const signature.
+        hr = PrjWriteFileData(
+            context,
+            &dataStreamId,
+            const_cast<uint8_t*>(source),
+            byteOffset,
+            static_cast<UINT32>(bytesToWrite)
+        );
+    } else {
+        // Unaligned offset: bounce through one aligned buffer
+        void* buffer = PrjAllocateAlignedBuffer(context, bytesToWrite);
+        if (!buffer) {
+            return E_OUTOFMEMORY;
         }
+
+        memcpy(buffer, source, bytesToWrite);
+        hr = PrjWriteFileData(
+            context,
+            &dataStreamId,
+            buffer,
+            byteOffset,
+            static_cast<UINT32>(bytesToWrite)
+        );
+        PrjFreeAlignedBuffer(buffer);
     }
 
-    // Notify all waiting threads to check the cache again
-    enumerationCv_.notify_all();
+    if (SUCCEEDED(hr)) {
+        *bytesWritten = bytesToWrite;
+    }
+    return hr;
+}
+
+HRESULT ProjFSProvider::ReportPathNotFound() {
+    negativePathCacheDirty_.store(true, std::memory_order_relaxed);
+    return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+}
+
+void ProjFSProvider::ClearNegativePathCache() {
+    // ProjFS only caches names we answered as missing, so there is nothing to
+    // clear until one has been handed out since the last clear
+    if (!isRunning_ || !negativePathCacheDirty_.exchange(false, std::memory_order_relaxed)) {
+        return;
+    }
 
-    if (asyncBridge_) {
-        std::stringstream msg;
-        msg << "[ProjFS] Directory listing updated for path: " << path;
-        asyncBridge_->EmitDebugMessage(msg.str());
+    UINT32 clearedEntries = 0;
+    HRESULT hr = PrjClearNegativePathCache(virtualizationContext_, &clearedEntries);
+    if (FAILED(hr)) {
+        negativePathCacheDirty_.store(true, std::memory_order_relaxed);
+        PROJFS_WARN("[ProjFS] PrjClearNegativePathCache failed with HRESULT 0x" << std::hex << hr << std::dec);
+        return;
     }
+    PROJFS_DEBUG("[ProjFS] Cleared " << clearedEntries << " negative path cache entries");
+}
+
+void ProjFSProvider::OnDirectoryListingUpdated(const std::string& path) {
+    // Waiting enumerations are woken through the fetch future; this only reports
+    PROJFS_DEBUG_JS("[ProjFS] Directory listing updated for path: " << path);
 }
 
 bool ProjFSProvider::InvalidateTombstone(const std::string& virtualPath) {
     if (!isRunning_ || !virtualizationContext_) {
-        std::cout << "[ProjFS] Cannot invalidate tombstone - provider not running" << std::endl;
+        PROJFS_WARN("[ProjFS] Cannot invalidate tombstone - provider not running");
         return false;
     }
 
@@ -1133,8 +2483,8 @@ bool ProjFSProvider::InvalidateTombstone(const std::string& virtualPath) {
 
     std::wstring widePath = ToWide(windowsPath);
 
-    std::cout << "[ProjFS] Invalidating tombstone for: " << virtualPath
-              << " (Windows path: " << windowsPath << ")" << std::endl;
+    PROJFS_DEBUG("[ProjFS] Invalidating tombstone for: " << virtualPath
+              << " (Windows path: " << windowsPath << ")");
 
     // Use PrjDeleteFile to remove the tombstone cache entry
     // This tells Windows to forget that the file was deleted
@@ -1146,7 +2496,7 @@ bool ProjFSProvider::InvalidateTombstone(const std::string& virtualPath) {
     );
 
     if (SUCCEEDED(hr)) {
-        std::cout << "[ProjFS] Successfully invalidated tombstone for: " << virtualPath << std::endl;
+        PROJFS_DEBUG("[ProjFS] Successfully invalidated tombstone for: " << virtualPath);
 
         // Clear our internal caches too
         if (cache_) {
@@ -1156,13 +2506,128 @@ bool ProjFSProvider::InvalidateTombstone(const std::string& virtualPath) {
         return true;
     } else if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND)) {
         // File not in tombstone cache - this is fine, it means there's no tombstone to clear
-        std::cout << "[ProjFS] No tombstone to invalidate for: " << virtualPath << std::endl;
+        PROJFS_DEBUG("[ProjFS] No tombstone to invalidate for: " << virtualPath);
         return true;
     } else {
-        std::cout << "[ProjFS] Failed to invalidate tombstone for: " << virtualPath
-                  << " HRESULT: 0x" << std::hex << hr << std::dec << std::endl;
+        PROJFS_WARN("[ProjFS] Failed to invalidate tombstone for: " << virtualPath
+                  << " HRESULT: 0x" << std::hex << hr << std::dec);
         return false;
     }
 }
 
-} // namespace oneifsprojfs
\ No newline at end of file
+PathUpdateResult ProjFSProvider::UpdatePaths(const std::vector<std::string>& virtualPaths) {
+    PathUpdateResult result;
+    if (!isRunning_ || !virtualizationContext_ || !cache_) {
+        result.failed = virtualPaths.size();
+        return result;
+    }
+
+    const PRJ_UPDATE_TYPES updateFlags = PRJ_UPDATE_ALLOW_DIRTY_METADATA | PRJ_UPDATE_ALLOW_READ_ONLY;
+    for (const auto& path : virtualPaths) {
+        std::string virtualPath = PathTable::Canonicalize(path);
+        if (virtualPath == "/") {
+            result.failed++;
+            continue;
+        }
+
+        // Entries ProjFS never wrote to disk are served from the cache on next access
+        std::wstring relativePath = ToRelativePath(ToWide(virtualPath));
+        std::wstring fullPath = virtualRoot_ + L"\\" + relativePath;
+        PRJ_FILE_STATE fileState = {};
+        if (FAILED(PrjGetOnDiskFileState(fullPath.c_str(), &fileState))) {
+            result.notOnDisk++;
+            continue;
+        }
+        if (fileState & PRJ_FILE_STATE_TOMBSTONE) {
+            result.notOnDisk++;  // Deleted locally; InvalidateTombstone brings it back
+            continue;
+        }
+        if (fileState & (PRJ_FILE_STATE_DIRTY_PLACEHOLDER | PRJ_FILE_STATE_FULL)) {
+            result.local++;  // Written locally; the local copy wins until written back
+            continue;
+        }
+
+        HRESULT hr;
+        PRJ_UPDATE_FAILURE_CAUSES failure = PRJ_UPDATE_FAILURE_CAUSE_NONE;
+        PRJ_PLACEHOLDER_INFO placeholderInfo = {};
+        bool deleted = false;
+        if (cache_->IsMissing(virtualPath)) {
+            // Checked first: a parent listing not yet replaced may still name it
+            hr = PrjDeleteFile(virtualizationContext_, relativePath.c_str(), updateFlags, &failure);
+            deleted = true;
+        } else if (LookupCachedPlaceholder(virtualPath, placeholderInfo)) {
+            // A matching ContentID makes this a no-op inside ProjFS
+            hr = PrjUpdateFileIfNeeded(virtualizationContext_, relativePath.c_str(),
+                                       &placeholderInfo, sizeof(placeholderInfo), updateFlags, &failure);
+        } else {
+            PROJFS_DEBUG("[ProjFS] UpdatePaths: Nothing cached for " << virtualPath);
+            result.failed++;
+            continue;
+        }
+
+        if (FAILED(hr)) {
+            PROJFS_WARN("[ProjFS] UpdatePaths: Failed to refresh " << virtualPath << ": HRESULT 0x"
+                << std::hex << hr << std::dec << ", failure cause " << failure);
+            result.failed++;
+            continue;
+        }
+        stats_.pathUpdates++;
+        (deleted ? result.deleted : result.updated)++;
+    }
+
+    PROJFS_DEBUG("[ProjFS] UpdatePaths: " << result.updated << " updated, " << result.deleted << " deleted, "
+        << result.notOnDisk << " not on disk, " << result.local << " changed locally, " << result.failed << " failed");
+    return result;
+}
+
+ChangeResult ProjFSProvider::ApplyChanges(const std::vector<DirectoryDelta>& deltas) {
+    ChangeResult result;
+    if (!cache_) {
+        return result;
+    }
+
+    std::vector<std::string> touched;
+    for (const auto& delta : deltas) {
+        std::string parent = PathTable::Canonicalize(delta.path);
+        if (parent == "/objects") {
+            // New and removed objects keep the object index current
+            for (const auto& info : delta.upserts) {
+                ObjectIndex::Key key;
+                if (ObjectInfoTable::ParseKey(info.name, key)) {
+                    storage_->Objects().Insert(key);
+                }
+            }
+            for (const auto& name : delta.removals) {
+                ObjectIndex::Key key;
+                if (ObjectInfoTable::ParseKey(name, key)) {
+                    storage_->Objects().Remove(key);
+                }
+            }
+        }
+        if (!cache_->ApplyDirectoryDelta(delta)) {
+            result.uncached++;
+        } else {
+            result.patched++;
+            if (isRunning_) {
+                RefreshOpenEnumerations(cache_->Paths().Find(parent));
+            }
+        }
+
+        std::string prefix = parent == "/" ? parent : parent + "/";
+        for (const auto& info : delta.upserts) {
+            touched.push_back(prefix + info.name);
+        }
+        for (const auto& name : delta.removals) {
+            touched.push_back(prefix + name);
+        }
+    }
+
+    if (isRunning_) {
+        result.placeholders = UpdatePaths(touched);
+    }
+    PROJFS_DEBUG("[ProjFS] ApplyChanges: " << result.patched << " listings patched, " << result.uncached
+        << " not cached, " << touched.size() << " entries touched");
+    return result;
+}
+
+} // namespace oneifsprojfs
@@ -7,13 +7,23 @@
 #include <memory>
 #include <atomic>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 #include <vector>
 #include <condition_variable>
 #include <chrono>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <functional>
 #include "sync_storage.h"
 #include "async_bridge.h"
 #include "content_cache.h"
+#include "path_table.h"
+#include "prefetcher.h"
+#include "metadata_snapshot.h"
+#include "thread_pool.h"
+#include "callback_stats.h"
 
 namespace oneifsprojfs {
 
@@ -30,16 +40,98 @@ inline bool operator==(const GUID& a, const GUID& b) {
     return memcmp(&a, &b, sizeof(GUID)) == 0;
 }
 
-// Enumeration state tracking
+// Enumeration state tracking: a cursor over the shared, sorted listing. The
+// session's search expression is resolved to matching entries once.
 struct EnumerationState {
-    std::vector<FileInfo> entries;  // Store full FileInfo, not just names
-    size_t nextIndex = 0;
+    DirectoryListingPtr listing;
+    bool matchesResolved = false;
+    bool matchAll = false;          // "*": every entry, no index needed
+    std::vector<uint32_t> matches;  // Otherwise the matching entries, in listing order
+    size_t nextIndex = 0;           // Into matches, or into the listing when matchAll
     bool isLoading = false;  // Prevent duplicate fetches
     bool isComplete = false; // Mark when fetch is done
     int callCount = 0;       // Track calls to detect loops
+    PathId directory = kNoPath;  // Set once entries come from a cached listing
+    // /objects is walked in hash order from the object index instead; the
+    // cursor is the last hash handed out, so objects added meanwhile show up
+    bool objectCursorSet = false;
+    ObjectIndex::Key objectCursor{};
     static constexpr int MAX_CALLS_PER_ENUM = 100; // Safety limit
 };
 
+// Pending ERROR_IO_PENDING commands grouped by interned path. The command
+// index records each command's path id, so completing every waiter of a path
+// or cancelling one command never scans the table. Not locked; the owner
+// serializes access.
+template<typename T>
+class PendingCommandTable {
+public:
+    void Add(INT32 commandId, PathId path, T request) {
+        byPath_[path].emplace_back(commandId, std::move(request));
+        pathOf_[commandId] = path;
+    }
+
+    // Removes and returns every command waiting on the path
+    std::vector<std::pair<INT32, T>> Take(PathId path) {
+        std::vector<std::pair<INT32, T>> taken;
+        auto it = byPath_.find(path);
+        if (it == byPath_.end()) {
+            return taken;
+        }
+        taken = std::move(it->second);
+        byPath_.erase(it);
+        for (const auto& command : taken) {
+            pathOf_.erase(command.first);
+        }
+        return taken;
+    }
+
+    std::optional<T> Remove(INT32 commandId) {
+        auto found = pathOf_.find(commandId);
+        if (found == pathOf_.end()) {
+            return std::nullopt;
+        }
+        auto it = byPath_.find(found->second);
+        pathOf_.erase(found);
+
+        auto& commands = it->second;
+        for (auto command = commands.begin(); command != commands.end(); ++command) {
+            if (command->first == commandId) {
+                std::optional<T> request(std::move(command->second));
+                commands.erase(command);
+                if (commands.empty()) {
+                    byPath_.erase(it);
+                }
+                return request;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void Clear() {
+        pathOf_.clear();
+        byPath_.clear();
+    }
+
+    size_t Size() const { return pathOf_.size(); }
+    bool Waiting(PathId path) const { return byPath_.count(path) > 0; }
+
+private:
+    std::unordered_map<PathId, std::vector<std::pair<INT32, T>>> byPath_;
+    std::unordered_map<INT32, PathId> pathOf_;
+};
+
+struct StartOptions {
+    // Reuse the previous mount's instance ID and keep its placeholders and
+    // hydrated files, reconciling them against fresh listings instead of
+    // deleting everything under the root
+    bool preservePlaceholders = false;
+    // Let applications create, overwrite and delete files outside /objects;
+    // each change is written back through the JavaScript write callbacks once
+    // the handle closes. Renames, hard links and directories stay denied.
+    bool writable = false;
+};
+
 struct ProviderStats {
     std::atomic<uint64_t> placeholderRequests{0};
     std::atomic<uint64_t> fileDataRequests{0};
@@ -49,11 +141,52 @@ struct ProviderStats {
     std::atomic<uint64_t> bytesRead{0};
     std::atomic<uint64_t> cacheHits{0};
     std::atomic<uint64_t> cacheMisses{0};
+    std::atomic<uint64_t> directoryFetches{0};   // Enumerations that had to ask JavaScript
+    std::atomic<uint64_t> cancelledCommands{0};  // Pending commands cancelled by ProjFS
+    std::atomic<uint64_t> negativeCacheHits{0};  // Placeholder requests answered as known-missing
+    std::atomic<uint64_t> snapshotRestores{0};   // Listings restored from the metadata snapshot
+    std::atomic<uint64_t> snapshotSaves{0};
+    std::atomic<uint64_t> placeholdersKept{0};     // Preserved entries found unchanged
+    std::atomic<uint64_t> placeholdersUpdated{0};  // Preserved entries refreshed in place
+    std::atomic<uint64_t> placeholdersDeleted{0};  // Preserved entries gone from the namespace
+    std::atomic<uint64_t> placeholdersLocal{0};    // Preserved entries left alone: changed, created or deleted locally
+    std::atomic<uint64_t> pathUpdates{0};          // On-disk entries refreshed through UpdatePaths
+    std::atomic<uint64_t> streamedChunks{0};       // Chunks of large files read through readFileRange
+    std::atomic<uint64_t> writeBacks{0};           // Closed modified or deleted files queued for JavaScript
+    std::atomic<uint64_t> offloadedCommands{0};    // Commands completed from the native pool
+    std::atomic<uint64_t> indexedObjectEntries{0}; // /objects entries enumerated from the object index
+    std::atomic<uint64_t> blobReads{0};            // Files outside /objects read from storage by their BLOB/CLOB hash
+};
+
+// Commands that returned ERROR_IO_PENDING and are not completed yet
+struct PendingCommandCounts {
+    size_t placeholders = 0;  // Waiting on getFileInfo
+    size_t fileData = 0;      // Waiting on readFile
+    size_t streams = 0;       // Large files being read range by range
+    size_t enumerations = 0;  // Waiting on readDirectory
+    size_t offloaded = 0;     // Queued or running on the native pool
+};
+
+// Outcome of UpdatePaths, by path
+struct PathUpdateResult {
+    size_t updated = 0;    // Placeholder rewritten, or already carrying the current ContentID
+    size_t deleted = 0;    // Known missing and removed from disk
+    size_t notOnDisk = 0;  // Never hydrated; the next access reads the cache anyway
+    size_t local = 0;      // Modified or created locally (dirty or full); left alone
+    size_t failed = 0;     // Nothing cached for the path, or ProjFS refused the update
+};
+
+// Outcome of ApplyChanges
+struct ChangeResult {
+    size_t patched = 0;   // Cached listings updated in place
+    size_t uncached = 0;  // No listing cached; only entry FileInfo was stored
+    PathUpdateResult placeholders;
 };
 
 class ProjFSProvider {
 public:
-    ProjFSProvider(const std::string& instancePath);
+    // Work goes to the given pool, shared with other roots, or to one of its own
+    explicit ProjFSProvider(const std::string& instancePath, std::shared_ptr<ThreadPool> pool = nullptr);
     ~ProjFSProvider();
 
     // Set async bridge for metadata operations
@@ -61,21 +194,50 @@ public:
         asyncBridge_ = bridge; 
         if (bridge) {
             cache_ = bridge->GetCache();
+            cache_->SetNameOrder(&ProjFSProvider::CompareFileNames);
             
             // Set up callback to notify when directory listing is updated
             bridge->SetDirectoryListingUpdatedCallback(
                 [this](const std::string& path) { this->OnDirectoryListingUpdated(path); }
             );
+
+            // A changed listing may bring back names ProjFS remembers as missing,
+            // and supersedes whatever the metadata snapshot holds for it
+            cache_->SetListingChangedCallback(
+                [this](PathId directory, const DirectoryListingPtr& listing) {
+                    if (listing) {
+                        this->HoldFetchedListing(directory, listing);
+                    }
+                    this->ClearNegativePathCache();
+                    this->DiscardSnapshotListing(directory, listing);
+                    this->ReconcileDirectory(directory);
+                }
+            );
+
+            // Read-ahead stays idle until SetPrefetchOptions enables it
+            prefetcher_ = std::make_shared<Prefetcher>(bridge, pool_, [this] { return this->HasPendingCommands(); });
         }
     }
+
+    // Configure read-ahead after enumerations; requires the async bridge
+    void SetPrefetchOptions(const PrefetchOptions& options) {
+        if (prefetcher_) {
+            prefetcher_->Configure(options);
+        }
+    }
+    std::shared_ptr<Prefetcher> GetPrefetcher() const { return prefetcher_; }
+    std::shared_ptr<ThreadPool> GetThreadPool() const { return pool_; }
+    ObjectInfoTable::Stats GetObjectInfoStats() const { return storage_->GetObjectInfoStats(); }
     
     // Start/stop virtualization
-    bool Start(const std::string& virtualRoot);
+    bool Start(const std::string& virtualRoot, const StartOptions& options = StartOptions());
     void Stop();
     bool IsRunning() const;
     
     // Get statistics
     const ProviderStats& GetStats() const { return stats_; }
+    CallbackStats::Snapshot GetCallbackStats() const { return callbackStats_.GetSnapshot(); }
+    PendingCommandCounts GetPendingCommandCounts() const;
     
     // Get last error
     std::string GetLastError() const { return lastError_; }
@@ -86,6 +248,18 @@ public:
     // Invalidate Windows tombstone cache for a deleted file so it can reappear
     bool InvalidateTombstone(const std::string& virtualPath);
 
+    // Refreshes the on-disk copies of paths whose FileInfo was just stored in
+    // the cache. Placeholders carry the ONE hash as their ContentID, so ProjFS
+    // leaves entries whose hash is unchanged alone; paths cached as missing are
+    // deleted. Replaces invalidating whole directories when a few entries change.
+    PathUpdateResult UpdatePaths(const std::vector<std::string>& virtualPaths);
+
+    // Applies per-directory deltas from ONE's change feed at the cost of the
+    // delta: cached listings are patched in place, on-disk copies of touched
+    // entries go through UpdatePaths, and enumerations of a patched directory
+    // that have not handed out entries yet see the new listing.
+    ChangeResult ApplyChanges(const std::vector<DirectoryDelta>& deltas);
+
 private:
     // ProjFS callbacks
     static HRESULT CALLBACK GetPlaceholderInfoCallback(const PRJ_CALLBACK_DATA* callbackData);
@@ -101,6 +275,22 @@ private:
                                                             PRJ_DIR_ENTRY_BUFFER_HANDLE dirEntryBufferHandle);
     static HRESULT CALLBACK EndDirectoryEnumerationCallback(const PRJ_CALLBACK_DATA* callbackData,
                                                            const GUID* enumerationId);
+    static void CALLBACK CancelCommandCallback(const PRJ_CALLBACK_DATA* callbackData);
+
+    // Registered in place of each callback above: times it into callbackStats_
+    // and the trace, by whether it was answered from the cache, without it, or
+    // left pending
+    template <CallbackKind Kind, auto Callback, typename... Args>
+    static HRESULT CALLBACK Timed(const PRJ_CALLBACK_DATA* callbackData, Args... args);
+    // Set by whatever answers the callback running on this thread from the cache
+    static thread_local bool answeredFromCache_;
+    void CountCacheHit() {
+        stats_.cacheHits++;
+        answeredFromCache_ = true;
+    }
+    // A pending command was completed startedAt after it was parked
+    void RecordCompletion(CallbackKind kind, INT32 commandId, HRESULT hr,
+                          std::chrono::steady_clock::time_point startedAt);
     
     // Notification callbacks
     static HRESULT CALLBACK NotificationCallback(const PRJ_CALLBACK_DATA* callbackData,
@@ -108,52 +298,246 @@ private:
                                                 PRJ_NOTIFICATION notification,
                                                 PCWSTR destinationFileName,
                                                 PRJ_NOTIFICATION_PARAMETERS* operationParameters);
+    // Whether a writable mount lets this modification through
+    bool AllowsWrite(std::string_view virtualPath, BOOLEAN isDirectory) const;
+    // Reads a modified file back from the virtualization root and queues it
+    void WriteBack(const PRJ_CALLBACK_DATA* callbackData, std::string_view virtualPath, bool deleted);
+    // The bytes of a modified file under the root, or nullptr if it cannot be read.
+    // Static, as the write-back worker may call it again after the provider is gone.
+    static AsyncBridge::WritePayload ReadBack(const std::wstring& diskPath, const std::string& path);
 
     // Helper methods
-    std::wstring ToWide(const std::string& str);
-    std::string ToUtf8(const std::wstring& wstr);
+    static std::wstring ToWide(const std::string& str);
+    static std::string ToUtf8(const std::wstring& wstr);
     PRJ_FILE_BASIC_INFO CreateFileBasicInfo(const ObjectMetadata& metadata);
+    // Basic info plus version info: the ONE hash as ContentID
+    void FillPlaceholderInfo(const FileInfo& info, PRJ_PLACEHOLDER_INFO& placeholderInfo);
+    // Writes [byteOffset, byteOffset + length) of the file from content, which
+    // holds the file's bytes starting at contentStart
+    HRESULT WriteContentRange(PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context,
+                              const GUID& dataStreamId,
+                              const FileContent& content,
+                              UINT64 contentStart,
+                              UINT64 byteOffset,
+                              UINT32 length,
+                              size_t* bytesWritten);
+    bool LookupCachedPlaceholder(std::string_view virtualPath, PRJ_PLACEHOLDER_INFO& placeholderInfo);
+    // The FileInfo behind LookupCachedPlaceholder
+    bool LookupCachedEntry(std::string_view virtualPath, FileInfo& info);
+    HRESULT FillDirEntryBuffer(EnumerationState& enumState,
+                               const std::wstring& searchPattern,
+                               PRJ_DIR_ENTRY_BUFFER_HANDLE dirEntryBufferHandle,
+                               std::string_view virtualPath);
+    // Enumerates /objects from storage's object index, resuming after the cursor
+    HRESULT FillObjectEntries(EnumerationState& enumState,
+                              const std::wstring& searchExpression,
+                              PRJ_DIR_ENTRY_BUFFER_HANDLE dirEntryBufferHandle);
+    // Literal expressions are answered by binary search, wildcards by one pass
+    void ResolveMatches(EnumerationState& enumState, const std::wstring& searchExpression);
+    // The order ProjFS expects enumerations in, for the cache's listings
+    static int CompareFileNames(std::string_view a, std::string_view b);
     void OnDirectoryListingUpdated(const std::string& path);
+
+    // Answers a placeholder request with ERROR_FILE_NOT_FOUND, which ProjFS
+    // remembers in its negative path cache until ClearNegativePathCache
+    HRESULT ReportPathNotFound();
+    void ClearNegativePathCache();
+
+    // Complete commands that returned ERROR_IO_PENDING once JavaScript has answered
+    void CompletePendingPlaceholderRequests(PathId path, bool resolved);
+    void CompletePendingEnumerations(PathId path, bool resolved);
+    // Keeps a just stored listing for the enumerations waiting on it, so they
+    // are answered even when the listing was too large for the cache to keep
+    void HoldFetchedListing(PathId path, const DirectoryListingPtr& listing);
+    // Hands a patched listing to open enumerations that have not filled yet
+    void RefreshOpenEnumerations(PathId directory);
+
+    // True while any command is waiting on JavaScript; read-ahead yields to them
+    bool HasPendingCommands() const;
+
+    // Metadata snapshot in the instance directory: opened at Start, consulted
+    // on directory listing misses, rewritten periodically and at Stop
+    std::filesystem::path SnapshotPath() const;
+    void OpenMetadataSnapshot();
+    bool RestoreFromSnapshot(std::string_view directoryPath);
+    // listing is set when a whole listing was cached, which is then known to
+    // match the current heads
+    void DiscardSnapshotListing(PathId directory, const DirectoryListingPtr& listing);
+    void SaveMetadataSnapshot(bool reopen);
+    // Periodic save, a background pool task that queues its next run
+    void ScheduleSnapshotSave(uint64_t generation);
+    void RunSnapshotSave(uint64_t generation);
+
+    // Preserved placeholders. The instance ID lives next to the snapshot; entries
+    // found on disk at Start wait in reconcile_ until their directory's listing
+    // is known, then are kept, updated or deleted by comparing against what the
+    // previous mount served (from its snapshot)
+    std::filesystem::path InstanceIdPath() const;
+    bool LoadInstanceId();
+    void SaveInstanceId();
+    void RemoveHydratedContent();
+    void CollectOnDiskEntries();
+    void BeginReconcile();
+    void ReconcileDirectory(PathId directory);
+    bool DeletePreserved(PathId path, bool isDirectory);
+    // Whether the entry on disk holds what only this machine has: a file
+    // written or created locally (dirty or full), or a local deletion. Such
+    // entries are never updated or deleted from the namespace.
+    bool HasLocalChanges(const std::wstring& relativePath) const;
     
     // Member variables
     std::unique_ptr<SyncStorage> storage_;  // For direct BLOB/CLOB access
     std::shared_ptr<AsyncBridge> asyncBridge_;  // For metadata and structure
     std::shared_ptr<ContentCache> cache_;  // Shared cache
+    std::shared_ptr<ThreadPool> pool_;  // Disk reads, sniffing, read-ahead and snapshot saves
+    std::unique_ptr<TaskGroup> tasks_;  // This provider's tasks on the pool
+    std::atomic<bool> objectScanCancelled_{false};  // Ends the scan and watch of /objects at Stop
+    std::thread objectWatcher_;  // Scans /objects, then follows its changes
+    std::shared_ptr<Prefetcher> prefetcher_;  // Read-ahead after enumerations
     std::wstring virtualRoot_;
     PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT virtualizationContext_;
     GUID virtualizationInstanceId_;
+    UINT32 writeAlignment_;  // Required alignment of PrjWriteFileData buffers
     bool isRunning_;
+    bool writable_ = false;
+    std::mutex createdFilesMutex_;
+    std::unordered_set<std::string> createdFiles_;  // Created in this mount and not yet written back
+    LARGE_INTEGER mountTime_ = {};  // Stands in for timestamps JavaScript did not provide
+    std::atomic<bool> negativePathCacheDirty_{false};  // ProjFS may hold negative entries
     
     // Statistics
     mutable ProviderStats stats_;
+    CallbackStats callbackStats_;
     std::string lastError_;
+
+    // Runs work on the native pool and completes the command with its result,
+    // unless ProjFS cancelled it meanwhile. Work returning ERROR_IO_PENDING
+    // has handed the command on and completes it elsewhere. Returns false if
+    // nothing was queued; the caller then answers inline.
+    bool OffloadCommand(CallbackKind kind, const PRJ_CALLBACK_DATA* callbackData, std::function<HRESULT()> work);
+    // When each was handed to the pool; under pendingRequestsMutex_
+    std::unordered_map<INT32, std::chrono::steady_clock::time_point> offloadedCommands_;
+    // Takes an offloaded command over for parking; false if it was cancelled
+    bool TakeOffloadedCommand(INT32 commandId, std::chrono::steady_clock::time_point& startedAt);
+
+    // Streams [byteOffset, byteOffset + length) of an /objects path from disk;
+    // found is false if the path is not known to storage
+    HRESULT WriteObjectRange(PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context, const GUID& dataStreamId,
+                             const std::string& objectPath, UINT64 byteOffset, UINT32 length, bool& found);
+    // Writes the placeholder for an /objects path from storage metadata, or
+    // hands the command to JavaScript when storage does not know the path
+    HRESULT WriteObjectPlaceholder(INT32 commandId, PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context,
+                                   const std::wstring& filePathName, const std::string& virtualPath);
+    // Parks a placeholder command until getFileInfo answers; fromPool takes
+    // it over from offloadedCommands_ in the same step. False if not parked.
+    bool QueuePlaceholderFetch(INT32 commandId, PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context,
+                               const std::wstring& filePathName, std::string_view virtualPath, bool fromPool);
+    // The same for a file data command waiting on getFileContent
+    bool QueueFileFetch(INT32 commandId, PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context, const GUID& dataStreamId,
+                        std::string_view virtualPath, UINT64 byteOffset, UINT32 length, bool fromPool);
+    // Serves every file data command parked on path from the cache, or fails
+    // them when the read did not resolve or left nothing cached
+    void CompletePendingFileRequests(PathId path, bool resolved);
+
+    // Upper bound for a single PrjWriteFileData call when streaming objects from disk
+    static constexpr size_t kObjectReadChunkSize = 1024 * 1024;
+    // Read size when reading modified files back for write-back
+    static constexpr size_t kWriteBackReadChunkSize = 256 * 1024;
+
+    // Metadata snapshot state
+    static constexpr std::chrono::minutes kSnapshotInterval{5};
+    std::mutex snapshotMutex_;
+    std::shared_ptr<MetadataSnapshot> snapshot_;
+    bool snapshotSaving_ = false;                // Discards are queued while the file is rewritten
+    std::vector<std::string> snapshotDiscards_;
+    std::atomic<uint64_t> listingChanges_{0};    // Skips periodic saves when nothing changed
+    std::condition_variable snapshotCv_;
+    uint64_t snapshotGeneration_ = 0;            // Bumped at Stop; older periodic saves do nothing
+    bool snapshotSaveActive_ = false;            // A periodic save is running
+    uint64_t savedListingChanges_ = 0;
+    // Directories whose cached listing was fetched under headsFingerprint_; a
+    // save that finds other heads starts the set over, so listings cached
+    // before the heads moved are never stamped with the new fingerprint
+    uint64_t headsFingerprint_ = 0;
+    std::unordered_set<PathId> currentListings_;
+
+    // Reconciliation of preserved placeholders
+    struct OnDiskEntry {
+        std::string name;
+        bool isDirectory;
+        std::optional<FileInfo> served;  // As of the previous mount, if known
+    };
+    std::mutex reconcileMutex_;
+    std::unordered_map<PathId, std::vector<OnDiskEntry>> reconcile_;
+    std::atomic<bool> reconcilePending_{false};
+    std::thread reconcileFetcher_;  // Asks JavaScript for the listings reconcile_ waits on
     
     // Enumeration state tracking
     mutable std::mutex enumerationMutex_;
     mutable std::unordered_map<GUID, EnumerationState, GuidHash> enumerationStates_;
     mutable std::condition_variable enumerationCv_;
     
-    // Global directory cache to prevent concurrent fetch issues
-    struct DirectoryCache {
-        std::vector<std::string> entries;
-        std::chrono::steady_clock::time_point lastFetch;
-        bool isFetching = false;
-        std::condition_variable fetchCv;
-    };
-    mutable std::mutex directoryCacheMutex_;
-    mutable std::unordered_map<std::string, DirectoryCache> directoryCache_;
-    static constexpr std::chrono::milliseconds CACHE_VALIDITY_MS{5000}; // 5 seconds
-
     // Track pending GetFileData commands for ERROR_IO_PENDING completion
     struct PendingFileRequest {
-        std::string virtualPath;
         UINT64 byteOffset;
         UINT32 length;
         PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT virtualizationContext;
         GUID dataStreamId;  // Store the GUID value itself, not a pointer
+        std::chrono::steady_clock::time_point startedAt;
     };
     mutable std::mutex pendingRequestsMutex_;
-    mutable std::unordered_map<INT32, PendingFileRequest> pendingFileRequests_;
+    mutable PendingCommandTable<PendingFileRequest> pendingFileRequests_;
+
+    // GetFileData commands for files larger than the content tier, served from
+    // ranged reads. A few chunks are asked for at a time and each is written
+    // as it arrives, so memory stays flat whatever the file size.
+    struct StreamedFileRequest {
+        std::mutex mutex;
+        INT32 commandId = 0;
+        PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT virtualizationContext = nullptr;
+        GUID dataStreamId = {};
+        PathId path = kNoPath;
+        std::string virtualPath;
+        std::string hash;
+        UINT64 fileSize = 0;       // As listed; every chunk but the last is whole
+        UINT64 begin = 0;          // Requested range, clipped to the file size
+        UINT64 end = 0;
+        uint32_t nextChunk = 0;    // Next chunk to write or ask for
+        uint32_t endChunk = 0;     // One past the last chunk of the range
+        size_t inflight = 0;       // Chunks asked for and not yet arrived
+        HRESULT result = S_OK;
+        bool finished = false;     // Completed or cancelled; nothing more is written
+        std::chrono::steady_clock::time_point startedAt;
+    };
+    static constexpr size_t kStreamWindow = 4;  // Chunks asked for at once per command
+    std::unordered_map<INT32, std::shared_ptr<StreamedFileRequest>> streamedFileRequests_;  // Under pendingRequestsMutex_
+    HRESULT StreamFileData(const PRJ_CALLBACK_DATA* callbackData, UINT64 byteOffset, UINT32 length,
+                           PathId path, const FileInfo& info);
+    // Writes cached chunks and asks for missing ones up to the window; completes
+    // the command once the range is written or a chunk failed
+    void PumpStream(const std::shared_ptr<StreamedFileRequest>& stream);
+    void OnStreamChunk(const std::shared_ptr<StreamedFileRequest>& stream, uint32_t index, FileContentPtr chunk);
+    // Fails with ERROR_HANDLE_EOF if the chunk ends before the range it should cover
+    HRESULT WriteStreamChunk(StreamedFileRequest& stream, uint32_t index, const FileContent& chunk);
+
+    // Track pending GetPlaceholderInfo commands waiting for getFileInfo
+    struct PendingPlaceholderRequest {
+        std::wstring filePathName;  // Destination for PrjWritePlaceholderInfo
+        PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT virtualizationContext;
+        std::chrono::steady_clock::time_point startedAt;
+    };
+    mutable PendingCommandTable<PendingPlaceholderRequest> pendingPlaceholderRequests_;
+
+    // Track pending GetDirectoryEnumeration commands waiting for readDirectory
+    struct PendingEnumeration {
+        GUID enumerationId;
+        std::wstring searchExpression;
+        PRJ_DIR_ENTRY_BUFFER_HANDLE dirEntryBufferHandle;  // Stays valid until the command completes
+        PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT virtualizationContext;
+        std::chrono::steady_clock::time_point startedAt;
+    };
+    mutable PendingCommandTable<PendingEnumeration> pendingEnumerations_;
+    std::unordered_map<PathId, DirectoryListingPtr> fetchedListings_;  // Only for paths with pending enumerations
 };
 
 } // namespace oneifsprojfs
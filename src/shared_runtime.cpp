@@ -0,0 +1,108 @@
+#include "shared_runtime.h"
+#include <algorithm>
+#include "log.h"
+
+namespace oneifsprojfs {
+
+namespace {
+
+// One tier's share for each root without a budget of its own
+size_t ShareOf(size_t total, size_t claimed, size_t sharing, size_t roots) {
+    size_t remaining = total > claimed ? total - claimed : 0;
+    return (std::max)(remaining / sharing, total / roots);
+}
+
+} // namespace
+
+SharedRuntime::SharedRuntime()
+    : pool_(std::make_shared<ThreadPool>()), contents_(std::make_shared<ContentStore>()) {}
+
+SharedRuntime::~SharedRuntime() {
+    // Every root has closed its task group by now
+    pool_->Stop();
+}
+
+void SharedRuntime::Attach(const std::shared_ptr<ContentCache>& cache) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    roots_.push_back({cache.get(), cache});
+    RebalanceLocked();
+    PROJFS_DEBUG("[Runtime] Root attached; " << roots_.size() << " roots share the cache budget");
+}
+
+void SharedRuntime::Detach(const ContentCache* cache) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    roots_.erase(std::remove_if(roots_.begin(), roots_.end(),
+                                [cache](const Root& root) { return root.key == cache; }),
+                 roots_.end());
+    RebalanceLocked();
+}
+
+void SharedRuntime::SetBudget(const CacheBudget& budget) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = budget;
+    RebalanceLocked();
+}
+
+CacheBudget SharedRuntime::GetBudget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+void SharedRuntime::SetRootBudget(const ContentCache* cache, const CacheBudget& budget) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& root : roots_) {
+        if (root.key == cache) {
+            if (auto attached = root.cache.lock()) {
+                attached->SetBudget(budget);
+                root.ownBudget = true;
+            }
+        }
+    }
+    RebalanceLocked();
+}
+
+void SharedRuntime::RebalanceLocked() {
+    CacheBudget claimed{0, 0, 0, 0};
+    std::vector<std::shared_ptr<ContentCache>> sharing;
+    for (const auto& root : roots_) {
+        auto cache = root.cache.lock();
+        if (!cache) {
+            continue;
+        }
+        if (root.ownBudget) {
+            CacheBudget own = cache->GetBudget();
+            claimed.fileInfoBytes += own.fileInfoBytes;
+            claimed.directoryBytes += own.directoryBytes;
+            claimed.contentBytes += own.contentBytes;
+            claimed.chunkBytes += own.chunkBytes;
+        } else {
+            sharing.push_back(std::move(cache));
+        }
+    }
+    if (sharing.empty()) {
+        return;
+    }
+
+    size_t roots = roots_.size();
+    CacheBudget share;
+    share.fileInfoBytes = ShareOf(budget_.fileInfoBytes, claimed.fileInfoBytes, sharing.size(), roots);
+    share.directoryBytes = ShareOf(budget_.directoryBytes, claimed.directoryBytes, sharing.size(), roots);
+    share.contentBytes = ShareOf(budget_.contentBytes, claimed.contentBytes, sharing.size(), roots);
+    share.chunkBytes = ShareOf(budget_.chunkBytes, claimed.chunkBytes, sharing.size(), roots);
+    for (const auto& cache : sharing) {
+        cache->SetBudget(share);
+    }
+}
+
+SharedRuntime::Stats SharedRuntime::GetStats() const {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.roots = roots_.size();
+        stats.budget = budget_;
+    }
+    stats.contents = contents_->GetStats();
+    return stats;
+}
+
+} // namespace oneifsprojfs
@@ -0,0 +1,68 @@
+#ifndef SHARED_RUNTIME_H
+#define SHARED_RUNTIME_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "content_cache.h"
+#include "content_store.h"
+#include "thread_pool.h"
+
+namespace oneifsprojfs {
+
+// What every root virtualized by one module instance shares: the worker pool,
+// the content store that deduplicates cached content across roots, and one
+// cache budget. Each root keeps its own cache, path table and JavaScript
+// callbacks; the budget is split evenly among the roots that have not set
+// their own, and re-split whenever a root comes or goes.
+class SharedRuntime {
+public:
+    SharedRuntime();
+    ~SharedRuntime();
+
+    SharedRuntime(const SharedRuntime&) = delete;
+    SharedRuntime& operator=(const SharedRuntime&) = delete;
+
+    const std::shared_ptr<ThreadPool>& Pool() const { return pool_; }
+    const std::shared_ptr<ContentStore>& Contents() const { return contents_; }
+
+    // A root's cache takes part in the shared budget from Attach until Detach
+    void Attach(const std::shared_ptr<ContentCache>& cache);
+    void Detach(const ContentCache* cache);
+
+    // The budget all roots share; defaults to what a single root has alone
+    void SetBudget(const CacheBudget& budget);
+    CacheBudget GetBudget() const;
+    // Takes a root out of the split with a budget of its own. The others share
+    // what is left, but never less than an even split of the whole.
+    void SetRootBudget(const ContentCache* cache, const CacheBudget& budget);
+
+    struct Stats {
+        size_t roots = 0;
+        CacheBudget budget;
+        ContentStore::Stats contents;
+    };
+    Stats GetStats() const;
+
+private:
+    struct Root {
+        const ContentCache* key;
+        std::weak_ptr<ContentCache> cache;
+        bool ownBudget = false;
+    };
+
+    // Hands every root its share; called with mutex_ held
+    void RebalanceLocked();
+
+    std::shared_ptr<ThreadPool> pool_;
+    std::shared_ptr<ContentStore> contents_;
+
+    mutable std::mutex mutex_;
+    std::vector<Root> roots_;
+    CacheBudget budget_;
+};
+
+} // namespace oneifsprojfs
+
+#endif // SHARED_RUNTIME_H
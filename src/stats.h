@@ -0,0 +1,165 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace oneifsprojfs {
+
+constexpr size_t kCacheLineSize = 64;
+
+// Counter split across cache-line-padded stripes. Each thread increments the
+// stripe picked by its thread id, so concurrent writers do not bounce a
+// shared cache line; Load() sums all stripes and is only approximate while
+// writers are active.
+class StripedCounter {
+public:
+    static constexpr size_t kStripeCount = 16;
+
+    void Add(uint64_t value = 1) {
+        stripes_[StripeIndex()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t Load() const {
+        uint64_t total = 0;
+        for (const auto& stripe : stripes_) {
+            total += stripe.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(kCacheLineSize) Stripe {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static size_t StripeIndex() {
+        thread_local const size_t index =
+            std::hash<std::thread::id>()(std::this_thread::get_id()) % kStripeCount;
+        return index;
+    }
+
+    std::array<Stripe, kStripeCount> stripes_;
+};
+
+// Lock-free latency histogram with log-linear nanosecond buckets, laid out as
+// HDR histograms are: values below kSubBuckets get a bucket each, and each
+// power of two above is split into kSubBuckets equal parts, so a percentile
+// is within 1/kSubBuckets (12.5%) of the true value. The last bucket is
+// open-ended. Cheap enough to record on every callback and cache lookup.
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBucketBits = 3;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static constexpr size_t kMaxExponent = 40;  // Up to ~18 minutes
+    static constexpr size_t kBucketCount = (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        std::array<uint64_t, kBucketCount> buckets{};
+
+        // Upper bound of the bucket holding the given percentile (0-100)
+        uint64_t PercentileNs(double percentile) const {
+            if (count == 0) return 0;
+            uint64_t threshold = static_cast<uint64_t>(count * (percentile / 100.0));
+            if (threshold >= count) threshold = count - 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBucketCount; i++) {
+                seen += buckets[i];
+                if (seen > threshold) {
+                    uint64_t upper = UpperBoundNs(i);
+                    return upper < maxNs ? upper : maxNs;
+                }
+            }
+            return maxNs;
+        }
+
+        uint64_t MeanNs() const { return count ? totalNs / count : 0; }
+    };
+
+    void Record(std::chrono::nanoseconds elapsed) {
+        uint64_t ns = elapsed.count() > 0 ? static_cast<uint64_t>(elapsed.count()) : 0;
+        buckets_[BucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+        totalNs_.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t currentMax = maxNs_.load(std::memory_order_relaxed);
+        while (ns > currentMax && !maxNs_.compare_exchange_weak(currentMax, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    Snapshot GetSnapshot() const {
+        Snapshot snapshot;
+        for (size_t i = 0; i < kBucketCount; i++) {
+            snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+            snapshot.count += snapshot.buckets[i];
+        }
+        snapshot.totalNs = totalNs_.load(std::memory_order_relaxed);
+        snapshot.maxNs = maxNs_.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    // One past the largest value bucket i holds
+    static uint64_t UpperBoundNs(size_t bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket + 1;
+        }
+        size_t shift = bucket / kSubBuckets - 1;
+        uint64_t lower = static_cast<uint64_t>(kSubBuckets + bucket % kSubBuckets) << shift;
+        return lower + (uint64_t(1) << shift);
+    }
+
+private:
+    static size_t BucketFor(uint64_t ns) {
+        if (ns < kSubBuckets) {
+            return static_cast<size_t>(ns);
+        }
+        size_t exponent = HighestBit(ns);
+        if (exponent >= kMaxExponent) {
+            return kBucketCount - 1;
+        }
+        size_t shift = exponent - kSubBucketBits;
+        return (shift + 1) * kSubBuckets + static_cast<size_t>((ns >> shift) - kSubBuckets);
+    }
+
+    static size_t HighestBit(uint64_t value) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        return 63 - static_cast<size_t>(__builtin_clzll(value));
+#endif
+    }
+
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+    alignas(kCacheLineSize) std::atomic<uint64_t> totalNs_{0};
+    std::atomic<uint64_t> maxNs_{0};
+};
+
+// Measures the lifetime of the scope into a histogram
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() { histogram_.Record(std::chrono::steady_clock::now() - start_); }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace oneifsprojfs
+
+#endif // STATS_H
@@ -1,12 +1,141 @@
 #include "sync_storage.h"
+#include "object_scan.h"
 #include <fstream>
 #include <sstream>
-#include <regex>
 #include <sys/stat.h>
 #include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace oneifsprojfs {
 
+namespace {
+
+const std::string kPrettyPrefix = "<html><body><pre>";
+const std::string kPrettySuffix = "</pre></body></html>";
+
+bool EndsWith(const std::string& value, const char* suffix) {
+    size_t length = strlen(suffix);
+    return value.size() >= length && value.compare(value.size() - length, length, suffix) == 0;
+}
+
+#ifdef _WIN32
+// The object watch wakes this often to see whether it was cancelled
+constexpr DWORD kWatchPollMs = 100;
+constexpr size_t kWatchBufferBytes = 64 * 1024;
+#endif
+
+// Copies the part of a generated view that overlaps [offset, offset + length)
+size_t CopyRange(const std::string& source, uint64_t offset, uint8_t* dest, size_t length) {
+    if (offset >= source.size()) {
+        return 0;
+    }
+    size_t count = (std::min)(length, source.size() - static_cast<size_t>(offset));
+    memcpy(dest, source.data() + offset, count);
+    return count;
+}
+
+} // namespace
+
+// Read-only handle to one object file, safe for concurrent positional reads
+class SyncStorage::ObjectFile {
+public:
+    static std::shared_ptr<ObjectFile> Open(const std::filesystem::path& path) {
+#ifdef _WIN32
+        // Share delete/write so pooled handles never block ONE's own file operations
+        HANDLE handle = CreateFileW(path.wstring().c_str(), GENERIC_READ,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                    nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(handle, &size)) {
+            CloseHandle(handle);
+            return nullptr;
+        }
+        return std::shared_ptr<ObjectFile>(new ObjectFile(handle, static_cast<uint64_t>(size.QuadPart)));
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return nullptr;
+        }
+        return std::shared_ptr<ObjectFile>(new ObjectFile(fd, static_cast<uint64_t>(st.st_size)));
+#endif
+    }
+
+    ~ObjectFile() {
+#ifdef _WIN32
+        CloseHandle(handle_);
+#else
+        close(fd_);
+#endif
+    }
+
+    uint64_t Size() const { return size_; }
+
+    std::optional<size_t> ReadAt(uint64_t offset, uint8_t* dest, size_t length) const {
+        if (offset >= size_) {
+            return 0;
+        }
+        length = static_cast<size_t>((std::min)(static_cast<uint64_t>(length), size_ - offset));
+
+        size_t total = 0;
+        while (total < length) {
+#ifdef _WIN32
+            // An OVERLAPPED offset on a synchronous handle is a positional read that
+            // leaves no shared file pointer behind, so concurrent readers are safe
+            OVERLAPPED overlapped = {};
+            uint64_t position = offset + total;
+            overlapped.Offset = static_cast<DWORD>(position & 0xFFFFFFFF);
+            overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+            DWORD chunk = static_cast<DWORD>((std::min)(length - total, static_cast<size_t>(1) << 30));
+            DWORD read = 0;
+            if (!ReadFile(handle_, dest + total, chunk, &read, &overlapped)) {
+                if (GetLastError() == ERROR_HANDLE_EOF) {
+                    break;
+                }
+                return std::nullopt;
+            }
+#else
+            ssize_t read = pread(fd_, dest + total, length - total, static_cast<off_t>(offset + total));
+            if (read < 0) {
+                return std::nullopt;
+            }
+#endif
+            if (read == 0) {
+                break;
+            }
+            total += static_cast<size_t>(read);
+        }
+        return total;
+    }
+
+private:
+#ifdef _WIN32
+    ObjectFile(HANDLE handle, uint64_t size) : handle_(handle), size_(size) {}
+    HANDLE handle_;
+#else
+    ObjectFile(int fd, uint64_t size) : fd_(fd), size_(size) {}
+    int fd_;
+#endif
+    uint64_t size_;
+};
+
 SyncStorage::SyncStorage(const std::string& instancePath) 
     : instancePath_(instancePath),
       objectsPath_(instancePath_ / "objects"),
@@ -96,8 +225,91 @@ std::optional<std::string> SyncStorage::ReadObjectSection(const std::string& has
     }
 }
 
+std::shared_ptr<SyncStorage::ObjectFile> SyncStorage::AcquireObjectFile(const std::string& hash) {
+    {
+        std::lock_guard<std::mutex> lock(openObjectsMutex_);
+        for (auto it = openObjects_.begin(); it != openObjects_.end(); ++it) {
+            if (it->first == hash) {
+                openObjects_.splice(openObjects_.begin(), openObjects_, it);
+                return it->second;
+            }
+        }
+    }
+
+    // Open outside the lock; a racing opener for the same hash just wastes one handle
+    auto file = ObjectFile::Open(objectsPath_ / hash);
+    if (!file) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(openObjectsMutex_);
+    openObjects_.emplace_front(hash, file);
+    if (openObjects_.size() > kMaxOpenObjects) {
+        // Readers still holding the evicted handle keep it alive until they finish
+        openObjects_.pop_back();
+    }
+    return file;
+}
+
+std::optional<size_t> SyncStorage::ReadObjectRange(const std::string& hash, uint64_t offset,
+                                                   uint8_t* dest, size_t length) {
+    auto file = AcquireObjectFile(hash);
+    if (!file) {
+        return std::nullopt;
+    }
+    return file->ReadAt(offset, dest, length);
+}
+
+uint64_t SyncStorage::VersionHeadsFingerprint() const {
+    struct Head {
+        std::string name;
+        uintmax_t size;
+        int64_t modified;
+    };
+    std::vector<Head> heads;
+    try {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(vheadsPath_)) {
+            if (entry.is_regular_file()) {
+                heads.push_back({
+                    std::filesystem::relative(entry.path(), vheadsPath_).generic_string(),
+                    entry.file_size(),
+                    static_cast<int64_t>(entry.last_write_time().time_since_epoch().count())
+                });
+            }
+        }
+    } catch (...) {
+        return 0;
+    }
+
+    // Directory order is not stable; FNV-1a over the sorted heads is
+    std::sort(heads.begin(), heads.end(), [](const Head& a, const Head& b) { return a.name < b.name; });
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t length) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    for (const auto& head : heads) {
+        mix(head.name.data(), head.name.size() + 1);
+        mix(&head.size, sizeof(head.size));
+        mix(&head.modified, sizeof(head.modified));
+    }
+    return hash == 0 ? 1 : hash;
+}
+
 std::vector<std::string> SyncStorage::ListObjects() {
     std::vector<std::string> objects;
+    if (objectIndex_.Ready()) {
+        ObjectIndex::Snapshot snapshot = objectIndex_.Take();
+        objects.reserve(snapshot.Size());
+        ObjectIndex::Snapshot::Cursor cursor = snapshot.After(nullptr);
+        ObjectIndex::Key key;
+        while (snapshot.Next(cursor, key)) {
+            objects.push_back(ObjectIndex::Name(key));
+        }
+        return objects;
+    }
     try {
         for (const auto& entry : std::filesystem::directory_iterator(objectsPath_)) {
             // Include both files AND directories (hash directories)
@@ -135,67 +347,195 @@ std::vector<std::string> SyncStorage::ListDirectory(const std::string& virtualPa
 }
 
 ObjectMetadata SyncStorage::GetObjectMetadata(const std::string& hash) {
+    ObjectMetadata metadata;
+    metadata.isDirectory = false;
+
     // Check cache first
-    auto cached = metadataCache_.find(hash);
-    if (cached != metadataCache_.end()) {
-        return cached->second;
+    ObjectInfoTable::Key key;
+    bool keyed = ObjectInfoTable::ParseKey(hash, key);
+    ObjectInfoTable::Info info;
+    if (keyed && objectInfo_.Find(key, info) && info.hasSize) {
+        metadata.exists = true;
+        metadata.size = static_cast<size_t>(info.size);
+        metadata.type = info.type != ObjectInfoTable::kNoType ? objectInfo_.TypeName(info.type) : GetObjectType(hash);
+        return metadata;
     }
     
-    ObjectMetadata metadata;
     std::filesystem::path objectPath = objectsPath_ / hash;
     
     try {
         if (std::filesystem::exists(objectPath)) {
             metadata.exists = true;
             metadata.size = std::filesystem::file_size(objectPath);
-            metadata.isDirectory = false;
             metadata.type = GetObjectType(hash);
         } else {
             metadata.exists = false;
             metadata.size = 0;
-            metadata.isDirectory = false;
             metadata.type = "UNKNOWN";
         }
     } catch (...) {
         metadata.exists = false;
+        metadata.size = 0;
     }
     
     // Cache the result
-    metadataCache_[hash] = metadata;
+    if (keyed && metadata.exists) {
+        objectInfo_.SetSize(key, metadata.size);
+        objectIndex_.Insert(key);
+    }
     return metadata;
 }
 
 std::string SyncStorage::GetObjectType(const std::string& hash) {
     // Check cache first
-    auto cached = typeCache_.find(hash);
-    if (cached != typeCache_.end()) {
-        return cached->second;
+    ObjectInfoTable::Key key;
+    bool keyed = ObjectInfoTable::ParseKey(hash, key);
+    ObjectInfoTable::Info info;
+    if (keyed && objectInfo_.Find(key, info) && info.type != ObjectInfoTable::kNoType) {
+        return objectInfo_.TypeName(info.type);
     }
     
     std::string type = "BLOB"; // Default
+    bool read = false;
     
     try {
         std::string header = ReadFirst100Bytes((objectsPath_ / hash).string());
+        read = !header.empty();
         type = ExtractTypeFromMicrodata(header);
     } catch (...) {
         // Keep default
     }
     
-    // Cache the result
-    typeCache_[hash] = type;
+    // Cache the result, unless the object is not there (yet)
+    if (keyed && read) {
+        objectInfo_.SetType(key, objectInfo_.InternType(type));
+    }
     return type;
 }
 
+size_t SyncStorage::ScanObjects(const std::atomic<bool>& cancel) {
+    const size_t sizeLimit = ObjectInfoTable::kCapacity / 2;
+    std::vector<ObjectIndex::Key> keys;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(objectsPath_, error), end; !error && it != end; it.increment(error)) {
+        if (cancel.load(std::memory_order_relaxed)) {
+            return keys.size();
+        }
+        ObjectInfoTable::Key key;
+        if (!ObjectInfoTable::ParseKey(it->path().filename().string(), key)) {
+            continue;
+        }
+        // An object may be stored as a directory, which ListObjects reports too
+        std::error_code entryError;
+        bool isFile = it->is_regular_file(entryError);
+        if (!isFile && !it->is_directory(entryError)) {
+            continue;
+        }
+        keys.push_back(key);
+        // The directory listing carries the size, so no object is opened
+        if (isFile && keys.size() <= sizeLimit) {
+            uintmax_t size = it->file_size(entryError);
+            if (!entryError) {
+                objectInfo_.SetSize(key, size);
+            }
+        }
+    }
+
+    size_t found = keys.size();
+    if (!error) {
+        objectIndex_.Publish(std::move(keys));
+    }
+    return found;
+}
+
+void SyncStorage::WatchObjects(const std::atomic<bool>& cancel, const std::function<void(size_t)>& scanned) {
+#ifdef _WIN32
+    HANDLE directory = CreateFileW(objectsPath_.c_str(), FILE_LIST_DIRECTORY,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                   FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    HANDLE event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (directory == INVALID_HANDLE_VALUE || !event) {
+        if (directory != INVALID_HANDLE_VALUE) {
+            CloseHandle(directory);
+        }
+        if (event) {
+            CloseHandle(event);
+        }
+        scanned(ScanObjects(cancel));
+        return;
+    }
+
+    std::vector<DWORD> buffer(kWatchBufferBytes / sizeof(DWORD));
+    OVERLAPPED overlapped{};
+    overlapped.hEvent = event;
+    auto arm = [&] {
+        ResetEvent(event);
+        return ReadDirectoryChangesW(directory, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(DWORD)),
+                                     FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME,
+                                     nullptr, &overlapped, nullptr) != 0;
+    };
+
+    // Armed before the scan, so nothing added while it runs goes unseen
+    bool armed = arm();
+    scanned(ScanObjects(cancel));
+    while (armed && !cancel.load(std::memory_order_relaxed)) {
+        if (WaitForSingleObject(event, kWatchPollMs) != WAIT_OBJECT_0) {
+            continue;
+        }
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(directory, &overlapped, &bytes, FALSE)) {
+            if (GetLastError() != ERROR_NOTIFY_ENUM_DIR) {
+                armed = false;
+                break;
+            }
+            bytes = 0;
+        }
+
+        if (bytes == 0) {
+            // More changed than the watch could hold
+            ScanObjects(cancel);
+        } else {
+            const uint8_t* at = reinterpret_cast<const uint8_t*>(buffer.data());
+            for (;;) {
+                auto* change = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(at);
+                std::string name;
+                for (DWORD i = 0; i < change->FileNameLength / sizeof(WCHAR); i++) {
+                    WCHAR c = change->FileName[i];
+                    name.push_back(c < 0x80 ? static_cast<char>(c) : '?');
+                }
+                ObjectIndex::Key key;
+                if (ObjectInfoTable::ParseKey(name, key)) {
+                    if (change->Action == FILE_ACTION_ADDED || change->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+                        objectIndex_.Insert(key);
+                    } else if (change->Action == FILE_ACTION_REMOVED ||
+                               change->Action == FILE_ACTION_RENAMED_OLD_NAME) {
+                        objectIndex_.Remove(key);
+                    }
+                }
+                if (change->NextEntryOffset == 0) {
+                    break;
+                }
+                at += change->NextEntryOffset;
+            }
+        }
+        armed = arm();
+    }
+
+    if (armed) {
+        DWORD bytes = 0;
+        CancelIoEx(directory, &overlapped);
+        GetOverlappedResult(directory, &overlapped, &bytes, TRUE);
+    }
+    CloseHandle(event);
+    CloseHandle(directory);
+#else
+    scanned(ScanObjects(cancel));
+#endif
+}
+
 std::string SyncStorage::ExtractHashFromPath(const std::string& virtualPath) {
     // Pattern: /objects/[64-char-hash]/...
-    static const std::regex hashPattern(R"(/objects/([0-9a-fA-F]{64})(?:/|$))");
-    std::smatch match;
-    
-    if (std::regex_search(virtualPath, match, hashPattern)) {
-        return match[1].str();
-    }
-    
-    return "";
+    return std::string(ObjectHashOfPath(virtualPath));
 }
 
 bool SyncStorage::IsObjectPath(const std::string& virtualPath) {
@@ -227,15 +567,22 @@ ObjectMetadata SyncStorage::GetVirtualPathMetadata(const std::string& virtualPat
                 metadata.isDirectory = true;
                 metadata.size = 0;
                 metadata.type = "DIRECTORY";
-            } else if ((virtualPath.size() >= 8 && virtualPath.compare(virtualPath.size() - 8, 8, "/raw.txt") == 0) || 
-                       (virtualPath.size() >= 12 && virtualPath.compare(virtualPath.size() - 12, 12, "/pretty.html") == 0) ||
-                       (virtualPath.size() >= 9 && virtualPath.compare(virtualPath.size() - 9, 9, "/json.txt") == 0) ||
-                       (virtualPath.size() >= 9 && virtualPath.compare(virtualPath.size() - 9, 9, "/type.txt") == 0)) {
-                // Virtual file
+            } else if (EndsWith(virtualPath, "/raw.txt") || EndsWith(virtualPath, "/pretty.html") ||
+                       EndsWith(virtualPath, "/json.txt") || EndsWith(virtualPath, "/type.txt")) {
+                // Virtual file. The size must be exact: ProjFS requests data up to
+                // the placeholder size and serves it with ranged reads.
                 metadata.exists = objMeta.exists;
                 metadata.isDirectory = false;
-                metadata.size = objMeta.size; // Approximate
                 metadata.type = "FILE";
+                if (EndsWith(virtualPath, "/raw.txt")) {
+                    metadata.size = objMeta.size;
+                } else if (EndsWith(virtualPath, "/pretty.html")) {
+                    metadata.size = kPrettyPrefix.size() + objMeta.size + kPrettySuffix.size();
+                } else if (EndsWith(virtualPath, "/type.txt")) {
+                    metadata.size = objMeta.exists ? GetObjectType(hash).size() : 0;
+                } else {
+                    metadata.size = objMeta.exists ? BuildJsonView(hash).size() : 0;
+                }
             } else {
                 metadata.exists = false;
             }
@@ -259,27 +606,81 @@ std::optional<std::string> SyncStorage::ReadVirtualPath(const std::string& virtu
     }
     
     // Handle different virtual file types
-    if (virtualPath.size() >= 8 && virtualPath.compare(virtualPath.size() - 8, 8, "/raw.txt") == 0) {
+    if (EndsWith(virtualPath, "/raw.txt")) {
         return ReadObject(hash);
     }
-    else if (virtualPath.size() >= 9 && virtualPath.compare(virtualPath.size() - 9, 9, "/type.txt") == 0) {
+    else if (EndsWith(virtualPath, "/type.txt")) {
         return GetObjectType(hash);
     }
-    else if (virtualPath.size() >= 12 && virtualPath.compare(virtualPath.size() - 12, 12, "/pretty.html") == 0) {
+    else if (EndsWith(virtualPath, "/pretty.html")) {
         auto content = ReadObject(hash);
         if (content) {
             // Simple HTML formatting for microdata
-            return "<html><body><pre>" + *content + "</pre></body></html>";
+            return kPrettyPrefix + *content + kPrettySuffix;
         }
     }
-    else if (virtualPath.size() >= 9 && virtualPath.compare(virtualPath.size() - 9, 9, "/json.txt") == 0) {
-        // This would need proper microdata-to-JSON conversion
-        return "{\"hash\": \"" + hash + "\", \"type\": \"" + GetObjectType(hash) + "\"}";
+    else if (EndsWith(virtualPath, "/json.txt")) {
+        return BuildJsonView(hash);
     }
     
     return std::nullopt;
 }
 
+std::optional<size_t> SyncStorage::ReadVirtualPathRange(const std::string& virtualPath, uint64_t offset,
+                                                        uint8_t* dest, size_t length) {
+    if (!IsObjectPath(virtualPath)) {
+        return std::nullopt;
+    }
+
+    std::string hash = ExtractHashFromPath(virtualPath);
+    if (hash.empty()) {
+        return std::nullopt;
+    }
+
+    if (EndsWith(virtualPath, "/raw.txt")) {
+        return ReadObjectRange(hash, offset, dest, length);
+    }
+    else if (EndsWith(virtualPath, "/pretty.html")) {
+        // The HTML view is prefix + raw object + suffix; serve each overlapping piece
+        auto file = AcquireObjectFile(hash);
+        if (!file) {
+            return std::nullopt;
+        }
+
+        uint64_t bodyStart = kPrettyPrefix.size();
+        uint64_t bodyEnd = bodyStart + file->Size();
+        size_t total = 0;
+
+        if (offset < bodyStart) {
+            total += CopyRange(kPrettyPrefix, offset, dest, length);
+        }
+        if (total < length && offset + total < bodyEnd) {
+            auto read = file->ReadAt(offset + total - bodyStart, dest + total, length - total);
+            if (!read) {
+                return std::nullopt;
+            }
+            total += *read;
+        }
+        if (total < length && offset + total >= bodyEnd) {
+            total += CopyRange(kPrettySuffix, offset + total - bodyEnd, dest + total, length - total);
+        }
+        return total;
+    }
+    else if (EndsWith(virtualPath, "/type.txt")) {
+        return CopyRange(GetObjectType(hash), offset, dest, length);
+    }
+    else if (EndsWith(virtualPath, "/json.txt")) {
+        return CopyRange(BuildJsonView(hash), offset, dest, length);
+    }
+
+    return std::nullopt;
+}
+
+std::string SyncStorage::BuildJsonView(const std::string& hash) {
+    // This would need proper microdata-to-JSON conversion
+    return "{\"hash\": \"" + hash + "\", \"type\": \"" + GetObjectType(hash) + "\"}";
+}
+
 std::string SyncStorage::ReadFirst100Bytes(const std::string& objectPath) {
     std::ifstream file(objectPath, std::ios::binary);
     if (!file.is_open()) {
@@ -295,11 +696,9 @@ std::string SyncStorage::ReadFirst100Bytes(const std::string& objectPath) {
 
 std::string SyncStorage::ExtractTypeFromMicrodata(const std::string& microdata) {
     // Look for itemtype in microdata
-    static const std::regex typePattern("itemtype=\"//refin\\\\.io/([^\"]+)\"");
-    std::smatch match;
-    
-    if (std::regex_search(microdata, match, typePattern)) {
-        return match[1].str();
+    std::string_view type = FindRefinItemType(microdata);
+    if (!type.empty()) {
+        return std::string(type);
     }
     
     // Check if it looks like microdata at all
@@ -5,7 +5,14 @@
 #include <vector>
 #include <optional>
 #include <filesystem>
-#include <unordered_map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include "object_info_table.h"
+#include "object_index.h"
 
 namespace oneifsprojfs {
 
@@ -14,6 +21,7 @@ struct ObjectMetadata {
     std::string type;
     bool isDirectory;
     bool exists;
+    uint64_t mtime = 0;  // Milliseconds since the Unix epoch; 0 if unknown
 };
 
 class SyncStorage {
@@ -25,6 +33,11 @@ public:
     std::optional<std::string> ReadObject(const std::string& hash);
     std::optional<std::vector<uint8_t>> ReadObjectBinary(const std::string& hash);
     std::optional<std::string> ReadObjectSection(const std::string& hash, size_t offset, size_t length);
+
+    // Positional read of [offset, offset + length) straight into dest. Returns the
+    // number of bytes read (short at end of object), or nullopt if the object
+    // cannot be opened or read. Open handles are pooled per hash.
+    std::optional<size_t> ReadObjectRange(const std::string& hash, uint64_t offset, uint8_t* dest, size_t length);
     
     // Directory operations
     std::vector<std::string> ListObjects();
@@ -33,7 +46,29 @@ public:
     // Metadata operations
     ObjectMetadata GetObjectMetadata(const std::string& hash);
     std::string GetObjectType(const std::string& hash);
+
+    // Lists the objects directory once, without opening any object: every
+    // hash goes into the object index, and sizes into the object info table
+    // until half of it is used. Stops early once cancel is set, leaving the
+    // index as it was. Returns the number of objects found.
+    size_t ScanObjects(const std::atomic<bool>& cancel);
+    // Keeps the object index current until cancel is set: arms a change watch
+    // on the objects directory, scans it, then inserts and removes hashes as
+    // objects are added, removed or renamed. An overflowed watch is answered
+    // with a fresh scan. Where no watch can be armed the scan runs once.
+    // scanned is told how many objects the first scan found.
+    void WatchObjects(const std::atomic<bool>& cancel, const std::function<void(size_t)>& scanned);
+    // Sorted hashes of the objects on disk, kept current as objects are found
+    const ObjectIndex& Objects() const { return objectIndex_; }
+    ObjectIndex& Objects() { return objectIndex_; }
+    ObjectInfoTable::Stats GetObjectInfoStats() const { return objectInfo_.GetStats(); }
     
+    // Fingerprint of the version heads: changes whenever a head is added,
+    // removed or rewritten, so anything derived from ONE data can be checked
+    // against it. Returns 0 if the heads cannot be read.
+    uint64_t VersionHeadsFingerprint() const;
+    const std::filesystem::path& InstancePath() const { return instancePath_; }
+
     // Path utilities
     std::string ExtractHashFromPath(const std::string& virtualPath);
     bool IsObjectPath(const std::string& virtualPath);
@@ -41,8 +76,13 @@ public:
     // Virtual filesystem operations
     ObjectMetadata GetVirtualPathMetadata(const std::string& virtualPath);
     std::optional<std::string> ReadVirtualPath(const std::string& virtualPath);
+    std::optional<size_t> ReadVirtualPathRange(const std::string& virtualPath, uint64_t offset,
+                                               uint8_t* dest, size_t length);
 
 private:
+    class ObjectFile;
+    std::shared_ptr<ObjectFile> AcquireObjectFile(const std::string& hash);
+
     std::filesystem::path instancePath_;
     std::filesystem::path objectsPath_;
     std::filesystem::path vheadsPath_;
@@ -52,10 +92,17 @@ private:
     std::string ReadFirst100Bytes(const std::string& objectPath);
     std::string ExtractTypeFromMicrodata(const std::string& microdata);
     std::string ParseVirtualPath(const std::string& virtualPath);
+    std::string BuildJsonView(const std::string& hash);
     
-    // Cache for frequently accessed metadata
-    mutable std::unordered_map<std::string, ObjectMetadata> metadataCache_;
-    mutable std::unordered_map<std::string, std::string> typeCache_;
+    // Sizes and sniffed types of objects known to exist. Missing objects are
+    // not recorded, as ONE may write them at any time.
+    ObjectInfoTable objectInfo_;
+    ObjectIndex objectIndex_;
+
+    // Small LRU of open object files; objects are immutable, so a handle stays valid
+    static constexpr size_t kMaxOpenObjects = 32;
+    std::mutex openObjectsMutex_;
+    std::list<std::pair<std::string, std::shared_ptr<ObjectFile>>> openObjects_;  // Front is most recent
 };
 
 } // namespace oneifsprojfs
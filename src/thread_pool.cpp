@@ -0,0 +1,291 @@
+#include "thread_pool.h"
+#include "log.h"
+#include <algorithm>
+#include <exception>
+
+namespace oneifsprojfs {
+
+namespace {
+
+// The pool and worker index of the calling thread, if it is a pool worker
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+size_t PriorityIndex(ThreadPool::Priority priority) {
+    return priority == ThreadPool::Priority::Foreground ? 0 : 1;
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    threads = (std::min)((std::max)(threads, kMinThreads), kMaxThreads);
+
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        workers_[i]->thread = std::thread(&ThreadPool::Run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    Stop();
+}
+
+bool ThreadPool::Submit(Task task, Priority priority) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        PushLocked(std::move(task), priority);
+    }
+    cv_.notify_one();
+    return true;
+}
+
+bool ThreadPool::SubmitAfter(Clock::duration delay, Task task, Priority priority) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        delayed_.emplace(Clock::now() + delay, std::make_pair(std::move(task), priority));
+    }
+    // A sleeping worker may have to wake earlier than it planned
+    cv_.notify_one();
+    return true;
+}
+
+void ThreadPool::PushLocked(Task task, Priority priority) {
+    size_t index;
+    bool local = currentPool == this;
+    if (local) {
+        index = currentWorker;
+    } else {
+        index = nextWorker_;
+        nextWorker_ = (nextWorker_ + 1) % workers_.size();
+    }
+
+    Worker& worker = *workers_[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        auto& queue = worker.queues[PriorityIndex(priority)];
+        if (local) {
+            queue.push_front(std::move(task));
+        } else {
+            queue.push_back(std::move(task));
+        }
+    }
+    queued_[PriorityIndex(priority)]++;
+}
+
+void ThreadPool::ReleaseDueLocked(Clock::time_point now) {
+    while (!delayed_.empty() && delayed_.begin()->first <= now) {
+        auto node = delayed_.extract(delayed_.begin());
+        PushLocked(std::move(node.mapped().first), node.mapped().second);
+    }
+}
+
+ThreadPool::Task ThreadPool::Take(size_t index, Priority priority) {
+    size_t queueIndex = PriorityIndex(priority);
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        auto& queue = own.queues[queueIndex];
+        if (!queue.empty()) {
+            Task task = std::move(queue.front());
+            queue.pop_front();
+            return task;
+        }
+    }
+
+    // The claimed task is on another deque. Another worker may take the one
+    // found here first and leave its own behind a deque already passed, so
+    // keep going round until one turns up.
+    for (;;) {
+        for (size_t offset = 1; offset < workers_.size() + 1; offset++) {
+            Worker& victim = *workers_[(index + offset) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            auto& queue = victim.queues[queueIndex];
+            if (!queue.empty()) {
+                Task task = std::move(queue.back());
+                queue.pop_back();
+                if (offset != workers_.size()) {
+                    stolen_.Add();
+                }
+                return task;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void ThreadPool::Run(size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    const size_t backgroundSlots = workers_.size() - 1;
+
+    for (;;) {
+        Priority priority;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;) {
+                if (stopping_) {
+                    return;
+                }
+                ReleaseDueLocked(Clock::now());
+                if (queued_[0] > 0) {
+                    queued_[0]--;
+                    priority = Priority::Foreground;
+                    break;
+                }
+                if (queued_[1] > 0 && runningBackground_ < backgroundSlots) {
+                    queued_[1]--;
+                    runningBackground_++;
+                    priority = Priority::Background;
+                    break;
+                }
+                if (delayed_.empty()) {
+                    cv_.wait(lock);
+                } else {
+                    cv_.wait_until(lock, delayed_.begin()->first);
+                }
+            }
+            // More may be runnable than this one worker takes on
+            if (queued_[0] > 0 || (queued_[1] > 0 && runningBackground_ < backgroundSlots)) {
+                cv_.notify_one();
+            }
+        }
+
+        Task task = Take(index, priority);
+        try {
+            task();
+            executed_.Add();
+        } catch (const std::exception& e) {
+            failed_.Add();
+            PROJFS_ERROR("[ThreadPool] Task failed: " << e.what());
+        } catch (...) {
+            failed_.Add();
+            PROJFS_ERROR("[ThreadPool] Task failed");
+        }
+        task = nullptr;  // Captures are released before the next task starts
+
+        if (priority == Priority::Background) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                runningBackground_--;
+            }
+            cv_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    // Dropped tasks release their captures here, after every worker is gone
+    std::multimap<Clock::time_point, std::pair<Task, Priority>> delayed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(delayed, delayed_);
+        queued_ = {};
+    }
+    for (auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        for (auto& queue : worker->queues) {
+            queue.clear();
+        }
+    }
+}
+
+ThreadPool::Stats ThreadPool::GetStats() const {
+    Stats stats;
+    stats.executed = executed_.Load();
+    stats.stolen = stolen_.Load();
+    stats.failed = failed_.Load();
+    stats.threads = workers_.size();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.foregroundQueued = queued_[0];
+    stats.backgroundQueued = queued_[1];
+    stats.delayed = delayed_.size();
+    return stats;
+}
+
+// TaskGroup
+
+TaskGroup::TaskGroup(std::shared_ptr<ThreadPool> pool)
+    : pool_(std::move(pool)), state_(std::make_shared<State>()) {}
+
+TaskGroup::~TaskGroup() {
+    Close();
+}
+
+ThreadPool::Task TaskGroup::Guard(std::shared_ptr<State> state, ThreadPool::Task task) {
+    return [state = std::move(state), task = std::move(task)] {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->closed) {
+                return;
+            }
+            state->running++;
+        }
+        // Counted out even when the task throws; the pool reports the failure
+        struct Finished {
+            State* state;
+            ~Finished() {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (--state->running == 0) {
+                    state->idle.notify_all();
+                }
+            }
+        } finished{state.get()};
+        task();
+    };
+}
+
+bool TaskGroup::Submit(ThreadPool::Task task, ThreadPool::Priority priority) {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->closed) {
+            return false;
+        }
+    }
+    return pool_->Submit(Guard(state_, std::move(task)), priority);
+}
+
+bool TaskGroup::SubmitAfter(ThreadPool::Clock::duration delay, ThreadPool::Task task,
+                            ThreadPool::Priority priority) {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->closed) {
+            return false;
+        }
+    }
+    return pool_->SubmitAfter(delay, Guard(state_, std::move(task)), priority);
+}
+
+void TaskGroup::Close() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->closed = true;
+    // Tasks left on the pool release their captures when it gets to them
+    state_->idle.wait(lock, [this] { return state_->running == 0; });
+}
+
+} // namespace oneifsprojfs
@@ -0,0 +1,143 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "stats.h"
+
+namespace oneifsprojfs {
+
+// Native worker threads for work that should not hold a ProjFS callback
+// thread: disk reads, metadata sniffing, read-ahead and snapshot writing.
+//
+// Every worker owns one deque per priority. A task submitted from a worker
+// goes to the front of that worker's deque, one submitted from any other
+// thread is dealt round robin to the back of one. Workers take from the front
+// of their own deque and steal from the back of the others', so follow-up
+// work stays on the thread that produced it until another one runs dry.
+//
+// Foreground tasks always go before background ones, and background tasks
+// never occupy more than all but one worker, so a foreground task never waits
+// behind background work. Delayed tasks wait on a timer list and are dealt
+// out once due.
+class ThreadPool {
+public:
+    enum class Priority { Foreground, Background };
+    using Task = std::function<void()>;
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kMinThreads = 2;
+    static constexpr size_t kMaxThreads = 8;
+
+    // threads 0 picks the hardware concurrency, clamped to [kMinThreads, kMaxThreads]
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Both return false, dropping the task, once Stop has begun
+    bool Submit(Task task, Priority priority = Priority::Foreground);
+    bool SubmitAfter(Clock::duration delay, Task task, Priority priority = Priority::Background);
+
+    // Joins the workers after the tasks they are running; queued and delayed
+    // tasks are dropped. Must not be called from a task.
+    void Stop();
+
+    size_t ThreadCount() const { return workers_.size(); }
+
+    struct Stats {
+        uint64_t executed = 0;  // Tasks run to completion
+        uint64_t stolen = 0;    // Taken from another worker's deque
+        uint64_t failed = 0;    // Ended by an exception
+        size_t foregroundQueued = 0;
+        size_t backgroundQueued = 0;
+        size_t delayed = 0;
+        size_t threads = 0;
+    };
+    Stats GetStats() const;
+
+private:
+    static constexpr size_t kPriorityCount = 2;
+
+    struct Worker {
+        std::mutex mutex;
+        std::array<std::deque<Task>, kPriorityCount> queues;
+        std::thread thread;
+    };
+
+    void Run(size_t index);
+    // Places a task on a worker's deque; called with mutex_ held
+    void PushLocked(Task task, Priority priority);
+    // Moves due delayed tasks onto the deques; called with mutex_ held
+    void ReleaseDueLocked(Clock::time_point now);
+    // Pops a task of the claimed priority, stealing if the own deque is empty
+    Task Take(size_t index, Priority priority);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    // Guards the counts below and the timer list; workers sleep on cv_. A task
+    // is claimed by decrementing its count, so whoever claims one is certain
+    // to find it on some deque.
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::array<size_t, kPriorityCount> queued_{};
+    size_t runningBackground_ = 0;
+    std::multimap<Clock::time_point, std::pair<Task, Priority>> delayed_;
+    size_t nextWorker_ = 0;
+    bool stopping_ = false;
+
+    StripedCounter executed_;
+    StripedCounter stolen_;
+    StripedCounter failed_;
+};
+
+// The tasks one owner puts on a pool it shares with others. Close stops the
+// owner's queued and delayed tasks from starting and waits for its running
+// ones, so the owner can go away while the pool carries on for everyone else.
+class TaskGroup {
+public:
+    explicit TaskGroup(std::shared_ptr<ThreadPool> pool);
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    // Both return false, dropping the task, once the group or the pool is closing
+    bool Submit(ThreadPool::Task task, ThreadPool::Priority priority = ThreadPool::Priority::Foreground);
+    bool SubmitAfter(ThreadPool::Clock::duration delay, ThreadPool::Task task,
+                     ThreadPool::Priority priority = ThreadPool::Priority::Background);
+
+    // Must not be called from a task of the group
+    void Close();
+
+    const std::shared_ptr<ThreadPool>& Pool() const { return pool_; }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable idle;
+        size_t running = 0;
+        bool closed = false;
+    };
+
+    // Runs the task unless the group closed while it was queued
+    static ThreadPool::Task Guard(std::shared_ptr<State> state, ThreadPool::Task task);
+
+    std::shared_ptr<ThreadPool> pool_;
+    std::shared_ptr<State> state_;
+};
+
+} // namespace oneifsprojfs
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,91 @@
+#include "trace.h"
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <TraceLoggingProvider.h>
+
+// Derived from the provider name the way EventSource does, so tools that take
+// "*Refinio.OneIFSProjFS" find it without the GUID
+TRACELOGGING_DEFINE_PROVIDER(
+    g_traceProvider,
+    "Refinio.OneIFSProjFS",
+    (0x3ffc6680, 0x974c, 0x50ea, 0x76, 0x96, 0x46, 0xe5, 0xb4, 0x19, 0x63, 0x45));
+#endif
+
+namespace oneifsprojfs {
+namespace trace {
+
+namespace {
+
+std::mutex g_registrationMutex;
+size_t g_registrations = 0;
+
+} // namespace
+
+void Register() {
+    std::lock_guard<std::mutex> lock(g_registrationMutex);
+#ifdef _WIN32
+    if (g_registrations == 0) {
+        TraceLoggingRegister(g_traceProvider);
+    }
+#endif
+    g_registrations++;
+}
+
+void Unregister() {
+    std::lock_guard<std::mutex> lock(g_registrationMutex);
+    if (g_registrations == 0) {
+        return;
+    }
+    g_registrations--;
+#ifdef _WIN32
+    if (g_registrations == 0) {
+        TraceLoggingUnregister(g_traceProvider);
+    }
+#endif
+}
+
+#ifdef _WIN32
+
+bool Enabled() {
+    return TraceLoggingProviderEnabled(g_traceProvider, 0, 0);
+}
+
+void Callback(CallbackKind kind, CallbackOutcome outcome, int32_t commandId, const wchar_t* path,
+              std::chrono::nanoseconds elapsed) {
+    TraceLoggingWrite(g_traceProvider, "Callback",
+                      TraceLoggingString(CallbackKindName(kind), "Callback"),
+                      TraceLoggingString(CallbackOutcomeName(outcome), "Outcome"),
+                      TraceLoggingInt32(commandId, "CommandId"),
+                      TraceLoggingWideString(path ? path : L"", "Path"),
+                      TraceLoggingUInt64(static_cast<uint64_t>(elapsed.count()), "DurationNs"));
+}
+
+void CommandCompleted(CallbackKind kind, int32_t commandId, int32_t result, std::chrono::nanoseconds waited) {
+    TraceLoggingWrite(g_traceProvider, "CommandCompleted",
+                      TraceLoggingString(CallbackKindName(kind), "Callback"),
+                      TraceLoggingInt32(commandId, "CommandId"),
+                      TraceLoggingHResult(result, "Result"),
+                      TraceLoggingUInt64(static_cast<uint64_t>(waited.count()), "WaitNs"));
+}
+
+void Fetch(const char* kind, const std::string& path, bool resolved, std::chrono::nanoseconds elapsed) {
+    TraceLoggingWrite(g_traceProvider, "Fetch",
+                      TraceLoggingString(kind, "Kind"),
+                      TraceLoggingUtf8String(path.c_str(), "Path"),
+                      TraceLoggingBool(resolved, "Resolved"),
+                      TraceLoggingUInt64(static_cast<uint64_t>(elapsed.count()), "DurationNs"));
+}
+
+#else
+
+bool Enabled() { return false; }
+void Callback(CallbackKind, CallbackOutcome, int32_t, const wchar_t*, std::chrono::nanoseconds) {}
+void CommandCompleted(CallbackKind, int32_t, int32_t, std::chrono::nanoseconds) {}
+void Fetch(const char*, const std::string&, bool, std::chrono::nanoseconds) {}
+
+#endif
+
+} // namespace trace
+} // namespace oneifsprojfs
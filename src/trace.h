@@ -0,0 +1,35 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "callback_stats.h"
+
+namespace oneifsprojfs {
+
+// TraceLogging events for Windows Performance Analyzer, from the provider
+// "Refinio.OneIFSProjFS" {3ffc6680-974c-50ea-7696-46e5b4196345}; record them
+// with logman, or a WPR profile naming "*Refinio.OneIFSProjFS". Nothing is
+// formatted unless a session has the provider enabled, so the calls are left
+// in unconditionally. Elsewhere they compile to nothing.
+namespace trace {
+
+// Reference counted, one per running provider
+void Register();
+void Unregister();
+// Whether a session is listening; lets callers skip work only events need
+bool Enabled();
+
+// A callback returned; path is the callback's FilePathName
+void Callback(CallbackKind kind, CallbackOutcome outcome, int32_t commandId, const wchar_t* path,
+              std::chrono::nanoseconds elapsed);
+// A command that returned ERROR_IO_PENDING was completed
+void CommandCompleted(CallbackKind kind, int32_t commandId, int32_t result, std::chrono::nanoseconds waited);
+// A fetch from JavaScript settled for one caller
+void Fetch(const char* kind, const std::string& path, bool resolved, std::chrono::nanoseconds elapsed);
+
+} // namespace trace
+} // namespace oneifsprojfs
+
+#endif // TRACE_H
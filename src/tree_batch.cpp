@@ -0,0 +1,225 @@
+#include "tree_batch.h"
+#include <algorithm>
+#include <iterator>
+
+namespace oneifsprojfs {
+namespace tree_batch {
+
+namespace {
+
+// Records are not guaranteed to be aligned inside the caller's buffer
+uint32_t ReadU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void WriteU32(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+    p[2] = static_cast<uint8_t>(value >> 16);
+    p[3] = static_cast<uint8_t>(value >> 24);
+}
+
+bool StringInRange(uint32_t offset, uint32_t length, uint32_t stringBytes) {
+    return offset <= stringBytes && length <= stringBytes - offset;
+}
+
+} // namespace
+
+bool View::Open(const uint8_t* data, size_t size, std::string& error) {
+    if (size < kHeaderSize || ReadU32(data) != kMagic) {
+        error = "Not a cached tree batch";
+        return false;
+    }
+
+    uint32_t directoryCount = ReadU32(data + 4);
+    uint32_t entryCount = ReadU32(data + 8);
+    uint32_t stringBytes = ReadU32(data + 12);
+
+    // 64-bit arithmetic so hostile counts cannot wrap the size check
+    uint64_t expected = kHeaderSize +
+                        static_cast<uint64_t>(directoryCount) * kDirectoryRecordSize +
+                        static_cast<uint64_t>(entryCount) * kEntryRecordSize +
+                        stringBytes;
+    if (expected != size) {
+        error = "Cached tree batch size does not match its header";
+        return false;
+    }
+
+    directoryRecords_ = data + kHeaderSize;
+    entryRecords_ = directoryRecords_ + static_cast<size_t>(directoryCount) * kDirectoryRecordSize;
+    strings_ = reinterpret_cast<const char*>(entryRecords_ + static_cast<size_t>(entryCount) * kEntryRecordSize);
+    directoryCount_ = directoryCount;
+    entryCount_ = entryCount;
+    stringBytes_ = stringBytes;
+    return true;
+}
+
+const uint8_t* View::DirectoryRecord(uint32_t index) const {
+    return directoryRecords_ + static_cast<size_t>(index) * kDirectoryRecordSize;
+}
+
+std::string_view View::String(uint32_t offset, uint32_t length) const {
+    return std::string_view(strings_ + offset, length);
+}
+
+bool View::DirectoryPath(uint32_t index, std::string_view& path) const {
+    if (index >= directoryCount_) {
+        return false;
+    }
+    const uint8_t* record = DirectoryRecord(index);
+    uint32_t pathOffset = ReadU32(record);
+    uint32_t pathLength = ReadU32(record + 4);
+    if (!StringInRange(pathOffset, pathLength, stringBytes_)) {
+        return false;
+    }
+    path = String(pathOffset, pathLength);
+    return true;
+}
+
+bool View::EntryRange(uint32_t index, uint32_t& firstEntry, uint32_t& count) const {
+    if (index >= directoryCount_) {
+        return false;
+    }
+    const uint8_t* record = DirectoryRecord(index);
+    firstEntry = ReadU32(record + 8);
+    count = ReadU32(record + 12);
+    return firstEntry <= entryCount_ && count <= entryCount_ - firstEntry;
+}
+
+bool View::ReadDirectory(uint32_t index, DirectoryUpdate& update, std::string& error) const {
+    std::string_view path;
+    uint32_t firstEntry = 0;
+    uint32_t count = 0;
+    if (!DirectoryPath(index, path) || !EntryRange(index, firstEntry, count)) {
+        error = "Cached tree directory " + std::to_string(index) + " is out of range";
+        return false;
+    }
+
+    update.path.assign(path.data(), path.size());
+    update.listing.entries.clear();
+    update.listing.entries.reserve(count);
+
+    for (uint32_t e = firstEntry; e < firstEntry + count; e++) {
+        const uint8_t* entry = entryRecords_ + static_cast<size_t>(e) * kEntryRecordSize;
+        uint32_t nameOffset = ReadU32(entry);
+        uint32_t nameLength = ReadU32(entry + 4);
+        uint32_t hashOffset = ReadU32(entry + 8);
+        uint32_t hashLength = ReadU32(entry + 12);
+        uint32_t flags = ReadU32(entry + 28);
+
+        if (!StringInRange(nameOffset, nameLength, stringBytes_) ||
+            !StringInRange(hashOffset, hashLength, stringBytes_)) {
+            error = "Cached tree entry " + std::to_string(e) + " is out of range";
+            return false;
+        }
+
+        FileInfo info = {};
+        info.name.assign(strings_ + nameOffset, nameLength);
+        if (info.name.empty() || info.name.find_first_of("/\\") != std::string::npos) {
+            error = "Cached tree entry " + std::to_string(e) + " has an invalid name";
+            return false;
+        }
+        info.hash.assign(strings_ + hashOffset, hashLength);
+        info.size = static_cast<size_t>(ReadU32(entry + 16) | (static_cast<uint64_t>(ReadU32(entry + 20)) << 32));
+        info.mode = ReadU32(entry + 24);
+        info.isDirectory = (flags & kFlagDirectory) != 0;
+        info.isBlobOrClob = (flags & kFlagBlobOrClob) != 0;
+        info.mtime = ReadU32(entry + 32) | (static_cast<uint64_t>(ReadU32(entry + 36)) << 32);
+        update.listing.entries.push_back(std::move(info));
+    }
+    return true;
+}
+
+bool Decode(const uint8_t* data, size_t size, std::vector<DirectoryUpdate>& directories, std::string& error) {
+    View view;
+    if (!view.Open(data, size, error)) {
+        return false;
+    }
+
+    std::vector<DirectoryUpdate> decoded;
+    decoded.reserve(view.DirectoryCount());
+    uint32_t nextFreeEntry = 0;
+
+    for (uint32_t d = 0; d < view.DirectoryCount(); d++) {
+        uint32_t firstEntry = 0;
+        uint32_t count = 0;
+        if (view.EntryRange(d, firstEntry, count) && firstEntry < nextFreeEntry) {
+            error = "Cached tree directory " + std::to_string(d) + " is out of range";
+            return false;
+        }
+        nextFreeEntry = firstEntry + count;
+
+        DirectoryUpdate update;
+        if (!view.ReadDirectory(d, update, error)) {
+            return false;
+        }
+        decoded.push_back(std::move(update));
+    }
+
+    directories.insert(directories.end(),
+                       std::make_move_iterator(decoded.begin()),
+                       std::make_move_iterator(decoded.end()));
+    return true;
+}
+
+void Encode(const std::vector<DirectoryUpdate>& directories, std::vector<uint8_t>& out) {
+    size_t entryCount = 0;
+    size_t stringBytes = 0;
+    for (const auto& directory : directories) {
+        stringBytes += directory.path.size();
+        for (const auto& entry : directory.listing.entries) {
+            stringBytes += entry.name.size() + entry.hash.size();
+        }
+        entryCount += directory.listing.entries.size();
+    }
+
+    size_t start = out.size();
+    size_t directoryStart = start + kHeaderSize;
+    size_t entryStart = directoryStart + directories.size() * kDirectoryRecordSize;
+    size_t stringStart = entryStart + entryCount * kEntryRecordSize;
+    out.resize(stringStart + stringBytes);
+
+    uint8_t* header = out.data() + start;
+    WriteU32(header, kMagic);
+    WriteU32(header + 4, static_cast<uint32_t>(directories.size()));
+    WriteU32(header + 8, static_cast<uint32_t>(entryCount));
+    WriteU32(header + 12, static_cast<uint32_t>(stringBytes));
+
+    uint32_t nextString = 0;
+    auto addString = [&](const std::string& value, uint8_t* record) {
+        std::copy(value.begin(), value.end(), out.begin() + stringStart + nextString);
+        WriteU32(record, nextString);
+        WriteU32(record + 4, static_cast<uint32_t>(value.size()));
+        nextString += static_cast<uint32_t>(value.size());
+    };
+
+    uint32_t nextEntry = 0;
+    for (size_t d = 0; d < directories.size(); d++) {
+        const auto& directory = directories[d];
+        uint8_t* record = out.data() + directoryStart + d * kDirectoryRecordSize;
+        addString(directory.path, record);
+        WriteU32(record + 8, nextEntry);
+        WriteU32(record + 12, static_cast<uint32_t>(directory.listing.entries.size()));
+
+        for (const auto& info : directory.listing.entries) {
+            uint8_t* entry = out.data() + entryStart + static_cast<size_t>(nextEntry) * kEntryRecordSize;
+            addString(info.name, entry);
+            addString(info.hash, entry + 8);
+            uint64_t size = info.size;
+            WriteU32(entry + 16, static_cast<uint32_t>(size));
+            WriteU32(entry + 20, static_cast<uint32_t>(size >> 32));
+            WriteU32(entry + 24, info.mode);
+            WriteU32(entry + 28, (info.isDirectory ? kFlagDirectory : 0) |
+                                 (info.isBlobOrClob ? kFlagBlobOrClob : 0));
+            WriteU32(entry + 32, static_cast<uint32_t>(info.mtime));
+            WriteU32(entry + 36, static_cast<uint32_t>(info.mtime >> 32));
+            nextEntry++;
+        }
+    }
+}
+
+} // namespace tree_batch
+} // namespace oneifsprojfs
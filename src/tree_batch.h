@@ -0,0 +1,71 @@
+#ifndef TREE_BATCH_H
+#define TREE_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "content_cache.h"
+
+namespace oneifsprojfs {
+
+// Packed directory trees handed over by IFSProjFSProvider#setCachedTree, so a
+// whole directory (or many) crosses N-API as one buffer instead of one object
+// walk per field per entry. All integers are little-endian uint32; strings
+// are UTF-8 slices of the string table at the end of the buffer.
+//
+//   header     magic "PJT2", directoryCount, entryCount, stringBytes
+//   directory  pathOffset, pathLength, firstEntry, entryCount        (x directoryCount)
+//   entry      nameOffset, nameLength, hashOffset, hashLength,
+//              sizeLow, sizeHigh, mode, flags, mtimeLow, mtimeHigh  (x entryCount)
+//   strings    stringBytes bytes
+//
+// Directories reference a contiguous run of entries; runs may not overlap.
+namespace tree_batch {
+
+constexpr uint32_t kMagic = 0x32544A50;  // "PJT2"
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kDirectoryRecordSize = 16;
+constexpr size_t kEntryRecordSize = 40;
+
+constexpr uint32_t kFlagDirectory = 1;
+constexpr uint32_t kFlagBlobOrClob = 2;
+
+// Returns false and describes the problem in error if the buffer is malformed;
+// nothing is appended to directories in that case
+bool Decode(const uint8_t* data, size_t size, std::vector<DirectoryUpdate>& directories, std::string& error);
+
+// Appends the encoding of directories to out, in the order given
+void Encode(const std::vector<DirectoryUpdate>& directories, std::vector<uint8_t>& out);
+
+// Random access to one directory at a time, for buffers too large to decode
+// up front. Open only checks the header against the buffer size; every record
+// is range-checked when it is read.
+class View {
+public:
+    bool Open(const uint8_t* data, size_t size, std::string& error);
+
+    uint32_t DirectoryCount() const { return directoryCount_; }
+    // False if the record points outside the string table
+    bool DirectoryPath(uint32_t index, std::string_view& path) const;
+    bool EntryRange(uint32_t index, uint32_t& firstEntry, uint32_t& count) const;
+    bool ReadDirectory(uint32_t index, DirectoryUpdate& update, std::string& error) const;
+
+private:
+    const uint8_t* DirectoryRecord(uint32_t index) const;
+    std::string_view String(uint32_t offset, uint32_t length) const;
+
+    const uint8_t* directoryRecords_ = nullptr;
+    const uint8_t* entryRecords_ = nullptr;
+    const char* strings_ = nullptr;
+    uint32_t directoryCount_ = 0;
+    uint32_t entryCount_ = 0;
+    uint32_t stringBytes_ = 0;
+};
+
+} // namespace tree_batch
+
+} // namespace oneifsprojfs
+
+#endif // TREE_BATCH_H
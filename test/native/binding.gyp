@@ -0,0 +1,57 @@
+# Native unit tests. They need neither ProjFS nor Node, so they also build and
+# run off Windows; install does not build them:
+#   npm run test:native
+{
+  "target_defaults": {
+    "type": "executable",
+    "include_dirs": [
+      "../../src",
+      "."
+    ],
+    "cflags!": ["-fno-exceptions"],
+    "cflags_cc!": ["-fno-exceptions"],
+    "msvs_settings": {
+      "VCCLCompilerTool": {
+        "ExceptionHandling": 1,
+        "AdditionalOptions": ["/std:c++17"]
+      }
+    }
+  },
+  "targets": [
+    {
+      "target_name": "tree_batch_test",
+      "sources": [
+        "tree_batch_test.cpp",
+        "../../src/tree_batch.cpp"
+      ]
+    },
+    {
+      "target_name": "metadata_snapshot_test",
+      "sources": [
+        "metadata_snapshot_test.cpp",
+        "../../src/metadata_snapshot.cpp",
+        "../../src/tree_batch.cpp"
+      ]
+    },
+    {
+      "target_name": "directory_delta_test",
+      "sources": [
+        "directory_delta_test.cpp",
+        "../../src/content_cache.cpp",
+        "../../src/content_store.cpp",
+        "../../src/path_table.cpp",
+        "../../src/packed_listing.cpp",
+        "../../src/tree_batch.cpp",
+        "../../src/log.cpp"
+      ]
+    },
+    {
+      "target_name": "object_index_test",
+      "sources": [
+        "object_index_test.cpp",
+        "../../src/object_index.cpp",
+        "../../src/object_info_table.cpp"
+      ]
+    }
+  ]
+}
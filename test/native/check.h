@@ -0,0 +1,38 @@
+#ifndef NATIVE_TEST_CHECK_H
+#define NATIVE_TEST_CHECK_H
+
+#include <cstdio>
+
+// Just enough of a test harness for the native tests: a failed CHECK prints
+// where it failed and the test keeps going, so one run reports every failure.
+// Each test's main returns CheckResult().
+namespace oneifsprojfs {
+namespace test {
+
+inline int& FailureCount() {
+    static int failures = 0;
+    return failures;
+}
+
+inline bool Check(bool condition, const char* expression, const char* file, int line) {
+    if (!condition) {
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+        FailureCount()++;
+    }
+    return condition;
+}
+
+inline int CheckResult() {
+    if (FailureCount() != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", FailureCount());
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace test
+} // namespace oneifsprojfs
+
+#define CHECK(condition) ::oneifsprojfs::test::Check((condition), #condition, __FILE__, __LINE__)
+
+#endif // NATIVE_TEST_CHECK_H
@@ -0,0 +1,215 @@
+// ContentCache::ApplyDirectoryDelta: patched listings stay in name order, hold
+// exactly what a full resend would, and carry FileInfo, content and missing
+// names along with them.
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "content_cache.h"
+
+using namespace oneifsprojfs;
+
+namespace {
+
+FileInfo MakeEntry(const std::string& name, const std::string& hash, size_t size = 1) {
+    FileInfo info = {};
+    info.name = name;
+    info.hash = hash;
+    info.size = size;
+    info.mode = 0100644;
+    return info;
+}
+
+DirectoryListing MakeListing(std::initializer_list<const char*> names) {
+    DirectoryListing listing;
+    for (const char* name : names) {
+        listing.entries.push_back(MakeEntry(name, std::string("old-") + name));
+    }
+    return listing;
+}
+
+std::vector<std::string> Names(const ContentCache& cache, const std::string& path) {
+    std::vector<std::string> names;
+    DirectoryListingPtr listing = cache.GetDirectoryListing(path);
+    if (listing) {
+        for (size_t i = 0; i < listing->Size(); i++) {
+            names.emplace_back(listing->Name(i));
+        }
+    }
+    return names;
+}
+
+void TestUncachedListing() {
+    ContentCache cache;
+    DirectoryDelta delta;
+    delta.path = "/d";
+    delta.upserts.push_back(MakeEntry("new.txt", "h"));
+    delta.removals.push_back("gone.txt");
+
+    // Nothing to patch, but the named entries still follow
+    CHECK(!cache.ApplyDirectoryDelta(delta));
+    CHECK(cache.GetDirectoryListing("/d") == nullptr);
+    auto info = cache.GetFileInfo("/d/new.txt");
+    CHECK(info && info->hash == "h");
+    CHECK(cache.IsMissing("/d/gone.txt"));
+}
+
+void TestMergeOrder() {
+    ContentCache cache;
+    cache.SetDirectoryListing("/d", MakeListing({"delta", "Bravo", "foxtrot"}));
+    CHECK((Names(cache, "/d") == std::vector<std::string>{"Bravo", "delta", "foxtrot"}));
+
+    DirectoryDelta delta;
+    delta.path = "/d";
+    for (const char* name : {"golf", "Echo", "alpha", "charlie"}) {
+        delta.upserts.push_back(MakeEntry(name, "new"));
+    }
+    CHECK(cache.ApplyDirectoryDelta(delta));
+    CHECK((Names(cache, "/d") ==
+           std::vector<std::string>{"alpha", "Bravo", "charlie", "delta", "Echo", "foxtrot", "golf"}));
+
+    DirectoryListingPtr listing = cache.GetDirectoryListing("/d");
+    CHECK(listing != nullptr);
+    if (listing) {
+        for (const char* name : {"alpha", "Bravo", "golf"}) {
+            CHECK(cache.FindEntry(*listing, name) != PackedListing::kNotFound);
+        }
+        CHECK(cache.FindEntry(*listing, "hotel") == PackedListing::kNotFound);
+    }
+}
+
+void TestTiesKeepOldEntryFirst() {
+    ContentCache cache;
+    cache.SetDirectoryListing("/d", MakeListing({"b", "name"}));
+
+    // Equal under the case-insensitive order, but not the same name
+    DirectoryDelta delta;
+    delta.path = "/d";
+    delta.upserts.push_back(MakeEntry("NAME", "new"));
+    delta.upserts.push_back(MakeEntry("Name", "new"));
+    CHECK(cache.ApplyDirectoryDelta(delta));
+    CHECK((Names(cache, "/d") == std::vector<std::string>{"b", "name", "NAME", "Name"}));
+}
+
+void TestReplaceAndRemove() {
+    ContentCache cache;
+    cache.SetDirectoryListing("/d", MakeListing({"a", "b", "c", "d"}));
+
+    DirectoryDelta delta;
+    delta.path = "/d";
+    delta.upserts.push_back(MakeEntry("b", "first", 10));
+    delta.upserts.push_back(MakeEntry("b", "second", 20));  // The last upsert of a name wins
+    delta.upserts.push_back(MakeEntry("e", "added"));
+    delta.upserts.push_back(MakeEntry("e", "added again"));
+    delta.upserts.push_back(MakeEntry("c", "removed anyway"));
+    delta.upserts.push_back(MakeEntry("f", "removed anyway"));
+    delta.removals.push_back("c");  // Removing a name wins over upserting it
+    delta.removals.push_back("f");
+    delta.removals.push_back("a");
+    delta.removals.push_back("not-there");
+    CHECK(cache.ApplyDirectoryDelta(delta));
+
+    CHECK((Names(cache, "/d") == std::vector<std::string>{"b", "d", "e"}));
+    DirectoryListingPtr listing = cache.GetDirectoryListing("/d");
+    if (listing && listing->Size() == 3) {
+        CHECK(listing->Hash(0) == "second" && listing->Entry(0).size == 20);
+        CHECK(listing->Hash(1) == "old-d");
+        CHECK(listing->Hash(2) == "added again");
+    }
+
+    CHECK(cache.IsMissing("/d/a"));
+    CHECK(cache.IsMissing("/d/c"));
+    CHECK(cache.IsMissing("/d/f") && !cache.GetFileInfo("/d/f"));
+    CHECK(!cache.GetFileInfo("/d/a"));
+    CHECK(!cache.IsMissing("/d/b"));
+    auto info = cache.GetFileInfo("/d/b");
+    CHECK(info && info->hash == "second");
+
+    // Emptying a listing leaves it cached, and empty
+    DirectoryDelta clear;
+    clear.path = "/d";
+    clear.removals = {"b", "d", "e"};
+    CHECK(cache.ApplyDirectoryDelta(clear));
+    listing = cache.GetDirectoryListing("/d");
+    CHECK(listing && listing->Size() == 0);
+}
+
+void TestContentFollowsHash() {
+    ContentCache cache;
+    cache.SetDirectoryListing("/d", MakeListing({"same", "changed"}));
+    const uint8_t bytes[] = {'x', 'y'};
+    cache.SetFileContent("/d/same", FileContent::Copy(bytes, sizeof(bytes)));
+    cache.SetFileContent("/d/changed", FileContent::Copy(bytes, sizeof(bytes)));
+
+    DirectoryDelta delta;
+    delta.path = "/d";
+    delta.upserts.push_back(MakeEntry("same", "old-same", 2));
+    delta.upserts.push_back(MakeEntry("changed", "other", 2));
+    CHECK(cache.ApplyDirectoryDelta(delta));
+    CHECK(cache.GetFileContent("/d/same") != nullptr);
+    CHECK(cache.GetFileContent("/d/changed") == nullptr);
+}
+
+// Random deltas against a model of what the listing should hold
+void TestAgainstModel() {
+    std::mt19937 random(17);
+    for (int round = 0; round < 200; round++) {
+        ContentCache cache;
+        DirectoryListing listing;
+        std::map<std::string, std::string> model;  // Name to hash
+        size_t count = random() % 200;
+        for (size_t i = 0; i < count; i++) {
+            std::string name = "f" + std::to_string(random() % 500) + (random() % 7 == 0 ? "\xc3\xa9" : "");
+            if (model.emplace(name, "old" + std::to_string(i)).second) {
+                listing.entries.push_back(MakeEntry(name, model[name]));
+            }
+        }
+        cache.SetDirectoryListing("/d", listing);
+
+        DirectoryDelta delta;
+        delta.path = "/d";
+        for (int i = 0; i < 30; i++) {
+            delta.upserts.push_back(MakeEntry("f" + std::to_string(random() % 500), "new" + std::to_string(i)));
+        }
+        for (int i = 0; i < 20; i++) {
+            delta.removals.push_back("f" + std::to_string(random() % 500));
+        }
+        std::map<std::string, std::string> upserts;
+        for (const auto& info : delta.upserts) {
+            upserts[info.name] = info.hash;
+        }
+        for (const auto& name : delta.removals) {
+            model.erase(name);
+            upserts.erase(name);
+        }
+        for (const auto& [name, hash] : upserts) {
+            model[name] = hash;
+        }
+
+        CHECK(cache.ApplyDirectoryDelta(delta));
+        DirectoryListingPtr patched = cache.GetDirectoryListing("/d");
+        if (!CHECK(patched && patched->Size() == model.size())) {
+            continue;
+        }
+        for (size_t i = 0; i < patched->Size(); i++) {
+            auto expected = model.find(std::string(patched->Name(i)));
+            CHECK(expected != model.end() && expected->second == patched->Hash(i));
+            CHECK(i == 0 || CompareNamesIgnoringCase(patched->Name(i - 1), patched->Name(i)) <= 0);
+            CHECK(cache.FindEntry(*patched, patched->Name(i)) == i);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    TestUncachedListing();
+    TestMergeOrder();
+    TestTiesKeepOldEntryFirst();
+    TestReplaceAndRemove();
+    TestContentFollowsHash();
+    TestAgainstModel();
+    return test::CheckResult();
+}
@@ -0,0 +1,171 @@
+// Metadata snapshots: listings survive a write and reopen, and Open refuses
+// files that are missing, malformed, of another version or taken against
+// other heads.
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "metadata_snapshot.h"
+
+using namespace oneifsprojfs;
+
+namespace {
+
+constexpr uint64_t kHeads = 0x0123456789ABCDEFULL;
+
+DirectoryUpdate MakeDirectory(const std::string& path, std::initializer_list<const char*> names) {
+    DirectoryUpdate update;
+    update.path = path;
+    for (const char* name : names) {
+        FileInfo info = {};
+        info.name = name;
+        info.hash = std::string(64, 'b');
+        info.size = 12;
+        info.isBlobOrClob = true;
+        info.mode = 0100644;
+        update.listing.entries.push_back(std::move(info));
+    }
+    return update;
+}
+
+std::vector<uint8_t> ReadBytes(const std::filesystem::path& file) {
+    std::ifstream in(file, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void WriteBytes(const std::filesystem::path& file, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+void WriteU32(std::vector<uint8_t>& bytes, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        bytes[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+bool Rejected(const std::filesystem::path& file, uint64_t fingerprint) {
+    std::string error;
+    auto snapshot = MetadataSnapshot::Open(file, fingerprint, error);
+    CHECK(snapshot || !error.empty());
+    return !snapshot;
+}
+
+// Writes a snapshot of three directories, in an order Write has to sort and
+// with a duplicate path it has to drop
+std::vector<uint8_t> WriteSample(const std::filesystem::path& file) {
+    std::vector<DirectoryUpdate> directories;
+    directories.push_back(MakeDirectory("/chats", {"a.txt", "b.txt"}));
+    directories.push_back(MakeDirectory("/", {"chats", "objects"}));
+    directories.push_back(MakeDirectory("/chats", {"stale.txt"}));
+    directories.push_back(MakeDirectory("/objects", {}));
+    std::string error;
+    CHECK(MetadataSnapshot::Write(file, kHeads, directories, error));
+    CHECK(!std::filesystem::exists(std::filesystem::path(file).concat(".tmp")));
+    return ReadBytes(file);
+}
+
+void TestRoundTrip(const std::filesystem::path& file) {
+    WriteSample(file);
+    std::string error;
+    auto snapshot = MetadataSnapshot::Open(file, kHeads, error);
+    CHECK(snapshot != nullptr);
+    if (!snapshot) {
+        return;
+    }
+    CHECK(snapshot->Fingerprint() == kHeads);
+    CHECK(snapshot->DirectoryCount() == 3);
+
+    DirectoryUpdate update;
+    CHECK(snapshot->Read("/chats", update));
+    CHECK(update.listing.entries.size() == 2);  // The first of the duplicates wins
+    CHECK(!update.listing.entries.empty() && update.listing.entries[0].name == "a.txt");
+    CHECK(snapshot->Read("/objects", update) && update.listing.entries.empty());
+    CHECK(!snapshot->Read("/missing", update));
+    CHECK(!snapshot->Read("/chat", update));
+
+    // Taken and discarded directories are handed out once at most
+    CHECK(snapshot->Take("/", update) && update.path == "/");
+    CHECK(!snapshot->Take("/", update));
+    CHECK(snapshot->Read("/", update));
+    snapshot->Discard("/objects");
+    CHECK(!snapshot->Take("/objects", update));
+
+    std::vector<DirectoryUpdate> remaining;
+    snapshot->CollectRemaining(remaining);
+    CHECK(remaining.size() == 1 && remaining[0].path == "/chats");
+}
+
+void TestMissingAndEmpty(const std::filesystem::path& file) {
+    std::filesystem::remove(file);
+    CHECK(Rejected(file, kHeads));
+
+    WriteBytes(file, {});
+    CHECK(Rejected(file, kHeads));
+
+    WriteBytes(file, std::vector<uint8_t>(MetadataSnapshot::kHeaderSize - 1, 0));
+    CHECK(Rejected(file, kHeads));
+}
+
+void TestHeader(const std::filesystem::path& file) {
+    std::vector<uint8_t> good = WriteSample(file);
+    CHECK(good.size() > MetadataSnapshot::kHeaderSize);
+
+    std::vector<uint8_t> badMagic = good;
+    badMagic[0] ^= 0xFF;
+    WriteBytes(file, badMagic);
+    CHECK(Rejected(file, kHeads));
+    CHECK(Rejected(file, MetadataSnapshot::kAnyFingerprint));
+
+    for (uint32_t version : {MetadataSnapshot::kVersion - 1, MetadataSnapshot::kVersion + 1}) {
+        std::vector<uint8_t> otherVersion = good;
+        WriteU32(otherVersion, 4, version);
+        WriteBytes(file, otherVersion);
+        CHECK(Rejected(file, kHeads));
+        CHECK(Rejected(file, MetadataSnapshot::kAnyFingerprint));
+    }
+
+    // A payload shorter or longer than the header says
+    std::vector<uint8_t> truncated(good.begin(), good.end() - 1);
+    WriteBytes(file, truncated);
+    CHECK(Rejected(file, kHeads));
+
+    std::vector<uint8_t> padded = good;
+    padded.push_back(0);
+    WriteBytes(file, padded);
+    CHECK(Rejected(file, kHeads));
+
+    // A payload whose length matches but which is not a tree batch
+    std::vector<uint8_t> badPayload = good;
+    badPayload[MetadataSnapshot::kHeaderSize] ^= 0xFF;
+    WriteBytes(file, badPayload);
+    CHECK(Rejected(file, kHeads));
+}
+
+void TestFingerprint(const std::filesystem::path& file) {
+    WriteSample(file);
+    CHECK(Rejected(file, kHeads + 1));
+
+    std::string error;
+    auto snapshot = MetadataSnapshot::Open(file, MetadataSnapshot::kAnyFingerprint, error);
+    CHECK(snapshot && snapshot->Fingerprint() == kHeads);
+}
+
+} // namespace
+
+int main() {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "metadata_snapshot_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::path file = directory / "snapshot.bin";
+
+    TestRoundTrip(file);
+    TestMissingAndEmpty(file);
+    TestHeader(file);
+    TestFingerprint(file);
+
+    std::filesystem::remove_all(directory);
+    return test::CheckResult();
+}
@@ -0,0 +1,221 @@
+// ObjectIndex: snapshots walk the large and small runs as one sorted list,
+// before and after they are merged, and resume from any key.
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "object_index.h"
+
+using namespace oneifsprojfs;
+
+namespace {
+
+using Key = ObjectIndex::Key;
+
+Key MakeKey(uint64_t value) {
+    // Spread over the high word too, so ordering is not decided by one word
+    return Key{value * 0x9E3779B97F4A7C15ULL, value, 0, value};
+}
+
+std::vector<Key> Walk(const ObjectIndex::Snapshot& snapshot, const Key* after = nullptr) {
+    std::vector<Key> keys;
+    ObjectIndex::Snapshot::Cursor cursor = snapshot.After(after);
+    Key key;
+    while (snapshot.Next(cursor, key)) {
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+std::vector<Key> Sorted(const std::set<Key>& keys) {
+    return std::vector<Key>(keys.begin(), keys.end());
+}
+
+void TestEmpty() {
+    ObjectIndex index;
+    CHECK(!index.Ready());
+    CHECK(index.Size() == 0);
+    CHECK(Walk(index.Take()).empty());
+    CHECK(!index.Remove(MakeKey(1)));
+
+    index.Publish({});
+    CHECK(index.Ready());
+    CHECK(index.Take().Size() == 0);
+}
+
+void TestPublishSortsAndDeduplicates() {
+    ObjectIndex index;
+    index.Publish({MakeKey(3), MakeKey(1), MakeKey(2), MakeKey(1)});
+    std::set<Key> expected = {MakeKey(1), MakeKey(2), MakeKey(3)};
+    CHECK(index.Size() == 3);
+    CHECK(Walk(index.Take()) == Sorted(expected));
+    CHECK(!index.Insert(MakeKey(2)));
+}
+
+void TestAcrossRuns() {
+    ObjectIndex index;
+    std::set<Key> expected;
+    std::vector<Key> scan;
+    for (uint64_t i = 0; i < 1000; i += 2) {
+        scan.push_back(MakeKey(i));
+        expected.insert(MakeKey(i));
+    }
+    index.Publish(scan);
+
+    // Odd keys land in the small run, interleaved with the large one
+    for (uint64_t i = 1; i < 200; i += 2) {
+        CHECK(index.Insert(MakeKey(i)));
+        expected.insert(MakeKey(i));
+    }
+    CHECK(!index.Insert(MakeKey(1)));
+    CHECK(!index.Insert(MakeKey(2)));
+
+    ObjectIndex::Snapshot snapshot = index.Take();
+    CHECK(snapshot.Size() == expected.size());
+    CHECK(Walk(snapshot) == Sorted(expected));
+    CHECK(snapshot.Contains(MakeKey(1)) && snapshot.Contains(MakeKey(2)));
+    CHECK(!snapshot.Contains(MakeKey(201)));
+
+    // Resuming after any key, present or not, continues from the next larger one
+    for (uint64_t i : {1, 2, 199, 201, 998, 5000}) {
+        Key key = MakeKey(i);
+        std::vector<Key> rest(expected.upper_bound(key), expected.end());
+        CHECK(Walk(snapshot, &key) == rest);
+    }
+
+    // Removal from either run
+    CHECK(index.Remove(MakeKey(3)));
+    CHECK(index.Remove(MakeKey(4)));
+    CHECK(!index.Remove(MakeKey(3)));
+    expected.erase(MakeKey(3));
+    expected.erase(MakeKey(4));
+    CHECK(Walk(index.Take()) == Sorted(expected));
+
+    // The snapshot taken before still sees the keys as they were
+    CHECK(snapshot.Contains(MakeKey(3)) && snapshot.Contains(MakeKey(4)));
+}
+
+void TestCompaction() {
+    ObjectIndex index;
+    std::set<Key> expected;
+    for (uint64_t i = 0; i < 100; i++) {
+        expected.insert(MakeKey(i * 3));
+    }
+    index.Publish(Sorted(expected));
+
+    // One insertion past the threshold merges the small run into the large one
+    ObjectIndex::Snapshot beforeMerge;
+    for (uint64_t i = 0; i <= ObjectIndex::kMergeThreshold; i++) {
+        if (i == ObjectIndex::kMergeThreshold) {
+            beforeMerge = index.Take();
+        }
+        Key key = MakeKey(1000 + i);
+        CHECK(index.Insert(key));
+        expected.insert(key);
+    }
+    CHECK(index.Size() == expected.size());
+    ObjectIndex::Snapshot afterMerge = index.Take();
+    CHECK(Walk(afterMerge) == Sorted(expected));
+    for (const Key& key : expected) {
+        CHECK(afterMerge.Contains(key));
+    }
+
+    std::set<Key> beforeExpected = expected;
+    beforeExpected.erase(MakeKey(1000 + ObjectIndex::kMergeThreshold));
+    CHECK(Walk(beforeMerge) == Sorted(beforeExpected));
+
+    // Cursors taken on the merged runs hand out the rest in order
+    const Key* middle = &*std::next(expected.begin(), static_cast<std::ptrdiff_t>(expected.size() / 2));
+    std::vector<Key> rest(expected.upper_bound(*middle), expected.end());
+    CHECK(Walk(afterMerge, middle) == rest);
+
+    // Insertions after the merge start a new small run
+    CHECK(index.Insert(MakeKey(1)));
+    expected.insert(MakeKey(1));
+    CHECK(index.Remove(MakeKey(0)));
+    expected.erase(MakeKey(0));
+    CHECK(Walk(index.Take()) == Sorted(expected));
+}
+
+void TestPublishKeepsRecentInserts() {
+    ObjectIndex index;
+    index.Publish({MakeKey(1), MakeKey(2)});
+    CHECK(index.Insert(MakeKey(3)));
+
+    // A rescan that raced the insertion does not lose it, and replaces the rest
+    index.Publish({MakeKey(2), MakeKey(4)});
+    std::set<Key> expected = {MakeKey(2), MakeKey(3), MakeKey(4)};
+    CHECK(Walk(index.Take()) == Sorted(expected));
+
+    // After the rescan the small run is empty again
+    index.Publish({MakeKey(5)});
+    CHECK(Walk(index.Take()) == std::vector<Key>{MakeKey(5)});
+}
+
+// Random insertions and removals against a std::set, crossing the merge
+// threshold several times
+void TestAgainstModel() {
+    std::mt19937_64 random(26);
+    ObjectIndex index;
+    std::set<Key> model;
+    std::vector<Key> scan;
+    for (int i = 0; i < 2000; i++) {
+        Key key = MakeKey(random() % 50000);
+        scan.push_back(key);
+        model.insert(key);
+    }
+    index.Publish(scan);
+
+    for (int i = 0; i < 20000; i++) {
+        Key key = MakeKey(random() % 50000);
+        if (random() % 4 == 0) {
+            CHECK(index.Remove(key) == (model.erase(key) == 1));
+        } else {
+            CHECK(index.Insert(key) == model.insert(key).second);
+        }
+        if (i % 2500 == 0) {
+            CHECK(Walk(index.Take()) == Sorted(model));
+        }
+    }
+    CHECK(index.Size() == model.size());
+    CHECK(Walk(index.Take()) == Sorted(model));
+}
+
+void TestNames() {
+    Key key = MakeKey(0xABCDEF);
+    std::string name = ObjectIndex::Name(key);
+    CHECK(name.size() == ObjectIndex::kNameLength);
+    CHECK(name.find_first_not_of("0123456789abcdef") == std::string::npos);
+
+    Key parsed;
+    CHECK(ObjectInfoTable::ParseKey(name, parsed) && parsed == key);
+
+    wchar_t wide[ObjectIndex::kNameLength + 1];
+    ObjectIndex::FormatName(key, wide);
+    CHECK(std::wstring(wide) == std::wstring(name.begin(), name.end()));
+
+    // Key order is name order
+    Key smaller = MakeKey(7);
+    Key larger = MakeKey(8);
+    if (larger < smaller) {
+        std::swap(smaller, larger);
+    }
+    CHECK(ObjectIndex::Name(smaller) < ObjectIndex::Name(larger));
+}
+
+} // namespace
+
+int main() {
+    TestEmpty();
+    TestPublishSortsAndDeduplicates();
+    TestAcrossRuns();
+    TestCompaction();
+    TestPublishKeepsRecentInserts();
+    TestAgainstModel();
+    TestNames();
+    return test::CheckResult();
+}
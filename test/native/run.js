@@ -0,0 +1,36 @@
+#!/usr/bin/env node
+
+/**
+ * Runs every native test built by `node-gyp rebuild --directory=test/native`
+ * and exits non-zero if any of them fails.
+ */
+
+import fs from 'fs';
+import path from 'path';
+import { spawnSync } from 'child_process';
+import { fileURLToPath } from 'url';
+
+const __dirname = path.dirname(fileURLToPath(import.meta.url));
+const BUILD_DIR = path.join(__dirname, 'build', 'Release');
+
+const tests = fs.readdirSync(BUILD_DIR)
+    .filter(name => /_test(\.exe)?$/.test(name))
+    .sort();
+
+if (tests.length === 0) {
+    console.error(`No native tests in ${BUILD_DIR}`);
+    process.exit(1);
+}
+
+let failed = 0;
+for (const test of tests) {
+    const result = spawnSync(path.join(BUILD_DIR, test), { stdio: 'inherit' });
+    const passed = result.status === 0;
+    console.log(`${passed ? 'PASS' : 'FAIL'} ${test}`);
+    if (!passed) {
+        failed++;
+    }
+}
+
+console.log(`${tests.length - failed}/${tests.length} native tests passed`);
+process.exit(failed === 0 ? 0 : 1);
@@ -0,0 +1,210 @@
+// Decoding of setCachedTree buffers: well-formed batches round-trip, and every
+// malformed one is rejected without touching the caller's directories.
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "tree_batch.h"
+
+using namespace oneifsprojfs;
+
+namespace {
+
+FileInfo MakeEntry(const std::string& name, bool isDirectory, uint64_t size = 0) {
+    FileInfo info = {};
+    info.name = name;
+    info.hash = isDirectory ? std::string() : std::string(64, 'a');
+    info.size = static_cast<size_t>(size);
+    info.isDirectory = isDirectory;
+    info.isBlobOrClob = !isDirectory;
+    info.mode = isDirectory ? 040755 : 0100644;
+    info.mtime = 1700000000123ULL;
+    return info;
+}
+
+std::vector<DirectoryUpdate> TwoDirectories() {
+    DirectoryUpdate root;
+    root.path = "/";
+    root.listing.entries.push_back(MakeEntry("objects", true));
+    root.listing.entries.push_back(MakeEntry("chats", true));
+
+    DirectoryUpdate chats;
+    chats.path = "/chats";
+    chats.listing.entries.push_back(MakeEntry("large.bin", false, 5ULL << 30));
+    return {root, chats};
+}
+
+void WriteU32(std::vector<uint8_t>& buffer, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        buffer[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+size_t DirectoryRecord(uint32_t index) {
+    return tree_batch::kHeaderSize + index * tree_batch::kDirectoryRecordSize;
+}
+
+size_t EntryRecord(uint32_t directoryCount, uint32_t index) {
+    return DirectoryRecord(directoryCount) + index * tree_batch::kEntryRecordSize;
+}
+
+// Decodes into a list that already holds one directory, which a failed decode
+// must leave alone
+bool DecodeRejected(const std::vector<uint8_t>& buffer, size_t size) {
+    std::vector<DirectoryUpdate> directories(1);
+    directories[0].path = "/existing";
+    std::string error;
+    bool decoded = tree_batch::Decode(buffer.data(), size, directories, error);
+    CHECK(directories.size() == 1 && directories[0].path == "/existing");
+    CHECK(decoded || !error.empty());
+    return !decoded;
+}
+
+void TestRoundTrip() {
+    std::vector<uint8_t> buffer;
+    tree_batch::Encode(TwoDirectories(), buffer);
+
+    std::vector<DirectoryUpdate> directories;
+    std::string error;
+    CHECK(tree_batch::Decode(buffer.data(), buffer.size(), directories, error));
+    CHECK(directories.size() == 2);
+    if (directories.size() != 2) {
+        return;
+    }
+    CHECK(directories[0].path == "/");
+    CHECK(directories[0].listing.entries.size() == 2);
+    CHECK(directories[0].listing.entries[1].name == "chats");
+    CHECK(directories[0].listing.entries[1].isDirectory);
+
+    CHECK(directories[1].path == "/chats");
+    CHECK(directories[1].listing.entries.size() == 1);
+    const FileInfo& large = directories[1].listing.entries[0];
+    CHECK(large.name == "large.bin");
+    CHECK(large.hash == std::string(64, 'a'));
+    CHECK(static_cast<uint64_t>(large.size) == (5ULL << 30));
+    CHECK(large.isBlobOrClob && !large.isDirectory);
+    CHECK(large.mode == 0100644);
+    CHECK(large.mtime == 1700000000123ULL);
+}
+
+void TestBadMagic() {
+    std::vector<uint8_t> buffer;
+    tree_batch::Encode(TwoDirectories(), buffer);
+    std::memcpy(buffer.data(), "PJT1", 4);
+    CHECK(DecodeRejected(buffer, buffer.size()));
+
+    tree_batch::View view;
+    std::string error;
+    CHECK(!view.Open(buffer.data(), buffer.size(), error));
+}
+
+void TestTruncated() {
+    std::vector<uint8_t> buffer;
+    tree_batch::Encode(TwoDirectories(), buffer);
+
+    // Shorter than the header, then every cut inside the records and strings
+    for (size_t size = 0; size < buffer.size(); size++) {
+        CHECK(DecodeRejected(buffer, size));
+    }
+
+    // Trailing bytes the header does not account for
+    std::vector<uint8_t> padded = buffer;
+    padded.push_back(0);
+    CHECK(DecodeRejected(padded, padded.size()));
+}
+
+void TestHostileCounts() {
+    // Counts whose 32-bit product would wrap back to the buffer size
+    std::vector<uint8_t> buffer(tree_batch::kHeaderSize, 0);
+    WriteU32(buffer, 0, tree_batch::kMagic);
+    WriteU32(buffer, 4, 0x10000000);  // 0x10000000 * 16 wraps to 0 in 32 bits
+    CHECK(DecodeRejected(buffer, buffer.size()));
+}
+
+void TestOverlappingRuns() {
+    std::vector<uint8_t> buffer;
+    tree_batch::Encode(TwoDirectories(), buffer);
+
+    // The second directory claims the first directory's entries
+    std::vector<uint8_t> overlapping = buffer;
+    WriteU32(overlapping, DirectoryRecord(1) + 8, 1);
+    CHECK(DecodeRejected(overlapping, overlapping.size()));
+
+    // Runs out of order overlap as well, even when each is in range alone
+    std::vector<uint8_t> reordered = buffer;
+    WriteU32(reordered, DirectoryRecord(0) + 8, 2);
+    WriteU32(reordered, DirectoryRecord(0) + 12, 1);
+    WriteU32(reordered, DirectoryRecord(1) + 8, 0);
+    WriteU32(reordered, DirectoryRecord(1) + 12, 2);
+    CHECK(DecodeRejected(reordered, reordered.size()));
+
+    // The View reads each directory on its own and has no such rule
+    tree_batch::View view;
+    std::string error;
+    CHECK(view.Open(reordered.data(), reordered.size(), error));
+    DirectoryUpdate update;
+    CHECK(view.ReadDirectory(1, update, error));
+    CHECK(update.listing.entries.size() == 2);
+}
+
+void TestRecordsOutOfRange() {
+    std::vector<uint8_t> buffer;
+    tree_batch::Encode(TwoDirectories(), buffer);
+    const uint32_t directoryCount = 2;
+    const uint32_t entryCount = 3;
+
+    std::vector<uint8_t> entriesPastEnd = buffer;
+    WriteU32(entriesPastEnd, DirectoryRecord(1) + 8, entryCount);
+    WriteU32(entriesPastEnd, DirectoryRecord(1) + 12, 1);
+    CHECK(DecodeRejected(entriesPastEnd, entriesPastEnd.size()));
+
+    // firstEntry + count would wrap in 32 bits
+    std::vector<uint8_t> wrappingCount = buffer;
+    WriteU32(wrappingCount, DirectoryRecord(1) + 12, UINT32_MAX);
+    CHECK(DecodeRejected(wrappingCount, wrappingCount.size()));
+
+    std::vector<uint8_t> pathPastEnd = buffer;
+    WriteU32(pathPastEnd, DirectoryRecord(0) + 4, UINT32_MAX);
+    CHECK(DecodeRejected(pathPastEnd, pathPastEnd.size()));
+
+    std::vector<uint8_t> namePastEnd = buffer;
+    WriteU32(namePastEnd, EntryRecord(directoryCount, 2), UINT32_MAX);
+    CHECK(DecodeRejected(namePastEnd, namePastEnd.size()));
+
+    std::vector<uint8_t> hashPastEnd = buffer;
+    WriteU32(hashPastEnd, EntryRecord(directoryCount, 2) + 12, UINT32_MAX);
+    CHECK(DecodeRejected(hashPastEnd, hashPastEnd.size()));
+
+    tree_batch::View view;
+    std::string error;
+    CHECK(view.Open(buffer.data(), buffer.size(), error));
+    std::string_view path;
+    CHECK(!view.DirectoryPath(directoryCount, path));
+    DirectoryUpdate update;
+    CHECK(!view.ReadDirectory(directoryCount, update, error));
+}
+
+void TestInvalidNames() {
+    for (const char* name : {"", "a/b", "a\\b"}) {
+        DirectoryUpdate directory;
+        directory.path = "/";
+        directory.listing.entries.push_back(MakeEntry(name, false));
+        std::vector<uint8_t> buffer;
+        tree_batch::Encode({directory}, buffer);
+        CHECK(DecodeRejected(buffer, buffer.size()));
+    }
+}
+
+} // namespace
+
+int main() {
+    TestRoundTrip();
+    TestBadMagic();
+    TestTruncated();
+    TestHostileCounts();
+    TestOverlappingRuns();
+    TestRecordsOutOfRange();
+    TestInvalidNames();
+    return test::CheckResult();
+}